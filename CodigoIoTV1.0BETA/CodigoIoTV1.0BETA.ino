@@ -25,7 +25,7 @@ const char* topicTX = "ucol/iot/sensores";
 #define BUT_CARRUSEL 2
 
 bool bombaManual = false;
-String modo = "manual"; // Por defecto, inicia en modo manual
+const char *modo = "manual"; // Por defecto, inicia en modo manual; siempre apunta a un literal
 int pantallaActual = 0;
 unsigned long lastButtonPress = 0;
 unsigned long lastPublishTime = 0; // Variable para controlar el tiempo de publicación
@@ -118,13 +118,9 @@ void loop() {
 
 // Función de callback MQTT
 void callback(char* topic, byte* payload, unsigned int length) {
-    String message;
-    for (unsigned int i = 0; i < length; i++) {
-        message += (char)payload[i];
-    }
-
+    // Se interpreta directamente del buffer de PubSubClient, sin copiarlo a un String
     StaticJsonDocument<256> doc;
-    DeserializationError error = deserializeJson(doc, message);
+    DeserializationError error = deserializeJson(doc, payload, length);
 
     if (error) {
         Serial.println("Error al parsear JSON");
@@ -143,11 +139,14 @@ void callback(char* topic, byte* payload, unsigned int length) {
             humedadSueloUmbral = doc["humedadSuelo"];
         }
         Serial.println("Umbrales actualizados:");
-        Serial.println("Nivel de luz: " + String(nivelLuzUmbral));
-        Serial.println("Humedad del suelo: " + String(humedadSueloUmbral));
+        Serial.print("Nivel de luz: ");
+        Serial.println(nivelLuzUmbral);
+        Serial.print("Humedad del suelo: ");
+        Serial.println(humedadSueloUmbral);
     }
 
-    Serial.println("Modo actualizado: " + modo);
+    Serial.print("Modo actualizado: ");
+    Serial.println(modo);
 }
 
 // Control del riego con condición base
@@ -159,10 +158,10 @@ void controlarRiego() {
     }
 
     // Condicionales para los modos manual y automático
-    if (modo == "manual") {
+    if (strcmp(modo, "manual") == 0) {
         bombaManualboton(); // Controla el riego con el botón
         digitalWrite(RELAY1_PIN, bombaManual ? HIGH : LOW);
-    } else if (modo == "auto") {
+    } else if (strcmp(modo, "auto") == 0) {
         if (ldrValue < nivelLuzUmbral || humidity < humedadSueloUmbral) {
             digitalWrite(RELAY1_PIN, HIGH);
         } else {
@@ -260,11 +259,12 @@ float obtener_distancia() {
 
     digitalWrite(TRIGGER, LOW);
 
-    return (pulseIn(ECHO, HIGH) * VELOCIDAD_SONIDO / 2);
+    // Sin eco, pulseIn esperaría 1 s por defecto; 30 ms cubren el rango del sensor
+    return (pulseIn(ECHO, HIGH, 30000) * VELOCIDAD_SONIDO / 2);
 }
 
 // Función para guardar datos en la SD
-void guardarEnSD(const String& jsonString) {
+void guardarEnSD(const char* jsonString) {
     File file = SD.open("/datalog.json", FILE_APPEND);
     if (file) {
         file.println(jsonString);
@@ -280,9 +280,15 @@ void enviarDatos() {
     if (millis() - lastPublishTime > 5000) { // Publicar cada 5 segundos
         DateTime now = rtc.now();
 
+        // Fecha y hora en buffers fijos para no crear Strings temporales
+        char fecha[12];
+        char hora[9];
+        snprintf(fecha, sizeof(fecha), "%d/%d/%d", now.day(), now.month(), now.year());
+        snprintf(hora, sizeof(hora), "%d:%d:%d", now.hour(), now.minute(), now.second());
+
         StaticJsonDocument<512> doc;
-        doc["fecha"] = String(now.day()) + "/" + String(now.month()) + "/" + String(now.year());
-        doc["hora"] = String(now.hour()) + ":" + String(now.minute()) + ":" + String(now.second());
+        doc["fecha"] = fecha;
+        doc["hora"] = hora;
         doc["timestamp"] = now.unixtime();
         doc["temperaturaAmbiente"] = temperature;
         doc["humedadAmbiente"] = humidity;
@@ -290,11 +296,15 @@ void enviarDatos() {
         doc["iluminacion"] = ldrValue;
         doc["nivelAgua"] = nivelAgua;
 
-        String jsonString;
-        serializeJson(doc, jsonString);
+        char jsonString[256];
+        if (serializeJson(doc, jsonString, sizeof(jsonString)) >= sizeof(jsonString) - 1) {
+            Serial.println("JSON truncado, la muestra no se publica");
+            lastPublishTime = millis();
+            return;
+        }
 
         if (MQTTHandler::isMQTTConnected()) {
-            MQTTHandler::publishMessage(topicTX, jsonString.c_str());
+            MQTTHandler::publishMessage(topicTX, jsonString);
             Serial.println("Datos publicados en MQTT");
         } else {
             Serial.println("No se pudo publicar. MQTT no está conectado.");
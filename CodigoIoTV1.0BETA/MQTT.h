@@ -20,6 +20,12 @@ PubSubClient mqttClient(espClient);
 
 const char* topicRX = "ucol/iot/config";
 
+// Reintentos de MQTT sin bloquear loop(): espera creciente entre intentos
+#define MQTT_RETRY_MIN 1000
+#define MQTT_RETRY_MAX 60000
+unsigned long nextMQTTAttempt = 0;
+unsigned long mqttRetryDelay = MQTT_RETRY_MIN;
+
 class MQTTHandler {
   public:
     static void startConnections();
@@ -34,20 +40,16 @@ class MQTTHandler {
 void MQTTHandler::startConnections() {
     connectWiFi();
     mqttClient.setServer(mqtt_server, MQTT_PORT);
+    mqttClient.setSocketTimeout(2);
     Serial.println("Iniciando conexiones MQTT y WiFi...");
 }
 
 void MQTTHandler::connectWiFi() {
+    // El ESP32 termina de conectarse (y se reconecta) por su cuenta; no se espera aquí
     Serial.print("Conectando a WiFi: ");
     Serial.println(ssid);
+    WiFi.setAutoReconnect(true);
     WiFi.begin(ssid, password);
-    while (WiFi.status() != WL_CONNECTED) {
-        Serial.print(".");
-        delay(1000);
-    }
-    Serial.println("\nWiFi conectado.");
-    Serial.print("Dirección IP: ");
-    Serial.println(WiFi.localIP());
 }
 
 bool MQTTHandler::isWiFiConnected() {
@@ -66,17 +68,26 @@ bool MQTTHandler::isMQTTConnected() {
 }
 
 void MQTTHandler::reconnectMQTT() {
-    if (!isMQTTConnected()) {
-        Serial.print("Intentando conectar a MQTT...");
-        if (mqttClient.connect("IoTRiegoAutoMKUltra")) {
-            Serial.println("Conectado a MQTT.");
-            mqttClient.subscribe(topicRX);
-            Serial.println("Suscrito al topic ucol/iot/confs.");
-        } else {
-            Serial.print("Error de conexión MQTT. Código: ");
-            Serial.println(mqttClient.state());
-            delay(5000);
-        }
+    if (isMQTTConnected() || (long)(millis() - nextMQTTAttempt) < 0) {
+        return;
+    }
+    if (!isWiFiConnected()) {
+        nextMQTTAttempt = millis() + MQTT_RETRY_MIN;
+        return;
+    }
+
+    Serial.print("Intentando conectar a MQTT...");
+    if (mqttClient.connect("IoTRiegoAutoMKUltra")) {
+        Serial.println("Conectado a MQTT.");
+        mqttClient.subscribe(topicRX);
+        Serial.println("Suscrito al topic ucol/iot/confs.");
+        mqttRetryDelay = MQTT_RETRY_MIN;
+    } else {
+        Serial.print("Error de conexión MQTT. Código: ");
+        Serial.println(mqttClient.state());
+        // En lugar de delay(5000): se programa el siguiente intento con variación aleatoria
+        nextMQTTAttempt = millis() + mqttRetryDelay / 2 + random(mqttRetryDelay / 2);
+        mqttRetryDelay = min(mqttRetryDelay * 2, (unsigned long)MQTT_RETRY_MAX);
     }
 }
 
@@ -0,0 +1,178 @@
+/*
+  Simulación del planificador de sensores con un reloj virtual.
+
+  Los controladores simulados sólo avanzan el reloj lo que tarda cada lectura
+  en el ESP32 (el DHT11 ~25 ms, el ADC ~100 us). Se compara la lectura
+  monolítica anterior (todos los sensores seguidos cada 5 s) contra
+  SensorScheduler: lecturas de cada sensor, hueco máximo entre dos lecturas
+  seguidas, antigüedad máxima del dato en una muestra y el bloqueo más largo
+  de una vuelta de la tarea.
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o bench_planificador bench_planificador.cpp
+  Uso:
+    ./bench_planificador [segundos simulados]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "SensorScheduler.h"
+
+#define SNAPSHOT_INTERVAL 5000 // SENSOR_READ_INTERVAL de DualCore.h
+#define LOOP_TICK 100          // Vuelta de la tarea con la lectura monolítica
+
+static uint64_t virtualUs = 0;
+
+static uint32_t virtualMillis(void) { return (uint32_t)(virtualUs / 1000); }
+static uint32_t virtualMicros(void) { return (uint32_t)virtualUs; }
+
+struct SimSensor
+{
+  const char *name;
+  uint32_t periodMs;
+  uint32_t deadlineMs;
+  uint32_t costUs;
+  uint32_t lastReadMs;
+  uint32_t maxAgeMs;
+  uint32_t reads;
+  uint32_t maxGapMs;
+};
+
+// Mismos periodos y costos que IrrigationControl::registerSensors
+static SimSensor sensors[] = {
+    {"luz", 500, 100, 100, 0, 0, 0, 0},
+    {"suelo1", 1000, 200, 100, 0, 0, 0, 0},
+    {"suelo2", 1000, 200, 100, 0, 0, 0, 0},
+    {"dht", 2000, 1000, 25000, 0, 0, 0, 0},
+    {"agua", 100, 50, 50, 0, 0, 0, 0},
+    {"rtc", 1000, 500, 1000, 0, 0, 0, 0},
+};
+static const uint8_t SENSOR_COUNT = sizeof(sensors) / sizeof(sensors[0]);
+
+static void simRead(void *context)
+{
+  SimSensor *s = (SimSensor *)context;
+  virtualUs += s->costUs;
+  uint32_t now = virtualMillis();
+  if (s->reads > 0 && now - s->lastReadMs > s->maxGapMs)
+    s->maxGapMs = now - s->lastReadMs;
+  s->lastReadMs = now;
+  s->reads++;
+}
+
+static void takeSnapshot(void)
+{
+  uint32_t now = virtualMillis();
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+  {
+    uint32_t age = now - sensors[i].lastReadMs;
+    if (age > sensors[i].maxAgeMs)
+      sensors[i].maxAgeMs = age;
+  }
+}
+
+static void resetSensors(void)
+{
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+  {
+    sensors[i].lastReadMs = 0;
+    sensors[i].maxAgeMs = 0;
+    sensors[i].reads = 0;
+    sensors[i].maxGapMs = 0;
+  }
+}
+
+static void printAges(void)
+{
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+    printf("    %-7s lecturas %6u, hueco máx %5u ms, antigüedad máx %5u ms (periodo %u ms)\n",
+           sensors[i].name, (unsigned)sensors[i].reads, (unsigned)sensors[i].maxGapMs,
+           (unsigned)sensors[i].maxAgeMs, (unsigned)sensors[i].periodMs);
+}
+
+static void runMonolithic(uint32_t seconds)
+{
+  resetSensors();
+  virtualUs = 0;
+  uint32_t lastRead = 0;
+  uint64_t worstPassUs = 0;
+  uint64_t end = (uint64_t)seconds * 1000000;
+
+  // Con la tarea anterior el ultrasónico sí se servía cada vuelta
+  while (virtualUs < end)
+  {
+    uint64_t passStart = virtualUs;
+    simRead(&sensors[4]);
+    if (virtualMillis() - lastRead >= SNAPSHOT_INTERVAL)
+    {
+      lastRead = virtualMillis();
+      for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+        if (i != 4)
+          simRead(&sensors[i]);
+      takeSnapshot();
+    }
+    if (virtualUs - passStart > worstPassUs)
+      worstPassUs = virtualUs - passStart;
+    virtualUs += LOOP_TICK * 1000;
+  }
+
+  printf("Lectura monolítica cada %d ms\n", SNAPSHOT_INTERVAL);
+  printf("  vuelta más larga: %llu us\n", (unsigned long long)worstPassUs);
+  printAges();
+}
+
+static void runScheduler(uint32_t seconds)
+{
+  resetSensors();
+  virtualUs = 0;
+  SensorScheduler scheduler(virtualMillis, virtualMicros);
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++)
+    scheduler.add(sensors[i].name, sensors[i].periodMs, sensors[i].deadlineMs, sensors[i].costUs,
+                  simRead, &sensors[i]);
+
+  uint32_t lastSnapshot = 0;
+  uint64_t worstPassUs = 0;
+  uint32_t passes = 0;
+  uint64_t end = (uint64_t)seconds * 1000000;
+
+  while (virtualUs < end)
+  {
+    uint64_t passStart = virtualUs;
+    uint32_t untilNextRead = scheduler.runDue();
+    if (virtualUs - passStart > worstPassUs)
+      worstPassUs = virtualUs - passStart;
+    passes++;
+
+    if (virtualMillis() - lastSnapshot >= SNAPSHOT_INTERVAL)
+    {
+      lastSnapshot = virtualMillis();
+      takeSnapshot();
+    }
+
+    // Igual que ReadSensorsTask: dormir hasta lo que ocurra primero, mínimo 1 ms
+    uint32_t elapsed = virtualMillis() - lastSnapshot;
+    uint32_t untilSample = elapsed >= SNAPSHOT_INTERVAL ? 0 : SNAPSHOT_INTERVAL - elapsed;
+    uint32_t sleepMs = untilNextRead < untilSample ? untilNextRead : untilSample;
+    virtualUs += (uint64_t)(sleepMs > 0 ? sleepMs : 1) * 1000;
+  }
+
+  printf("SensorScheduler (presupuesto %d us por vuelta)\n", SCHED_PASS_BUDGET_US);
+  printf("  vueltas: %u, vuelta más larga: %llu us\n", (unsigned)passes, (unsigned long long)worstPassUs);
+  printAges();
+  for (uint8_t i = 0; i < scheduler.size(); i++)
+  {
+    SensorEntry &e = scheduler.entry(i);
+    printf("    %-7s prom %5u us, máx %5u us, tarde %u\n", e.name, (unsigned)e.duration.meanUs(),
+           (unsigned)e.duration.maxUs, (unsigned)e.deadlineMisses);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t seconds = argc > 1 ? strtoul(argv[1], NULL, 10) : 3600;
+
+  runMonolithic(seconds);
+  printf("\n");
+  runScheduler(seconds);
+  return 0;
+}
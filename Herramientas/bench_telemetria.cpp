@@ -0,0 +1,141 @@
+/*
+  Comparación del codificador de telemetría contra la ruta anterior con
+  ArduinoJson (DynamicJsonDocument + concatenación de Strings + copia al
+  mensaje de la cola).
+
+  Mide nanosegundos por mensaje y reservas de memoria por mensaje. La parte de
+  ArduinoJson sólo se compila si la librería (versión 6) está en el include
+  path; la versión de escritorio se obtiene de https://arduinojson.org.
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -I<ruta a ArduinoJson/src> -o bench_telemetria bench_telemetria.cpp
+  Uso:
+    ./bench_telemetria [iteraciones]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include "TelemetryEncoder.h"
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#if ARDUINOJSON_VERSION_MAJOR == 6
+#define BENCH_ARDUINOJSON 1
+
+// Asignador que cuenta las reservas del documento
+struct CountingAllocator
+{
+  void *allocate(size_t size)
+  {
+    allocations++;
+    return malloc(size);
+  }
+  void deallocate(void *p) { free(p); }
+  void *reallocate(void *p, size_t size)
+  {
+    allocations++;
+    return realloc(p, size);
+  }
+};
+
+typedef BasicJsonDocument<CountingAllocator> CountingJsonDocument;
+
+// Réplica de la ruta original: IrrigationControl::createJSON + strncpy en ReadSensorsTask
+static size_t encodeArduinoJson(const SensorsData &data, char *out, size_t size)
+{
+  CivilTime t = TelemetryEncoder::civilFromUnix(data.timestamp);
+  CountingJsonDocument doc(512);
+  doc["fecha"] = std::to_string(t.day) + "/" + std::to_string(t.month) + "/" + std::to_string(t.year);
+  doc["hora"] = std::to_string(t.hour) + ":" + std::to_string(t.minute) + ":" + std::to_string(t.second);
+  doc["temperaturaAmbiente"] = data.temperature;
+  doc["humedadAmbiente"] = data.humidity;
+  doc["humedadSuelo"]["sensor1"] = data.soilMoisture1;
+  doc["humedadSuelo"]["sensor2"] = data.soilMoisture2;
+  doc["iluminacion"] = data.lightIntensity;
+  doc["riegoManual"] = false;
+  doc["nivelAgua"] = data.waterLevel;
+  doc["timestamp"] = data.timestamp;
+
+  std::string json;
+  serializeJson(doc, json);
+
+  strncpy(out, json.c_str(), size - 1);
+  out[size - 1] = '\0';
+  return json.size();
+}
+#endif
+#endif
+
+struct Result
+{
+  double nsPerMessage;
+  double allocationsPerMessage;
+  size_t bytes;
+};
+
+template <typename Encode>
+static Result run(unsigned long iterations, Encode encode)
+{
+  SensorsData data = {24.5f, 61.0f, 45, 52, 80, 12.34f, 60, 1700000000UL};
+  char message[256];
+  size_t bytes = 0;
+
+  unsigned long before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    // Variar los valores para que el compilador no pueda precalcular nada
+    data.timestamp += 5;
+    data.soilMoisture1 = (int16_t)(i % 100);
+    data.temperature = 20.0f + (float)(i % 1000) / 100.0f;
+    bytes += encode(data, message, sizeof(message));
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  Result r;
+  r.nsPerMessage = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+  r.allocationsPerMessage = (double)(allocations - before) / iterations;
+  r.bytes = bytes / iterations;
+  return r;
+}
+
+static void report(const char *name, const Result &r)
+{
+  printf("%-24s %10.1f ns/msg %8.2f reservas/msg %6zu bytes/msg\n", name, r.nsPerMessage, r.allocationsPerMessage, r.bytes);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000UL;
+
+  report("TelemetryEncoder", run(iterations, [](const SensorsData &d, char *out, size_t size) {
+           size_t length = 0;
+           TelemetryEncoder::encode(d, false, out, size, &length);
+           return length;
+         }));
+
+#ifdef BENCH_ARDUINOJSON
+  report("ArduinoJson + String", run(iterations, encodeArduinoJson));
+#else
+  printf("ArduinoJson 6 no encontrado en el include path; se omite la comparación\n");
+#endif
+  return 0;
+}
@@ -0,0 +1,600 @@
+/*
+  Carga del envío por lotes a Firebase (SiRIM/FirebaseSink.h) contra un
+  sustituto local de Realtime Database.
+
+  El sustituto es un servidor HTTP/1.1 en 127.0.0.1 con los puntos REST de
+  la base: GET, PUT, PATCH (multirruta), POST (push) y DELETE sobre
+  /ruta.json, con print=silent y conexiones keep-alive. Guarda cada hijo
+  como texto JSON. Puede simular fallas:
+    -f  porcentaje de peticiones que contesta 503 sin escribir y de las que
+        escribe y luego cierra sin contestar (respuesta perdida)
+    -k  cierra la conexión en silencio cada k peticiones, como un balanceador
+        que descarta conexiones inactivas
+    -t  espera al aceptar cada conexión, en lugar del saludo TLS
+
+  El cliente es el FirebaseBatcher y FirebaseClient del firmware sobre un
+  socket. Las muestras llevan un timestamp cada 5 s y el reloj del lote es el
+  de las muestras, así que "latenciaSeg" y el retroceso se cumplen sin
+  esperar. Para cada escenario reporta muestras por segundo, bytes por
+  muestra (petición y respuesta), conexiones y reintentos, y verifica que la
+  base tenga cada muestra una sola vez con el JSON de TelemetryEncoder.
+
+  Compilar:
+    g++ -std=c++17 -O2 -pthread -I../SiRIM -o carga_firebase carga_firebase.cpp
+  Uso:
+    ./carga_firebase [-n muestras] [-f fallas %] [-k peticiones] [-t ms]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include "FirebaseSink.h"
+
+#define SOCKET_TIMEOUT_MS 2000
+#define SAMPLE_PERIOD_MS 5000
+#define START_TIME 1767225600UL // 2026-01-01 00:00
+#define DATABASE_PATH "sirim/telemetria"
+
+static const uint8_t NODE_MAC[6] = {0x24, 0x0A, 0xC4, 0x5A, 0x10, 0x01};
+
+struct Options
+{
+  uint32_t samples = 2000;
+  double faults = 5;        // % de 503 y otro tanto de respuestas perdidas
+  uint32_t closeEvery = 50; // Peticiones por conexión en el escenario con fallas
+  uint32_t acceptDelayMs = 0;
+} options;
+
+/*-- Sustituto de Realtime Database --*/
+
+class StandIn
+{
+private:
+  int listener = -1;
+  std::thread thread;
+  std::atomic<bool> running{false};
+  std::mt19937 rng{7};
+
+  bool readRequest(int fd, std::string &method, std::string &target, std::string &body, bool &close);
+  void respond(int fd, int status, const std::string &body, bool close);
+  int apply(const std::string &method, const std::string &path, const std::string &body, std::string &reply);
+  void serve(int fd);
+  void run(void);
+
+public:
+  uint16_t port = 0;
+  std::mutex lock;
+  std::map<std::string, std::string> data; // Ruta completa del hijo -> JSON
+  double faultPercent = 0;
+  uint32_t closeEvery = 0;
+  uint32_t acceptDelayMs = 0;
+
+  // Métricas
+  std::atomic<uint64_t> connections{0};
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> injected{0};
+  uint64_t overwritten = 0; // Hijos que ya existían (reintentos)
+
+  bool start(void);
+  void stop(void);
+  void reset(double faults, uint32_t close)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    data.clear();
+    faultPercent = faults;
+    closeEvery = close;
+    connections = requests = injected = 0;
+    overwritten = 0;
+  }
+};
+
+bool StandIn ::start(void)
+{
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 4) != 0 ||
+      getsockname(listener, (struct sockaddr *)&address, &length) != 0)
+    return false;
+  port = ntohs(address.sin_port);
+  running = true;
+  thread = std::thread(&StandIn::run, this);
+  return true;
+}
+
+void StandIn ::stop(void)
+{
+  running = false;
+  shutdown(listener, SHUT_RDWR);
+  ::close(listener);
+  thread.join();
+}
+
+void StandIn ::run(void)
+{
+  // Una conexión a la vez: el nodo sólo tiene una
+  while (running)
+  {
+    struct pollfd waiting = {listener, POLLIN, 0};
+    if (poll(&waiting, 1, 100) != 1)
+      continue;
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0)
+      continue;
+    if (acceptDelayMs > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(acceptDelayMs));
+    connections++;
+    serve(fd);
+    ::close(fd);
+  }
+}
+
+bool StandIn ::readRequest(int fd, std::string &method, std::string &target, std::string &body, bool &close)
+{
+  std::string head;
+  char c;
+  while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0)
+  {
+    if (recv(fd, &c, 1, 0) != 1)
+      return false;
+    head += c;
+  }
+  char m[16], t[512];
+  if (sscanf(head.c_str(), "%15s %511s HTTP/1.1", m, t) != 2)
+    return false;
+  method = m;
+  target = t;
+
+  size_t length = 0;
+  close = false;
+  for (size_t at = head.find("\r\n"); at != std::string::npos && at + 2 < head.size(); at = head.find("\r\n", at + 2))
+  {
+    std::string line = head.substr(at + 2, head.find("\r\n", at + 2) - at - 2);
+    for (size_t i = 0; i < line.size() && line[i] != ':'; i++)
+      line[i] = tolower(line[i]);
+    if (line.compare(0, 15, "content-length:") == 0)
+      length = strtoul(line.c_str() + 15, NULL, 10);
+    else if (line.compare(0, 11, "connection:") == 0 && line.find("close") != std::string::npos)
+      close = true;
+  }
+  body.resize(length);
+  for (size_t got = 0; got < length;)
+  {
+    ssize_t n = recv(fd, &body[got], length - got, 0);
+    if (n <= 0)
+      return false;
+    got += n;
+  }
+  return true;
+}
+
+void StandIn ::respond(int fd, int status, const std::string &body, bool close)
+{
+  const char *reason = "Service Unavailable";
+  if (status == 200)
+    reason = "OK";
+  else if (status == 204)
+    reason = "No Content";
+  else if (status == 400)
+    reason = "Bad Request";
+
+  // Los mismos encabezados que la base; 204 va sin cuerpo ni Content-Length
+  std::string out = "HTTP/1.1 " + std::to_string(status) + " " + reason +
+                    "\r\nContent-Type: application/json; charset=utf-8\r\nAccess-Control-Allow-Origin: *\r\n"
+                    "Cache-Control: no-cache\r\n";
+  if (status != 204)
+    out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  if (close)
+    out += "Connection: close\r\n";
+  out += "\r\n" + body;
+  ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+}
+
+// Hijos del primer nivel de un objeto JSON: clave -> texto del valor
+static bool splitObject(const std::string &json, std::map<std::string, std::string> &children)
+{
+  size_t i = json.find_first_not_of(" \t\r\n");
+  if (i == std::string::npos || json[i] != '{')
+    return false;
+  i++;
+  while (true)
+  {
+    while (i < json.size() && (isspace(json[i]) || json[i] == ','))
+      i++;
+    if (i >= json.size())
+      return false;
+    if (json[i] == '}')
+      return true;
+    size_t keyEnd = json.find('"', i + 1);
+    if (json[i] != '"' || keyEnd == std::string::npos)
+      return false;
+    std::string key = json.substr(i + 1, keyEnd - i - 1);
+    i = json.find(':', keyEnd) + 1;
+    while (i < json.size() && isspace(json[i]))
+      i++;
+    size_t start = i;
+    int depth = 0;
+    bool quoted = false;
+    for (; i < json.size(); i++)
+    {
+      char c = json[i];
+      if (quoted)
+      {
+        if (c == '\\')
+          i++;
+        else if (c == '"')
+          quoted = false;
+        continue;
+      }
+      if (c == '"')
+        quoted = true;
+      else if (c == '{' || c == '[')
+        depth++;
+      else if ((c == '}' || c == ']') && depth-- == 0)
+        break;
+      else if (c == ',' && depth == 0)
+        break;
+    }
+    children[key] = json.substr(start, i - start);
+  }
+}
+
+int StandIn ::apply(const std::string &method, const std::string &path, const std::string &body, std::string &reply)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::string prefix = path + "/";
+  if (method == "GET")
+  {
+    auto exact = data.find(path);
+    if (exact != data.end())
+    {
+      reply = exact->second;
+      return 200;
+    }
+    reply = "{";
+    for (auto it = data.lower_bound(prefix); it != data.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+      reply += (reply.size() > 1 ? ",\"" : "\"") + it->first.substr(prefix.size()) + "\":" + it->second;
+    reply = reply.size() > 1 ? reply + "}" : "null";
+    return 200;
+  }
+  if (method == "DELETE" || method == "PUT")
+  {
+    data.erase(path);
+    data.erase(data.lower_bound(prefix), data.lower_bound(path + "0")); // '0' sigue a '/'
+    if (method == "PUT")
+      data[path] = body;
+    reply = method == "PUT" ? body : "null";
+    return 200;
+  }
+  if (method == "POST")
+  {
+    char key[FIREBASE_KEY_SIZE + 1];
+    FirebaseRecord r = {};
+    r.sequence = (uint32_t)data.size();
+    FirebaseClient::makeKey(r, NODE_MAC, key);
+    data[prefix + key] = body;
+    reply = std::string("{\"name\":\"") + key + "\"}";
+    return 200;
+  }
+  if (method == "PATCH")
+  {
+    std::map<std::string, std::string> children;
+    if (!splitObject(body, children))
+    {
+      reply = "{\"error\":\"Invalid data; couldn't parse JSON object.\"}";
+      return 400;
+    }
+    for (const auto &child : children)
+    {
+      std::string &slot = data[prefix + child.first];
+      overwritten += !slot.empty();
+      slot = child.second;
+    }
+    reply = body;
+    return 200;
+  }
+  reply = "{\"error\":\"Method not allowed\"}";
+  return 400;
+}
+
+void StandIn ::serve(int fd)
+{
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  uint32_t served = 0;
+  std::string method, target, body, reply;
+  bool close;
+  while (running && readRequest(fd, method, target, body, close))
+  {
+    requests++;
+    served++;
+    // /ruta.json?consulta
+    std::string query = target.find('?') != std::string::npos ? target.substr(target.find('?') + 1) : "";
+    std::string path = target.substr(1, target.find(".json") - 1);
+    bool silent = query.find("print=silent") != std::string::npos;
+
+    std::uniform_real_distribution<double> chance(0, 100);
+    double roll = chance(rng);
+    if (roll < faultPercent)
+    {
+      injected++;
+      respond(fd, 503, "{\"error\":\"Service Unavailable\"}", close);
+    }
+    else
+    {
+      int status = apply(method, path, body, reply);
+      if (roll < 2 * faultPercent)
+      {
+        // Escrito, pero la respuesta no llega
+        injected++;
+        return;
+      }
+      respond(fd, status == 200 && silent ? 204 : status, silent ? "" : reply, close);
+    }
+    if (close || (closeEvery > 0 && served % closeEvery == 0))
+      return;
+  }
+}
+
+/*-- HttpStream sobre un socket --*/
+
+class SocketStream : public HttpStream
+{
+private:
+  int fd = -1;
+
+public:
+  ~SocketStream() { stop(); }
+
+  bool connect(const char *host, uint16_t port)
+  {
+    stop();
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, host, &address.sin_addr);
+    if (fd < 0 || ::connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+      stop();
+      return false;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval timeout = {SOCKET_TIMEOUT_MS / 1000, (SOCKET_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+  }
+  bool connected(void) { return fd >= 0; }
+  void stop(void)
+  {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t sent = 0;
+    while (fd >= 0 && sent < size)
+    {
+      ssize_t n = ::send(fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+      if (n <= 0)
+        break;
+      sent += n;
+    }
+    return sent;
+  }
+  size_t read(uint8_t *buffer, size_t size)
+  {
+    ssize_t n = fd >= 0 ? recv(fd, buffer, size, 0) : 0;
+    return n > 0 ? (size_t)n : 0;
+  }
+};
+
+/*-- Escenarios --*/
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static SensorsData sample(uint32_t i, std::mt19937 &rng)
+{
+  SensorsData d;
+  d.temperature = 20 + (rng() % 100) / 10.0f;
+  d.humidity = 50 + (rng() % 300) / 10.0f;
+  d.soilMoisture1 = (int16_t)(rng() % 100);
+  d.soilMoisture2 = (int16_t)(rng() % 100);
+  d.lightIntensity = (int16_t)(rng() % 100);
+  d.waterLevel = 12.5f;
+  d.waterPercent = (int16_t)(rng() % 100);
+  d.timestamp = START_TIME + i * (SAMPLE_PERIOD_MS / 1000);
+  return d;
+}
+
+static void scenario(StandIn &server, const char *name, uint8_t batchSize, uint16_t latencySeconds, bool keepAlive,
+                     bool faults)
+{
+  server.reset(faults ? options.faults : 0, faults ? options.closeEvery : 0);
+
+  SocketStream stream;
+  FirebaseClient client(stream);
+  client.begin("127.0.0.1", server.port, "secreto", DATABASE_PATH, NODE_MAC);
+  client.setKeepAlive(keepAlive);
+  FirebaseBatcher batcher;
+  FirebaseConfig config = {batchSize, latencySeconds};
+  batcher.configure(config);
+
+  std::mt19937 rng(1);
+  std::map<std::string, std::string> expected;
+  FirebaseRecord batch[FIREBASE_BATCH_MAX];
+  uint32_t nowMs = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < options.samples || batcher.pending() > 0; i++, nowMs += SAMPLE_PERIOD_MS)
+  {
+    if (i < options.samples)
+    {
+      SensorsData d = sample(i, rng);
+      bool manual = i % 7 == 0;
+      batcher.add(d, manual, nowMs);
+
+      FirebaseRecord r = {d, i, nowMs, manual};
+      char key[FIREBASE_KEY_SIZE + 1];
+      char json[FIREBASE_RECORD_JSON];
+      FirebaseClient::makeKey(r, NODE_MAC, key);
+      TelemetryEncoder::encode(d, manual, json, sizeof(json));
+      expected[std::string(DATABASE_PATH) + "/" + key] = json;
+    }
+    // Como serveFirebase() en la tarea de red
+    while (batcher.due(nowMs))
+    {
+      uint8_t n = batcher.peek(batch, FIREBASE_BATCH_MAX);
+      if (FirebaseClient::succeeded(client.send(batch, n)))
+        batcher.commit();
+      else
+        batcher.fail(nowMs);
+    }
+  }
+  client.stop();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  double perSample = (double)(client.bytesSent + client.bytesReceived) / options.samples;
+  printf("%-22s %9.0f muestras/s  %6.1f B/muestra  conexiones %5llu  peticiones %5lu  fallidas %4lu  "
+         "reescritas %4llu\n",
+         name, options.samples / seconds, perSample, (unsigned long long)server.connections,
+         (unsigned long)client.requests, (unsigned long)batcher.failedBatches,
+         (unsigned long long)server.overwritten);
+
+  std::lock_guard<std::mutex> guard(server.lock);
+  check(name, batcher.sent == options.samples && batcher.dropped == 0, "muestras sin confirmar");
+  check(name, server.data == expected, "la base no tiene cada muestra una vez con su JSON");
+  if (!faults && keepAlive)
+    check(name, server.connections == 1, "no se reutilizó la conexión");
+}
+
+// Los otros puntos REST del sustituto, con una conexión por petición
+static void rest(StandIn &server)
+{
+  server.reset(0, 0);
+  SocketStream stream;
+  auto call = [&](const char *method, const char *target, const char *body) {
+    std::string request = std::string(method) + " " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " +
+                          std::to_string(strlen(body)) + "\r\nConnection: close\r\n\r\n" + body;
+    std::string response;
+    uint8_t buffer[512];
+    size_t n;
+    if (stream.connect("127.0.0.1", server.port))
+    {
+      stream.write((const uint8_t *)request.data(), request.size());
+      while ((n = stream.read(buffer, sizeof(buffer))) > 0)
+        response.append((const char *)buffer, n);
+    }
+    stream.stop();
+    size_t bodyAt = response.find("\r\n\r\n");
+    return bodyAt == std::string::npos ? std::string() : response.substr(bodyAt + 4);
+  };
+
+  call("PUT", "/sirim/nodo.json", "{\"nombre\":\"invernadero\"}");
+  call("POST", "/sirim/eventos.json", "{\"riego\":true}");
+  call("PATCH", "/sirim/telemetria.json", "{\"a\":{\"x\":1},\"b\":[1,{\"y\":\"},\"}]}");
+  std::string children = call("GET", "/sirim/telemetria.json", "");
+  std::string bad = call("PATCH", "/sirim/telemetria.json", "[1,2]");
+  call("DELETE", "/sirim/telemetria/a.json", "");
+  std::string after = call("GET", "/sirim/telemetria.json", "");
+  printf("REST     GET %s, después de DELETE %s\n", children.c_str(), after.c_str());
+  check("REST", children == "{\"a\":{\"x\":1},\"b\":[1,{\"y\":\"},\"}]}", "PATCH multirruta o GET distintos");
+  check("REST", bad.find("error") != std::string::npos, "PATCH sin objeto aceptado");
+  check("REST", after == "{\"b\":[1,{\"y\":\"},\"}]}", "DELETE no quitó el hijo");
+  check("REST", call("GET", "/sirim/nodo.json", "") == "{\"nombre\":\"invernadero\"}", "PUT no se guardó");
+}
+
+static void keys(void)
+{
+  // Ordenan como los timestamps y no se repiten entre muestras del mismo segundo
+  FirebaseRecord a = {}, b = {}, c = {};
+  a.data.timestamp = START_TIME;
+  b.data.timestamp = START_TIME;
+  b.sequence = 1;
+  c.data.timestamp = START_TIME + 1;
+  char ka[FIREBASE_KEY_SIZE + 1], kb[FIREBASE_KEY_SIZE + 1], kc[FIREBASE_KEY_SIZE + 1];
+  FirebaseClient::makeKey(a, NODE_MAC, ka);
+  FirebaseClient::makeKey(b, NODE_MAC, kb);
+  FirebaseClient::makeKey(c, NODE_MAC, kc);
+  printf("claves   %s %s %s\n", ka, kb, kc);
+  check("claves", strlen(ka) == FIREBASE_KEY_SIZE && strcmp(ka, kb) < 0 && strcmp(kb, kc) < 0,
+        "las claves no ordenan por fecha o se repiten");
+}
+
+int main(int argc, char **argv)
+{
+  int option;
+  while ((option = getopt(argc, argv, "n:f:k:t:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      options.samples = strtoul(optarg, NULL, 10);
+      break;
+    case 'f':
+      options.faults = atof(optarg);
+      break;
+    case 'k':
+      options.closeEvery = strtoul(optarg, NULL, 10);
+      break;
+    case 't':
+      options.acceptDelayMs = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "Uso: %s [-n muestras] [-f fallas %%] [-k peticiones] [-t ms]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (options.samples == 0 || options.faults < 0 || options.faults >= 50)
+  {
+    fprintf(stderr, "Parámetros fuera de rango\n");
+    return 2;
+  }
+
+  StandIn server;
+  if (!server.start())
+  {
+    perror("servidor");
+    return 1;
+  }
+  server.acceptDelayMs = options.acceptDelayMs;
+
+  keys();
+  rest(server);
+  // Como firebaseLogger.ino: una petición y una conexión por muestra
+  scenario(server, "una por conexión", 1, 60, false, false);
+  scenario(server, "una por petición", 1, 60, true, false);
+  // Con una muestra cada 5 s, 60 s de latencia dejan lotes de 12 como máximo
+  scenario(server, "lote 10", 10, 60, true, false);
+  scenario(server, "lote 32, 5 min", FIREBASE_BATCH_MAX, 300, true, false);
+  scenario(server, "lote 10 con fallas", 10, 60, true, true);
+  server.stop();
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,856 @@
+/*
+  Generador de carga: una flota de nodos SiRIM contra un broker local.
+
+  Cada nodo es un hilo con su propio ConnectivityManager (Connectivity.h,
+  el mismo retroceso con variación aleatoria del firmware), un client ID
+  único generado con makeClientId a partir de una MAC sintética y su propia
+  muestra de sensores que cambia poco a poco. Publica con TelemetryEncoder
+  (JSON en el tópico de telemetría) o TelemetryPacket (-b, tópico binario)
+  cada intervalo ± variación, igual que ReadSensorsTask, y como el firmware
+  en el subtópico de su client ID (makeNodeTopic).
+
+  Un suscriptor aparte recibe los tópicos de todos los nodos y mide la
+  latencia de extremo a extremo (publicación -> entrega). Los mensajes se
+  emparejan por su contenido; si dos nodos publican el mismo contenido a la
+  vez se toma el más antiguo y se cuenta como colisión.
+
+  Reporta percentiles de latencia, rendimiento del broker y, cuando el broker
+  se reinicia (a mano o con -k), la tormenta de reconexiones: intentos por
+  segundo y tiempo hasta que toda la flota vuelve a estar en línea.
+
+  Con -q cada nodo separa las dos tareas del firmware: un hilo arma las
+  muestras y las mete a una cola de MQTT_QUEUE_LENGTH, y el hilo del nodo la
+  vacía como WiFiMQTTTask (espera hasta MQTT_SERVICE_INTERVAL, publica todo
+  lo pendiente y atiende el socket cada MQTT_LOOP_EVERY publicaciones). La
+  latencia se mide entonces desde que la muestra entra a la cola. -N deja
+  activo el algoritmo de Nagle para comparar.
+
+  El cliente MQTT 3.1.1 (QoS 0) está incluido para no depender de
+  libmosquitto.
+
+  Compilar:
+    g++ -std=c++17 -O2 -pthread -I../SiRIM -o carga_flota carga_flota.cpp
+  Uso:
+    ./carga_flota [-n nodos] [-t segundos] [-i intervalo ms] [-j variación %]
+                  [-h host] [-p puerto] [-b] [-q] [-N] [-k seg:comando]
+    ./carga_flota -n 500 -t 120 -i 1000 -k 40:"systemctl restart mosquitto"
+    ./carga_flota -n 1 -t 60 -i 10 -j 0 -q     # 100 mensajes/s por la cola
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Connectivity.h"
+#include "TelemetryEncoder.h"
+#include "TelemetryPacket.h"
+#include "Ultrasonic.h"
+
+// Mismos valores que el firmware (env.h, WiFiMQTT.h, DualCore.h)
+#define TELEMETRY_TOPIC "ucol/iot/sensores"
+#define BINARY_TOPIC "ucol/iot/sensores/bin"
+#define SOCKET_TIMEOUT_MS 2000 // MQTT_SOCKET_TIMEOUT
+#define KEEPALIVE_S 15         // MQTT_KEEPALIVE de PubSubClient
+#define SAMPLE_INTERVAL_MS 5000
+#define SAMPLE_PERIOD_MS 100   // Muestreo del estado de la flota
+#define QUEUE_LENGTH 10        // MQTT_QUEUE_LENGTH
+#define SERVICE_INTERVAL_MS 10 // MQTT_SERVICE_INTERVAL
+#define RECONNECT_INTERVAL_MS 100 // MQTT_RECONNECT_INTERVAL
+#define LOOP_EVERY 8           // MQTT_LOOP_EVERY
+
+static std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+static int64_t nowUs(void)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+static uint32_t nowMs(void) { return (uint32_t)(nowUs() / 1000); }
+
+struct Options
+{
+  int nodes = 100;
+  int seconds = 60;
+  uint32_t intervalMs = SAMPLE_INTERVAL_MS;
+  float jitter = 0.10f;
+  const char *host = "127.0.0.1";
+  uint16_t port = 1883;
+  bool binary = false;
+  bool queued = false;
+  bool noDelay = true;
+  int restartAt = -1;
+  const char *restartCommand = NULL;
+};
+
+static Options options;
+
+/*-- Cliente MQTT 3.1.1 mínimo (QoS 0) --*/
+
+class MqttSocket
+{
+private:
+  int fd = -1;
+  int64_t lastSendUs = 0;
+
+  bool sendAll(const uint8_t *data, size_t length);
+  bool readAll(uint8_t *data, size_t length);
+  static size_t putLength(uint8_t *out, size_t length);
+  static size_t putString(uint8_t *out, const char *text);
+
+public:
+  ~MqttSocket() { close(); }
+
+  bool open(const char *host, uint16_t port, const char *clientId);
+  void close(void);
+  bool connected(void) { return fd >= 0; }
+  bool publish(const char *topic, const uint8_t *payload, size_t length);
+  bool subscribe(const char *topic);
+  // Lee un paquete si hay uno antes de timeoutMs; devuelve su tipo o 0
+  uint8_t read(std::vector<uint8_t> &body, int timeoutMs);
+  // Atiende PINGRESP y el keepalive; detecta que el broker cerró el socket
+  void service(void);
+};
+
+bool MqttSocket ::open(const char *host, uint16_t port, const char *clientId)
+{
+  close();
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  struct addrinfo hints = {}, *address = NULL;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, service, &hints, &address) != 0)
+    return false;
+
+  fd = socket(address->ai_family, address->ai_socktype, 0);
+  if (fd < 0)
+  {
+    freeaddrinfo(address);
+    return false;
+  }
+
+  // Conexión acotada por el timeout del socket, como PubSubClient
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  int result = ::connect(fd, address->ai_addr, address->ai_addrlen);
+  freeaddrinfo(address);
+  if (result < 0 && errno != EINPROGRESS)
+  {
+    close();
+    return false;
+  }
+  struct pollfd waiting = {fd, POLLOUT, 0};
+  int error = 0;
+  socklen_t errorLength = sizeof(error);
+  if (poll(&waiting, 1, SOCKET_TIMEOUT_MS) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0 ||
+      error != 0)
+  {
+    close();
+    return false;
+  }
+  fcntl(fd, F_SETFL, 0);
+  int noDelay = options.noDelay ? 1 : 0;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  struct timeval timeout = {SOCKET_TIMEOUT_MS / 1000, (SOCKET_TIMEOUT_MS % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  uint8_t packet[128];
+  uint8_t variable[] = {0, 4, 'M', 'Q', 'T', 'T', 4, 0x02 /* sesión limpia */, 0, KEEPALIVE_S};
+  size_t bodyLength = sizeof(variable) + 2 + strlen(clientId);
+  size_t used = 0;
+  packet[used++] = 0x10;
+  used += putLength(packet + used, bodyLength);
+  memcpy(packet + used, variable, sizeof(variable));
+  used += sizeof(variable);
+  used += putString(packet + used, clientId);
+
+  std::vector<uint8_t> body;
+  if (!sendAll(packet, used) || read(body, SOCKET_TIMEOUT_MS) != 0x20 || body.size() < 2 || body[1] != 0)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MqttSocket ::close(void)
+{
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+}
+
+size_t MqttSocket ::putLength(uint8_t *out, size_t length)
+{
+  size_t used = 0;
+  do
+  {
+    uint8_t digit = length % 128;
+    length /= 128;
+    out[used++] = digit | (length > 0 ? 0x80 : 0);
+  } while (length > 0);
+  return used;
+}
+
+size_t MqttSocket ::putString(uint8_t *out, const char *text)
+{
+  size_t length = strlen(text);
+  out[0] = (uint8_t)(length >> 8);
+  out[1] = (uint8_t)length;
+  memcpy(out + 2, text, length);
+  return length + 2;
+}
+
+bool MqttSocket ::sendAll(const uint8_t *data, size_t length)
+{
+  while (fd >= 0 && length > 0)
+  {
+    ssize_t sent = ::send(fd, data, length, MSG_NOSIGNAL);
+    if (sent <= 0)
+    {
+      close();
+      return false;
+    }
+    data += sent;
+    length -= sent;
+  }
+  lastSendUs = nowUs();
+  return fd >= 0;
+}
+
+bool MqttSocket ::readAll(uint8_t *data, size_t length)
+{
+  while (fd >= 0 && length > 0)
+  {
+    ssize_t got = ::recv(fd, data, length, 0);
+    if (got <= 0)
+    {
+      close();
+      return false;
+    }
+    data += got;
+    length -= got;
+  }
+  return fd >= 0;
+}
+
+bool MqttSocket ::publish(const char *topic, const uint8_t *payload, size_t length)
+{
+  std::vector<uint8_t> packet(5 + 2 + strlen(topic) + length);
+  size_t used = 0;
+  packet[used++] = 0x30;
+  used += putLength(&packet[used], 2 + strlen(topic) + length);
+  used += putString(&packet[used], topic);
+  memcpy(&packet[used], payload, length);
+  return sendAll(packet.data(), used + length);
+}
+
+bool MqttSocket ::subscribe(const char *topic)
+{
+  uint8_t packet[128];
+  size_t used = 0;
+  packet[used++] = 0x82;
+  used += putLength(packet + used, 2 + 2 + strlen(topic) + 1);
+  packet[used++] = 0;
+  packet[used++] = 1; // Identificador del paquete
+  used += putString(packet + used, topic);
+  packet[used++] = 0; // QoS 0
+  std::vector<uint8_t> body;
+  return sendAll(packet, used) && read(body, SOCKET_TIMEOUT_MS) == 0x90;
+}
+
+uint8_t MqttSocket ::read(std::vector<uint8_t> &body, int timeoutMs)
+{
+  if (fd < 0)
+    return 0;
+  struct pollfd waiting = {fd, POLLIN, 0};
+  if (poll(&waiting, 1, timeoutMs) != 1)
+    return 0;
+
+  uint8_t header;
+  if (!readAll(&header, 1))
+    return 0;
+  size_t length = 0;
+  for (int shift = 0; shift < 28; shift += 7)
+  {
+    uint8_t digit;
+    if (!readAll(&digit, 1))
+      return 0;
+    length |= (size_t)(digit & 0x7F) << shift;
+    if ((digit & 0x80) == 0)
+      break;
+  }
+  body.resize(length);
+  if (length > 0 && !readAll(body.data(), length))
+    return 0;
+  return header & 0xF0;
+}
+
+void MqttSocket ::service(void)
+{
+  std::vector<uint8_t> body;
+  while (read(body, 0) != 0)
+    ;
+  if (fd >= 0 && nowUs() - lastSendUs > KEEPALIVE_S * 1000000LL / 2)
+  {
+    uint8_t ping[] = {0xC0, 0x00};
+    sendAll(ping, sizeof(ping));
+  }
+}
+
+/*-- Estado compartido --*/
+
+static std::atomic<bool> publishing(true); // Nodos
+static std::atomic<bool> running(true);    // Suscriptor
+static std::atomic<int> online(0);
+static std::atomic<uint64_t> attempts(0);   // Intentos de conexión al broker
+static std::atomic<uint64_t> connects(0);   // Conexiones aceptadas
+static std::atomic<uint64_t> published(0);
+static std::atomic<uint64_t> publishFailures(0);
+static std::atomic<uint64_t> offlineSamples(0); // El firmware las mandaría al respaldo
+static std::atomic<uint64_t> publishedBytes(0);
+static std::atomic<uint64_t> queueFull(0); // El firmware las mandaría al respaldo
+static std::atomic<uint64_t> queueMax(0);
+
+// Mensajes publicados que el suscriptor aún no recibe, por contenido
+static std::mutex pendingLock;
+static std::unordered_map<std::string, std::deque<int64_t>> pending;
+static uint64_t collisions = 0;
+
+/*-- Cola entre el hilo de muestras y el de red (-q) --*/
+
+struct QueuedSample
+{
+  char topic[MQTT_NODE_TOPIC_SIZE];
+  uint8_t payload[256];
+  size_t length;
+};
+
+class SampleQueue
+{
+private:
+  std::mutex lock;
+  std::condition_variable ready;
+  std::deque<QueuedSample> items;
+
+public:
+  // Como xQueueSend con espera 0
+  bool send(const QueuedSample &sample)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (items.size() >= QUEUE_LENGTH)
+      return false;
+    items.push_back(sample);
+    uint64_t depth = items.size();
+    if (depth > queueMax)
+      queueMax = depth;
+    ready.notify_one();
+    return true;
+  }
+
+  // Como xQueueReceive: espera hasta timeoutMs
+  bool receive(QueuedSample &sample, int timeoutMs)
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!ready.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this] { return !items.empty(); }))
+      return false;
+    sample = items.front();
+    items.pop_front();
+    return true;
+  }
+};
+
+/*-- Nodo --*/
+
+class FleetNode : public LinkLayer
+{
+private:
+  int index;
+  char clientId[MQTT_CLIENT_ID_SIZE];
+  MqttSocket mqtt;
+  ConnectivityManager connectivity;
+  std::mt19937 rng;
+  SensorsData data;
+  uint16_t sequence = 0;
+
+  float uniform(float low, float high) { return std::uniform_real_distribution<float>(low, high)(rng); }
+  static int percent(int value) { return value < 0 ? 0 : (value > 100 ? 100 : value); }
+  void nextSample(void);
+  bool encodeSample(QueuedSample &sample);
+  void track(const QueuedSample &sample);
+  void untrack(const QueuedSample &sample);
+  void publishSample(void);
+  bool publishQueued(const QueuedSample &sample);
+  void produce(SampleQueue &queue);
+  void runQueued(void);
+
+public:
+  FleetNode(int index) : index(index), connectivity(*this), rng(index + 1)
+  {
+    // MAC sintética con el OUI de Espressif, distinta por nodo
+    uint8_t mac[6] = {0x24, 0x0A, 0xC4, (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index};
+    makeClientId(clientId, sizeof(clientId), mac);
+    data = {uniform(18, 30), uniform(40, 80), (int16_t)uniform(20, 80), (int16_t)uniform(20, 80),
+            (int16_t)uniform(0, 100), uniform(TANK_FULL_CM, TANK_EMPTY_CM), 50, 1718000000};
+  }
+
+  void run(void);
+
+  // LinkLayer: el WiFi siempre está arriba; sólo se prueba el broker
+  void wifiBegin(int32_t, const uint8_t *) {}
+  bool wifiConnected(void) { return true; }
+  void wifiDisconnect(void) {}
+  bool wifiApInfo(ApCache &) { return false; }
+  bool mqttConnect(void)
+  {
+    attempts++;
+    if (!mqtt.open(options.host, options.port, clientId))
+      return false;
+    connects++;
+    return true;
+  }
+  bool mqttConnected(void) { return mqtt.connected(); }
+  uint32_t random32(void) { return rng(); }
+};
+
+void FleetNode ::nextSample(void)
+{
+  // Caminata aleatoria: la mayoría de las muestras difieren entre nodos
+  data.temperature += uniform(-0.2f, 0.2f);
+  data.humidity += uniform(-0.5f, 0.5f);
+  data.soilMoisture1 = percent(data.soilMoisture1 + (int)uniform(-1.5f, 1.5f));
+  data.soilMoisture2 = percent(data.soilMoisture2 + (int)uniform(-1.5f, 1.5f));
+  data.lightIntensity = percent(data.lightIntensity + (int)uniform(-3, 3));
+  data.waterLevel = std::min(TANK_EMPTY_CM, std::max(TANK_FULL_CM, data.waterLevel + uniform(-0.1f, 0.1f)));
+  data.waterPercent = (int)UltrasonicFilter::tankPercent(data.waterLevel);
+  data.timestamp = 1718000000 + nowMs() / 1000;
+}
+
+bool FleetNode ::encodeSample(QueuedSample &sample)
+{
+  if (options.binary)
+  {
+    sample.length = TelemetryPacket::encode(data, sequence++, false, false, sample.payload, sizeof(sample.payload));
+    makeNodeTopic(sample.topic, sizeof(sample.topic), BINARY_TOPIC, clientId);
+    return true;
+  }
+  makeNodeTopic(sample.topic, sizeof(sample.topic), TELEMETRY_TOPIC, clientId);
+  return TelemetryEncoder::encode(data, false, (char *)sample.payload, sizeof(sample.payload), &sample.length);
+}
+
+// El suscriptor empareja por contenido la hora en que la muestra quedó lista
+void FleetNode ::track(const QueuedSample &sample)
+{
+  std::string key((const char *)sample.payload, sample.length);
+  std::lock_guard<std::mutex> guard(pendingLock);
+  std::deque<int64_t> &times = pending[key];
+  if (!times.empty())
+    collisions++;
+  times.push_back(nowUs());
+}
+
+void FleetNode ::untrack(const QueuedSample &sample)
+{
+  std::string key((const char *)sample.payload, sample.length);
+  std::lock_guard<std::mutex> guard(pendingLock);
+  std::deque<int64_t> &times = pending[key];
+  times.pop_back();
+  if (times.empty())
+    pending.erase(key);
+}
+
+bool FleetNode ::publishQueued(const QueuedSample &sample)
+{
+  if (mqtt.publish(sample.topic, sample.payload, sample.length))
+  {
+    published++;
+    publishedBytes += sample.length;
+    return true;
+  }
+  // Como publishMessage: sin conexión la muestra no sale
+  publishFailures++;
+  untrack(sample);
+  return false;
+}
+
+void FleetNode ::publishSample(void)
+{
+  QueuedSample sample;
+  if (!encodeSample(sample))
+    return;
+  track(sample);
+  publishQueued(sample);
+}
+
+// Como ReadSensorsTask: arma la muestra y la deja en la cola sin esperar
+void FleetNode ::produce(SampleQueue &queue)
+{
+  std::mt19937 jitter(index + 7);
+  uint32_t nextPublish = nowMs() + jitter() % options.intervalMs;
+  while (publishing)
+  {
+    uint32_t wait = nextPublish - nowMs();
+    if ((int32_t)wait > 0)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+      continue;
+    }
+    QueuedSample sample;
+    nextSample();
+    if (encodeSample(sample))
+    {
+      track(sample);
+      if (!queue.send(sample))
+      {
+        queueFull++;
+        untrack(sample);
+      }
+    }
+    float factor = 1 + std::uniform_real_distribution<float>(-options.jitter, options.jitter)(jitter);
+    nextPublish += (uint32_t)(options.intervalMs * factor);
+  }
+}
+
+// Como WiFiMQTTTask: duerme en la cola y publica todo lo pendiente en cada despertar
+void FleetNode ::runQueued(void)
+{
+  SampleQueue queue;
+  std::thread producer(&FleetNode::produce, this, std::ref(queue));
+  bool wasOnline = false;
+
+  while (publishing)
+  {
+    bool isOnline = connectivity.update(nowMs()) == CONN_ONLINE;
+    if (isOnline != wasOnline)
+      online += isOnline ? 1 : -1;
+    wasOnline = isOnline;
+
+    QueuedSample sample;
+    if (queue.receive(sample, isOnline ? SERVICE_INTERVAL_MS : RECONNECT_INTERVAL_MS))
+    {
+      uint32_t drained = 0;
+      do
+      {
+        if (isOnline)
+        {
+          publishQueued(sample);
+          if (++drained % LOOP_EVERY == 0)
+            mqtt.service();
+        }
+        else
+        {
+          offlineSamples++;
+          untrack(sample);
+        }
+      } while (queue.receive(sample, 0));
+    }
+    if (isOnline)
+      mqtt.service();
+  }
+  producer.join();
+  if (wasOnline)
+    online--;
+}
+
+void FleetNode ::run(void)
+{
+  if (options.queued)
+  {
+    runQueued();
+    return;
+  }
+
+  // Fase inicial aleatoria para no publicar todos en el mismo instante
+  uint32_t nextPublish = nowMs() + rng() % options.intervalMs;
+  bool wasOnline = false;
+
+  while (publishing)
+  {
+    uint32_t now = nowMs();
+    bool isOnline = connectivity.update(now) == CONN_ONLINE;
+    if (isOnline != wasOnline)
+      online += isOnline ? 1 : -1;
+    wasOnline = isOnline;
+
+    if ((int32_t)(now - nextPublish) >= 0)
+    {
+      nextSample();
+      if (isOnline)
+        publishSample();
+      else
+        offlineSamples++;
+      float factor = 1 + uniform(-options.jitter, options.jitter);
+      nextPublish += (uint32_t)(options.intervalMs * factor);
+    }
+    if (isOnline)
+      mqtt.service();
+
+    uint32_t wait = nextPublish - nowMs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min<uint32_t>((int32_t)wait > 0 ? wait : 0, 20)));
+  }
+  if (wasOnline)
+    online--;
+}
+
+/*-- Suscriptor: latencia de extremo a extremo --*/
+
+static std::vector<int64_t> latencies;
+static uint64_t received = 0;
+static uint64_t receivedBytes = 0;
+static uint64_t unmatched = 0;
+
+static void subscriberLoop(void)
+{
+  MqttSocket mqtt;
+  // Un nivel más: el client ID de cada nodo
+  std::string topic = std::string(options.binary ? BINARY_TOPIC : TELEMETRY_TOPIC) + "/+";
+  std::vector<uint8_t> body;
+
+  while (running)
+  {
+    if (!mqtt.connected())
+    {
+      if (!mqtt.open(options.host, options.port, "sirim-carga-medidor") || !mqtt.subscribe(topic.c_str()))
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        continue;
+      }
+    }
+    if (mqtt.read(body, 100) != 0x30 || body.size() < 2)
+    {
+      mqtt.service();
+      continue;
+    }
+    int64_t arrived = nowUs();
+    size_t topicLength = (size_t)body[0] << 8 | body[1];
+    if (2 + topicLength > body.size())
+      continue;
+    std::string key((const char *)body.data() + 2 + topicLength, body.size() - 2 - topicLength);
+    received++;
+    receivedBytes += key.size();
+
+    std::lock_guard<std::mutex> guard(pendingLock);
+    auto found = pending.find(key);
+    if (found == pending.end())
+    {
+      unmatched++;
+      continue;
+    }
+    latencies.push_back(arrived - found->second.front());
+    found->second.pop_front();
+    if (found->second.empty())
+      pending.erase(found);
+  }
+}
+
+/*-- Reporte --*/
+
+struct Timeline
+{
+  uint32_t atMs;
+  int online;
+  uint64_t attempts;
+  uint64_t connects;
+  uint64_t received;
+};
+
+static void reportStorms(const std::vector<Timeline> &timeline)
+{
+  // Una tormenta empieza cuando cae más de la cuarta parte de la flota y
+  // termina cuando vuelve a estar completa
+  int threshold = options.nodes - std::max(1, options.nodes / 4);
+  int storms = 0;
+  for (size_t i = 1; i < timeline.size(); i++)
+  {
+    if (!(timeline[i - 1].online > threshold && timeline[i].online <= threshold))
+      continue;
+
+    size_t start = i - 1;
+    size_t end = i;
+    size_t firstBack = 0;
+    int lowest = timeline[i].online;
+    while (end < timeline.size() && timeline[end].online < options.nodes)
+    {
+      lowest = std::min(lowest, timeline[end].online);
+      if (firstBack == 0 && timeline[end].online > lowest)
+        firstBack = end;
+      end++;
+    }
+    bool recovered = end < timeline.size();
+    if (!recovered)
+      end = timeline.size() - 1;
+
+    // Pico de intentos en una ventana de 1 s
+    uint64_t peak = 0;
+    size_t window = 1000 / SAMPLE_PERIOD_MS;
+    for (size_t j = start; j + window <= end + 1 && j + window < timeline.size(); j++)
+      peak = std::max(peak, timeline[j + window].attempts - timeline[j].attempts);
+
+    storms++;
+    printf("Tormenta %d a los %.1f s: %d nodos fuera de línea\n", storms, timeline[start].atMs / 1000.0,
+           options.nodes - lowest);
+    printf("  intentos de conexión %llu (pico %llu/s), conexiones %llu\n",
+           (unsigned long long)(timeline[end].attempts - timeline[start].attempts), (unsigned long long)peak,
+           (unsigned long long)(timeline[end].connects - timeline[start].connects));
+    if (firstBack != 0)
+      printf("  primera reconexión a los %.1f s\n", (timeline[firstBack].atMs - timeline[start].atMs) / 1000.0);
+    if (recovered)
+      printf("  flota completa después de %.1f s\n", (timeline[end].atMs - timeline[start].atMs) / 1000.0);
+    else
+      printf("  la flota no se recuperó antes del final (%d en línea)\n", timeline[end].online);
+  }
+  if (storms == 0)
+    printf("Sin tormentas de reconexión\n");
+}
+
+static void printReport(const std::vector<Timeline> &timeline, double elapsed)
+{
+  printf("\n== Flota: %d nodos, %.0f s, %s cada %u ms ± %.0f %%%s%s ==\n", options.nodes, elapsed,
+         options.binary ? "binario" : "JSON", options.intervalMs, options.jitter * 100,
+         options.queued ? ", por la cola" : "", options.noDelay ? "" : ", con Nagle");
+  if (options.queued)
+    printf("cola: máximo %llu de %d, llena %llu\n", (unsigned long long)queueMax, QUEUE_LENGTH,
+           (unsigned long long)queueFull);
+
+  uint64_t lost = 0;
+  for (const auto &entry : pending)
+    lost += entry.second.size();
+  printf("publicados %llu (%llu bytes), fallidos %llu, sin conexión %llu; recibidos %llu (%llu bytes), perdidos %llu, sin pareja %llu, "
+         "colisiones %llu\n",
+         (unsigned long long)published, (unsigned long long)publishedBytes, (unsigned long long)publishFailures,
+         (unsigned long long)offlineSamples,
+         (unsigned long long)received, (unsigned long long)receivedBytes, (unsigned long long)lost,
+         (unsigned long long)unmatched, (unsigned long long)collisions);
+
+  // Rendimiento promedio y mejor segundo del broker hacia el suscriptor
+  uint64_t best = 0;
+  size_t window = 1000 / SAMPLE_PERIOD_MS;
+  for (size_t j = 0; j + window < timeline.size(); j++)
+    best = std::max(best, timeline[j + window].received - timeline[j].received);
+  printf("rendimiento: %.1f mensajes/s promedio, %llu mensajes/s pico, %.1f KiB/s\n", received / elapsed,
+         (unsigned long long)best, receivedBytes / elapsed / 1024);
+
+  if (!latencies.empty())
+  {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [](double p) { return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))] / 1000.0; };
+    printf("latencia (ms): p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  máx %.2f\n", percentile(0.50), percentile(0.90),
+           percentile(0.99), percentile(0.999), latencies.back() / 1000.0);
+  }
+  printf("conexiones: intentos %llu, aceptadas %llu\n", (unsigned long long)attempts, (unsigned long long)connects);
+  reportStorms(timeline);
+}
+
+int main(int argc, char **argv)
+{
+  int option;
+  while ((option = getopt(argc, argv, "n:t:i:j:h:p:bqNk:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      options.nodes = atoi(optarg);
+      break;
+    case 't':
+      options.seconds = atoi(optarg);
+      break;
+    case 'i':
+      options.intervalMs = strtoul(optarg, NULL, 10);
+      break;
+    case 'j':
+      options.jitter = atof(optarg) / 100;
+      break;
+    case 'h':
+      options.host = optarg;
+      break;
+    case 'p':
+      options.port = atoi(optarg);
+      break;
+    case 'b':
+      options.binary = true;
+      break;
+    case 'q':
+      options.queued = true;
+      break;
+    case 'N':
+      options.noDelay = false;
+      break;
+    case 'k':
+      options.restartAt = atoi(optarg);
+      options.restartCommand = strchr(optarg, ':');
+      if (options.restartCommand != NULL)
+        options.restartCommand++;
+      break;
+    default:
+      fprintf(stderr,
+              "Uso: %s [-n nodos] [-t segundos] [-i intervalo ms] [-j variación %%] [-h host] [-p puerto] [-b] "
+              "[-q] [-N] [-k seg:comando]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (options.nodes <= 0 || options.seconds <= 0 || options.intervalMs == 0 || options.jitter < 0 || options.jitter >= 1)
+  {
+    fprintf(stderr, "Parámetros fuera de rango\n");
+    return 2;
+  }
+
+  std::thread subscriber(subscriberLoop);
+  // El suscriptor entra primero para no perder las primeras muestras
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  std::vector<FleetNode *> nodes;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.nodes; i++)
+  {
+    nodes.push_back(new FleetNode(i));
+    threads.emplace_back(&FleetNode::run, nodes.back());
+  }
+
+  std::vector<Timeline> timeline;
+  int64_t begin = nowUs();
+  bool restarted = false;
+  while (nowUs() - begin < options.seconds * 1000000LL)
+  {
+    timeline.push_back(Timeline{nowMs(), online.load(), attempts.load(), connects.load(), received});
+    if (!restarted && options.restartCommand != NULL && nowUs() - begin >= options.restartAt * 1000000LL)
+    {
+      restarted = true;
+      fprintf(stderr, "Reiniciando el broker: %s\n", options.restartCommand);
+      std::thread([]() { (void)!system(options.restartCommand); }).detach();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(SAMPLE_PERIOD_MS));
+  }
+  double elapsed = (nowUs() - begin) / 1e6;
+
+  publishing = false;
+  for (std::thread &thread : threads)
+    thread.join();
+  // Lo que sigue en vuelo tiene 1 s para llegar antes de contarse como perdido
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  running = false;
+  subscriber.join();
+
+  std::lock_guard<std::mutex> guard(pendingLock);
+  printReport(timeline, elapsed);
+  for (FleetNode *node : nodes)
+    delete node;
+  return 0;
+}
@@ -0,0 +1,1439 @@
+/*
+  Colector de telemetría: del broker a archivos columnares por nodo.
+
+  Se suscribe a ucol/iot/sensores y a sus subtópicos en el broker y guarda
+  cada muestra en la columna que le toca. El nodo es el último nivel del
+  tópico: el firmware y carga_flota.cpp publican en ucol/iot/sensores/<id> y
+  ucol/iot/sensores/bin/<id> con el client ID (makeNodeTopic en
+  Connectivity.h). El JSON no trae identificador, así que lo que llega al
+  tópico sin nivel extra queda en SIN_ID. Lo que cuelga de
+  ucol/iot/sensores/bin son paquetes o lotes de TelemetryPacket.h.
+
+  El JSON de TelemetryEncoder se interpreta en su lugar, sin copiarlo y sin
+  reservar memoria: memchr salta de comilla en comilla (la libc lo hace con
+  instrucciones vectoriales), la clave se reconoce por su longitud y una
+  letra, y los números salen directo a punto fijo. La hora es el campo
+  "timestamp"; "fecha" y "hora" sólo se interpretan si falta, como en los
+  mensajes de createJSON anteriores.
+
+  Cada nodo junta sus filas en memoria y las agrega como un bloque a
+  <dir>/<id>/AAAAMMDD.col (el día de la primera fila) cuando llega a -f filas
+  o cuando el bloque más viejo cumple -s segundos. Bloque, little endian:
+
+    encabezado  "SCOL", versión, columnas, filas, longitud total
+    columnas    por columna: primer valor y luego diferencias con el
+                anterior, en zigzag y varint (LEB128)
+    pie         por columna: desplazamiento, bytes, mínimo y máximo
+                (int64; mínimo > máximo si todas faltan), y CRC-32 de todo
+                lo anterior del bloque
+
+  Los valores son enteros: temperatura, humedad y nivel de agua en
+  centésimas, COLUMN_MISSING si el sensor no respondió (null en el JSON). Un
+  lector que busca un intervalo lee el encabezado, salta al pie y sólo
+  decodifica los bloques cuyo mínimo y máximo de timestamp lo tocan. Un
+  bloque cortado al final del archivo no pasa el CRC y se ignora.
+
+  Con -B no hace falta broker: un hilo escribe en un socketpair los PUBLISH
+  que mandaría el broker para -N nodos (la misma caminata aleatoria que
+  carga_flota.cpp, en los tópicos de makeNodeTopic; uno de cada
+  BENCH_BINARY_EVERY nodos manda paquetes de TelemetryPacket y el resto JSON
+  de TelemetryEncoder) y el colector los lee con un solo hilo. Mide mensajes
+  por segundo y bytes por fila, compara el JSON con la lectura renglón por
+  renglón (strstr, sscanf de fecha y hora, timegm y strtod) y vuelve a leer
+  los archivos para comprobar cada fila de cada nodo y que una consulta de
+  una hora sólo tenga que decodificar un bloque.
+
+  Compilar:
+    g++ -std=c++17 -O2 -pthread -I../SiRIM -o colector colector.cpp
+  Uso:
+    ./colector [-h host] [-p puerto] [-d dir] [-f filas] [-s segundos]
+    ./colector -B [-n mensajes] [-N nodos]
+    ./colector -r archivo.col [desde [hasta]]    (CSV; desde/hasta en segundos Unix)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Connectivity.h"
+#include "Datalog.h"
+#include "TelemetryEncoder.h"
+#include "TelemetryPacket.h"
+#include "Ultrasonic.h"
+
+// Mismos valores que el firmware (env.h, WiFiMQTT.h)
+#define TELEMETRY_TOPIC "ucol/iot/sensores"
+#define BINARY_LEVEL "bin"
+#define BINARY_TOPIC TELEMETRY_TOPIC "/" BINARY_LEVEL // MQTT_BINARY_TOPIC
+#define KEEPALIVE_S 15
+#define SOCKET_TIMEOUT_MS 2000
+
+#define SEGMENT_MAGIC 0x4C4F4353 // "SCOL"
+#define SEGMENT_VERSION 1
+#define SEGMENT_HEADER_SIZE 16
+#define SEGMENT_COLUMN_FOOTER 24
+#define SEGMENT_ROWS 2048
+#define SEGMENT_AGE_S 300
+#define READ_BUFFER_SIZE (1 << 20)
+#define COLUMN_MISSING INT64_MIN
+#define SIN_ID "sin-id"
+#define BENCH_BINARY_EVERY 4 // En -B, nodos por cada uno que publica binario
+
+/*-- Esquema --*/
+
+enum Column : uint8_t
+{
+  COL_TIMESTAMP,
+  COL_TEMPERATURE,
+  COL_HUMIDITY,
+  COL_SOIL1,
+  COL_SOIL2,
+  COL_LIGHT,
+  COL_WATER_LEVEL,
+  COL_WATER_PERCENT,
+  COL_MANUAL,
+  COL_IRRIGATING, // Sólo en el binario
+  COLUMNS
+};
+
+struct ColumnSpec
+{
+  const char *name;
+  uint8_t decimals;
+};
+
+static const ColumnSpec COLUMN_SPECS[COLUMNS] = {
+    {"timestamp", 0}, {"temperaturaAmbiente", 2}, {"humedadAmbiente", 2}, {"sensor1", 0},
+    {"sensor2", 0},   {"iluminacion", 0},         {"nivelAgua", 2},       {"porcentajeAgua", 0},
+    {"riegoManual", 0}, {"riegoActivo", 0},
+};
+
+struct Row
+{
+  int64_t values[COLUMNS];
+};
+
+static std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+static double elapsedSeconds(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// CPU del hilo que llama, sin el que hace de broker en -B
+static double threadSeconds(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Como JsonWriter::number: redondeo a centésimas en float
+static int64_t centi(float value)
+{
+  if (isnan(value) || isinf(value))
+    return COLUMN_MISSING;
+  bool negative = value < 0;
+  int64_t fixed = (int64_t)((negative ? -value : value) * 100 + 0.5f);
+  return negative ? -fixed : fixed;
+}
+
+static Row rowFromSample(const SensorsData &data, bool manual, int64_t irrigating)
+{
+  Row row;
+  row.values[COL_TIMESTAMP] = data.timestamp;
+  row.values[COL_TEMPERATURE] = centi(data.temperature);
+  row.values[COL_HUMIDITY] = centi(data.humidity);
+  row.values[COL_SOIL1] = data.soilMoisture1;
+  row.values[COL_SOIL2] = data.soilMoisture2;
+  row.values[COL_LIGHT] = data.lightIntensity;
+  row.values[COL_WATER_LEVEL] = centi(data.waterLevel);
+  row.values[COL_WATER_PERCENT] = data.waterPercent;
+  row.values[COL_MANUAL] = manual;
+  row.values[COL_IRRIGATING] = irrigating;
+  return row;
+}
+
+/*-- Intérprete del JSON de TelemetryEncoder --*/
+
+class TelemetryParser
+{
+private:
+  // Entero o decimal a punto fijo con `decimals` dígitos; null es COLUMN_MISSING
+  static const char *scalar(const char *p, const char *end, uint8_t decimals, int64_t &value);
+  static int columnOf(const char *key, size_t length);
+  static bool civilToUnix(const char *fecha, size_t fechaLength, const char *hora, size_t horaLength, int64_t &ts);
+
+public:
+  static bool parse(const char *json, size_t length, Row &row);
+};
+
+const char *TelemetryParser ::scalar(const char *p, const char *end, uint8_t decimals, int64_t &value)
+{
+  if (p < end && (*p == 't' || *p == 'f' || *p == 'n'))
+  {
+    size_t word = *p == 'f' ? 5 : 4;
+    if ((size_t)(end - p) < word)
+      return NULL;
+    value = *p == 'n' ? COLUMN_MISSING : (*p == 't');
+    return p + word;
+  }
+
+  bool negative = p < end && *p == '-';
+  p += negative;
+  const char *digitsStart = p;
+  int64_t integer = 0;
+  while (p < end && (unsigned)(*p - '0') < 10)
+    integer = integer * 10 + (*p++ - '0');
+  if (p == digitsStart)
+    return NULL;
+
+  int64_t fraction = 0;
+  uint8_t used = 0;
+  if (p < end && *p == '.')
+  {
+    p++;
+    while (p < end && (unsigned)(*p - '0') < 10)
+    {
+      // Dígitos de más: sólo el siguiente redondea
+      if (used < decimals)
+        fraction = fraction * 10 + (*p - '0');
+      else if (used == decimals && *p >= '5')
+        fraction++;
+      used++;
+      p++;
+    }
+  }
+  int64_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++)
+    scale *= 10;
+  for (uint8_t i = used; i < decimals; i++)
+    fraction *= 10;
+  value = integer * scale + fraction;
+  if (negative)
+    value = -value;
+  return p;
+}
+
+// Longitud y una letra bastan para las claves del esquema; memcmp confirma
+int TelemetryParser ::columnOf(const char *key, size_t length)
+{
+  const char *name = NULL;
+  int column = -1;
+  switch (length)
+  {
+  case 7: // sensor1, sensor2
+    column = key[6] == '1' ? COL_SOIL1 : COL_SOIL2;
+    break;
+  case 9: // timestamp, nivelAgua
+    column = key[0] == 't' ? COL_TIMESTAMP : COL_WATER_LEVEL;
+    break;
+  case 11: // iluminacion, riegoManual
+    column = key[0] == 'i' ? COL_LIGHT : COL_MANUAL;
+    break;
+  case 14:
+    column = COL_WATER_PERCENT;
+    break;
+  case 15:
+    column = COL_HUMIDITY;
+    break;
+  case 19:
+    column = COL_TEMPERATURE;
+    break;
+  default:
+    return -1;
+  }
+  name = COLUMN_SPECS[column].name;
+  return memcmp(key, name, length) == 0 ? column : -1;
+}
+
+// "d/m/aaaa" y "h:m:s" sin zona horaria, como civilFromUnix al revés
+bool TelemetryParser ::civilToUnix(const char *fecha, size_t fechaLength, const char *hora, size_t horaLength,
+                                   int64_t &ts)
+{
+  int64_t parts[6];
+  const char *texts[2] = {fecha, hora};
+  size_t lengths[2] = {fechaLength, horaLength};
+  for (int t = 0; t < 2; t++)
+  {
+    const char *p = texts[t];
+    const char *end = p + lengths[t];
+    for (int i = 0; i < 3; i++)
+    {
+      p = scalar(p, end, 0, parts[t * 3 + i]);
+      if (p == NULL || (i < 2 && (p >= end || (*p != '/' && *p != ':'))))
+        return false;
+      p += i < 2;
+    }
+  }
+  int64_t day = parts[0], month = parts[1], year = parts[2];
+  if (month < 1 || month > 12 || day < 1 || day > 31)
+    return false;
+  // Días civiles de H. Hinnant
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t yoe = year - era * 400;
+  int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = era * 146097 + doe - 719468;
+  ts = days * 86400 + parts[3] * 3600 + parts[4] * 60 + parts[5];
+  return true;
+}
+
+bool TelemetryParser ::parse(const char *json, size_t length, Row &row)
+{
+  for (int c = 0; c < COLUMNS; c++)
+    row.values[c] = COLUMN_MISSING;
+  const char *fecha = NULL, *hora = NULL;
+  size_t fechaLength = 0, horaLength = 0;
+
+  const char *p = json;
+  const char *end = json + length;
+  while (p < end)
+  {
+    // Clave
+    const char *key = (const char *)memchr(p, '"', end - p);
+    if (key == NULL)
+      break;
+    key++;
+    const char *keyEnd = (const char *)memchr(key, '"', end - key);
+    if (keyEnd == NULL)
+      return false;
+    p = keyEnd + 1;
+    while (p < end && *p == ' ')
+      p++;
+    if (p >= end || *p != ':')
+      return false;
+    p++;
+    while (p < end && *p == ' ')
+      p++;
+    if (p >= end)
+      return false;
+
+    // Valor: un objeto (humedadSuelo) se recorre como si fuera plano
+    if (*p == '{')
+    {
+      p++;
+      continue;
+    }
+    if (*p == '"')
+    {
+      const char *text = p + 1;
+      const char *close = text;
+      do
+      {
+        close = (const char *)memchr(close, '"', end - close);
+        if (close == NULL)
+          return false;
+      } while (close[-1] == '\\' && close++);
+      size_t keyLength = keyEnd - key;
+      if (keyLength == 5 && memcmp(key, "fecha", 5) == 0)
+        fecha = text, fechaLength = close - text;
+      else if (keyLength == 4 && memcmp(key, "hora", 4) == 0)
+        hora = text, horaLength = close - text;
+      p = close + 1;
+      continue;
+    }
+
+    int column = columnOf(key, keyEnd - key);
+    int64_t value;
+    p = scalar(p, end, column >= 0 ? COLUMN_SPECS[column].decimals : 0, value);
+    if (p == NULL)
+      return false;
+    if (column >= 0)
+      row.values[column] = value;
+  }
+
+  if (row.values[COL_TIMESTAMP] == COLUMN_MISSING)
+  {
+    if (fecha == NULL || hora == NULL || !civilToUnix(fecha, fechaLength, hora, horaLength, row.values[COL_TIMESTAMP]))
+      return false;
+  }
+  return true;
+}
+
+/*-- Segmentos columnares --*/
+
+static size_t putVarint(uint8_t *out, int64_t value)
+{
+  // Zigzag: las diferencias negativas pequeñas también caben en un byte
+  uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+  size_t used = 0;
+  while (zigzag >= 0x80)
+  {
+    out[used++] = (uint8_t)zigzag | 0x80;
+    zigzag >>= 7;
+  }
+  out[used++] = (uint8_t)zigzag;
+  return used;
+}
+
+static const uint8_t *getVarint(const uint8_t *in, const uint8_t *end, int64_t &value)
+{
+  uint64_t zigzag = 0;
+  for (int shift = 0; in < end && shift < 64; shift += 7)
+  {
+    uint8_t byte = *in++;
+    zigzag |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+      return in;
+    }
+  }
+  return NULL;
+}
+
+static void putI64(uint8_t *p, int64_t v)
+{
+  putU32(p, (uint32_t)v);
+  putU32(p + 4, (uint32_t)((uint64_t)v >> 32));
+}
+
+static int64_t getI64(const uint8_t *p) { return (int64_t)((uint64_t)getU32(p) | (uint64_t)getU32(p + 4) << 32); }
+
+class ColumnBatch
+{
+public:
+  std::vector<int64_t> columns[COLUMNS];
+  double openedAt = 0;
+
+  size_t rows(void) const { return columns[0].size(); }
+  void add(const Row &row)
+  {
+    if (rows() == 0)
+      openedAt = elapsedSeconds();
+    for (int c = 0; c < COLUMNS; c++)
+      columns[c].push_back(row.values[c]);
+  }
+  void clear(void)
+  {
+    for (int c = 0; c < COLUMNS; c++)
+      columns[c].clear();
+  }
+
+  // Bloque completo en `out`; devuelve su longitud
+  size_t encode(std::vector<uint8_t> &out) const;
+};
+
+size_t ColumnBatch ::encode(std::vector<uint8_t> &out) const
+{
+  size_t count = rows();
+  size_t footer = COLUMNS * SEGMENT_COLUMN_FOOTER + 4;
+  out.resize(SEGMENT_HEADER_SIZE + COLUMNS * count * 10 + footer);
+  uint8_t *base = out.data();
+  uint8_t *p = base + SEGMENT_HEADER_SIZE;
+
+  uint32_t offsets[COLUMNS], lengths[COLUMNS];
+  int64_t minimum[COLUMNS], maximum[COLUMNS];
+  for (int c = 0; c < COLUMNS; c++)
+  {
+    const int64_t *v = columns[c].data();
+    offsets[c] = p - base;
+    int64_t previous = 0, low = INT64_MAX, high = INT64_MIN;
+    for (size_t r = 0; r < count; r++)
+    {
+      p += putVarint(p, v[r] - previous);
+      previous = v[r];
+      if (v[r] != COLUMN_MISSING)
+      {
+        low = std::min(low, v[r]);
+        high = std::max(high, v[r]);
+      }
+    }
+    lengths[c] = (p - base) - offsets[c];
+    minimum[c] = low;
+    maximum[c] = high;
+  }
+
+  for (int c = 0; c < COLUMNS; c++, p += SEGMENT_COLUMN_FOOTER)
+  {
+    putU32(p, offsets[c]);
+    putU32(p + 4, lengths[c]);
+    putI64(p + 8, minimum[c]);
+    putI64(p + 16, maximum[c]);
+  }
+  size_t total = (p - base) + 4;
+  putU32(base, SEGMENT_MAGIC);
+  base[4] = SEGMENT_VERSION;
+  base[5] = COLUMNS;
+  putU16(base + 6, 0);
+  putU32(base + 8, (uint32_t)count);
+  putU32(base + 12, (uint32_t)total);
+  putU32(p, crc32Update(0, base, p - base));
+  out.resize(total);
+  return total;
+}
+
+// Un bloque leído del archivo
+struct SegmentBlock
+{
+  uint32_t rows;
+  int64_t minimum[COLUMNS];
+  int64_t maximum[COLUMNS];
+  uint32_t offsets[COLUMNS];
+  uint32_t lengths[COLUMNS];
+};
+
+class SegmentReader
+{
+private:
+  FILE *file;
+  std::vector<uint8_t> block;
+
+public:
+  uint32_t corrupt = 0;
+
+  SegmentReader(FILE *f) : file(f) {}
+
+  // Siguiente bloque válido; false al terminar el archivo o en un bloque roto
+  bool next(SegmentBlock &info);
+  // Columna del último bloque
+  bool column(const SegmentBlock &info, int c, std::vector<int64_t> &values);
+};
+
+bool SegmentReader ::next(SegmentBlock &info)
+{
+  uint8_t header[SEGMENT_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header))
+    return false;
+  uint32_t total = getU32(header + 12);
+  size_t footer = header[5] * SEGMENT_COLUMN_FOOTER + 4;
+  if (getU32(header) != SEGMENT_MAGIC || header[4] != SEGMENT_VERSION || header[5] != COLUMNS ||
+      total < SEGMENT_HEADER_SIZE + footer)
+  {
+    corrupt++;
+    return false;
+  }
+  block.resize(total);
+  memcpy(block.data(), header, sizeof(header));
+  if (fread(block.data() + sizeof(header), 1, total - sizeof(header), file) != total - sizeof(header) ||
+      crc32Update(0, block.data(), total - 4) != getU32(block.data() + total - 4))
+  {
+    corrupt++;
+    return false;
+  }
+
+  info.rows = getU32(header + 8);
+  const uint8_t *foot = block.data() + total - footer;
+  for (int c = 0; c < COLUMNS; c++, foot += SEGMENT_COLUMN_FOOTER)
+  {
+    info.offsets[c] = getU32(foot);
+    info.lengths[c] = getU32(foot + 4);
+    info.minimum[c] = getI64(foot + 8);
+    info.maximum[c] = getI64(foot + 16);
+  }
+  return true;
+}
+
+bool SegmentReader ::column(const SegmentBlock &info, int c, std::vector<int64_t> &values)
+{
+  const uint8_t *p = block.data() + info.offsets[c];
+  const uint8_t *end = p + info.lengths[c];
+  if (end > block.data() + block.size())
+    return false;
+  values.resize(info.rows);
+  int64_t previous = 0;
+  for (uint32_t r = 0; r < info.rows; r++)
+  {
+    int64_t delta;
+    p = getVarint(p, end, delta);
+    if (p == NULL)
+      return false;
+    previous += delta;
+    values[r] = previous;
+  }
+  return true;
+}
+
+/*-- Colector --*/
+
+class Collector
+{
+private:
+  struct Device
+  {
+    std::string directory;
+    ColumnBatch batch;
+  };
+
+  std::string root;
+  std::unordered_map<std::string, Device> devices;
+  std::string key; // Se reutiliza para no reservar en cada mensaje
+  std::vector<uint8_t> encoded;
+
+  Device &device(const char *id, size_t length);
+  void flush(Device &d);
+
+public:
+  size_t segmentRows = SEGMENT_ROWS;
+  double segmentAge = SEGMENT_AGE_S;
+
+  // Métricas
+  uint64_t messages = 0;
+  uint64_t rows = 0;
+  uint64_t rejected = 0;
+  uint64_t payloadBytes = 0;
+  uint64_t segments = 0;
+  uint64_t segmentBytes = 0;
+
+  Collector(const char *directory) : root(directory) { mkdir(root.c_str(), 0755); }
+
+  void ingest(const char *topic, size_t topicLength, const uint8_t *payload, size_t length);
+  // Bloques que ya cumplieron -s segundos; con all, todos
+  void flushOld(bool all);
+  size_t deviceCount(void) const { return devices.size(); }
+};
+
+Collector::Device &Collector ::device(const char *id, size_t length)
+{
+  key.assign(id, length);
+  auto found = devices.find(key);
+  if (found != devices.end())
+    return found->second;
+
+  Device &d = devices[key];
+  // El id llega del tópico: sólo caracteres seguros para un nombre de directorio
+  std::string safe = key;
+  for (char &c : safe)
+    if (!isalnum((unsigned char)c) && c != '-' && c != '_')
+      c = '_';
+  d.directory = root + "/" + safe;
+  d.batch.clear();
+  for (int c = 0; c < COLUMNS; c++)
+    d.batch.columns[c].reserve(segmentRows);
+  return d;
+}
+
+void Collector ::ingest(const char *topic, size_t topicLength, const uint8_t *payload, size_t length)
+{
+  messages++;
+  payloadBytes += length;
+
+  // ucol/iot/sensores[/bin][/<id>]
+  size_t prefix = sizeof(TELEMETRY_TOPIC) - 1;
+  if (topicLength < prefix || memcmp(topic, TELEMETRY_TOPIC, prefix) != 0)
+  {
+    rejected++;
+    return;
+  }
+  const char *rest = topic + prefix + (topicLength > prefix);
+  size_t restLength = topicLength > prefix ? topicLength - prefix - 1 : 0;
+  bool binary = false;
+  if (restLength >= sizeof(BINARY_LEVEL) - 1 && memcmp(rest, BINARY_LEVEL, sizeof(BINARY_LEVEL) - 1) == 0 &&
+      (restLength == sizeof(BINARY_LEVEL) - 1 || rest[sizeof(BINARY_LEVEL) - 1] == '/'))
+  {
+    binary = true;
+    size_t skip = std::min(restLength, sizeof(BINARY_LEVEL));
+    rest += skip;
+    restLength -= skip;
+  }
+  if (restLength == 0)
+  {
+    rest = SIN_ID;
+    restLength = sizeof(SIN_ID) - 1;
+  }
+  Device &d = device(rest, restLength);
+
+  if (binary)
+  {
+    // Lote del modo de bajo consumo o un paquete suelto
+    size_t count = TelemetryPacket::batchCount(payload, length);
+    if (count == 0)
+      count = TelemetryPacket::isPacket(payload, length) ? 1 : 0;
+    if (count == 0)
+      rejected++;
+    for (size_t i = 0; i < count; i++)
+    {
+      TelemetryRecord record;
+      TelemetryPacket::decode(payload + i * TELEMETRY_PACKET_SIZE, TELEMETRY_PACKET_SIZE, record);
+      d.batch.add(rowFromSample(record.data, record.manualIrrigation, record.irrigating));
+      rows++;
+    }
+  }
+  else
+  {
+    Row row;
+    if (!TelemetryParser::parse((const char *)payload, length, row))
+    {
+      rejected++;
+      return;
+    }
+    d.batch.add(row);
+    rows++;
+  }
+  if (d.batch.rows() >= segmentRows)
+    flush(d);
+}
+
+void Collector ::flush(Device &d)
+{
+  if (d.batch.rows() == 0)
+    return;
+  CivilTime t = TelemetryEncoder::civilFromUnix((uint32_t)d.batch.columns[COL_TIMESTAMP][0]);
+  char name[24];
+  snprintf(name, sizeof(name), "/%04u%02u%02u.col", t.year, t.month, t.day);
+
+  size_t length = d.batch.encode(encoded);
+  mkdir(d.directory.c_str(), 0755);
+  FILE *f = fopen((d.directory + name).c_str(), "ab");
+  if (f == NULL || fwrite(encoded.data(), 1, length, f) != length)
+    fprintf(stderr, "No se pudo escribir %s%s: %s\n", d.directory.c_str(), name, strerror(errno));
+  if (f != NULL)
+    fclose(f);
+  segments++;
+  segmentBytes += length;
+  d.batch.clear();
+}
+
+void Collector ::flushOld(bool all)
+{
+  double now = elapsedSeconds();
+  for (auto &entry : devices)
+    if (all || (entry.second.batch.rows() > 0 && now - entry.second.batch.openedAt >= segmentAge))
+      flush(entry.second);
+}
+
+/*-- Entrada MQTT --*/
+
+// Lee el socket en bloques grandes y entrega cada PUBLISH apuntando al
+// buffer; el tópico y el contenido valen hasta la siguiente llamada
+class PublishStream
+{
+private:
+  int fd;
+  std::vector<uint8_t> buffer;
+  size_t begin = 0;
+  size_t end = 0;
+
+public:
+  bool closed = false;
+
+  PublishStream(int socket) : fd(socket), buffer(READ_BUFFER_SIZE) {}
+
+  // Devuelve el tipo de paquete (0x30 para PUBLISH) o 0 si no hay uno completo
+  uint8_t next(const char *&topic, size_t &topicLength, const uint8_t *&payload, size_t &length);
+  // Espera datos hasta timeoutMs; false si el socket se cerró
+  bool fill(int timeoutMs);
+};
+
+uint8_t PublishStream ::next(const char *&topic, size_t &topicLength, const uint8_t *&payload, size_t &length)
+{
+  while (true)
+  {
+    const uint8_t *p = buffer.data() + begin;
+    size_t available = end - begin;
+    if (available < 2)
+      return 0;
+    size_t remaining = 0;
+    size_t used = 1;
+    for (int shift = 0;; shift += 7)
+    {
+      if (used >= available)
+        return 0;
+      uint8_t digit = p[used++];
+      remaining |= (size_t)(digit & 0x7F) << shift;
+      if ((digit & 0x80) == 0)
+        break;
+      if (shift >= 21)
+      {
+        closed = true;
+        return 0;
+      }
+    }
+    if (used + remaining > buffer.size())
+    {
+      // Un paquete más grande que el buffer: se agranda
+      buffer.resize(used + remaining);
+      p = buffer.data() + begin;
+    }
+    if (used + remaining > available)
+      return 0;
+
+    uint8_t type = p[0] & 0xF0;
+    begin += used + remaining;
+    if (type != 0x30)
+      return type;
+    const uint8_t *body = p + used;
+    topicLength = (size_t)body[0] << 8 | body[1];
+    if (remaining < 2 + topicLength)
+      continue;
+    topic = (const char *)body + 2;
+    // QoS 1 o 2 traen identificador de paquete; la suscripción es QoS 0
+    size_t id = (p[0] & 0x06) ? 2 : 0;
+    payload = body + 2 + topicLength + id;
+    length = remaining - 2 - topicLength - id;
+    return type;
+  }
+}
+
+bool PublishStream ::fill(int timeoutMs)
+{
+  // Lo que queda de un paquete incompleto pasa al inicio
+  if (begin > 0)
+  {
+    memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+  }
+  if (end == buffer.size())
+    buffer.resize(buffer.size() * 2);
+  struct pollfd waiting = {fd, POLLIN, 0};
+  if (poll(&waiting, 1, timeoutMs) != 1)
+    return !closed;
+  ssize_t got = ::recv(fd, buffer.data() + end, buffer.size() - end, 0);
+  if (got <= 0)
+  {
+    closed = true;
+    return false;
+  }
+  end += got;
+  return true;
+}
+
+static size_t putLength(uint8_t *out, size_t length)
+{
+  size_t used = 0;
+  do
+  {
+    uint8_t digit = length % 128;
+    length /= 128;
+    out[used++] = digit | (length > 0 ? 0x80 : 0);
+  } while (length > 0);
+  return used;
+}
+
+static size_t putString(uint8_t *out, const char *text)
+{
+  size_t length = strlen(text);
+  out[0] = (uint8_t)(length >> 8);
+  out[1] = (uint8_t)length;
+  memcpy(out + 2, text, length);
+  return length + 2;
+}
+
+static bool sendAll(int fd, const uint8_t *data, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t sent = ::send(fd, data, length, MSG_NOSIGNAL);
+    if (sent <= 0)
+      return false;
+    data += sent;
+    length -= sent;
+  }
+  return true;
+}
+
+// CONNECT y SUBSCRIBE a la telemetría y sus subtópicos; devuelve el socket o -1
+static int connectBroker(const char *host, uint16_t port)
+{
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  struct addrinfo hints = {}, *address = NULL;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, service, &hints, &address) != 0)
+    return -1;
+  int fd = socket(address->ai_family, address->ai_socktype, 0);
+  if (fd < 0 || ::connect(fd, address->ai_addr, address->ai_addrlen) != 0)
+  {
+    freeaddrinfo(address);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  freeaddrinfo(address);
+  // Búfer de recepción grande: el broker manda ráfagas de toda la flota
+  int size = 4 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  uint8_t packet[256];
+  uint8_t variable[] = {0, 4, 'M', 'Q', 'T', 'T', 4, 0x02 /* sesión limpia */, 0, KEEPALIVE_S};
+  char clientId[32];
+  snprintf(clientId, sizeof(clientId), "sirim-colector-%d", (int)getpid());
+  size_t used = 0;
+  packet[used++] = 0x10;
+  used += putLength(packet + used, sizeof(variable) + 2 + strlen(clientId));
+  memcpy(packet + used, variable, sizeof(variable));
+  used += sizeof(variable);
+  used += putString(packet + used, clientId);
+
+  // Dos filtros en un SUBSCRIBE: el tópico y todo lo que cuelga de él
+  uint8_t subscribe[128];
+  size_t s = 0;
+  subscribe[s++] = 0x82;
+  size_t body = 2 + 2 * 2 + (sizeof(TELEMETRY_TOPIC) - 1) * 2 + 2 + 2;
+  s += putLength(subscribe + s, body);
+  subscribe[s++] = 0;
+  subscribe[s++] = 1;
+  s += putString(subscribe + s, TELEMETRY_TOPIC);
+  subscribe[s++] = 0;
+  s += putString(subscribe + s, TELEMETRY_TOPIC "/#");
+  subscribe[s++] = 0;
+
+  PublishStream handshake(fd);
+  const char *topic;
+  size_t topicLength, length;
+  const uint8_t *payload;
+  if (!sendAll(fd, packet, used) || !handshake.fill(SOCKET_TIMEOUT_MS) ||
+      handshake.next(topic, topicLength, payload, length) != 0x20 || !sendAll(fd, subscribe, s))
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*-- Modo en línea --*/
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) { stopRequested = 1; }
+
+static int runLive(const char *host, uint16_t port, Collector &collector)
+{
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  double lastReport = elapsedSeconds();
+  uint64_t lastMessages = 0;
+
+  while (!stopRequested)
+  {
+    int fd = connectBroker(host, port);
+    if (fd < 0)
+    {
+      fprintf(stderr, "Sin conexión con %s:%u, reintentando\n", host, port);
+      sleep(2);
+      continue;
+    }
+    printf("Suscrito a %s y %s/# en %s:%u\n", TELEMETRY_TOPIC, TELEMETRY_TOPIC, host, port);
+
+    PublishStream stream(fd);
+    double lastPing = elapsedSeconds();
+    while (!stopRequested && stream.fill(1000))
+    {
+      const char *topic;
+      size_t topicLength, length;
+      const uint8_t *payload;
+      uint8_t type;
+      while ((type = stream.next(topic, topicLength, payload, length)) != 0)
+        if (type == 0x30)
+          collector.ingest(topic, topicLength, payload, length);
+
+      double now = elapsedSeconds();
+      if (now - lastPing > KEEPALIVE_S / 2)
+      {
+        uint8_t ping[] = {0xC0, 0x00};
+        sendAll(fd, ping, sizeof(ping));
+        lastPing = now;
+      }
+      collector.flushOld(false);
+      if (now - lastReport >= 10)
+      {
+        printf("%.0f msg/s, %zu nodos, %llu filas, %llu rechazados, %llu bloques (%.1f B/fila)\n",
+               (collector.messages - lastMessages) / (now - lastReport), collector.deviceCount(),
+               (unsigned long long)collector.rows, (unsigned long long)collector.rejected,
+               (unsigned long long)collector.segments,
+               collector.segments ? (double)collector.segmentBytes / (collector.rows ? collector.rows : 1) : 0.0);
+        fflush(stdout);
+        lastMessages = collector.messages;
+        lastReport = now;
+      }
+    }
+    close(fd);
+  }
+  collector.flushOld(true);
+  printf("%llu mensajes, %llu filas en %llu bloques\n", (unsigned long long)collector.messages,
+         (unsigned long long)collector.rows, (unsigned long long)collector.segments);
+  return 0;
+}
+
+/*-- Lectura de un archivo --*/
+
+static void printValue(int64_t value, uint8_t decimals)
+{
+  if (value == COLUMN_MISSING)
+    return;
+  if (decimals == 0)
+  {
+    printf("%lld", (long long)value);
+    return;
+  }
+  int64_t magnitude = value < 0 ? -value : value;
+  printf("%s%lld.%02lld", value < 0 ? "-" : "", (long long)(magnitude / 100), (long long)(magnitude % 100));
+}
+
+static int readSegments(const char *path, int64_t from, int64_t to)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+  {
+    fprintf(stderr, "No se pudo abrir %s\n", path);
+    return 1;
+  }
+  for (int c = 0; c < COLUMNS; c++)
+    printf("%s%s", c ? "," : "", COLUMN_SPECS[c].name);
+  printf("\n");
+
+  SegmentReader reader(f);
+  SegmentBlock info;
+  uint32_t blocks = 0, skipped = 0;
+  std::vector<int64_t> columns[COLUMNS];
+  while (reader.next(info))
+  {
+    blocks++;
+    // Sólo el pie decide si el bloque se decodifica
+    if (info.maximum[COL_TIMESTAMP] < from || info.minimum[COL_TIMESTAMP] > to)
+    {
+      skipped++;
+      continue;
+    }
+    for (int c = 0; c < COLUMNS; c++)
+      reader.column(info, c, columns[c]);
+    for (uint32_t r = 0; r < info.rows; r++)
+    {
+      int64_t ts = columns[COL_TIMESTAMP][r];
+      if (ts < from || ts > to)
+        continue;
+      for (int c = 0; c < COLUMNS; c++)
+      {
+        if (c)
+          printf(",");
+        printValue(columns[c][r], COLUMN_SPECS[c].decimals);
+      }
+      printf("\n");
+    }
+  }
+  fclose(f);
+  fprintf(stderr, "%u bloques, %u saltados por el pie, %u dañados\n", blocks, skipped, reader.corrupt);
+  return 0;
+}
+
+/*-- Banco de pruebas --*/
+
+struct FleetMessage
+{
+  std::string node; // Client ID: el directorio del nodo
+  std::string topic;
+  std::string payload;
+  bool binary;
+  Row expected;
+};
+
+// Muestras de la flota con la caminata de carga_flota.cpp, una por nodo cada 5 s
+static std::vector<FleetMessage> fleetMessages(int nodes, int perNode)
+{
+  std::mt19937 rng(24);
+  auto uniform = [&rng](float low, float high) { return std::uniform_real_distribution<float>(low, high)(rng); };
+  auto percent = [](int value) { return value < 0 ? 0 : (value > 100 ? 100 : value); };
+
+  std::vector<SensorsData> data(nodes);
+  std::vector<std::string> ids(nodes), topics(nodes);
+  for (int n = 0; n < nodes; n++)
+  {
+    // Los mismos client ID y tópicos que carga_flota.cpp y el firmware
+    uint8_t mac[6] = {0x24, 0x0A, 0xC4, (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+    char clientId[MQTT_CLIENT_ID_SIZE], topic[MQTT_NODE_TOPIC_SIZE];
+    makeClientId(clientId, sizeof(clientId), mac);
+    bool binary = n % BENCH_BINARY_EVERY == BENCH_BINARY_EVERY - 1;
+    makeNodeTopic(topic, sizeof(topic), binary ? BINARY_TOPIC : TELEMETRY_TOPIC, clientId);
+    ids[n] = clientId;
+    topics[n] = topic;
+    data[n] = {uniform(18, 30), uniform(40, 80), (int16_t)uniform(20, 80), (int16_t)uniform(20, 80),
+               (int16_t)uniform(0, 100), uniform(TANK_FULL_CM, TANK_EMPTY_CM), 50, 1718000000};
+  }
+
+  std::vector<FleetMessage> messages;
+  messages.reserve((size_t)nodes * perNode);
+  char payload[256];
+  for (int s = 0; s < perNode; s++)
+    for (int n = 0; n < nodes; n++)
+    {
+      SensorsData &d = data[n];
+      d.temperature += uniform(-0.2f, 0.2f);
+      d.humidity += uniform(-0.5f, 0.5f);
+      d.soilMoisture1 = percent(d.soilMoisture1 + (int)uniform(-1.5f, 1.5f));
+      d.soilMoisture2 = percent(d.soilMoisture2 + (int)uniform(-1.5f, 1.5f));
+      d.lightIntensity = percent(d.lightIntensity + (int)uniform(-3, 3));
+      d.waterLevel = std::min(TANK_EMPTY_CM, std::max(TANK_FULL_CM, d.waterLevel + uniform(-0.1f, 0.1f)));
+      d.waterPercent = (int)UltrasonicFilter::tankPercent(d.waterLevel);
+      d.timestamp = 1718000000 + s * 5 + n % 5;
+      SensorsData sample = d;
+      // De vez en cuando el DHT11 no contesta
+      if (rng() % 200 == 0)
+        sample.temperature = sample.humidity = NAN;
+      bool manual = rng() % 50 == 0;
+      size_t length;
+      if (n % BENCH_BINARY_EVERY == BENCH_BINARY_EVERY - 1)
+      {
+        // Lo que guarda el colector es lo que sobrevive al punto fijo del paquete
+        bool irrigating = rng() % 10 == 0;
+        length = TelemetryPacket::encode(sample, (uint16_t)s, manual, irrigating, (uint8_t *)payload, sizeof(payload));
+        TelemetryRecord record;
+        TelemetryPacket::decode((const uint8_t *)payload, length, record);
+        messages.push_back({ids[n], topics[n], std::string(payload, length), true,
+                            rowFromSample(record.data, record.manualIrrigation, record.irrigating)});
+        continue;
+      }
+      TelemetryEncoder::encode(sample, manual, payload, sizeof(payload), &length);
+      messages.push_back(
+          {ids[n], topics[n], std::string(payload, length), false, rowFromSample(sample, manual, COLUMN_MISSING)});
+    }
+  return messages;
+}
+
+// La ingesta de antes: cada campo con strstr y strtod, fecha y hora con sscanf y timegm
+static bool parseRowByRow(const char *json, Row &row)
+{
+  static const char *const keys[COLUMNS] = {NULL,         "\"temperaturaAmbiente\":", "\"humedadAmbiente\":",
+                                            "\"sensor1\":", "\"sensor2\":",             "\"iluminacion\":",
+                                            "\"nivelAgua\":", "\"porcentajeAgua\":",    "\"riegoManual\":",
+                                            NULL};
+  const char *fecha = strstr(json, "\"fecha\":\"");
+  const char *hora = strstr(json, "\"hora\":\"");
+  struct tm civil = {};
+  if (fecha == NULL || hora == NULL ||
+      sscanf(fecha + 9, "%d/%d/%d", &civil.tm_mday, &civil.tm_mon, &civil.tm_year) != 3 ||
+      sscanf(hora + 8, "%d:%d:%d", &civil.tm_hour, &civil.tm_min, &civil.tm_sec) != 3)
+    return false;
+  civil.tm_mon -= 1;
+  civil.tm_year -= 1900;
+  row.values[COL_TIMESTAMP] = timegm(&civil);
+  for (int c = 1; c < COLUMNS; c++)
+  {
+    const char *found = keys[c] ? strstr(json, keys[c]) : NULL;
+    if (found == NULL)
+    {
+      row.values[c] = COLUMN_MISSING;
+      continue;
+    }
+    const char *value = found + strlen(keys[c]);
+    if (*value == 'n')
+      row.values[c] = COLUMN_MISSING;
+    else if (*value == 't' || *value == 'f')
+      row.values[c] = *value == 't';
+    else
+      row.values[c] = (int64_t)llround(strtod(value, NULL) * (COLUMN_SPECS[c].decimals ? 100 : 1));
+  }
+  return true;
+}
+
+// PUBLISH QoS 0 tal como lo manda el broker
+static void appendPublish(std::vector<uint8_t> &out, const FleetMessage &m)
+{
+  uint8_t header[8];
+  size_t used = 0;
+  header[used++] = 0x30;
+  used += putLength(header + used, 2 + m.topic.size() + m.payload.size());
+  out.insert(out.end(), header, header + used);
+  out.push_back((uint8_t)(m.topic.size() >> 8));
+  out.push_back((uint8_t)m.topic.size());
+  out.insert(out.end(), m.topic.begin(), m.topic.end());
+  out.insert(out.end(), m.payload.begin(), m.payload.end());
+}
+
+static int runBenchmark(uint64_t total, int nodes)
+{
+  // Cada corrida en un directorio nuevo para poder verificarlo completo
+  char temporary[] = "/tmp/sirim-colector-XXXXXX";
+  const char *directory = mkdtemp(temporary);
+  if (directory == NULL)
+  {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  int failures = 0;
+  int perNode = 200;
+  std::vector<FleetMessage> fleet = fleetMessages(nodes, perNode);
+  size_t pool = fleet.size();
+
+  // Los intérpretes sólo ven los mensajes JSON
+  std::vector<const FleetMessage *> json;
+  double jsonBytes = 0;
+  for (const FleetMessage &m : fleet)
+    if (!m.binary)
+    {
+      json.push_back(&m);
+      jsonBytes += m.payload.size();
+    }
+  jsonBytes /= json.size();
+
+  // Solo el intérprete, sin socket ni archivos
+  uint64_t parseRounds = std::max<uint64_t>(total, json.size());
+  Row row;
+  uint64_t parsed = 0;
+  double t0 = elapsedSeconds();
+  for (uint64_t i = 0; i < parseRounds; i++)
+  {
+    const std::string &p = json[i % json.size()]->payload;
+    parsed += TelemetryParser::parse(p.data(), p.size(), row);
+  }
+  double parseSeconds = elapsedSeconds() - t0;
+
+  uint64_t legacyRounds = std::max<uint64_t>(parseRounds / 10, json.size());
+  uint64_t legacyParsed = 0;
+  t0 = elapsedSeconds();
+  for (uint64_t i = 0; i < legacyRounds; i++)
+    legacyParsed += parseRowByRow(json[i % json.size()]->payload.c_str(), row);
+  double legacySeconds = elapsedSeconds() - t0;
+
+  // Todas las filas, en los dos intérpretes, iguales a la muestra codificada
+  for (const FleetMessage *m : json)
+  {
+    Row fast, slow;
+    if (!TelemetryParser::parse(m->payload.data(), m->payload.size(), fast) || !parseRowByRow(m->payload.c_str(), slow))
+    {
+      failures++;
+      continue;
+    }
+    for (int c = 0; c < COL_IRRIGATING; c++)
+      if (fast.values[c] != m->expected.values[c] || slow.values[c] != m->expected.values[c])
+      {
+        if (failures < 5)
+          printf("  FALLA %s: %s %lld, se esperaba %lld\n", m->payload.c_str(), COLUMN_SPECS[c].name,
+                 (long long)fast.values[c], (long long)m->expected.values[c]);
+        failures++;
+        break;
+      }
+  }
+
+  // Sin "timestamp", como los mensajes de createJSON: la hora sale de fecha y hora
+  {
+    std::string legacy = json[0]->payload;
+    size_t at = legacy.find(",\"timestamp\"");
+    legacy = legacy.substr(0, at) + "}";
+    Row fast;
+    if (!TelemetryParser::parse(legacy.data(), legacy.size(), fast) ||
+        fast.values[COL_TIMESTAMP] != json[0]->expected.values[COL_TIMESTAMP])
+    {
+      printf("  FALLA sin timestamp: la hora de fecha y hora no coincide\n");
+      failures++;
+    }
+  }
+
+  // Del socket a los archivos con un solo hilo, como el colector en línea
+  std::vector<uint8_t> wire;
+  for (const FleetMessage &m : fleet)
+    appendPublish(wire, m);
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+  {
+    perror("socketpair");
+    return 1;
+  }
+  uint64_t rounds = (total + pool - 1) / pool;
+  std::thread broker([&]() {
+    for (uint64_t r = 0; r < rounds; r++)
+      sendAll(pair[0], wire.data(), wire.size());
+    close(pair[0]);
+  });
+
+  Collector collector(directory);
+  PublishStream stream(pair[1]);
+  double cpu0 = threadSeconds();
+  t0 = elapsedSeconds();
+  while (stream.fill(1000))
+  {
+    const char *topic;
+    size_t topicLength, length;
+    const uint8_t *payload;
+    while (stream.next(topic, topicLength, payload, length) == 0x30)
+      collector.ingest(topic, topicLength, payload, length);
+  }
+  collector.flushOld(true);
+  double ingestSeconds = elapsedSeconds() - t0;
+  double ingestCpu = threadSeconds() - cpu0;
+  broker.join();
+  close(pair[1]);
+
+  // Leer de vuelta: cada nodo tiene sus filas en orden, una vuelta tras otra
+  uint64_t checked = 0;
+  uint32_t corrupt = 0;
+  for (int n = 0; n < nodes; n++)
+  {
+    std::string path = std::string(directory) + "/" + fleet[n].node + "/20240610.col";
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+    {
+      printf("  FALLA no existe %s\n", path.c_str());
+      failures++;
+      continue;
+    }
+    SegmentReader reader(f);
+    SegmentBlock info;
+    std::vector<int64_t> columns[COLUMNS];
+    uint64_t index = 0;
+    while (reader.next(info))
+    {
+      for (int c = 0; c < COLUMNS; c++)
+        reader.column(info, c, columns[c]);
+      for (uint32_t r = 0; r < info.rows; r++, index++)
+      {
+        const Row &expected = fleet[(index % perNode) * nodes + n].expected;
+        for (int c = 0; c < COLUMNS; c++)
+          if (columns[c][r] != expected.values[c])
+          {
+            if (failures < 5)
+              printf("  FALLA nodo %d fila %llu: %s\n", n, (unsigned long long)index, COLUMN_SPECS[c].name);
+            failures++;
+            break;
+          }
+        checked++;
+      }
+    }
+    corrupt += reader.corrupt;
+    fclose(f);
+  }
+  if (checked != collector.rows || collector.rows != rounds * pool || corrupt != 0)
+  {
+    printf("  FALLA %llu filas leídas de %llu escritas (%llu enviadas), %u bloques dañados\n",
+           (unsigned long long)checked, (unsigned long long)collector.rows, (unsigned long long)(rounds * pool),
+           corrupt);
+    failures++;
+  }
+
+  // Una serie que avanza: una consulta de una hora sólo decodifica los bloques de esa hora
+  {
+    Collector series((std::string(directory) + "/serie").c_str());
+    series.segmentRows = 720; // Una hora cada 5 s
+    const FleetMessage &m = *json[0];
+    char payload[256];
+    SensorsData sample = {24.5f, 60, 40, 40, 50, 10, 60, 0};
+    for (uint32_t i = 0; i < 12 * 720; i++)
+    {
+      sample.timestamp = 1718000000 + i * 5;
+      size_t length;
+      TelemetryEncoder::encode(sample, false, payload, sizeof(payload), &length);
+      series.ingest(m.topic.data(), m.topic.size(), (const uint8_t *)payload, length);
+    }
+    series.flushOld(true);
+    std::string path = std::string(directory) + "/serie/" + m.node + "/20240610.col";
+    FILE *f = fopen(path.c_str(), "rb");
+    uint32_t blocks = 0, decoded = 0;
+    if (f != NULL)
+    {
+      SegmentReader reader(f);
+      SegmentBlock info;
+      int64_t from = 1718000000 + 5 * 3600, to = from + 3599;
+      while (reader.next(info))
+      {
+        blocks++;
+        decoded += info.maximum[COL_TIMESTAMP] >= from && info.minimum[COL_TIMESTAMP] <= to;
+      }
+      fclose(f);
+    }
+    if (blocks != 12 || decoded != 1)
+    {
+      printf("  FALLA consulta de una hora: %u bloques, %u por decodificar\n", blocks, decoded);
+      failures++;
+    }
+  }
+
+  printf("%d nodos (%d binarios), %llu mensajes, los JSON de %.0f B (esquema de TelemetryEncoder)\n", nodes,
+         nodes / BENCH_BINARY_EVERY, (unsigned long long)collector.messages, jsonBytes);
+  printf("renglón por renglón  %10.0f msg/s  %6.0f ns/msg\n", legacyParsed / legacySeconds,
+         legacySeconds * 1e9 / legacyParsed);
+  printf("intérprete           %10.0f msg/s  %6.0f ns/msg\n", parsed / parseSeconds, parseSeconds * 1e9 / parsed);
+  printf("socket -> archivos   %10.0f msg/s  %6.0f ns/msg  (CPU %.0f%% de un núcleo)\n",
+         collector.messages / ingestSeconds, ingestSeconds * 1e9 / collector.messages,
+         100 * ingestCpu / ingestSeconds);
+  printf("%llu bloques, %.2f B/fila en disco (%.0fx menos que el JSON) en %s\n",
+         (unsigned long long)collector.segments, (double)collector.segmentBytes / collector.rows,
+         jsonBytes * collector.rows / collector.segmentBytes, directory);
+
+  if (collector.messages / ingestSeconds < 100000)
+  {
+    printf("  FALLA menos de 100000 msg/s\n");
+    failures++;
+  }
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+  const char *host = "127.0.0.1";
+  uint16_t port = 1883;
+  const char *directory = "colector";
+  bool benchmark = false;
+  uint64_t total = 2000000;
+  int nodes = 200;
+  size_t rows = SEGMENT_ROWS;
+  double age = SEGMENT_AGE_S;
+
+  if (argc >= 3 && strcmp(argv[1], "-r") == 0)
+  {
+    int64_t from = argc > 3 ? atoll(argv[3]) : INT64_MIN;
+    int64_t to = argc > 4 ? atoll(argv[4]) : INT64_MAX;
+    return readSegments(argv[2], from, to);
+  }
+
+  int option;
+  while ((option = getopt(argc, argv, "h:p:d:f:s:Bn:N:")) != -1)
+  {
+    switch (option)
+    {
+    case 'h':
+      host = optarg;
+      break;
+    case 'p':
+      port = (uint16_t)atoi(optarg);
+      break;
+    case 'd':
+      directory = optarg;
+      break;
+    case 'f':
+      rows = (size_t)atol(optarg);
+      break;
+    case 's':
+      age = atof(optarg);
+      break;
+    case 'B':
+      benchmark = true;
+      break;
+    case 'n':
+      total = strtoull(optarg, NULL, 10);
+      break;
+    case 'N':
+      nodes = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "uso: %s [-h host] [-p puerto] [-d dir] [-f filas] [-s segundos]\n"
+                      "     %s -B [-n mensajes] [-N nodos]\n"
+                      "     %s -r archivo.col [desde [hasta]]\n",
+              argv[0], argv[0], argv[0]);
+      return 2;
+    }
+  }
+  if (rows == 0 || nodes <= 0 || total == 0)
+  {
+    fprintf(stderr, "filas, nodos y mensajes deben ser positivos\n");
+    return 2;
+  }
+
+  if (benchmark)
+    return runBenchmark(total, nodes);
+
+  Collector collector(directory);
+  collector.segmentRows = rows;
+  collector.segmentAge = age;
+  return runLive(host, port, collector);
+}
@@ -0,0 +1,172 @@
+/*
+  Decodificador de la bitácora binaria de SiRIM.
+
+  Lee los bloques de los archivos copiados de la microSD, descarta los que no
+  pasan el CRC, los ordena por número de secuencia y escribe las muestras en
+  el mismo JSON que publica el nodo (una línea por muestra) o en CSV. Acepta
+  las particiones de la serie (/serie/AAAAMMDD.dat, ver SeriesStore.h), una
+  después de otra en el orden en que se pasan; los índices .idx se ignoran.
+  Con el archivo de resúmenes (/resumen.bin, ver Rollup.h) escribe un
+  resumen por línea.
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o datalog_decoder datalog_decoder.cpp
+  Uso:
+    ./datalog_decoder [--csv] 20260101.dat 20260102.dat ... > serie.json
+    ./datalog_decoder [--csv] resumen.bin > resumen.json
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "Datalog.h"
+#include "TelemetryEncoder.h"
+#include "Rollup.h"
+
+struct DecodedBlock
+{
+  size_t file; // Posición del archivo en la línea de comandos
+  uint32_t sequence;
+  std::vector<SensorsData> samples;
+  std::vector<Rollup> rollups;
+};
+
+static void printJSON(const SensorsData &d)
+{
+  // Mismo codificador que usa el nodo para publicar
+  char json[256];
+  if (TelemetryEncoder::encode(d, false, json, sizeof(json)))
+    printf("%s\n", json);
+}
+
+static void printCSV(const SensorsData &d)
+{
+  printf("%u,%g,%g,%d,%d,%d,%g,%d\n", d.timestamp, d.temperature, d.humidity,
+         d.soilMoisture1, d.soilMoisture2, d.lightIntensity, d.waterLevel, d.waterPercent);
+}
+
+static void printRollupJSON(const Rollup &r)
+{
+  char json[ROLLUP_MESSAGE_SIZE];
+  if (RollupEncoder::encode(r, json, sizeof(json)))
+    printf("%s\n", json);
+}
+
+static void printRollupCSV(const Rollup &r)
+{
+  printf("%u,%u,%u", r.start, r.period, r.samples);
+  for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+  {
+    const RunningStats &s = r.channels[c];
+    if (s.count == 0)
+      printf(",,,,");
+    else
+      printf(",%g,%g,%g,%g", s.min, s.max, s.mean, s.stddev());
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+  bool csv = false;
+  std::vector<const char *> paths;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--csv") == 0)
+      csv = true;
+    else
+    {
+      size_t length = strlen(argv[i]);
+      if (length < 4 || strcmp(argv[i] + length - 4, ".idx") != 0)
+        paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty())
+  {
+    fprintf(stderr, "Uso: %s [--csv] serie/*.dat | resumen.bin\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<DecodedBlock> blocks;
+  uint8_t buffer[DATALOG_BLOCK_SIZE];
+  uint32_t invalid = 0;
+  for (size_t file = 0; file < paths.size(); file++)
+  {
+    FILE *f = fopen(paths[file], "rb");
+    if (f == NULL)
+    {
+      perror(paths[file]);
+      return 1;
+    }
+    while (fread(buffer, 1, sizeof(buffer), f) == sizeof(buffer))
+    {
+      if (getU32(buffer) == 0 && getU32(buffer + 4) == 0)
+        continue; // Bloque preasignado sin usar
+      bool rollup = RollupLog::isValidBlock(buffer);
+      if (!rollup && !Datalog::isValidBlock(buffer))
+      {
+        invalid++;
+        continue;
+      }
+      DecodedBlock block;
+      block.file = file;
+      block.sequence = getU32(buffer + 4);
+      uint16_t count = getU16(buffer + 8);
+      for (uint16_t r = 0; r < count; r++)
+      {
+        if (rollup)
+        {
+          Rollup summary;
+          RollupEncoder::unpack(buffer + DATALOG_HEADER_SIZE + r * ROLLUP_RECORD_SIZE, summary);
+          block.rollups.push_back(summary);
+          continue;
+        }
+        SensorsData d;
+        Datalog::unpackRecord(buffer + DATALOG_HEADER_SIZE + r * DATALOG_RECORD_SIZE, d);
+        block.samples.push_back(d);
+      }
+      blocks.push_back(block);
+    }
+    fclose(f);
+  }
+
+  std::sort(blocks.begin(), blocks.end(), [](const DecodedBlock &a, const DecodedBlock &b)
+            { return a.file != b.file ? a.file < b.file : a.sequence < b.sequence; });
+
+  bool rollups = !blocks.empty() && !blocks[0].rollups.empty();
+  if (csv && rollups)
+  {
+    printf("inicio,periodo,muestras");
+    for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+      printf(",%s_min,%s_max,%s_prom,%s_desv", ROLLUP_CHANNEL_NAMES[c], ROLLUP_CHANNEL_NAMES[c],
+             ROLLUP_CHANNEL_NAMES[c], ROLLUP_CHANNEL_NAMES[c]);
+    printf("\n");
+  }
+  else if (csv)
+    printf("timestamp,temperaturaAmbiente,humedadAmbiente,sensor1,sensor2,iluminacion,nivelAgua,porcentajeAgua\n");
+
+  size_t samples = 0;
+  for (const DecodedBlock &block : blocks)
+  {
+    for (const Rollup &r : block.rollups)
+    {
+      if (csv)
+        printRollupCSV(r);
+      else
+        printRollupJSON(r);
+      samples++;
+    }
+    for (const SensorsData &d : block.samples)
+    {
+      if (csv)
+        printCSV(d);
+      else
+        printJSON(d);
+      samples++;
+    }
+  }
+
+  fprintf(stderr, "%zu bloques, %zu %s, %u bloques con CRC inválido\n", blocks.size(), samples, rollups ? "resúmenes" : "muestras", invalid);
+  return 0;
+}
@@ -0,0 +1,350 @@
+/*
+  Prueba de estrés del buzón de configuración (SiRIM/ConfigMailbox.h) y del
+  intérprete de ucol/iot/config (SiRIM/NodeConfig.h).
+
+  Un hilo escritor publica sin pausa configuraciones en las que todos los
+  campos salen del mismo contador, como el callback MQTT en el núcleo 0; un
+  hilo lector las toma como la tarea de sensores en el núcleo 1 y comprueba
+  que cada copia sea de una sola publicación (sin mezclar campos de dos) y
+  que las versiones nunca retrocedan. Con -u se usa una copia sin protección
+  para mostrar que la prueba sí detecta lecturas mezcladas.
+
+  Con un solo núcleo los hilos se intercalan sólo cuando el sistema los
+  expropia, así que las colisiones son raras; con varios son constantes.
+
+  Después verifica el intérprete con mensajes válidos e inválidos y mide
+  cuánto tarda y cuántas reservas de memoria hace por mensaje.
+
+  Compilar:
+    g++ -std=c++17 -O2 -pthread -I../SiRIM -o estres_config estres_config.cpp
+  Uso:
+    ./estres_config [-t segundos] [-p pausa_us] [-u] [-i iteraciones]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include "ConfigMailbox.h"
+#include "NodeConfig.h"
+
+static std::atomic<unsigned long> allocations{0};
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+/*-- Buzón --*/
+
+// Todos los campos se derivan de n; exactos en float para n < 2^24
+static NodeConfig makeConfig(uint32_t n)
+{
+  NodeConfig c;
+  uint32_t v = n & 0x7FFF;
+  c.report.enabled = n & 1;
+  c.report.temperature = (float)v;
+  c.report.humidity = (float)v + 0.5f;
+  c.report.soilMoisture = (int16_t)v;
+  c.report.light = (int16_t)~v;
+  c.report.waterLevel = (float)v * 2;
+  c.report.waterPercent = (int16_t)(v ^ 0x5555);
+  c.report.heartbeatMs = n;
+  c.schedule.clear();
+  c.schedule.add(v & 1, (uint16_t)(v % SCHEDULE_MINUTES_PER_WEEK), (uint16_t)(v + 3));
+  c.irrigation.setLightThreshold = (int16_t)(v + 1);
+  c.irrigation.setSoilMoistureThreshold = (int16_t)(v + 2);
+  c.irrigation.setManualIrrigationMode = n & 2;
+  c.irrigation.setTimerIrrigationMode = n & 4;
+  c.irrigation.setIrrigationStatus = n & 8;
+  c.receivedAt = n;
+  return c;
+}
+
+static bool consistent(const NodeConfig &c)
+{
+  NodeConfig expected = makeConfig(c.receivedAt);
+  return sameConfig(expected.report, c.report) && sameConfig(expected.irrigation, c.irrigation) &&
+         expected.schedule.equals(c.schedule);
+}
+
+// Una sola copia con un contador aparte: lo que el buzón evita
+template <typename T>
+class UnprotectedMailbox
+{
+private:
+  T slot;
+  std::atomic<uint32_t> version{0};
+  uint32_t seen = 0;
+
+public:
+  uint32_t retries = 0;
+
+  void publish(const T &value)
+  {
+    memcpy((void *)&slot, &value, sizeof(T));
+    version.fetch_add(1, std::memory_order_release);
+  }
+  bool take(T &out)
+  {
+    uint32_t current = version.load(std::memory_order_acquire);
+    if (current == seen)
+      return false;
+    memcpy((void *)&out, (const void *)&slot, sizeof(T));
+    seen = current;
+    return true;
+  }
+};
+
+struct StressResult
+{
+  uint64_t published = 0;
+  uint64_t taken = 0;
+  uint64_t polls = 0;
+  uint64_t torn = 0;
+  uint64_t backwards = 0;
+  uint32_t retries = 0;
+  double seconds = 0;
+};
+
+template <typename Mailbox>
+static StressResult stress(Mailbox &mailbox, double seconds, unsigned pauseUs)
+{
+  StressResult r;
+  std::atomic<bool> running{true};
+
+  std::thread writer([&]() {
+    uint32_t n = 1;
+    while (running.load(std::memory_order_relaxed))
+    {
+      mailbox.publish(makeConfig(n++));
+      if (pauseUs > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(pauseUs));
+    }
+    r.published = n - 1;
+  });
+
+  std::thread reader([&]() {
+    NodeConfig config;
+    uint32_t last = 0;
+    while (running.load(std::memory_order_relaxed))
+    {
+      r.polls++;
+      if (!mailbox.take(config))
+        continue;
+      r.taken++;
+      if (!consistent(config))
+        r.torn++;
+      else if (config.receivedAt < last)
+        r.backwards++;
+      else
+        last = config.receivedAt;
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  running = false;
+  writer.join();
+  reader.join();
+  r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  r.retries = mailbox.retries;
+  return r;
+}
+
+/*-- Intérprete --*/
+
+struct ParseCase
+{
+  const char *json;
+  ConfigStatus expected;
+};
+
+static const ParseCase parseCases[] = {
+    {"{\"reporte\":{\"latidoSeg\":60,\"humedadSuelo\":3}}", CONFIG_OK},
+    {"{\"riego\":{\"hora\":\"6:30\",\"segundos\":45,\"umbralSuelo\":40,\"temporizador\":true}}", CONFIG_OK},
+    {" { \"otro\" : [1, {\"a\": null}, \"x\"], \"riego\" : { \"hora\" : \"\" } } ", CONFIG_OK},
+    {"{\"riego\":{\"umbralLuz\":1.5e1,\"nuevo\":{\"b\":[true,false]}}}", CONFIG_OK},
+    {"{}", CONFIG_EMPTY},
+    {"{\"otro\":1}", CONFIG_EMPTY},
+    {"", CONFIG_SYNTAX},
+    {"{\"reporte\":", CONFIG_SYNTAX},
+    {"{\"reporte\":{\"activo\":true}", CONFIG_SYNTAX},
+    {"{\"reporte\":{\"activo\":true}} x", CONFIG_SYNTAX},
+    {"{\"riego\":{\"hora\":\"6:3\\u0030\"}}", CONFIG_SYNTAX},
+    {"{\"reporte\":{\"activo\":\"si\"}}", CONFIG_TYPE},
+    {"{\"reporte\":[]}", CONFIG_TYPE},
+    {"{\"riego\":{\"segundos\":\"10\"}}", CONFIG_TYPE},
+    {"{\"riego\":{\"hora\":630}}", CONFIG_TYPE},
+    {"{\"reporte\":{\"latidoSeg\":1}}", CONFIG_RANGE},
+    {"{\"reporte\":{\"humedadSuelo\":-1}}", CONFIG_RANGE},
+    {"{\"riego\":{\"segundos\":0}}", CONFIG_RANGE},
+    {"{\"riego\":{\"hora\":\"24:00\"}}", CONFIG_RANGE},
+    {"{\"riego\":{\"hora\":\"6:5\"}}", CONFIG_RANGE},
+    {"{\"riego\":{\"umbralSuelo\":101}}", CONFIG_RANGE},
+    {"{\"riego\":{\"umbralSuelo\":96}}", CONFIG_RANGE},
+    {"{\"riego\":{\"umbralSuelo\":95}}", CONFIG_OK},
+    {"{\"horario\":[]}", CONFIG_OK},
+    {"{\"horario\":[{\"zona\":2,\"dias\":\"lxv\",\"hora\":\"23:59\",\"segundos\":60}]}", CONFIG_OK},
+    {"{\"horario\":{}}", CONFIG_TYPE},
+    {"{\"horario\":[{\"zona\":3,\"hora\":\"6:00\"}]}", CONFIG_RANGE},
+    {"{\"horario\":[{\"dias\":\"LQ\",\"hora\":\"6:00\"}]}", CONFIG_RANGE},
+    {"{\"horario\":[{\"zona\":1}]}", CONFIG_RANGE},
+    {"{\"horario\":[{\"hora\":\"6:00\"},{\"hora\":\"7:00\"},{\"hora\":\"8:00\"}]}", CONFIG_RANGE},
+    {"{\"horario\":[{\"hora\":\"6:00\"}", CONFIG_SYNTAX},
+    {"{\"energia\":{\"bajoConsumo\":true,\"muestraSeg\":300,\"lote\":40,\"radioCada\":32}}", CONFIG_OK},
+    {"{\"energia\":{\"bajoConsumo\":1}}", CONFIG_TYPE},
+    {"{\"energia\":{\"muestraSeg\":2}}", CONFIG_RANGE},
+    {"{\"energia\":{\"lote\":41}}", CONFIG_RANGE},
+    {"{\"energia\":{\"radioCada\":0}}", CONFIG_RANGE},
+    {"{\"resumen\":{\"soloResumen\":true,\"minuto\":false}}", CONFIG_OK},
+    {"{\"resumen\":{}}", CONFIG_OK},
+    {"{\"resumen\":{\"hora\":1}}", CONFIG_TYPE},
+    {"{\"resumen\":true}", CONFIG_TYPE},
+    {"{\"firebase\":{\"lote\":32,\"latenciaSeg\":3600}}", CONFIG_OK},
+    {"{\"firebase\":{\"lote\":\"10\"}}", CONFIG_TYPE},
+    {"{\"firebase\":{\"lote\":0}}", CONFIG_RANGE},
+    {"{\"firebase\":{\"lote\":33}}", CONFIG_RANGE},
+    {"{\"firebase\":{\"latenciaSeg\":0}}", CONFIG_RANGE},
+};
+
+static const NodeConfig baseConfig = {DEFAULT_REPORT_CONFIG, DEFAULT_IRRIGATION_CONFIG, {}, DEFAULT_POWER_CONFIG,
+                                      DEFAULT_ROLLUP_CONFIG, DEFAULT_FIREBASE_CONFIG, 0};
+
+static int checkParser(void)
+{
+  int failures = 0;
+  for (const ParseCase &c : parseCases)
+  {
+    NodeConfig config = baseConfig;
+    ConfigStatus status = NodeConfigParser::parse((const uint8_t *)c.json, strlen(c.json), config, 5000);
+    bool unchanged = sameConfig(config.report, baseConfig.report) &&
+                     sameConfig(config.irrigation, baseConfig.irrigation) && config.schedule.equals(baseConfig.schedule) &&
+                     sameConfig(config.power, baseConfig.power) && sameConfig(config.rollup, baseConfig.rollup) &&
+                     sameConfig(config.firebase, baseConfig.firebase);
+    // Un mensaje rechazado no debe tocar la configuración
+    if (status != c.expected || (status != CONFIG_OK && !unchanged))
+    {
+      printf("  FALLA %-60s -> %s (se esperaba %s)\n", c.json, NodeConfigParser::describe(status),
+             NodeConfigParser::describe(c.expected));
+      failures++;
+    }
+  }
+
+  // Los valores llegan a los campos
+  const char *full = "{\"reporte\":{\"activo\":false,\"nivelAgua\":2.5,\"latidoSeg\":600},"
+                     "\"riego\":{\"hora\":\"18:05\",\"segundos\":90,\"umbralLuz\":20,\"umbralSuelo\":35,"
+                     "\"manual\":true,\"temporizador\":false,\"regar\":true},"
+                     "\"horario\":[{\"zona\":2,\"dias\":\"DS\",\"hora\":\"7:00\",\"segundos\":120}],"
+                     "\"energia\":{\"bajoConsumo\":true,\"muestraSeg\":120,\"radioCada\":5},"
+                     "\"resumen\":{\"soloResumen\":true,\"dia\":false},"
+                     "\"firebase\":{\"latenciaSeg\":300}}";
+  NodeConfig config = baseConfig;
+  NodeConfigParser::parse((const uint8_t *)full, strlen(full), config, 5000);
+  const ChangeConfiguration &i = config.irrigation;
+  if (config.report.enabled || config.report.waterLevel != 2.5f || config.report.heartbeatMs != 600000 ||
+      config.schedule.count[0] != 0 || config.schedule.count[1] != 2 ||
+      config.schedule.slots[1][1].minuteOfWeek != 6 * 1440 + 7 * 60 || config.schedule.slots[1][1].seconds != 120 ||
+      i.setLightThreshold != 20 ||
+      i.setSoilMoistureThreshold != 35 || !i.setManualIrrigationMode || i.setTimerIrrigationMode ||
+      !i.setIrrigationStatus || config.report.humidity != DEFAULT_REPORT_CONFIG.humidity || !config.power.lowPower ||
+      config.power.sampleSeconds != 120 || config.power.radioEvery != 5 ||
+      config.power.batchSize != DEFAULT_POWER_CONFIG.batchSize || !config.rollup.rollupOnly ||
+      !config.rollup.publish[ROLLUP_MINUTE] || config.rollup.publish[ROLLUP_DAY] ||
+      config.firebase.batchSize != DEFAULT_FIREBASE_CONFIG.batchSize || config.firebase.maxLatencySeconds != 300)
+  {
+    printf("  FALLA valores del mensaje completo\n");
+    failures++;
+  }
+
+  printf("intérprete: %zu casos, %d fallas\n", sizeof(parseCases) / sizeof(parseCases[0]) + 1, failures);
+  return failures;
+}
+
+static void benchParser(unsigned long iterations)
+{
+  const char *message = "{\"reporte\": {\"activo\": true, \"temperaturaAmbiente\": 0.5, \"humedadAmbiente\": 2, "
+                        "\"humedadSuelo\": 2, \"iluminacion\": 5, \"nivelAgua\": 1.0, \"porcentajeAgua\": 5, "
+                        "\"latidoSeg\": 300}, \"riego\": {\"hora\": \"6:30\", \"segundos\": 10, \"umbralLuz\": 100, "
+                        "\"umbralSuelo\": 40, \"manual\": false, \"temporizador\": true, \"regar\": false}}";
+  size_t length = strlen(message);
+  NodeConfig config = baseConfig;
+  unsigned long ok = 0;
+
+  unsigned long before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long n = 0; n < iterations; n++)
+    ok += NodeConfigParser::parse((const uint8_t *)message, length, config, 5000) == CONFIG_OK;
+  auto end = std::chrono::steady_clock::now();
+
+  printf("intérprete: %zu bytes, %.1f ns/mensaje, %.2f reservas/mensaje (%lu válidos)\n", length,
+         std::chrono::duration<double, std::nano>(end - start).count() / iterations,
+         (double)(allocations - before) / iterations, ok);
+}
+
+int main(int argc, char **argv)
+{
+  double seconds = 3;
+  unsigned pauseUs = 0;
+  bool unprotected = false;
+  unsigned long iterations = 1000000UL;
+  int option;
+
+  while ((option = getopt(argc, argv, "t:p:ui:")) != -1)
+  {
+    switch (option)
+    {
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'p':
+      pauseUs = strtoul(optarg, NULL, 10);
+      break;
+    case 'u':
+      unprotected = true;
+      break;
+    case 'i':
+      iterations = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "Uso: %s [-t segundos] [-p pausa_us] [-u] [-i iteraciones]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  StressResult r;
+  if (unprotected)
+  {
+    static UnprotectedMailbox<NodeConfig> mailbox;
+    r = stress(mailbox, seconds, pauseUs);
+  }
+  else
+  {
+    static ConfigMailbox<NodeConfig> mailbox;
+    r = stress(mailbox, seconds, pauseUs);
+  }
+
+  printf("buzón %s: %.1f s, %zu bytes por configuración\n", unprotected ? "sin protección" : "ConfigMailbox", r.seconds,
+         sizeof(NodeConfig));
+  printf("  publicadas %llu (%.0f/s), tomadas %llu de %llu consultas, reintentos %lu\n",
+         (unsigned long long)r.published, r.published / r.seconds, (unsigned long long)r.taken,
+         (unsigned long long)r.polls, (unsigned long)r.retries);
+  printf("  mezcladas %llu, fuera de orden %llu\n", (unsigned long long)r.torn, (unsigned long long)r.backwards);
+
+  int failures = checkParser();
+  benchParser(iterations);
+
+  bool mailboxOk = unprotected || (r.torn == 0 && r.backwards == 0);
+  return mailboxOk && failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+#ifndef HostArduino_h
+#define HostArduino_h
+
+/*
+  Núcleo de Arduino para ESP32 sobre el simulador: reloj virtual de
+  SimKernel, pines y ADC de SimBoard. Sólo cubre lo que usa SiRIM.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+#include "SimKernel.h"
+#include "SimBoard.h"
+#include "freertos/FreeRTOS.h"
+
+using std::max;
+using std::min;
+
+#define ESP_ARDUINO_VERSION_MAJOR 3
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define ADC_11db 3
+
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define DRAM_ATTR
+#define F(text) (text)
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/*-- String: lo que usa el firmware sobre std::string --*/
+
+class String : public std::string
+{
+public:
+  String() {}
+  String(const char *text) : std::string(text != NULL ? text : "") {}
+  String(const std::string &text) : std::string(text) {}
+  String(char c) : std::string(1, c) {}
+  String(int value) : std::string(std::to_string(value)) {}
+  String(unsigned int value) : std::string(std::to_string(value)) {}
+  String(long value) : std::string(std::to_string(value)) {}
+  String(unsigned long value) : std::string(std::to_string(value)) {}
+  String(float value, int decimals = 2) : std::string(format(value, decimals)) {}
+  String(double value, int decimals = 2) : std::string(format(value, decimals)) {}
+
+  static std::string format(double value, int decimals)
+  {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", decimals, value);
+    return text;
+  }
+
+  int toInt(void) const { return atoi(c_str()); }
+  float toFloat(void) const { return atof(c_str()); }
+  String &operator+=(const char *text)
+  {
+    append(text);
+    return *this;
+  }
+  String &operator+=(const String &text)
+  {
+    append(text);
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    push_back(c);
+    return *this;
+  }
+};
+
+inline String operator+(const String &a, const String &b) { return String((const std::string &)a + (const std::string &)b); }
+inline String operator+(const String &a, const char *b) { return String((const std::string &)a + b); }
+inline String operator+(const char *a, const String &b) { return String(a + (const std::string &)b); }
+
+/*-- Serial: por defecto no imprime; el simulador puede mandarlo a un archivo --*/
+
+class Print
+{
+public:
+  virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t print(const String &text) { return print(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = 10) { return print(String(value)); }
+  size_t print(unsigned int value, int base = 10) { return print(String(value)); }
+  size_t print(long value, int base = 10) { return print(String(value)); }
+  size_t print(unsigned long value, int base = 10) { return print(String(value)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+  // Clases con toString() (IPAddress); los aritméticos usan las sobrecargas
+  template <class T, typename std::enable_if<std::is_class<T>::value, int>::type = 0>
+  size_t print(const T &value) { return print(value.toString()); }
+  template <class T>
+  size_t println(const T &value) { return print(value) + println(); }
+  size_t println(void) { return print("\n"); }
+  size_t printf(const char *format, ...)
+  {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return length > 0 ? print(text) : 0;
+  }
+};
+
+class HardwareSerial : public Print
+{
+public:
+  FILE *output = NULL;
+  uint64_t bytesWritten = 0;
+
+  void begin(unsigned long baud) {}
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  void flush(void)
+  {
+    if (output != NULL)
+      fflush(output);
+  }
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    bytesWritten += size;
+    if (output != NULL)
+      fwrite(buffer, 1, size, output);
+    return size;
+  }
+  using Print::write;
+};
+
+HardwareSerial Serial;
+
+/*-- Tiempo --*/
+
+static inline unsigned long micros(void) { return (unsigned long)(uint32_t)simKernel.micros(); }
+static inline unsigned long millis(void) { return (unsigned long)(uint32_t)(simKernel.micros() / 1000); }
+static inline void delay(uint32_t ms) { simKernel.sleepFor((uint64_t)ms * 1000); }
+static inline void delayMicroseconds(uint32_t us) { simKernel.sleepFor(us); }
+static inline void yield(void) { simKernel.sleepFor(0); }
+
+/*-- Pines --*/
+
+// Una entrada con pull-up lee HIGH mientras nadie la lleve a tierra
+static inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (mode == INPUT_PULLUP)
+    simBoard.pullUp(pin);
+}
+static inline void digitalWrite(uint8_t pin, uint8_t level) { simBoard.write(pin, level); }
+static inline int digitalRead(uint8_t pin) { return simBoard.read(pin); }
+static inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+static inline void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) { simBoard.attach(pin, handler, mode); }
+static inline void detachInterrupt(uint8_t pin) { simBoard.detach(pin); }
+
+// driver/gpio.h: los pines que despiertan del light sleep (ver esp_sleep.h)
+typedef int gpio_num_t;
+typedef enum
+{
+  GPIO_INTR_LOW_LEVEL = 4,
+  GPIO_INTR_HIGH_LEVEL = 5
+} gpio_int_type_t;
+static inline int gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) { return 0; }
+static inline int gpio_wakeup_disable(gpio_num_t pin) { return 0; }
+
+static inline int analogRead(uint8_t pin)
+{
+  simBoard.analogReads++;
+  return simBoard.sample(pin, 1);
+}
+static inline uint32_t analogReadMilliVolts(uint8_t pin) { return analogRead(pin) * 3300 / 4095; }
+static inline void analogReadResolution(uint8_t bits) {}
+static inline void analogSetAttenuation(int attenuation) {}
+
+static inline bool analogContinuous(const uint8_t pins[], size_t count, uint32_t conversions, uint32_t frequency,
+                                    void (*callback)(void))
+{
+  return simBoard.adcConfigure(pins, count, conversions, frequency, callback);
+}
+static inline bool analogContinuousStart(void) { return simBoard.adcStart(); }
+static inline bool analogContinuousStop(void) { return simBoard.adcStop(); }
+static inline bool analogContinuousRead(adc_continuous_data_t **buffer, uint32_t timeoutMs) { return simBoard.adcRead(buffer); }
+static inline void analogContinuousSetWidth(uint8_t bits) {}
+static inline void analogContinuousSetAtten(int attenuation) {}
+
+/*-- Utilidades --*/
+
+static inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+static inline uint32_t esp_random(void) { return simBoard.rng(); }
+static inline void randomSeed(unsigned long seed) {}
+static inline long random(long howBig) { return howBig > 0 ? esp_random() % howBig : 0; }
+static inline long random(long howSmall, long howBig) { return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+
+class EspClass
+{
+public:
+  uint32_t getHeapSize(void) { return 320 * 1024; }
+  uint32_t getFreeHeap(void) { return 200 * 1024; }
+  uint32_t getMinFreeHeap(void) { return 200 * 1024; }
+  uint32_t getMaxAllocHeap(void) { return 110 * 1024; }
+  void restart(void) { exit(0); }
+};
+
+EspClass ESP;
+
+#endif
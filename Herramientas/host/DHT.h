@@ -0,0 +1,58 @@
+#ifndef HostDHT_h
+#define HostDHT_h
+
+/*
+  DHT11 simulado. Una transacción real bloquea ~25 ms (bit a bit por un solo
+  cable) y el sensor no entrega datos nuevos antes de 2 s; como la librería de
+  Adafruit, la segunda lectura dentro de ese plazo devuelve la anterior sin
+  volver a consultar. El DHT11 sólo resuelve enteros.
+*/
+
+#include "Arduino.h"
+
+#define DHT11 11
+#define DHT22 22
+#define DHT_TRANSACTION_US 25000
+#define DHT_MIN_INTERVAL_MS 2000
+
+class DHT
+{
+private:
+  uint8_t pin;
+  uint8_t type;
+  bool hasRead = false;
+  uint32_t lastRead = 0;
+  float temperature = NAN;
+  float humidity = NAN;
+
+  void read(void)
+  {
+    if (hasRead && millis() - lastRead < DHT_MIN_INTERVAL_MS)
+      return;
+    // Como la librería, el plazo cuenta desde el inicio de la transacción
+    lastRead = millis();
+    hasRead = true;
+    delayMicroseconds(DHT_TRANSACTION_US);
+    transactions++;
+    temperature = simBoard.airTemperature ? roundf(simBoard.airTemperature()) : NAN;
+    humidity = simBoard.airHumidity ? roundf(simBoard.airHumidity()) : NAN;
+  }
+
+public:
+  uint64_t transactions = 0;
+
+  DHT(uint8_t pin, uint8_t type) : pin(pin), type(type) {}
+  void begin(void) {}
+  float readTemperature(bool fahrenheit = false)
+  {
+    read();
+    return fahrenheit ? temperature * 1.8f + 32 : temperature;
+  }
+  float readHumidity(void)
+  {
+    read();
+    return humidity;
+  }
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef HostLiquidCrystal_I2C_h
+#define HostLiquidCrystal_I2C_h
+
+// LCD 16x2 simulado: guarda el contenido y cuenta las escrituras al módulo.
+// busBytes estima el tráfico I2C del adaptador PCF8574 en modo de 4 bits:
+// cada comando o carácter son dos nibbles de tres escrituras al expansor
+// (dato, E alto, E bajo), cada una con su byte de dirección; la luz de fondo
+// es una sola escritura.
+
+#include "Arduino.h"
+
+class LiquidCrystal_I2C : public Print
+{
+private:
+  uint8_t columns;
+  uint8_t rows;
+  uint8_t cursorColumn = 0;
+  uint8_t cursorRow = 0;
+  char screen[4][41];
+
+  void countCommand(void);
+
+public:
+  uint64_t commands = 0;   // clear, setCursor, backlight...
+  uint64_t characters = 0; // Datos escritos en la DDRAM
+  uint64_t busBytes = 0;   // Bytes en el bus I2C
+  uint64_t clears = 0;     // Cada clear() deja el módulo en blanco ~2 ms (parpadeo)
+
+  static const uint8_t BYTES_PER_WRITE = 12;
+
+  LiquidCrystal_I2C(uint8_t address, uint8_t columns, uint8_t rows) : columns(columns), rows(rows) { clear(); }
+
+  void init(void) { countCommand(); }
+  void begin(void) { countCommand(); }
+  void backlight(void)
+  {
+    commands++;
+    busBytes += 2;
+  }
+  void noBacklight(void)
+  {
+    commands++;
+    busBytes += 2;
+  }
+  void clear(void)
+  {
+    countCommand();
+    clears++;
+    memset(screen, ' ', sizeof(screen));
+    for (uint8_t r = 0; r < 4; r++)
+      screen[r][40] = '\0';
+    cursorColumn = cursorRow = 0;
+  }
+  void setCursor(uint8_t column, uint8_t row)
+  {
+    countCommand();
+    cursorColumn = column;
+    cursorRow = row < rows ? row : rows - 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      if (cursorColumn < 40)
+        screen[cursorRow][cursorColumn++] = (char)buffer[i];
+      characters++;
+      busBytes += BYTES_PER_WRITE;
+    }
+    return size;
+  }
+  using Print::write;
+
+  // Fila tal como se ve en el módulo (sólo las columnas visibles)
+  std::string line(uint8_t row) const { return std::string(screen[row], columns); }
+};
+
+void LiquidCrystal_I2C ::countCommand(void)
+{
+  commands++;
+  busBytes += BYTES_PER_WRITE;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef HostPreferences_h
+#define HostPreferences_h
+
+// NVS en memoria: persiste mientras dure el proceso (sobrevive a un "reinicio"
+// simulado que vuelva a llamar setup()).
+
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+class Preferences
+{
+private:
+  std::string space;
+
+  static std::map<std::string, std::vector<uint8_t>> &store(void)
+  {
+    static std::map<std::string, std::vector<uint8_t>> values;
+    return values;
+  }
+  std::string keyOf(const char *key) const { return space + "/" + key; }
+
+public:
+  static uint64_t writes;
+
+  bool begin(const char *name, bool readOnly = false)
+  {
+    SimHostScope host;
+    space = name;
+    return true;
+  }
+  void end(void) {}
+  size_t getBytes(const char *key, void *buffer, size_t length)
+  {
+    SimHostScope host;
+    auto found = store().find(keyOf(key));
+    if (found == store().end() || found->second.size() > length)
+      return 0;
+    memcpy(buffer, found->second.data(), found->second.size());
+    return found->second.size();
+  }
+  size_t putBytes(const char *key, const void *buffer, size_t length)
+  {
+    SimHostScope host;
+    writes++;
+    const uint8_t *bytes = (const uint8_t *)buffer;
+    store()[keyOf(key)] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+  }
+  bool remove(const char *key) { return store().erase(keyOf(key)) > 0; }
+  bool clear(void)
+  {
+    for (auto it = store().begin(); it != store().end();)
+      it = it->first.compare(0, space.size() + 1, space + "/") == 0 ? store().erase(it) : std::next(it);
+    return true;
+  }
+};
+
+uint64_t Preferences::writes = 0;
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef HostPubSubClient_h
+#define HostPubSubClient_h
+
+/*
+  PubSubClient sobre el broker de SimNetwork. Conserva las reglas que
+  importan al firmware: connect() bloquea hasta el timeout si el broker no
+  responde, publish() falla si el paquete no cabe en el buffer y loop()
+  entrega a lo más un mensaje entrante por llamada.
+*/
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include "SimNetwork.h"
+#include <functional>
+#include <set>
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_CONNECT_US 30000 // Ida y vuelta de TCP + CONNECT/CONNACK en la LAN
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+class PubSubClient
+{
+private:
+  MQTT_CALLBACK_SIGNATURE;
+  uint16_t bufferSize = 256;
+  uint16_t socketTimeout = 15;
+  bool session = false;
+  int lastState = MQTT_DISCONNECTED;
+  std::set<std::string> subscriptions;
+
+public:
+  PubSubClient(Client &client) {}
+  PubSubClient &setServer(const char *domain, uint16_t port) { return *this; }
+  PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE)
+  {
+    this->callback = callback;
+    return *this;
+  }
+  PubSubClient &setKeepAlive(uint16_t seconds) { return *this; }
+  PubSubClient &setSocketTimeout(uint16_t seconds)
+  {
+    socketTimeout = seconds;
+    return *this;
+  }
+  bool setBufferSize(uint16_t size)
+  {
+    bufferSize = size;
+    return size > 0;
+  }
+  uint16_t getBufferSize(void) { return bufferSize; }
+
+  bool connect(const char *id)
+  {
+    if (WiFi.status() != WL_CONNECTED || !simNetwork.brokerUp())
+    {
+      delay((uint32_t)socketTimeout * 1000);
+      lastState = MQTT_CONNECTION_TIMEOUT;
+      return session = false;
+    }
+    delayMicroseconds(MQTT_CONNECT_US);
+    simNetwork.connects++;
+    subscriptions.clear();
+    lastState = MQTT_CONNECTED;
+    return session = true;
+  }
+  void disconnect(void)
+  {
+    session = false;
+    lastState = MQTT_DISCONNECTED;
+  }
+  bool connected(void)
+  {
+    if (session && (WiFi.status() != WL_CONNECTED || !simNetwork.brokerUp()))
+    {
+      session = false;
+      lastState = MQTT_CONNECTION_LOST;
+    }
+    return session;
+  }
+  int state(void) { return lastState; }
+
+  bool publish(const char *topic, const uint8_t *payload, unsigned int length)
+  {
+    if (!connected() || MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length > bufferSize)
+    {
+      simNetwork.rejected++;
+      return false;
+    }
+    simNetwork.record(topic, payload, length);
+    return true;
+  }
+  bool publish(const char *topic, const char *payload) { return publish(topic, (const uint8_t *)payload, strlen(payload)); }
+  bool subscribe(const char *topic)
+  {
+    if (!connected())
+      return false;
+    SimHostScope host;
+    subscriptions.insert(topic);
+    return true;
+  }
+
+  bool loop(void)
+  {
+    if (!connected())
+      return false;
+    uint64_t now = simKernel.micros();
+    for (auto it = simNetwork.inbound.begin(); it != simNetwork.inbound.end(); ++it)
+    {
+      if (it->at > now || subscriptions.count(it->topic) == 0)
+        continue;
+      // La copia es del broker; el callback ya es firmware
+      SimInbound message;
+      {
+        SimHostScope host;
+        message = *it;
+        simNetwork.inbound.erase(it);
+      }
+      if (callback)
+        callback((char *)message.topic.c_str(), (uint8_t *)&message.payload[0], message.payload.size());
+      break;
+    }
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef HostRTClib_h
+#define HostRTClib_h
+
+// RTC DS1307 simulado: la hora es simBoard.epoch más el reloj virtual.
+
+#include "Arduino.h"
+
+class TimeSpan
+{
+public:
+  int32_t seconds;
+  TimeSpan(int32_t seconds = 0) : seconds(seconds) {}
+  int32_t totalseconds(void) const { return seconds; }
+};
+
+class DateTime
+{
+private:
+  uint32_t unix;
+
+  static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+  {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+  }
+
+  void civil(uint16_t &y, uint8_t &m, uint8_t &d) const
+  {
+    int64_t z = unix / 86400 + 719468;
+    int64_t era = z / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (uint16_t)(yoe + era * 400 + (m <= 2));
+  }
+
+public:
+  DateTime(uint32_t t = 0) : unix(t) {}
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0)
+  {
+    unix = (uint32_t)(daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+  }
+  // Formato de __DATE__ ("Jun 10 2024") y __TIME__ ("12:34:56")
+  DateTime(const char *date, const char *time)
+  {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char *found = strstr(months, std::string(date, 3).c_str());
+    uint8_t month = found != NULL ? (found - months) / 3 + 1 : 1;
+    *this = DateTime(atoi(date + 7), month, atoi(date + 4), atoi(time), atoi(time + 3), atoi(time + 6));
+  }
+
+  uint32_t unixtime(void) const { return unix; }
+  uint16_t year(void) const
+  {
+    uint16_t y;
+    uint8_t m, d;
+    civil(y, m, d);
+    return y;
+  }
+  uint8_t month(void) const
+  {
+    uint16_t y;
+    uint8_t m, d;
+    civil(y, m, d);
+    return m;
+  }
+  uint8_t day(void) const
+  {
+    uint16_t y;
+    uint8_t m, d;
+    civil(y, m, d);
+    return d;
+  }
+  uint8_t hour(void) const { return unix / 3600 % 24; }
+  uint8_t minute(void) const { return unix / 60 % 60; }
+  uint8_t second(void) const { return unix % 60; }
+  uint8_t dayOfTheWeek(void) const { return (unix / 86400 + 4) % 7; } // 0 = domingo
+  DateTime operator+(const TimeSpan &span) const { return DateTime(unix + span.seconds); }
+};
+
+class RTC_DS1307
+{
+public:
+  uint64_t reads = 0;
+  // Sin respuesta en el bus I2C hasta esta hora del reloj virtual
+  uint64_t absentUntilUs = 0;
+
+  bool begin(void) { return simKernel.micros() >= absentUntilUs; }
+  bool isrunning(void) { return true; }
+  void adjust(const DateTime &date) { simBoard.epoch = date.unixtime() - (uint32_t)(simKernel.micros() / 1000000); }
+  DateTime now(void)
+  {
+    reads++;
+    return DateTime(simBoard.epoch + (uint32_t)(simKernel.micros() / 1000000));
+  }
+};
+
+class RTC_DS3231 : public RTC_DS1307
+{
+public:
+  bool lostPower(void) { return false; }
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef HostSD_h
+#define HostSD_h
+
+/*
+  Sustituto de la librería SD del ESP32 para compilar en Linux.
+
+  Cada ruta de la "tarjeta" se guarda como un archivo normal debajo de un
+  directorio raíz (por defecto el directorio actual, ver SD.setRoot). Sólo
+  implementa lo que usa el firmware de SiRIM.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "SimKernel.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File
+{
+private:
+  std::shared_ptr<FILE> handle;
+  std::string filePath;
+  std::shared_ptr<DIR> dir;
+
+public:
+  File() {}
+  File(FILE *f, const std::string &path) : handle(f, fclose), filePath(path) {}
+  File(DIR *d, const std::string &path) : filePath(path), dir(d, closedir) {}
+
+  operator bool() const { return handle != nullptr || dir != nullptr; }
+
+  size_t write(const uint8_t *buffer, size_t size) { return handle ? fwrite(buffer, 1, size, handle.get()) : 0; }
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t println(const char *s) { return print(s) + print("\n"); }
+  size_t read(uint8_t *buffer, size_t size) { return handle ? fread(buffer, 1, size, handle.get()) : 0; }
+  int read(void)
+  {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int available(void) { return handle ? (int)(size() - position()) : 0; }
+  bool seek(uint32_t pos) { return handle && fseek(handle.get(), pos, SEEK_SET) == 0; }
+  size_t position(void) { return handle ? (size_t)ftell(handle.get()) : 0; }
+  size_t size(void)
+  {
+    if (!handle)
+      return 0;
+    struct stat st;
+    fflush(handle.get());
+    return fstat(fileno(handle.get()), &st) == 0 ? (size_t)st.st_size : 0;
+  }
+  void flush(void)
+  {
+    if (handle)
+      fflush(handle.get());
+  }
+  void close(void)
+  {
+    handle.reset();
+    dir.reset();
+  }
+  const char *path(void) { return filePath.c_str(); }
+  const char *name(void)
+  {
+    size_t slash = filePath.rfind('/');
+    return filePath.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+  }
+  bool isDirectory(void) { return dir != nullptr; }
+
+  // Recorre un directorio igual que File::openNextFile del ESP32
+  File openNextFile(void);
+};
+
+class HostSDFS
+{
+private:
+  std::string root = ".";
+
+public:
+  // Las rutas y archivos del anfitrión no cuentan como heap del firmware
+  std::string hostPath(const char *path)
+  {
+    SimHostScope host;
+    return root + (path[0] == '/' ? "" : "/") + path;
+  }
+
+  // Tarjeta fuera de la ranura hasta esta hora del reloj virtual
+  uint64_t absentUntilUs = 0;
+
+  void setRoot(const std::string &directory) { root = directory; }
+  bool begin(uint8_t ssPin = 5) { return simKernel.micros() >= absentUntilUs && access(root.c_str(), W_OK) == 0; }
+  void end(void) {}
+
+  File open(const char *path, const char *mode = FILE_READ, bool create = false)
+  {
+    SimHostScope host;
+    std::string full = hostPath(path);
+    struct stat st;
+    if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      DIR *d = opendir(full.c_str());
+      return d ? File(d, path) : File();
+    }
+    FILE *f = fopen(full.c_str(), mode);
+    return f ? File(f, path) : File();
+  }
+  File open(const std::string &path, const char *mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+  bool exists(const char *path)
+  {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+  }
+  bool remove(const char *path) { return ::unlink(hostPath(path).c_str()) == 0; }
+  bool rename(const char *from, const char *to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+  bool mkdir(const char *path) { return ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+  bool rmdir(const char *path) { return ::rmdir(hostPath(path).c_str()) == 0; }
+};
+
+HostSDFS SD;
+
+File File ::openNextFile(void)
+{
+  if (!dir)
+    return File();
+  SimHostScope host;
+  struct dirent *entry;
+  while ((entry = readdir(dir.get())) != nullptr)
+  {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+    std::string child = filePath + (filePath.size() > 0 && filePath.back() == '/' ? "" : "/") + entry->d_name;
+    return SD.open(child.c_str(), "r+");
+  }
+  return File();
+}
+
+#endif
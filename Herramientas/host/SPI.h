@@ -0,0 +1,17 @@
+#ifndef HostSPI_h
+#define HostSPI_h
+
+// El bus SPI no se simula: la SD se guarda en archivos (ver SD.h).
+
+#include "Arduino.h"
+
+class SPIClass
+{
+public:
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+  void end(void) {}
+};
+
+SPIClass SPI;
+
+#endif
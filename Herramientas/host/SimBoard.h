@@ -0,0 +1,187 @@
+#ifndef SimBoard_h
+#define SimBoard_h
+
+/*
+  Tarjeta simulada: niveles de los pines, interrupciones y ADC.
+
+  Los sustitutos de Arduino.h, DHT.h, RTClib.h, etc. leen y escriben aquí; el
+  modelo de la planta (SimPlant.h) se conecta por medio de los ganchos para
+  entregar lecturas analógicas y reaccionar a las salidas (relevadores,
+  disparo del ultrasónico).
+*/
+
+#include <stdint.h>
+#include <math.h>
+#include <functional>
+#include <random>
+#include "SimKernel.h"
+
+#define SIM_PINS 64
+#define SIM_ADC_MAX_PINS 8
+
+typedef struct
+{
+  uint8_t pin;
+  uint8_t channel;
+  int avg_read_raw;
+  int avg_read_mV;
+} adc_continuous_data_t;
+
+class SimBoard
+{
+private:
+  uint8_t levels[SIM_PINS] = {0};
+  void (*isr[SIM_PINS])(void) = {nullptr};
+  int isrMode[SIM_PINS] = {0};
+
+  // ADC continuo
+  uint8_t adcPins[SIM_ADC_MAX_PINS];
+  size_t adcCount = 0;
+  uint32_t adcConversions = 1;
+  uint64_t adcFrameUs = 0;
+  void (*adcCallback)(void) = nullptr;
+  bool adcRunning = false;
+  adc_continuous_data_t adcFrame[SIM_ADC_MAX_PINS];
+
+  void scheduleFrame(void);
+
+public:
+  std::mt19937 rng{1};
+
+  // Ganchos del modelo de la planta
+  std::function<float(uint8_t pin)> analogSource;           // Lectura cruda sin ruido (0-4095)
+  std::function<void(uint8_t pin, uint8_t level)> onWrite;  // Salidas digitales
+  float adcNoise = 40.0f;                                   // Ruido de una conversión (cuentas)
+  uint64_t adcMinFrameUs = 0;                               // Modo rápido: bloques más espaciados
+
+  // Datos del DHT11 y del RTC
+  std::function<float(void)> airTemperature;
+  std::function<float(void)> airHumidity;
+  uint32_t epoch = 1718000000; // Segundos Unix al arrancar la simulación
+
+  // Estadísticas
+  uint64_t analogReads = 0;
+  uint64_t adcFrames = 0;
+
+  uint8_t read(uint8_t pin) { return pin < SIM_PINS ? levels[pin] : 0; }
+  void write(uint8_t pin, uint8_t level);
+  // Cambia un pin de entrada y dispara su interrupción (desde un evento)
+  void drive(uint8_t pin, uint8_t level);
+  void attach(uint8_t pin, void (*handler)(void), int mode);
+  void detach(uint8_t pin) { isr[pin] = nullptr; }
+  // Nivel de reposo de una entrada con pull-up, sin disparar la interrupción
+  void pullUp(uint8_t pin)
+  {
+    if (pin < SIM_PINS)
+      levels[pin] = 1;
+  }
+
+  uint16_t sample(uint8_t pin, uint32_t conversions);
+
+  bool adcConfigure(const uint8_t pins[], size_t count, uint32_t conversions, uint32_t frequency, void (*callback)(void));
+  bool adcStart(void);
+  bool adcStop(void) { return !(adcRunning = false); }
+  bool adcRead(adc_continuous_data_t **buffer);
+};
+
+SimBoard simBoard;
+
+void SimBoard ::write(uint8_t pin, uint8_t level)
+{
+  if (pin >= SIM_PINS)
+    return;
+  levels[pin] = level;
+  if (onWrite)
+    onWrite(pin, level);
+}
+
+void SimBoard ::drive(uint8_t pin, uint8_t level)
+{
+  if (pin >= SIM_PINS)
+    return;
+  uint8_t before = levels[pin];
+  levels[pin] = level;
+  if (isr[pin] == nullptr || before == level)
+    return;
+  // 1 = RISING, 2 = FALLING, 3 = CHANGE (mismos valores que Arduino.h)
+  int mode = isrMode[pin];
+  if (mode == 3 || (mode == 1 && level) || (mode == 2 && !level))
+    isr[pin]();
+}
+
+void SimBoard ::attach(uint8_t pin, void (*handler)(void), int mode)
+{
+  if (pin >= SIM_PINS)
+    return;
+  isr[pin] = handler;
+  isrMode[pin] = mode;
+}
+
+uint16_t SimBoard ::sample(uint8_t pin, uint32_t conversions)
+{
+  // El promedio de N conversiones reduce el ruido en raíz de N
+  float raw = analogSource ? analogSource(pin) : 0;
+  std::normal_distribution<float> noise(0, adcNoise / sqrtf((float)conversions));
+  raw += noise(rng);
+  if (raw < 0)
+    raw = 0;
+  if (raw > 4095)
+    raw = 4095;
+  return (uint16_t)lroundf(raw);
+}
+
+bool SimBoard ::adcConfigure(const uint8_t pins[], size_t count, uint32_t conversions, uint32_t frequency,
+                             void (*callback)(void))
+{
+  if (count == 0 || count > SIM_ADC_MAX_PINS || frequency == 0)
+    return false;
+  for (size_t i = 0; i < count; i++)
+    adcPins[i] = pins[i];
+  adcCount = count;
+  adcConversions = conversions;
+  adcFrameUs = (uint64_t)conversions * count * 1000000 / frequency;
+  if (adcFrameUs < adcMinFrameUs)
+    adcFrameUs = adcMinFrameUs;
+  adcCallback = callback;
+  return true;
+}
+
+bool SimBoard ::adcStart(void)
+{
+  if (adcCount == 0)
+    return false;
+  adcRunning = true;
+  scheduleFrame();
+  return true;
+}
+
+void SimBoard ::scheduleFrame(void)
+{
+  simKernel.schedule(simKernel.micros() + adcFrameUs, [this]() {
+    if (!adcRunning)
+      return;
+    adcFrames++;
+    if (adcCallback != nullptr)
+      adcCallback();
+    scheduleFrame();
+  });
+}
+
+bool SimBoard ::adcRead(adc_continuous_data_t **buffer)
+{
+  if (!adcRunning)
+    return false;
+  // El bloque se calcula al leerlo; el resultado es el mismo que si se
+  // hubiera guardado al terminar la conversión
+  for (size_t i = 0; i < adcCount; i++)
+  {
+    adcFrame[i].pin = adcPins[i];
+    adcFrame[i].channel = i;
+    adcFrame[i].avg_read_raw = sample(adcPins[i], adcConversions);
+    adcFrame[i].avg_read_mV = adcFrame[i].avg_read_raw * 3300 / 4095;
+  }
+  *buffer = adcFrame;
+  return true;
+}
+
+#endif
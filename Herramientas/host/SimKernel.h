@@ -0,0 +1,313 @@
+#ifndef SimKernel_h
+#define SimKernel_h
+
+/*
+  Núcleo del simulador: reloj virtual y tareas cooperativas.
+
+  Cada tarea de FreeRTOS es una corrutina (ucontext) sobre un solo hilo del
+  sistema. Una tarea corre hasta que se bloquea (vTaskDelay, espera en una
+  cola o semáforo); cuando ninguna puede avanzar, el reloj salta al siguiente
+  despertar o evento (interrupciones, bloques del ADC). El código del
+  firmware no consume tiempo virtual salvo lo que los controladores simulados
+  declaran (por ejemplo los 25 ms del DHT11), así que la simulación es
+  determinista y corre tan rápido como el anfitrión ejecuta el firmware.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <functional>
+#include <new>
+#include <queue>
+#include <vector>
+
+#define SIM_STACK_SIZE (256 * 1024)
+#define SIM_STACK_FILL 0xA5 // Patrón para medir la pila usada, como FreeRTOS
+
+struct SimTask
+{
+  const char *name;
+  void (*entry)(void *);
+  void *argument;
+  ucontext_t context;
+  std::vector<char> stack;
+  uint64_t wakeAt = 0;                 // Despertar por tiempo (us)
+  std::function<bool(void)> condition; // Despertar por condición (cola, semáforo)
+  uint32_t notifyValue = 0;            // xTaskNotifyGive / ulTaskNotifyTake
+  bool blocked = false;
+  bool finished = false;
+  uint64_t switches = 0;
+};
+
+struct SimEvent
+{
+  uint64_t at;
+  uint64_t order; // Desempate: mismo instante, orden de programación
+  std::function<void(void)> action;
+
+  bool operator>(const SimEvent &other) const
+  {
+    return at != other.at ? at > other.at : order > other.order;
+  }
+};
+
+class SimKernel
+{
+private:
+  uint64_t nowUs = 0;
+  uint64_t endUs = UINT64_MAX;
+  uint64_t eventOrder = 0;
+  std::vector<SimTask *> tasks;
+  std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+  SimTask *current = nullptr;
+  size_t nextPick = 0;
+  ucontext_t schedulerContext;
+  SimTask *sleeper = nullptr; // Tarea que puso al chip en light sleep
+  uint64_t frozenUntil = 0;
+
+  static void trampoline(void);
+  bool runnable(SimTask *task);
+  void block(void);
+
+public:
+  uint64_t switches = 0;
+  uint64_t eventsFired = 0;
+  uint64_t lightSleeps = 0;
+  uint64_t sleptUs = 0;
+
+  uint64_t micros(void) { return nowUs; }
+  SimTask *currentTask(void) { return current; }
+  const std::vector<SimTask *> &allTasks(void) { return tasks; }
+
+  SimTask *spawn(const char *name, void (*entry)(void *), void *argument);
+  void finish(void);
+
+  // Bytes de la pila que nunca se escribieron (la pila crece hacia abajo)
+  size_t stackUnused(SimTask *task)
+  {
+    size_t unused = 0;
+    while (unused < task->stack.size() && task->stack[unused] == (char)SIM_STACK_FILL)
+      unused++;
+    return unused;
+  }
+
+  // Bloquea la tarea actual hasta un instante o hasta que condition() sea
+  // verdadera (lo que ocurra primero); devuelve el resultado de condition()
+  bool waitUntil(uint64_t wakeAt, std::function<bool(void)> condition = nullptr);
+  void sleepFor(uint64_t us) { waitUntil(nowUs + us); }
+
+  // Light sleep: ninguna tarea corre hasta que vence el temporizador, pero
+  // los eventos (la planta, los ecos) siguen avanzando
+  void lightSleep(uint64_t us);
+
+  // Evento en el contexto del planificador (como una interrupción)
+  void schedule(uint64_t at, std::function<void(void)> action);
+
+  // Corre hasta que el reloj llega a untilUs o no queda nada por hacer
+  void run(uint64_t untilUs);
+};
+
+SimKernel simKernel;
+
+/*
+  Asignaciones del heap hechas por el firmware. Se reemplaza el operator new
+  global y sólo se cuentan las que ocurren dentro de una tarea, fuera de las
+  rutinas del anfitrión que imitan al hardware (SimHostScope): el broker, la
+  NVS, los archivos de la SD y los eventos del planificador. malloc de C no
+  se cuenta; el firmware no lo usa.
+*/
+class SimHeap
+{
+public:
+  int hostDepth = 0;
+  uint64_t steadyFromUs = UINT64_MAX; // Desde aquí ya no debería haber ninguna
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+  uint64_t steadyAllocations = 0;
+  uint64_t steadyBytes = 0;
+  const char *firstSteadyTask = nullptr; // Primera asignación en régimen, para depurar
+  size_t firstSteadySize = 0;
+
+  void note(size_t size)
+  {
+    if (hostDepth > 0 || simKernel.currentTask() == nullptr)
+      return;
+    allocations++;
+    bytes += size;
+    if (simKernel.micros() < steadyFromUs)
+      return;
+    if (steadyAllocations++ == 0)
+    {
+      firstSteadyTask = simKernel.currentTask()->name;
+      firstSteadySize = size;
+    }
+    steadyBytes += size;
+  }
+};
+
+SimHeap simHeap;
+
+// Marca código del anfitrión: lo que reserve no es del firmware
+class SimHostScope
+{
+public:
+  SimHostScope(void) { simHeap.hostDepth++; }
+  ~SimHostScope(void) { simHeap.hostDepth--; }
+};
+
+// Reemplazo estándar de new/delete sobre malloc/free
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void *operator new(size_t size)
+{
+  simHeap.note(size);
+  void *memory = malloc(size > 0 ? size : 1);
+  if (memory == nullptr)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t size) noexcept { free(memory); }
+#pragma GCC diagnostic pop
+
+void SimKernel ::trampoline(void)
+{
+  SimTask *task = simKernel.current;
+  task->entry(task->argument);
+  simKernel.finish();
+}
+
+SimTask *SimKernel ::spawn(const char *name, void (*entry)(void *), void *argument)
+{
+  // La pila del anfitrión no es la del ESP32; xTaskCreate cuenta aparte
+  SimHostScope host;
+  SimTask *task = new SimTask();
+  task->name = name;
+  task->entry = entry;
+  task->argument = argument;
+  task->stack.assign(SIM_STACK_SIZE, (char)SIM_STACK_FILL);
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp = task->stack.data();
+  task->context.uc_stack.ss_size = task->stack.size();
+  task->context.uc_link = &schedulerContext;
+  makecontext(&task->context, trampoline, 0);
+  tasks.push_back(task);
+  return task;
+}
+
+void SimKernel ::finish(void)
+{
+  current->finished = true;
+  swapcontext(&current->context, &schedulerContext);
+}
+
+void SimKernel ::block(void)
+{
+  SimTask *self = current;
+  self->blocked = true;
+  swapcontext(&self->context, &schedulerContext);
+}
+
+bool SimKernel ::waitUntil(uint64_t wakeAt, std::function<bool(void)> condition)
+{
+  if (current == nullptr)
+  {
+    // Fuera de una tarea (antes de arrancar): sólo avanza el reloj
+    if (wakeAt > nowUs)
+      nowUs = wakeAt;
+    return condition ? condition() : false;
+  }
+  if (condition && condition())
+    return true;
+  current->wakeAt = wakeAt;
+  current->condition = condition;
+  block();
+  bool result = current->condition ? current->condition() : false;
+  current->condition = nullptr;
+  return result;
+}
+
+void SimKernel ::lightSleep(uint64_t us)
+{
+  lightSleeps++;
+  sleptUs += us;
+  sleeper = current;
+  frozenUntil = nowUs + us;
+  waitUntil(frozenUntil);
+  sleeper = nullptr;
+}
+
+void SimKernel ::schedule(uint64_t at, std::function<void(void)> action)
+{
+  SimHostScope host;
+  events.push(SimEvent{at < nowUs ? nowUs : at, eventOrder++, action});
+}
+
+bool SimKernel ::runnable(SimTask *task)
+{
+  if (task->finished)
+    return false;
+  if (sleeper != nullptr && task != sleeper)
+    return false;
+  if (!task->blocked)
+    return true;
+  return nowUs >= task->wakeAt || (task->condition && task->condition());
+}
+
+void SimKernel ::run(uint64_t untilUs)
+{
+  endUs = untilUs;
+  while (true)
+  {
+    // Eventos vencidos primero, como una interrupción
+    while (!events.empty() && events.top().at <= nowUs)
+    {
+      SimEvent event = events.top();
+      events.pop();
+      eventsFired++;
+      event.action();
+    }
+
+    // Siguiente tarea lista en orden circular
+    SimTask *pick = nullptr;
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+      SimTask *task = tasks[(nextPick + i) % tasks.size()];
+      if (runnable(task))
+      {
+        pick = task;
+        nextPick = (nextPick + i + 1) % tasks.size();
+        break;
+      }
+    }
+
+    if (pick != nullptr)
+    {
+      pick->blocked = false;
+      pick->switches++;
+      switches++;
+      current = pick;
+      swapcontext(&schedulerContext, &pick->context);
+      current = nullptr;
+      continue;
+    }
+
+    // Nadie puede avanzar: saltar al siguiente despertar o evento
+    uint64_t next = UINT64_MAX;
+    for (SimTask *task : tasks)
+      if (!task->finished && task->blocked && (sleeper == nullptr || task == sleeper) && task->wakeAt < next)
+        next = task->wakeAt;
+    if (!events.empty() && events.top().at < next)
+      next = events.top().at;
+    if (next == UINT64_MAX || next > endUs)
+    {
+      nowUs = endUs;
+      return;
+    }
+    nowUs = next;
+  }
+}
+
+#endif
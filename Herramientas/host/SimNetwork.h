@@ -0,0 +1,88 @@
+#ifndef SimNetwork_h
+#define SimNetwork_h
+
+/*
+  Red simulada: el AP, el broker MQTT y sus cortes.
+
+  WiFi.h y PubSubClient.h consultan aquí si hay enlace. El broker guarda
+  cuántos mensajes y bytes recibió por tópico y puede entregar mensajes
+  programados (por ejemplo una configuración) a los nodos suscritos.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "SimKernel.h"
+
+struct SimOutage
+{
+  uint64_t startUs;
+  uint64_t endUs;
+  bool wifi; // false = sólo el broker
+};
+
+struct SimTopicStats
+{
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  size_t maxBytes = 0; // Mensaje más grande
+  std::string last;    // Último mensaje publicado
+};
+
+struct SimInbound
+{
+  uint64_t at;
+  std::string topic;
+  std::string payload;
+};
+
+class SimNetwork
+{
+public:
+  uint32_t associationMs = 1500; // Tiempo de asociación con el AP
+  std::vector<SimOutage> outages;
+  std::map<std::string, SimTopicStats> topics;
+  std::vector<SimInbound> inbound;
+  uint64_t connects = 0;
+  uint64_t rejected = 0; // Publicaciones fallidas (sin conexión o paquete muy grande)
+  // Cliente simulado que contesta a lo que publica el firmware
+  std::function<void(const std::string &topic, const std::string &payload)> onPublish;
+
+  bool wifiUp(void) { return !inOutage(true); }
+  bool brokerUp(void) { return wifiUp() && !inOutage(false); }
+
+  bool inOutage(bool wifi)
+  {
+    uint64_t now = simKernel.micros();
+    for (const SimOutage &o : outages)
+      if (o.wifi == wifi && now >= o.startUs && now < o.endUs)
+        return true;
+    return false;
+  }
+
+  void record(const char *topic, const uint8_t *payload, size_t length)
+  {
+    SimHostScope host;
+    SimTopicStats &stats = topics[topic];
+    stats.messages++;
+    stats.bytes += length;
+    if (length > stats.maxBytes)
+      stats.maxBytes = length;
+    stats.last.assign((const char *)payload, length);
+    if (onPublish)
+      onPublish(topic, stats.last);
+  }
+
+  // Mensaje que el broker entregará a los suscritos a partir de atUs
+  void inject(uint64_t atUs, const std::string &topic, const std::string &payload)
+  {
+    inbound.push_back(SimInbound{atUs, topic, payload});
+  }
+};
+
+SimNetwork simNetwork;
+
+#endif
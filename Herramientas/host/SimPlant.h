@@ -0,0 +1,202 @@
+#ifndef SimPlant_h
+#define SimPlant_h
+
+/*
+  Modelo del invernadero para el simulador.
+
+  Se integra cada SIM_PLANT_STEP_S segundos virtuales:
+    - Luz: seno entre las 6:00 y las 18:00 por un factor de nubes diario.
+    - Aire: temperatura y humedad diurnas (opuestas) con variación diaria.
+    - Suelo: cada zona se seca por evapotranspiración (más con sol y calor),
+      sube con la lluvia y con su relevador encendido.
+    - Tanque: baja mientras riega algún relevador y se rellena a las 9:00
+      si quedó bajo el mínimo.
+
+  Las sondas responden en las cuentas crudas que espera la calibración por
+  omisión de AnalogSampler.h (suelo 790 = 0 %, 390 = 100 %; luz lineal) y el
+  HC-SR04 responde al flanco de bajada del disparo con un eco cuyo ancho
+  corresponde a la distancia al agua.
+*/
+
+#include <math.h>
+#include <random>
+#include "SimKernel.h"
+#include "SimBoard.h"
+
+#define SIM_PLANT_STEP_S 60
+#define SIM_ZONES 2
+
+struct SimPlantPins
+{
+  uint8_t trigger;
+  uint8_t echo;
+  uint8_t light;
+  uint8_t soil[SIM_ZONES];
+  uint8_t relay[SIM_ZONES];
+};
+
+struct SimPlantConfig
+{
+  float tankLiters = 20.0f;      // Capacidad del tanque
+  float pumpLitersPerMin = 1.0f; // Consumo de cada zona regando
+  float irrigationPctPerMin = 2.0f;
+  float dryingPctPerHour = 0.6f; // A pleno sol y 30 °C
+  float rainProbability = 0.15f; // Por día
+  float refillBelow = 0.30f;     // Fracción del tanque que dispara el rellenado (el firmware bloquea la bomba bajo 20 %)
+  float tankFullCm = 6.0f;       // Distancia del sensor al agua (TANK_FULL_CM, TANK_EMPTY_CM)
+  float tankEmptyCm = 17.0f;
+  float echoNoiseCm = 0.3f;
+  float echoLossProbability = 0.01f;
+};
+
+class SimPlant
+{
+private:
+  SimPlantPins pins;
+  std::mt19937 rng;
+  uint8_t triggerLevel = 0;
+  int64_t currentDay = -1;
+  float cloudFactor = 1.0f;
+  float dayOffset = 0.0f;
+  int rainHour = -1;
+
+  uint32_t localSeconds(void) { return simBoard.epoch + (uint32_t)(simKernel.micros() / 1000000); }
+  float hourOfDay(void) { return (localSeconds() % 86400) / 3600.0f; }
+  float uniform(float low, float high) { return std::uniform_real_distribution<float>(low, high)(rng); }
+  void newDay(void);
+  void step(void);
+  void onTrigger(uint8_t level);
+
+public:
+  SimPlantConfig config;
+
+  // Estado
+  float soil[SIM_ZONES] = {55.0f, 60.0f}; // % de humedad
+  float tankLiters;
+
+  // Estadísticas
+  double irrigationSeconds[SIM_ZONES] = {0, 0};
+  double litersUsed = 0;
+  uint32_t rainEvents = 0;
+  uint32_t refills = 0;
+  uint64_t echoes = 0;
+  float minSoil = 100.0f;
+
+  SimPlant(const SimPlantPins &pins, uint32_t seed) : pins(pins), rng(seed) {}
+
+  void begin(void);
+  float light(void);
+  float temperature(void) { return 24.0f + dayOffset + 6.0f * sinf(2 * (float)M_PI * (hourOfDay() - 9) / 24); }
+  float humidity(void)
+  {
+    float h = 65.0f - 2 * dayOffset - 18.0f * sinf(2 * (float)M_PI * (hourOfDay() - 9) / 24);
+    return h < 20 ? 20 : (h > 98 ? 98 : h);
+  }
+  float tankDistanceCm(void)
+  {
+    return config.tankEmptyCm - (config.tankEmptyCm - config.tankFullCm) * tankLiters / config.tankLiters;
+  }
+  bool relayOn(uint8_t zone) { return simBoard.read(pins.relay[zone]) == HIGH; }
+};
+
+void SimPlant ::begin(void)
+{
+  tankLiters = config.tankLiters * 0.8f;
+  newDay();
+
+  simBoard.analogSource = [this](uint8_t pin) -> float {
+    if (pin == pins.light)
+      return light() * 40.95f;
+    for (uint8_t z = 0; z < SIM_ZONES; z++)
+      if (pin == pins.soil[z])
+        return 790.0f - soil[z] * 4.0f;
+    return 0;
+  };
+  simBoard.airTemperature = [this]() { return temperature(); };
+  simBoard.airHumidity = [this]() { return humidity(); };
+  simBoard.onWrite = [this](uint8_t pin, uint8_t level) {
+    if (pin == pins.trigger)
+      onTrigger(level);
+  };
+
+  simKernel.schedule(simKernel.micros() + SIM_PLANT_STEP_S * 1000000ULL, [this]() { step(); });
+}
+
+void SimPlant ::newDay(void)
+{
+  currentDay = localSeconds() / 86400;
+  cloudFactor = uniform(0.35f, 1.0f);
+  dayOffset = uniform(-3.0f, 3.0f);
+  rainHour = uniform(0, 1) < config.rainProbability ? (int)uniform(12, 20) : -1;
+}
+
+float SimPlant ::light(void)
+{
+  float h = hourOfDay();
+  if (h < 6 || h > 18)
+    return 0;
+  return 100.0f * cloudFactor * sinf((float)M_PI * (h - 6) / 12);
+}
+
+void SimPlant ::step(void)
+{
+  if ((int64_t)(localSeconds() / 86400) != currentDay)
+    newDay();
+
+  float minutes = SIM_PLANT_STEP_S / 60.0f;
+  int hour = (int)hourOfDay();
+  bool raining = hour == rainHour;
+
+  // Evapotranspiración: base nocturna más la parte que depende del sol y el calor
+  float heat = (temperature() - 10) / 20;
+  float drying = config.dryingPctPerHour * (0.15f + light() / 100 * (heat > 0 ? heat : 0)) * minutes / 60;
+
+  for (uint8_t z = 0; z < SIM_ZONES; z++)
+  {
+    soil[z] -= drying * (z == 0 ? 1.0f : 0.85f);
+    if (raining)
+      soil[z] += 30.0f / 60 * minutes;
+    if (relayOn(z) && tankLiters > 0)
+    {
+      soil[z] += config.irrigationPctPerMin * minutes;
+      float used = config.pumpLitersPerMin * minutes;
+      if (used > tankLiters)
+        used = tankLiters;
+      tankLiters -= used;
+      litersUsed += used;
+      irrigationSeconds[z] += SIM_PLANT_STEP_S;
+    }
+    soil[z] = soil[z] < 0 ? 0 : (soil[z] > 100 ? 100 : soil[z]);
+    if (soil[z] < minSoil)
+      minSoil = soil[z];
+  }
+  if (raining && localSeconds() % 3600 < SIM_PLANT_STEP_S)
+    rainEvents++;
+
+  // Rellenado a las 9:00 si quedó bajo el mínimo
+  if (tankLiters < config.tankLiters * config.refillBelow && localSeconds() % 86400 / SIM_PLANT_STEP_S == 9 * 3600 / SIM_PLANT_STEP_S)
+  {
+    tankLiters = config.tankLiters;
+    refills++;
+  }
+
+  simKernel.schedule(simKernel.micros() + SIM_PLANT_STEP_S * 1000000ULL, [this]() { step(); });
+}
+
+void SimPlant ::onTrigger(uint8_t level)
+{
+  // El HC-SR04 emite la ráfaga al flanco de bajada del pulso de 10 us
+  bool falling = triggerLevel == HIGH && level == LOW;
+  triggerLevel = level;
+  if (!falling || uniform(0, 1) < config.echoLossProbability)
+    return;
+
+  float distance = tankDistanceCm() + std::normal_distribution<float>(0, config.echoNoiseCm)(rng);
+  uint64_t width = (uint64_t)(distance * 2 / 0.034f);
+  uint64_t start = simKernel.micros() + 450; // Ráfaga de 8 ciclos a 40 kHz
+  echoes++;
+  simKernel.schedule(start, [this]() { simBoard.drive(pins.echo, HIGH); });
+  simKernel.schedule(start + width, [this]() { simBoard.drive(pins.echo, LOW); });
+}
+
+#endif
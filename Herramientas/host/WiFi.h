@@ -0,0 +1,85 @@
+#ifndef HostWiFi_h
+#define HostWiFi_h
+
+// WiFi del ESP32 sobre SimNetwork: el enlace se establece associationMs
+// después de begin() si no hay un corte de WiFi en curso.
+
+#include "Arduino.h"
+#include "SimNetwork.h"
+
+#define WIFI_OFF 0
+#define WIFI_STA 1
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class IPAddress
+{
+public:
+  uint8_t octets[4] = {192, 168, 1, 50};
+  String toString(void) const
+  {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+  }
+};
+
+
+class WiFiClass
+{
+private:
+  bool started = false;
+  uint64_t connectAt = 0;
+  uint8_t bssid[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+
+public:
+  uint64_t begins = 0;
+
+  void mode(int mode)
+  {
+    if (mode == WIFI_OFF)
+      started = false;
+  }
+  void setAutoReconnect(bool enable) {}
+  void begin(const char *ssid, const char *password, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true)
+  {
+    begins++;
+    started = true;
+    // Con canal y BSSID conocidos no hay escaneo
+    connectAt = simKernel.micros() + (uint64_t)simNetwork.associationMs * (channel != 0 ? 300 : 1000);
+  }
+  void disconnect(bool wifiOff = false) { started = false; }
+  int status(void)
+  {
+    if (!started || !simNetwork.wifiUp() || simKernel.micros() < connectAt)
+      return WL_DISCONNECTED;
+    return WL_CONNECTED;
+  }
+  uint8_t *BSSID(void) { return status() == WL_CONNECTED ? bssid : NULL; }
+  int32_t channel(void) { return 6; }
+  uint8_t *macAddress(uint8_t *mac)
+  {
+    static const uint8_t address[6] = {0x24, 0x0A, 0xC4, 0x5A, 0x10, 0x01};
+    memcpy(mac, address, sizeof(address));
+    return mac;
+  }
+  int8_t RSSI(void) { return -60; }
+  IPAddress localIP(void) { return IPAddress(); }
+};
+
+WiFiClass WiFi;
+
+class Client
+{
+public:
+  virtual ~Client() {}
+};
+
+class WiFiClient : public Client
+{
+public:
+  void setNoDelay(bool noDelay) {}
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef HostWiFiClientSecure_h
+#define HostWiFiClientSecure_h
+
+// HTTPS hacia Firebase con FIREBASE_SINK: la conexión abre si hay WiFi y
+// cada PATCH recibe un "204 No Content" (print=silent) sin pasar por TLS.
+
+#include <string>
+#include "WiFi.h"
+
+class WiFiClientSecure : public Client
+{
+private:
+  bool open = false;
+  std::string response; // Lo que falta por leer
+  size_t position = 0;
+
+public:
+  static uint64_t requests;
+  static uint64_t bytesWritten;
+
+  void setInsecure(void) {}
+  void setCACert(const char *certificate) {}
+
+  bool connect(const char *host, uint16_t port)
+  {
+    open = simNetwork.wifiUp();
+    response.clear();
+    position = 0;
+    return open;
+  }
+  bool connected(void) { return open && simNetwork.wifiUp(); }
+  void stop(void) { open = false; }
+
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    if (!connected())
+      return 0;
+    // Cada petición de FirebaseClient empieza con un write() propio
+    if (size >= 6 && memcmp(buffer, "PATCH ", 6) == 0)
+    {
+      requests++;
+      response.append("HTTP/1.1 204 No Content\r\nConnection: keep-alive\r\n\r\n");
+    }
+    bytesWritten += size;
+    return size;
+  }
+
+  int available(void) { return connected() ? (int)(response.size() - position) : 0; }
+
+  int read(uint8_t *buffer, size_t size)
+  {
+    size_t n = response.size() - position;
+    if (n > size)
+      n = size;
+    memcpy(buffer, response.data() + position, n);
+    position += n;
+    if (position == response.size())
+    {
+      response.clear();
+      position = 0;
+    }
+    return (int)n;
+  }
+};
+
+uint64_t WiFiClientSecure::requests = 0;
+uint64_t WiFiClientSecure::bytesWritten = 0;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HostWire_h
+#define HostWire_h
+
+// El bus I2C no se simula: los dispositivos (RTC, LCD) tienen su propio sustituto.
+
+#include "Arduino.h"
+
+class TwoWire
+{
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+  void setClock(uint32_t frequency) {}
+};
+
+TwoWire Wire;
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef env_h
+#define env_h
+
+// Credenciales de prueba para el simulador (el broker es SimNetwork)
+
+struct KeysEnv
+{
+  const char *ssid = "simulador";
+  const char *password = "simulador";
+  const char *mqtt_server = "127.0.0.1";
+  uint16_t MQTT_PORT = 1883;
+  const char *topicTX = "ucol/iot/sensores";
+  const char *topicRX = "ucol/iot/config";
+  const char *firebase_host = "simulador.firebaseio.com"; // Con FIREBASE_SINK (WiFiClientSecure.h)
+  const char *firebase_auth = "";
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HostEspSleep_h
+#define HostEspSleep_h
+
+// Light sleep del ESP32 sobre el reloj virtual (ver SimKernel::lightSleep);
+// sólo el temporizador despierta al chip: la activación por GPIO se acepta
+// pero los botones no se simulan durante el sueño.
+
+#include "SimKernel.h"
+
+#ifndef ESP_OK
+#define ESP_OK 0
+typedef int esp_err_t;
+#endif
+
+static uint64_t simSleepTimerUs = 0;
+
+static inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us)
+{
+  simSleepTimerUs = us;
+  return ESP_OK;
+}
+
+static inline esp_err_t esp_sleep_enable_gpio_wakeup(void) { return ESP_OK; }
+
+static inline esp_err_t esp_light_sleep_start(void)
+{
+  simKernel.lightSleep(simSleepTimerUs);
+  return ESP_OK;
+}
+
+#endif
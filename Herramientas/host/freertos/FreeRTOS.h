@@ -0,0 +1,288 @@
+#ifndef HostFreeRTOS_h
+#define HostFreeRTOS_h
+
+/*
+  API de FreeRTOS que usa SiRIM, sobre las tareas cooperativas de SimKernel.
+  Un tick dura 1 ms. Las prioridades y el núcleo asignado se ignoran: las
+  tareas listas corren en orden circular.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "../SimKernel.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef SimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef uint8_t StackType_t; // Como en el ESP32: la pila se mide en bytes
+
+// Memoria de los objetos estáticos; el simulador no la usa
+struct StaticTask_t
+{
+  uint8_t reserved[352];
+};
+struct StaticQueue_t
+{
+  uint8_t reserved[84];
+};
+typedef StaticQueue_t StaticSemaphore_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define errQUEUE_FULL 0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portYIELD_FROM_ISR(...)
+
+// Anillo con su memoria reservada al crearse, como en FreeRTOS: enviar y
+// recibir no tocan el heap
+struct SimQueue
+{
+  size_t itemSize;
+  size_t capacity;
+  std::vector<uint8_t> storage;
+  size_t head = 0;
+  size_t count = 0;
+  size_t maxDepth = 0; // Para el reporte del simulador
+  bool isMutex = false;
+
+  size_t size(void) const { return count; }
+  bool empty(void) const { return count == 0; }
+  void push(const void *item)
+  {
+    if (item != NULL && itemSize > 0)
+      memcpy(&storage[(head + count) % capacity * itemSize], item, itemSize);
+    count++;
+  }
+  void front(void *item) const
+  {
+    if (itemSize > 0)
+      memcpy(item, &storage[head * itemSize], itemSize);
+  }
+  void pop(void)
+  {
+    head = (head + 1) % capacity;
+    count--;
+  }
+  void clear(void) { head = count = 0; }
+};
+
+typedef SimQueue *QueueHandle_t;
+typedef SimQueue *SemaphoreHandle_t;
+
+// Todas las colas y semáforos en orden de creación (para el reporte)
+static inline std::vector<SimQueue *> &simQueues(void)
+{
+  static std::vector<SimQueue *> queues;
+  return queues;
+}
+
+static inline uint64_t simDeadline(TickType_t ticks)
+{
+  if (ticks == portMAX_DELAY)
+    return UINT64_MAX;
+  return simKernel.micros() + (uint64_t)ticks * 1000;
+}
+
+/*-- Tareas --*/
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                                                 void *parameters, UBaseType_t priority, TaskHandle_t *created,
+                                                 BaseType_t coreId)
+{
+  // En el ESP32 la pila y el TCB salen del heap
+  simHeap.note(stackDepth + sizeof(StaticTask_t));
+  TaskHandle_t task = simKernel.spawn(name, code, parameters);
+  if (created != NULL)
+    *created = task;
+  return pdPASS;
+}
+
+static inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                                                         void *parameters, UBaseType_t priority, StackType_t *stack,
+                                                         StaticTask_t *buffer, BaseType_t coreId)
+{
+  return simKernel.spawn(name, code, parameters);
+}
+
+static inline BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                                     void *parameters, UBaseType_t priority, TaskHandle_t *created)
+{
+  return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, created, tskNO_AFFINITY);
+}
+
+static inline void vTaskDelay(TickType_t ticks) { simKernel.sleepFor((uint64_t)ticks * 1000); }
+
+static inline void vTaskDelayUntil(TickType_t *previous, TickType_t increment)
+{
+  *previous += increment;
+  simKernel.waitUntil((uint64_t)*previous * 1000);
+}
+
+static inline TickType_t xTaskGetTickCount(void) { return (TickType_t)(simKernel.micros() / 1000); }
+
+static inline void vTaskDelete(TaskHandle_t task)
+{
+  if (task == NULL || task == simKernel.currentTask())
+    simKernel.finish();
+}
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void) { return simKernel.currentTask(); }
+
+// Mínimo de pila libre (palabras) sobre la pila del anfitrión, que usa más
+// que el ESP32: sirve para comparar tareas, no como valor absoluto
+static inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+  if (task == NULL)
+    task = simKernel.currentTask();
+  return task != NULL ? simKernel.stackUnused(task) / 4 : 0;
+}
+
+/*-- Notificaciones: un contador por tarea --*/
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  task->notifyValue++;
+  return pdPASS;
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+  SimTask *task = simKernel.currentTask();
+  if (!simKernel.waitUntil(simDeadline(ticks), [task]() { return task->notifyValue > 0; }))
+    return 0;
+  uint32_t value = task->notifyValue;
+  task->notifyValue = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+/*-- Colas --*/
+
+static inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  SimQueue *queue = new SimQueue();
+  queue->itemSize = itemSize;
+  queue->capacity = length;
+  queue->storage.resize(length * itemSize);
+  {
+    SimHostScope host;
+    simQueues().push_back(queue);
+  }
+  return queue;
+}
+
+// Versiones estáticas: la memoria del anfitrión no cuenta como heap del firmware
+static inline QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t *storage,
+                                               StaticQueue_t *buffer)
+{
+  SimHostScope host;
+  return xQueueCreate(length, itemSize);
+}
+
+static inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+  if (!simKernel.waitUntil(simDeadline(ticks), [queue]() { return queue->size() < queue->capacity; }))
+    return errQUEUE_FULL;
+  queue->push(item);
+  if (queue->size() > queue->maxDepth)
+    queue->maxDepth = queue->size();
+  return pdPASS;
+}
+
+static inline BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+  return xQueueSend(queue, item, ticks);
+}
+
+static inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+  if (queue->size() >= queue->capacity)
+    return errQUEUE_FULL;
+  return xQueueSend(queue, item, 0);
+}
+
+static inline BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+  queue->clear();
+  return xQueueSend(queue, item, 0);
+}
+
+static inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+  if (!simKernel.waitUntil(simDeadline(ticks), [queue]() { return !queue->empty(); }))
+    return pdFALSE;
+  queue->front(item);
+  queue->pop();
+  return pdTRUE;
+}
+
+static inline BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+  if (!simKernel.waitUntil(simDeadline(ticks), [queue]() { return !queue->empty(); }))
+    return pdFALSE;
+  queue->front(item);
+  return pdTRUE;
+}
+
+static inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) { return queue->size(); }
+static inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) { return queue->capacity - queue->size(); }
+
+/*-- Semáforos: una cola de elementos vacíos, como en FreeRTOS --*/
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xQueueCreate(1, 0); }
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+  mutex->isMutex = true;
+  mutex->push(NULL);
+  return mutex;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+  SimHostScope host;
+  return xSemaphoreCreateMutex();
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+  SimHostScope host;
+  return xSemaphoreCreateBinary();
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+  SemaphoreHandle_t semaphore = xQueueCreate(maxCount, 0);
+  for (UBaseType_t i = 0; i < initialCount; i++)
+    semaphore->push(NULL);
+  return semaphore;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+  uint8_t none;
+  return xQueueReceive(semaphore, &none, ticks);
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  if (semaphore->size() >= semaphore->capacity)
+    return pdFALSE;
+  semaphore->push(NULL);
+  return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken)
+{
+  return xSemaphoreGive(semaphore);
+}
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HostFreeRTOSQueue_h
+#define HostFreeRTOSQueue_h
+
+// Todo vive en FreeRTOS.h
+#include "FreeRTOS.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HostFreeRTOSSemphr_h
+#define HostFreeRTOSSemphr_h
+
+// Todo vive en FreeRTOS.h
+#include "FreeRTOS.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HostFreeRTOSTask_h
+#define HostFreeRTOSTask_h
+
+// Todo vive en FreeRTOS.h
+#include "FreeRTOS.h"
+
+#endif
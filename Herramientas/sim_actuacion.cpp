@@ -0,0 +1,329 @@
+/*
+  Prueba de escritorio del control de zonas (SiRIM/ZoneController.h).
+
+  Evalúa el controlador cada ACTUATION_TICK_MS como ActuationTask y le manda
+  una instantánea por segundo, como las lecturas de suelo y tanque:
+    - histéresis   cada zona sigue a su sensor y no rebota en el umbral
+    - tanque       un eco ruidoso entre 19 % y 25 % no suelta el interbloqueo
+    - máximo       un turno de más de una hora se corta y la zona descansa
+    - sin lecturas si dejan de llegar instantáneas todo se apaga
+    - sin datos    un sensor sin lectura (READING_INVALID) apaga su zona en
+                   automático; el temporizador no depende de él
+    - sin tanque   el ultrasónico deja de contestar (READING_INVALID): todo
+                   apagado en cualquier modo, y un interbloqueo puesto vuelve
+                   a esperar TANK_RELEASE_HOLD_MS de lecturas válidas
+    - manual       ambas zonas siguen la orden, salvo con el tanque bajo
+    - omisión      con los umbrales de DEFAULT_IRRIGATION_CONFIG y una
+                   planta sencilla, cada zona riega hasta el umbral más la
+                   histéresis y se apaga
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_actuacion sim_actuacion.cpp
+  Uso:
+    ./sim_actuacion
+*/
+
+#include <stdio.h>
+#include "ZoneController.h"
+#include "NodeConfig.h"
+
+#define TICK_MS 250
+#define SNAPSHOT_MS 1000
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static ActuationSnapshot base(ActuationMode mode)
+{
+  ActuationSnapshot s;
+  memset(&s, 0, sizeof(s));
+  s.soil[0] = s.soil[1] = 60;
+  s.light = 10;
+  s.waterPercent = 80;
+  s.soilThreshold = 40;
+  s.lightThreshold = 50;
+  s.mode = mode;
+  return s;
+}
+
+class Run
+{
+public:
+  ZoneController ctrl;
+  uint32_t now = 0;
+  uint32_t switches = 0;
+  uint8_t relays = 0;
+
+  // Avanza ms; snapshot == NULL simula que la tarea de sensores se colgó
+  void run(uint32_t ms, ActuationSnapshot *snapshot)
+  {
+    for (uint32_t end = now + ms; now < end; now += TICK_MS)
+    {
+      if (snapshot != NULL && now % SNAPSHOT_MS == 0)
+      {
+        ctrl.update(*snapshot, now);
+        memset(snapshot->turnSeconds, 0, sizeof(snapshot->turnSeconds));
+      }
+      uint8_t r = ctrl.evaluate(now);
+      if (r != relays)
+        switches++;
+      relays = r;
+    }
+  }
+};
+
+static void report(const char *scenario, Run &r)
+{
+  printf("%-12s cambios %4lu  encendidos %3lu/%3lu  bloqueos %lu  cortes %lu  sin lecturas %lu\n", scenario,
+         (unsigned long)r.switches, (unsigned long)r.ctrl.zone(0).starts, (unsigned long)r.ctrl.zone(1).starts,
+         (unsigned long)r.ctrl.interlockTrips, (unsigned long)r.ctrl.maxRunCutoffs, (unsigned long)r.ctrl.staleCutoffs);
+}
+
+static void hysteresis(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_AUTO);
+
+  // La zona 1 se seca y oscila alrededor del umbral; la 2 sigue húmeda
+  for (int i = 0; i < 600; i++)
+  {
+    s.soil[0] = 38 + i % 5; // 38..42
+    r.run(SNAPSHOT_MS, &s);
+  }
+  check("histéresis", r.ctrl.zone(0).on && r.ctrl.zone(0).starts == 1, "la zona 1 rebotó en el umbral");
+  check("histéresis", !r.ctrl.zone(1).on && r.ctrl.zone(1).starts == 0, "la zona 2 se encendió con el suelo húmedo");
+
+  s.soil[0] = 46;
+  r.run(2 * SNAPSHOT_MS, &s);
+  check("histéresis", !r.ctrl.zone(0).on && r.ctrl.zone(0).cause == CAUSE_SATISFIED, "la zona 1 no se apagó sobre el umbral");
+
+  // Con luz alta no arranca aunque el suelo esté seco
+  s.soil[0] = s.soil[1] = 30;
+  s.light = 80;
+  r.run(10 * SNAPSHOT_MS, &s);
+  check("histéresis", r.relays == 0, "se regó con luz alta");
+  report("histéresis", r);
+}
+
+static void tank(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_AUTO);
+  s.soil[0] = s.soil[1] = 20;
+  r.run(5 * SNAPSHOT_MS, &s);
+  check("tanque", r.relays == 3, "no se encendieron las zonas secas");
+
+  // Eco ruidoso cerca del límite durante 10 minutos
+  for (int i = 0; i < 600; i++)
+  {
+    s.waterPercent = i % 3 == 0 ? 19 : 25;
+    r.run(SNAPSHOT_MS, &s);
+    if (i > 0)
+      check("tanque", r.relays == 0, "el interbloqueo se soltó con el eco ruidoso");
+  }
+  check("tanque", r.ctrl.interlockTrips == 1, "el interbloqueo debe contarse una vez");
+
+  s.waterPercent = 30;
+  r.run(TANK_RELEASE_HOLD_MS - 5 * SNAPSHOT_MS, &s);
+  check("tanque", r.relays == 0, "el interbloqueo se soltó antes de tiempo");
+  r.run(10 * SNAPSHOT_MS, &s);
+  check("tanque", r.relays == 3 && !r.ctrl.isTankLow(), "el interbloqueo no se soltó con el tanque lleno");
+  report("tanque", r);
+}
+
+static void maxRun(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_TIMER);
+  s.turnSeconds[0] = 7200;
+  r.run(ZONE_MAX_RUN_MS - SNAPSHOT_MS, &s);
+  check("máximo", r.ctrl.zone(0).on, "el turno se cortó antes del máximo");
+  r.run(2 * SNAPSHOT_MS, &s);
+  check("máximo", !r.ctrl.zone(0).on && r.ctrl.zone(0).cause == CAUSE_MAX_RUN, "el turno pasó del máximo");
+
+  // Un turno nuevo durante el descanso espera a que termine
+  s.turnSeconds[0] = 60;
+  r.run(ZONE_REST_MS / 2, &s);
+  check("máximo", !r.ctrl.zone(0).on, "la zona regó durante el descanso");
+  r.run(ZONE_REST_MS / 2 + 5 * SNAPSHOT_MS, &s);
+  s.turnSeconds[0] = 60;
+  r.run(5 * SNAPSHOT_MS, &s);
+  check("máximo", r.ctrl.zone(0).on && r.ctrl.zone(0).cause == CAUSE_TURN, "la zona no volvió tras el descanso");
+  r.run(70 * SNAPSHOT_MS, &s);
+  check("máximo", !r.ctrl.zone(0).on && r.ctrl.maxRunCutoffs == 1, "el turno de 60 s no terminó");
+  report("máximo", r);
+}
+
+static void stale(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_MANUAL);
+  s.manualOn = true;
+  r.run(5 * SNAPSHOT_MS, &s);
+  check("sin lecturas", r.relays == 3, "la orden manual no encendió las zonas");
+
+  // La última instantánea llegó un segundo antes
+  r.run(ACTUATION_STALE_MS - SNAPSHOT_MS, NULL);
+  check("sin lecturas", r.relays == 3, "se apagó antes de ACTUATION_STALE_MS");
+  r.run(2 * TICK_MS, NULL);
+  check("sin lecturas", r.relays == 0 && r.ctrl.staleCutoffs == 2, "no se apagó sin lecturas");
+
+  r.run(SNAPSHOT_MS, &s);
+  check("sin lecturas", r.relays == 3, "no se recuperó al volver las lecturas");
+  report("sin lecturas", r);
+}
+
+static void invalid(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_AUTO);
+
+  // Arranque: el ADC todavía no entrega datos
+  s.soil[0] = s.soil[1] = READING_INVALID;
+  s.light = READING_INVALID;
+  r.run(10 * SNAPSHOT_MS, &s);
+  check("sin datos", r.relays == 0 && r.ctrl.zone(0).starts == 0, "se regó sin lecturas de suelo");
+
+  // Las dos zonas secas riegan; se pierde la sonda 1
+  s.soil[0] = s.soil[1] = 20;
+  s.light = 10;
+  r.run(5 * SNAPSHOT_MS, &s);
+  check("sin datos", r.relays == 3, "no se encendieron las zonas secas");
+  s.soil[0] = READING_INVALID;
+  r.run(2 * SNAPSHOT_MS, &s);
+  check("sin datos", r.relays == 2 && r.ctrl.zone(0).cause == CAUSE_STALE, "la zona sin sonda siguió regando");
+
+  // Sin luz no se decide ninguna zona
+  s.light = READING_INVALID;
+  r.run(2 * SNAPSHOT_MS, &s);
+  check("sin datos", r.relays == 0, "se regó sin lectura de luz");
+
+  // El temporizador no lee los sensores
+  s.mode = ACTUATION_TIMER;
+  s.turnSeconds[0] = s.turnSeconds[1] = 60;
+  r.run(5 * SNAPSHOT_MS, &s);
+  check("sin datos", r.relays == 3, "el turno no empezó sin lecturas");
+  report("sin datos", r);
+}
+
+static void tankInvalid(void)
+{
+  // En cada modo, con las zonas encendidas, el tanque se queda sin lectura
+  const ActuationMode modes[] = {ACTUATION_AUTO, ACTUATION_TIMER, ACTUATION_MANUAL};
+  for (ActuationMode mode : modes)
+  {
+    Run r;
+    ActuationSnapshot s = base(mode);
+    s.soil[0] = s.soil[1] = 20;
+    s.manualOn = true;
+    s.turnSeconds[0] = s.turnSeconds[1] = 600;
+    r.run(5 * SNAPSHOT_MS, &s);
+    check("sin tanque", r.relays == 3, "no se encendieron las zonas");
+    s.waterPercent = READING_INVALID;
+    r.run(2 * SNAPSHOT_MS, &s);
+    check("sin tanque", r.relays == 0 && r.ctrl.zone(0).cause == CAUSE_STALE, "se regó sin lectura del tanque");
+    s.waterPercent = 80;
+    r.run(2 * SNAPSHOT_MS, &s);
+    check("sin tanque", r.relays == 3, "no se recuperó al volver la lectura del tanque");
+  }
+
+  // Tanque bajo, casi listo para soltar; el sensor se calla y la espera empieza de nuevo
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_MANUAL);
+  s.manualOn = true;
+  s.waterPercent = 10;
+  r.run(5 * SNAPSHOT_MS, &s);
+  s.waterPercent = 30;
+  r.run(TANK_RELEASE_HOLD_MS - 5 * SNAPSHOT_MS, &s);
+  s.waterPercent = READING_INVALID;
+  r.run(3 * SNAPSHOT_MS, &s);
+  s.waterPercent = 30;
+  r.run(TANK_RELEASE_HOLD_MS - 5 * SNAPSHOT_MS, &s);
+  check("sin tanque", r.relays == 0 && r.ctrl.isTankLow(), "el interbloqueo se soltó contando el tiempo sin lectura");
+  r.run(10 * SNAPSHOT_MS, &s);
+  check("sin tanque", r.relays == 3 && r.ctrl.interlockTrips == 1, "el interbloqueo no se soltó al volver la lectura");
+  report("sin tanque", r);
+}
+
+static void manual(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_MANUAL);
+  s.manualOn = true;
+  s.waterPercent = 10;
+  r.run(10 * SNAPSHOT_MS, &s);
+  check("manual", r.relays == 0 && r.ctrl.zone(0).cause == CAUSE_NONE, "la orden manual ignoró el tanque bajo");
+
+  s.waterPercent = 80;
+  r.run(TANK_RELEASE_HOLD_MS + 2 * SNAPSHOT_MS, &s);
+  check("manual", r.relays == 3, "la orden manual no encendió al llenarse el tanque");
+  s.manualOn = false;
+  r.run(SNAPSHOT_MS, &s);
+  check("manual", r.relays == 0, "la orden manual no apagó");
+  report("manual", r);
+}
+
+static void defaults(void)
+{
+  Run r;
+  ActuationSnapshot s = base(ACTUATION_AUTO);
+  s.soilThreshold = DEFAULT_IRRIGATION_CONFIG.setSoilMoistureThreshold;
+  s.lightThreshold = DEFAULT_IRRIGATION_CONFIG.setLightThreshold;
+  s.soil[0] = 30;
+  s.soil[1] = 45;
+  s.light = 20;
+
+  // Regar sube el suelo 1 % por segundo hasta saturarlo; sin riego se seca 1 % por minuto
+  uint32_t onSeconds[SCHEDULE_ZONES] = {0, 0};
+  uint8_t peak[SCHEDULE_ZONES] = {0, 0};
+  const uint32_t seconds = 4 * 3600;
+  for (uint32_t t = 0; t < seconds; t++)
+  {
+    r.run(SNAPSHOT_MS, &s);
+    for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+    {
+      if (r.ctrl.zone(z).on)
+      {
+        if (s.soil[z] < 100)
+          s.soil[z]++;
+        onSeconds[z]++;
+      }
+      else if (t % 60 == 0)
+        s.soil[z]--;
+      if (s.soil[z] > peak[z])
+        peak[z] = s.soil[z];
+    }
+  }
+  printf("omisión      umbral %d %%: riego %u s / %u s, suelo máximo %u %% / %u %%\n", s.soilThreshold, onSeconds[0],
+         onSeconds[1], peak[0], peak[1]);
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    check("omisión", r.ctrl.zone(z).starts > 1, "la zona no volvió a regar al secarse");
+    check("omisión", peak[z] <= s.soilThreshold + ZONE_HYSTERESIS + 1, "la zona regó de más");
+    check("omisión", onSeconds[z] < seconds / 10, "la zona nunca se apagó");
+  }
+  report("omisión", r);
+}
+
+int main(void)
+{
+  hysteresis();
+  tank();
+  maxRun();
+  stale();
+  invalid();
+  tankInvalid();
+  manual();
+  defaults();
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
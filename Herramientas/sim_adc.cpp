@@ -0,0 +1,122 @@
+/*
+  Prueba de escritorio del filtrado y la calibración de AnalogFilter.h con
+  señales sintéticas.
+
+  Simula una sonda de humedad de suelo que se seca lentamente y cruza una
+  vez el umbral de riego. A la lectura se le suma ruido gaussiano y picos
+  ocasionales como los del ADC del ESP32. Compara la lectura anterior (un
+  solo analogRead con map(..., 790, 390, 0, 100)) contra los bloques
+  sobremuestreados + AnalogChannel + CalibrationTable: error RMS contra el
+  valor real y cuántas veces cambia la decisión "suelo seco" (lo ideal es 1).
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_adc sim_adc.cpp
+  Uso:
+    ./sim_adc [ruido en cuentas] [umbral %]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include "AnalogFilter.h"
+
+#define SIM_SECONDS 3600
+#define SERVICE_PERIOD_MS 20    // ADC_SERVICE_PERIOD de IrrigationControl.h
+#define READ_PERIOD_MS 1000     // SOIL_READ_PERIOD
+#define FRAME_CONVERSIONS 256   // ADC_FRAME_CONVERSIONS de AnalogSampler.h
+#define SPIKE_PROBABILITY 0.002 // Conversiones con pico
+#define SPIKE_COUNTS 600
+
+static std::mt19937 rng(1);
+
+static uint16_t clampRaw(double raw)
+{
+  if (raw < 0)
+    return 0;
+  if (raw > 4095)
+    return 4095;
+  return (uint16_t)lround(raw);
+}
+
+// Una conversión con ruido y, a veces, un pico
+static uint16_t convert(double trueRaw, double noise)
+{
+  std::normal_distribution<double> gauss(0, noise);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  double raw = trueRaw + gauss(rng);
+  if (uniform(rng) < SPIKE_PROBABILITY)
+    raw += uniform(rng) < 0.5 ? -SPIKE_COUNTS : SPIKE_COUNTS;
+  return clampRaw(raw);
+}
+
+static double legacyMap(uint16_t raw)
+{
+  // map() de Arduino con enteros
+  return (long)(raw - 790) * (100 - 0) / (390 - 790) + 0;
+}
+
+struct Result
+{
+  double sumSquares = 0;
+  uint32_t reads = 0;
+  uint32_t flips = 0;
+  bool dry = false;
+  bool started = false;
+
+  void add(double measured, double truth, double threshold)
+  {
+    double err = measured - truth;
+    sumSquares += err * err;
+    reads++;
+    bool nowDry = measured < threshold;
+    if (started && nowDry != dry)
+      flips++;
+    dry = nowDry;
+    started = true;
+  }
+
+  double rms(void) { return reads > 0 ? sqrt(sumSquares / reads) : 0; }
+};
+
+int main(int argc, char **argv)
+{
+  double noise = argc > 1 ? atof(argv[1]) : 40;
+  double threshold = argc > 2 ? atof(argv[2]) : 40;
+
+  CalibrationTable table = {2, {{390, 100.0f}, {790, 0.0f}}};
+  AnalogChannel channel;
+  Result legacy, filtered;
+
+  // La humedad baja de 60 % a 20 % en una hora
+  for (uint32_t ms = 0; ms < SIM_SECONDS * 1000; ms += SERVICE_PERIOD_MS)
+  {
+    double truth = 60.0 - 40.0 * ms / (SIM_SECONDS * 1000.0);
+    double trueRaw = 790 - truth * (790 - 390) / 100.0;
+
+    // Bloque del DMA: promedio de las conversiones del bloque
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < FRAME_CONVERSIONS; i++)
+      sum += convert(trueRaw, noise);
+    channel.addBlock((uint16_t)((sum + FRAME_CONVERSIONS / 2) / FRAME_CONVERSIONS));
+
+    if (ms % READ_PERIOD_MS == 0)
+    {
+      legacy.add(legacyMap(convert(trueRaw, noise)), truth, threshold);
+      filtered.add(table.apply(channel.raw()), truth, threshold);
+    }
+  }
+
+  printf("Ruido %.0f cuentas, umbral %.0f %%, %u lecturas\n", noise, threshold, (unsigned)legacy.reads);
+  printf("  analogRead + map:       error RMS %6.2f %%, cambios de decisión %u\n", legacy.rms(), (unsigned)legacy.flips);
+  printf("  sobremuestreo + filtro: error RMS %6.2f %%, cambios de decisión %u\n", filtered.rms(), (unsigned)filtered.flips);
+
+  // Tabla de varios tramos: los extremos saturan y los puntos interiores se respetan
+  CalibrationTable curve = {4, {{400, 100.0f}, {550, 60.0f}, {700, 20.0f}, {800, 0.0f}}};
+  bool ok = curve.isValid() && curve.apply(300) == 100.0f && curve.apply(900) == 0.0f &&
+            fabsf(curve.apply(550) - 60.0f) < 0.01f && fabsf(curve.apply(625) - 40.0f) < 0.01f;
+  CalibrationTable unsorted = {3, {{500, 0.0f}, {400, 50.0f}, {600, 100.0f}}};
+  ok = ok && !unsorted.isValid();
+  printf("Tabla por tramos: %s\n", ok ? "correcta" : "ERROR");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+/*
+  Prueba de escritorio de los botones (SiRIM/ButtonDebouncer.h).
+
+  Arma trazas de flancos sintéticas como las que vería la interrupción de
+  cada pin y las pasa por el antirrebote igual que ButtonTask: cada flanco
+  llama a edge() y despierta la revisión, y sin flancos se revisa cuando
+  vence la espera que devolvió la anterior.
+    - limpio      un toque sin rebote sale como PRESS a los BUTTON_DEBOUNCE_MS
+    - rebote      ráfagas de 1 a 15 flancos de 0.1 a 5 ms al presionar y al
+                  soltar: un PRESS por toque
+    - ruido       pulsos de 1 a 15 ms más cortos que el antirrebote: ningún
+                  gesto, todos cuentan como ruido
+    - largo       PRESS y un solo LONG; el toque siguiente no es DOUBLE
+    - doble       dos toques seguidos: PRESS y DOUBLE; el tercero vuelve a ser PRESS
+    - lento       dos toques a más de BUTTON_DOUBLE_MS: dos PRESS
+    - dos pines   un botón sostenido no detiene ni cambia los gestos del otro
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_botones sim_botones.cpp
+  Uso:
+    ./sim_botones [semilla]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "ButtonDebouncer.h"
+
+#define BUTTONS 2
+#define TRIALS 200
+#define NEVER 0xFFFFFFFFUL
+
+static int failures = 0;
+static std::mt19937 rng;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+struct Edge
+{
+  uint32_t ms;
+  uint8_t button;
+  bool pressed;
+};
+
+struct Emitted
+{
+  ButtonEvent event;
+  uint32_t atMs;
+};
+
+class Trace
+{
+public:
+  std::vector<Edge> edges;
+
+  // Cambio de nivel con `bounces` idas y vueltas antes de quedar en `pressed`;
+  // devuelve el último flanco
+  uint32_t transition(uint8_t button, uint32_t atMs, bool pressed, uint8_t bounces)
+  {
+    std::uniform_real_distribution<float> gap(0.1f, 5.0f);
+    float t = (float)atMs;
+    bool level = pressed;
+    for (uint8_t i = 0; i < 2 * bounces + 1; i++)
+    {
+      edges.push_back({(uint32_t)t, button, level});
+      level = !level;
+      t += gap(rng);
+    }
+    return edges.back().ms;
+  }
+
+  // Toque completo; devuelve cuándo quedó suelto
+  uint32_t tap(uint8_t button, uint32_t atMs, uint32_t holdMs, bool bouncy)
+  {
+    std::uniform_int_distribution<int> count(0, 7);
+    transition(button, atMs, true, bouncy ? count(rng) : 0);
+    return transition(button, atMs + holdMs, false, bouncy ? count(rng) : 0);
+  }
+
+  // Pulso de ruido: baja y sube antes del antirrebote
+  void glitch(uint8_t button, uint32_t atMs, uint32_t widthMs)
+  {
+    edges.push_back({atMs, button, true});
+    edges.push_back({atMs + widthMs, button, false});
+  }
+};
+
+struct Run
+{
+  std::vector<Emitted> events;
+  uint32_t glitches[BUTTONS];
+  uint32_t polls;
+};
+
+// Como ButtonTask con ButtonInput::service(): una espera para todos los botones
+static Run replay(Trace &trace)
+{
+  std::stable_sort(trace.edges.begin(), trace.edges.end(),
+                   [](const Edge &a, const Edge &b) { return a.ms < b.ms; });
+  ButtonDebouncer debouncers[BUTTONS];
+  bool levels[BUTTONS] = {false, false};
+  for (uint8_t b = 0; b < BUTTONS; b++)
+    debouncers[b].begin(false);
+
+  Run run;
+  run.polls = 0;
+  uint32_t deadline = NEVER;
+  size_t next = 0;
+  while (next < trace.edges.size() || deadline != NEVER)
+  {
+    uint32_t now;
+    if (next < trace.edges.size() && trace.edges[next].ms <= deadline)
+    {
+      // Interrupciones del mismo milisegundo antes de que la tarea corra
+      now = trace.edges[next].ms;
+      while (next < trace.edges.size() && trace.edges[next].ms == now)
+      {
+        const Edge &e = trace.edges[next++];
+        levels[e.button] = e.pressed;
+        debouncers[e.button].edge(now);
+      }
+    }
+    else
+      now = deadline;
+
+    uint32_t waitMs = 0;
+    for (uint8_t b = 0; b < BUTTONS; b++)
+    {
+      ButtonEvent event;
+      uint32_t wait;
+      if (debouncers[b].poll(levels[b], now, event, wait))
+      {
+        event.button = b;
+        run.events.push_back({event, now});
+      }
+      if (wait != 0 && (waitMs == 0 || wait < waitMs))
+        waitMs = wait;
+    }
+    run.polls++;
+    deadline = waitMs > 0 ? now + waitMs : NEVER;
+  }
+  for (uint8_t b = 0; b < BUTTONS; b++)
+    run.glitches[b] = debouncers[b].glitches;
+  return run;
+}
+
+static const char *gestureName(ButtonGesture g)
+{
+  return g == BUTTON_PRESS ? "P" : g == BUTTON_LONG ? "L" : "D";
+}
+
+// Gestos de un botón como "PDP"
+static std::string gestures(const Run &run, uint8_t button)
+{
+  std::string text;
+  for (const Emitted &e : run.events)
+    if (e.event.button == button)
+      text += gestureName(e.event.gesture);
+  return text;
+}
+
+static uint32_t worstLatency(const Run &run)
+{
+  uint32_t worst = 0;
+  for (const Emitted &e : run.events)
+    if (e.event.gesture != BUTTON_LONG)
+      worst = std::max(worst, e.atMs - e.event.edgeMs);
+  return worst;
+}
+
+static void report(const char *name, const Run &run, const std::string &expected, uint8_t button = 0)
+{
+  std::string got = gestures(run, button);
+  printf("%-12s %5zu gestos  %6u revisiones  ruido %4u  latencia máx %3u ms\n", name, got.size(), run.polls,
+         run.glitches[button], worstLatency(run));
+  if (got != expected)
+  {
+    printf("  FALLA %s: gestos \"%.40s\", se esperaba \"%.40s\"\n", name, got.c_str(), expected.c_str());
+    failures++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  rng.seed(argc > 1 ? (uint32_t)atoi(argv[1]) : 23);
+  std::uniform_int_distribution<uint32_t> hold(80, 400);
+
+  {
+    Trace trace;
+    trace.tap(0, 1000, 200, false);
+    Run run = replay(trace);
+    report("limpio", run, "P");
+    check("limpio", worstLatency(run) == BUTTON_DEBOUNCE_MS, "el PRESS no sale al vencer el antirrebote");
+  }
+
+  {
+    // Separados más que la ventana del doble toque
+    Trace trace;
+    uint32_t t = 1000;
+    for (int i = 0; i < TRIALS; i++)
+      t = trace.tap(0, t, hold(rng), true) + BUTTON_DOUBLE_MS + 200;
+    Run run = replay(trace);
+    report("rebote", run, std::string(TRIALS, 'P'));
+    // El peor rebote dura 15 flancos de 5 ms
+    check("rebote", worstLatency(run) <= 15 * 5 + BUTTON_DEBOUNCE_MS, "latencia mayor a la ráfaga más el antirrebote");
+    check("rebote", run.glitches[0] == 0, "un toque contó como ruido");
+  }
+
+  {
+    Trace trace;
+    std::uniform_int_distribution<uint32_t> width(1, BUTTON_DEBOUNCE_MS * 3 / 4);
+    uint32_t t = 1000;
+    for (int i = 0; i < TRIALS; i++, t += 100)
+      trace.glitch(0, t, width(rng));
+    Run run = replay(trace);
+    report("ruido", run, "");
+    check("ruido", run.glitches[0] == TRIALS, "no todos los pulsos contaron como ruido");
+  }
+
+  {
+    Trace trace;
+    uint32_t released = trace.tap(0, 1000, 1500, true);
+    trace.tap(0, released + 100, 150, true);
+    Run run = replay(trace);
+    report("largo", run, "PLP");
+    for (const Emitted &e : run.events)
+      if (e.event.gesture == BUTTON_LONG)
+        check("largo", e.atMs >= 1000 + BUTTON_LONG_MS && e.atMs <= 1000 + BUTTON_LONG_MS + 15 * 5 + BUTTON_DEBOUNCE_MS,
+              "el LONG no sale al cumplir BUTTON_LONG_MS");
+  }
+
+  {
+    Trace trace;
+    uint32_t t = trace.tap(0, 1000, 120, true);
+    t = trace.tap(0, t + 150, 120, true);
+    trace.tap(0, t + 150, 120, true);
+    Run run = replay(trace);
+    report("doble", run, "PDP");
+  }
+
+  {
+    Trace trace;
+    uint32_t t = trace.tap(0, 1000, 120, true);
+    trace.tap(0, t + BUTTON_DOUBLE_MS + 200, 120, true);
+    Run run = replay(trace);
+    report("lento", run, "PP");
+  }
+
+  {
+    // Uno sostenido 3 s mientras el otro da toques sueltos y un doble
+    Trace trace;
+    trace.tap(0, 1000, 3000, true);
+    uint32_t t = 1100;
+    for (int i = 0; i < 3; i++)
+      t = trace.tap(1, t, hold(rng), true) + BUTTON_DOUBLE_MS + 200;
+    t = trace.tap(1, t, 100, true);
+    trace.tap(1, t + 100, 100, true);
+    Run run = replay(trace);
+    report("dos pines 0", run, "PL", 0);
+    report("dos pines 1", run, "PPPPD", 1);
+  }
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+/*
+  Prueba de escritorio del administrador de conectividad (SiRIM/Connectivity.h).
+
+  El enlace es un LinkLayer con guion: cada escenario fija cuándo asocia el
+  AP (con y sin caché), cuándo se cae y qué responde el broker, y avanza el
+  reloj de milisegundo en milisegundo como la tarea de red:
+    - asociacion  el AP nunca responde: el intento vence a los
+                  CONN_WIFI_TIMEOUT, se suelta el WiFi y se espera el retroceso
+    - retroceso   fallas seguidas: cada espera cae entre la mitad y el total
+                  de base * 2^(fallas-1) con tope en CONN_BACKOFF_MAX, crece
+                  con cada falla y la variación sí reparte a los nodos
+    - cache       el AP guardado no responde: sin esperar se hace un escaneo
+                  completo, el AP nuevo se entrega una sola vez para
+                  guardarlo; con el AP correcto se conecta sin escanear
+    - perdida     en línea se cae el WiFi: si vuelve dentro del tiempo límite
+                  se reconecta al broker sin reiniciar el WiFi; si no, se
+                  suelta y tras el retroceso se usa el AP guardado. Si sólo
+                  se cae el broker se espera un retroceso corto
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_conectividad sim_conectividad.cpp
+  Uso:
+    ./sim_conectividad
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "Connectivity.h"
+
+#define NEVER 0xFFFFFFFFUL
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static const uint8_t OLD_BSSID[6] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01};
+static const uint8_t NEW_BSSID[6] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x02};
+
+struct WifiBegin
+{
+  uint32_t at;
+  int32_t channel;
+  bool cached;
+};
+
+class ScriptedLink : public LinkLayer
+{
+private:
+  bool begun = false;
+  bool beganCached = false;
+  uint32_t begunAt = 0;
+
+public:
+  uint32_t now = 0;
+  // Guion: ms desde wifiBegin hasta asociar, con el AP guardado o escaneando
+  uint32_t cachedDelay = NEVER;
+  uint32_t scanDelay = NEVER;
+  bool radioUp = true;  // false: el AP desaparece aunque se haya asociado
+  bool brokerUp = true; // Respuesta de mqttConnect()
+  bool session = false; // Conexión abierta con el broker
+  ApCache ap;           // Lo que reporta el AP al asociarse
+  std::mt19937 rng;
+
+  // Registro
+  std::vector<WifiBegin> begins;
+  uint32_t disconnects = 0;
+  uint32_t mqttAttempts = 0;
+
+  ScriptedLink(uint32_t seed) : rng(seed)
+  {
+    memset(&ap, 0, sizeof(ap));
+    ap.channel = 11;
+    memcpy(ap.bssid, NEW_BSSID, 6);
+    ap.valid = true;
+  }
+
+  void wifiBegin(int32_t channel, const uint8_t *bssid) override
+  {
+    begun = true;
+    beganCached = bssid != NULL;
+    begunAt = now;
+    begins.push_back({now, channel, beganCached});
+  }
+
+  bool wifiConnected(void) override
+  {
+    if (!begun || !radioUp)
+      return false;
+    uint32_t delay = beganCached ? cachedDelay : scanDelay;
+    // Con el AP guardado sólo asocia si el canal sigue siendo el mismo
+    if (beganCached && begins.back().channel != ap.channel)
+      return false;
+    return delay != NEVER && now - begunAt >= delay;
+  }
+
+  void wifiDisconnect(void) override
+  {
+    begun = false;
+    session = false;
+    disconnects++;
+  }
+
+  bool wifiApInfo(ApCache &info) override
+  {
+    info = ap;
+    return true;
+  }
+
+  bool mqttConnect(void) override
+  {
+    mqttAttempts++;
+    session = brokerUp;
+    return session;
+  }
+
+  bool mqttConnected(void) override { return session && brokerUp && wifiConnected(); }
+  uint32_t random32(void) override { return rng(); }
+};
+
+// El broker se intenta en la vuelta siguiente a la asociación
+#define BROKER_TURN_MS 1
+
+// Avanza hasta que el estado cambie a target o se acabe el plazo; devuelve la hora
+static uint32_t runUntil(ConnectivityManager &manager, ScriptedLink &link, ConnState target, uint32_t limitMs)
+{
+  uint32_t end = link.now + limitMs;
+  while (link.now < end)
+  {
+    if (manager.update(link.now) == target)
+      return link.now;
+    link.now++;
+  }
+  return NEVER;
+}
+
+// Espera esperada para la n-ésima falla antes de la variación
+static uint32_t backoffCeiling(uint32_t failure)
+{
+  uint32_t delay = CONN_BACKOFF_BASE;
+  for (uint32_t i = 1; i < failure && delay < CONN_BACKOFF_MAX; i++)
+    delay *= 2;
+  return delay > CONN_BACKOFF_MAX ? CONN_BACKOFF_MAX : delay;
+}
+
+static void association(void)
+{
+  ScriptedLink link(1);
+  ConnectivityManager manager(link);
+  manager.begin(NULL);
+
+  check("asociacion", manager.update(0) == CONN_WIFI_CONNECTING, "no inició el WiFi");
+  check("asociacion", link.begins.size() == 1 && link.begins[0].channel == 0 && !link.begins[0].cached,
+        "sin AP guardado no escaneó");
+  uint32_t timeout = runUntil(manager, link, CONN_WIFI_BACKOFF, CONN_WIFI_TIMEOUT * 2);
+  uint32_t retry = runUntil(manager, link, CONN_WIFI_CONNECTING, CONN_BACKOFF_MAX);
+  printf("asociacion   vence a los %u ms, %u desconexión, siguiente intento a los %u ms\n", timeout, link.disconnects,
+         retry);
+  check("asociacion", timeout == CONN_WIFI_TIMEOUT, "el intento no venció a tiempo");
+  check("asociacion", link.disconnects == 1, "no soltó el WiFi al vencer");
+  check("asociacion", link.begins.size() == 2 && link.begins[1].at - timeout >= CONN_BACKOFF_BASE / 2 &&
+                          link.begins[1].at - timeout <= CONN_BACKOFF_BASE,
+        "el primer retroceso no está entre base/2 y base");
+  check("asociacion", manager.wifiConnects == 0 && manager.mqttConnects == 0, "contó una conexión que no hubo");
+}
+
+static void backoff(void)
+{
+  const uint32_t runs = 64, attempts = 12;
+  std::vector<uint32_t> shortest(attempts, NEVER), longest(attempts, 0);
+  bool bounded = true, growing = true;
+
+  for (uint32_t run = 0; run < runs; run++)
+  {
+    ScriptedLink link(run + 1);
+    ConnectivityManager manager(link);
+    manager.begin(NULL);
+    manager.update(0);
+    for (uint32_t failure = 1; failure < attempts; failure++)
+    {
+      uint32_t expired = runUntil(manager, link, CONN_WIFI_BACKOFF, CONN_WIFI_TIMEOUT + 1);
+      runUntil(manager, link, CONN_WIFI_CONNECTING, CONN_BACKOFF_MAX + 1);
+      uint32_t wait = link.begins.back().at - expired;
+      uint32_t ceiling = backoffCeiling(failure);
+      if (wait < ceiling / 2 || wait > ceiling)
+        bounded = false;
+      if (wait < shortest[failure])
+        shortest[failure] = wait;
+      if (wait > longest[failure])
+        longest[failure] = wait;
+    }
+  }
+
+  for (uint32_t failure = 1; failure < attempts; failure++)
+  {
+    uint32_t ceiling = backoffCeiling(failure);
+    printf("retroceso    falla %2u: espera %5u..%5u ms (tope %5u)\n", failure, shortest[failure], longest[failure],
+           ceiling);
+    // Con 64 nodos la variación cubre buena parte del intervalo [tope/2, tope]
+    if (longest[failure] - shortest[failure] < ceiling / 4)
+      check("retroceso", false, "la variación no reparte los reintentos");
+    if (failure > 1 && ceiling < CONN_BACKOFF_MAX && shortest[failure] <= shortest[failure - 1])
+      growing = false;
+  }
+  check("retroceso", bounded, "una espera quedó fuera de [tope/2, tope]");
+  check("retroceso", growing, "la espera no crece con las fallas");
+  check("retroceso", backoffCeiling(attempts - 1) == CONN_BACKOFF_MAX, "la prueba no llegó al tope");
+}
+
+static void cachedAp(void)
+{
+  // El AP cambió de canal desde que se guardó
+  ApCache saved;
+  memcpy(saved.bssid, OLD_BSSID, 6);
+  saved.channel = 6;
+  saved.valid = true;
+
+  ScriptedLink link(2);
+  link.cachedDelay = 300;
+  link.scanDelay = 2500;
+  ConnectivityManager manager(link);
+  manager.begin(&saved);
+
+  manager.update(0);
+  check("cache", link.begins.size() == 1 && link.begins[0].cached && link.begins[0].channel == 6,
+        "no intentó primero con el AP guardado");
+  uint32_t online = runUntil(manager, link, CONN_ONLINE, 3 * CONN_WIFI_TIMEOUT);
+  bool rescanned = link.begins.size() == 2 && !link.begins[1].cached && link.begins[1].channel == 0;
+  printf("cache        AP guardado vence a los %u ms, escaneo completo, en línea a los %u ms\n",
+         rescanned ? link.begins[1].at : (uint32_t)NEVER, online);
+  check("cache", rescanned && link.begins[1].at == CONN_WIFI_TIMEOUT,
+        "el AP guardado falló y no se escaneó de inmediato");
+  check("cache", online == CONN_WIFI_TIMEOUT + link.scanDelay + BROKER_TURN_MS, "el escaneo no terminó en línea");
+
+  ApCache update;
+  check("cache", manager.takeCacheUpdate(update) && update.channel == 11 && memcmp(update.bssid, NEW_BSSID, 6) == 0,
+        "no entregó el AP nuevo para guardarlo");
+  check("cache", !manager.takeCacheUpdate(update), "entregó el AP nuevo dos veces");
+
+  // Con el AP correcto el siguiente arranque se salta el escaneo
+  ScriptedLink fast(3);
+  fast.cachedDelay = 300;
+  ConnectivityManager next(fast);
+  next.begin(&update);
+  uint32_t fastOnline = runUntil(next, fast, CONN_ONLINE, CONN_WIFI_TIMEOUT);
+  printf("cache        con el AP nuevo: en línea a los %u ms, asociación %u ms\n", fastOnline,
+         next.lastWiFiConnectMs);
+  check("cache", fastOnline == fast.cachedDelay + BROKER_TURN_MS && fast.begins.size() == 1 && fast.begins[0].cached,
+        "la conexión rápida no usó el AP guardado");
+  check("cache", !next.takeCacheUpdate(update), "pidió guardar el mismo AP");
+}
+
+static void linkLoss(void)
+{
+  ScriptedLink link(4);
+  link.cachedDelay = 300;
+  link.scanDelay = 1500;
+  ConnectivityManager manager(link);
+  manager.begin(NULL);
+  uint32_t online = runUntil(manager, link, CONN_ONLINE, CONN_WIFI_TIMEOUT);
+  check("perdida", online == link.scanDelay + BROKER_TURN_MS, "no llegó a estar en línea");
+
+  // El AP desaparece 3 s y regresa: no se reinicia el WiFi
+  link.now = 60000;
+  link.radioUp = false;
+  check("perdida", manager.update(link.now) == CONN_WIFI_CONNECTING, "no detectó la caída del WiFi");
+  runUntil(manager, link, CONN_ONLINE, 3000);
+  link.radioUp = true;
+  uint32_t back = runUntil(manager, link, CONN_ONLINE, CONN_WIFI_TIMEOUT);
+  printf("perdida      caída breve: en línea otra vez a los %u ms, %u inicios de WiFi, %u desconexiones\n", back,
+         (uint32_t)link.begins.size(), link.disconnects);
+  check("perdida", back == 63000 + BROKER_TURN_MS && link.begins.size() == 1 && link.disconnects == 0,
+        "una caída breve reinició el WiFi");
+  check("perdida", manager.mqttConnects == 2 && manager.onlineSince == back, "no volvió a conectar con el broker");
+
+  // El AP no vuelve: al vencer se suelta y, tras el retroceso, se intenta con
+  // el AP que se guardó al conectarse
+  link.now = 120000;
+  link.radioUp = false;
+  manager.update(link.now);
+  uint32_t expired = runUntil(manager, link, CONN_WIFI_BACKOFF, 2 * CONN_WIFI_TIMEOUT);
+  link.radioUp = true;
+  uint32_t rescan = runUntil(manager, link, CONN_WIFI_CONNECTING, CONN_BACKOFF_MAX);
+  uint32_t recovered = runUntil(manager, link, CONN_ONLINE, CONN_WIFI_TIMEOUT);
+  printf("perdida      caída larga: vence a los %u ms, AP guardado a los %u ms, en línea a los %u ms\n", expired,
+         rescan, recovered);
+  check("perdida", expired == 120000 + CONN_WIFI_TIMEOUT && link.disconnects == 1, "no soltó el WiFi al vencer");
+  check("perdida", link.begins.size() == 2 && link.begins[1].cached && rescan - expired >= CONN_BACKOFF_BASE / 2 &&
+                       rescan - expired <= CONN_BACKOFF_BASE,
+        "no reintentó con el AP guardado después del primer retroceso");
+  check("perdida", recovered == rescan + link.cachedDelay + BROKER_TURN_MS, "el reintento no terminó en línea");
+
+  // Sólo se cae el broker: retroceso corto sin tocar el WiFi
+  link.now = 200000;
+  link.brokerUp = false;
+  check("perdida", manager.update(link.now) == CONN_MQTT_BACKOFF, "no detectó la caída del broker");
+  uint32_t attempts = link.mqttAttempts;
+  uint32_t retry = runUntil(manager, link, CONN_MQTT_CONNECTING, CONN_BACKOFF_MAX);
+  check("perdida", retry - 200000 >= CONN_BACKOFF_BASE / 2 && retry - 200000 <= CONN_BACKOFF_BASE,
+        "el retroceso del broker no es el primero");
+  link.brokerUp = true;
+  uint32_t reconnected = runUntil(manager, link, CONN_ONLINE, CONN_BACKOFF_MAX);
+  printf("perdida      broker caído: reintento a los %u ms, en línea a los %u ms\n", retry, reconnected);
+  check("perdida", reconnected != NEVER && link.mqttAttempts > attempts && link.begins.size() == 2,
+        "la caída del broker reinició el WiFi o no reconectó");
+}
+
+int main(void)
+{
+  association();
+  backoff();
+  cachedAp();
+  linkLoss();
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,345 @@
+/*
+  Prueba de escritorio del horario de riego (SiRIM/IrrigationSchedule.h) con
+  reloj acelerado.
+
+  Consulta el motor cada 5 s (SENSOR_READ_INTERVAL) como ReadSensorsTask y
+  mueve el reloj del RTC como lo haría el nodo real:
+    - año      un año completo, con turnos en el cambio de día y de semana;
+               se compara contra la lista de turnos calculada minuto a minuto
+    - verano   a las 2:00 el reloj salta a las 3:00
+    - invierno a las 2:00 el reloj regresa a la 1:00 (sin regar dos veces)
+    - corte    el nodo se apaga de 0:00 a 8:00
+    - ajuste   el RTC se atrasa un día entero (el día se repite)
+    - arranque el nodo enciende 10 minutos después de un turno
+    - siesta   bajo consumo con una muestra cada 5 minutos: el light sleep
+               (powerSleepMs de PowerManager.h) se corta en el siguiente
+               turno y cada turno sale a tiempo; sin el tope se atrasan
+  y mide el tiempo de armar las alarmas con las tablas llenas.
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_horario sim_horario.cpp
+  Uso:
+    ./sim_horario
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "IrrigationSchedule.h"
+#include "PowerManager.h"
+
+#define POLL_PERIOD_S 5
+#define LOW_POWER_SAMPLE_MS 300000UL // "muestraSeg": 300
+#define AWAKE_STEP_MS 100            // Despierta, la tarea vuelve con cada lectura
+#define DAY_S 86400UL
+
+struct Fire
+{
+  uint8_t zone;
+  uint32_t dueAt;
+  uint32_t at;
+};
+
+class ClockRun
+{
+public:
+  ScheduleEngine engine;
+  std::vector<Fire> fires;
+  uint32_t now;
+
+  ClockRun(const ScheduleTable &table, uint32_t start) : now(start) { engine.load(table); }
+
+  void run(uint32_t seconds)
+  {
+    ScheduleEvent events[SCHEDULE_ZONES];
+    for (uint32_t end = now + seconds; now < end; now += POLL_PERIOD_S)
+    {
+      uint8_t count = engine.poll(now, events);
+      for (uint8_t i = 0; i < count; i++)
+        fires.push_back(Fire{events[i].zone, events[i].dueAt, now});
+    }
+  }
+  void jump(int32_t seconds) { now += seconds; }
+  size_t count(uint8_t zone, uint32_t dueAt)
+  {
+    size_t n = 0;
+    for (const Fire &f : fires)
+      n += f.zone == zone && f.dueAt == dueAt;
+    return n;
+  }
+};
+
+// Hora local (segundos desde 1970) de una fecha civil
+static uint32_t localTime(int year, int month, int day, int hour, int minute)
+{
+  // Días desde 1970-01-01 (algoritmo de Howard Hinnant)
+  year -= month <= 2;
+  int era = year / 400;
+  int yoe = year - era * 400;
+  int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  long days = (long)era * 146097 + doe - 719468;
+  return (uint32_t)(days * DAY_S + hour * 3600 + minute * 60);
+}
+
+static ScheduleTable daily(uint8_t zone, int hour, int minute, uint16_t seconds)
+{
+  ScheduleTable t;
+  t.clear();
+  for (uint8_t d = 0; d < 7; d++)
+    t.add(zone, d * 1440 + hour * 60 + minute, seconds);
+  return t;
+}
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static void report(const char *scenario, ClockRun &r)
+{
+  printf("%-9s disparos %5zu  atrasados %3lu  omitidos %3lu  saltos %lu\n", scenario, r.fires.size(),
+         (unsigned long)r.engine.late, (unsigned long)r.engine.skipped, (unsigned long)r.engine.clockJumps);
+}
+
+static void year(void)
+{
+  ScheduleTable t = daily(0, 6, 30, 600);
+  t.add(0, 6 * 1440 + 23 * 60 + 59, 60);  // Sábado 23:59: el siguiente es de la semana que viene
+  t.add(1, 0, 300);                       // Domingo 0:00
+  t.add(1, 3 * 1440 + 12 * 60, 300);      // Miércoles 12:00
+  t.add(1, 6 * 1440 + 23 * 60 + 59, 300); // Sábado 23:59
+
+  uint32_t start = localTime(2026, 1, 7, 10, 0);
+  ClockRun r(t, start);
+  r.run(365 * DAY_S);
+  report("año", r);
+
+  // Referencia: cada minuto del año que cae en un turno
+  std::vector<Fire> expected;
+  for (uint32_t m = (start + 59) / 60 * 60; m < r.now; m += 60)
+    for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+      for (uint8_t i = 0; i < t.count[z]; i++)
+        if (t.slots[z][i].minuteOfWeek == ScheduleEngine::minuteOfWeek(m))
+          expected.push_back(Fire{z, m, m});
+
+  bool same = expected.size() == r.fires.size();
+  for (size_t i = 0; same && i < expected.size(); i++)
+  {
+    // Ambas listas van en orden de hora; en el mismo minuto, la zona 0 primero
+    const Fire &e = expected[i], &f = r.fires[i];
+    same = e.zone == f.zone && e.dueAt == f.dueAt && f.at - f.dueAt < POLL_PERIOD_S;
+  }
+  check("año", same, "los disparos no coinciden con la referencia");
+  check("año", r.engine.late == 0 && r.engine.skipped == 0, "hubo turnos atrasados u omitidos");
+}
+
+static void springForward(void)
+{
+  ScheduleTable t = daily(0, 2, 30, 600);
+  for (uint8_t d = 0; d < 7; d++)
+    t.add(1, d * 1440 + 3 * 60 + 15, 300);
+
+  uint32_t sunday = localTime(2026, 4, 5, 0, 0);
+  ClockRun r(t, sunday - 3600);
+  r.run(3 * 3600); // Hasta las 2:00
+  r.jump(3600);
+  r.run(6 * 3600);
+  report("verano", r);
+
+  check("verano", r.count(0, sunday + 2 * 3600 + 1800) == 1, "el turno de las 2:30 no se ejecutó al saltar a las 3:00");
+  check("verano", r.count(1, sunday + 3 * 3600 + 900) == 1, "el turno de las 3:15 no se ejecutó");
+  check("verano", r.engine.late == 1 && r.engine.skipped == 0, "atrasados u omitidos inesperados");
+}
+
+static void fallBack(void)
+{
+  ScheduleTable t = daily(0, 1, 30, 600);
+  for (uint8_t d = 0; d < 7; d++)
+    t.add(1, d * 1440 + 2 * 60 + 30, 300);
+
+  uint32_t sunday = localTime(2026, 10, 25, 0, 0);
+  ClockRun r(t, sunday);
+  r.run(2 * 3600); // Hasta las 2:00
+  r.jump(-3600);
+  r.run(4 * 3600);
+  report("invierno", r);
+
+  check("invierno", r.count(0, sunday + 3600 + 1800) == 1, "el turno de la 1:30 se repitió o no se ejecutó");
+  check("invierno", r.count(1, sunday + 2 * 3600 + 1800) == 1, "el turno de las 2:30 se repitió o no se ejecutó");
+  check("invierno", r.engine.clockJumps == 1, "no se detectó el reloj atrasado");
+}
+
+static void outage(void)
+{
+  ScheduleTable t = daily(0, 3, 0, 600);
+  for (uint8_t d = 0; d < 7; d++)
+    t.add(0, d * 1440 + 7 * 60 + 30, 600);
+
+  uint32_t day = localTime(2026, 6, 10, 0, 0);
+  ClockRun r(t, day - 3600);
+  r.run(3600);
+  r.jump(8 * 3600);
+  r.run(3600);
+  report("corte", r);
+
+  check("corte", r.count(0, day + 3 * 3600) == 0, "se ejecutó un turno con más de una hora de atraso");
+  check("corte", r.count(0, day + 7 * 3600 + 1800) == 1, "no se ejecutó el último turno pendiente");
+  check("corte", r.engine.skipped == 1, "se esperaba un turno omitido");
+}
+
+static void rtcSetBack(void)
+{
+  ScheduleTable t = daily(0, 6, 30, 600);
+
+  uint32_t day = localTime(2026, 3, 3, 6, 0);
+  ClockRun r(t, day);
+  r.run(3600);
+  r.jump(-(int32_t)DAY_S);
+  r.run(DAY_S);
+  report("ajuste", r);
+
+  // La misma hora local vuelve a ocurrir y se riega otra vez, una sola
+  check("ajuste", r.count(0, day + 1800) == 2 && r.fires.size() == 2, "el día repetido debe volver a regar una vez");
+}
+
+static void coldStart(void)
+{
+  ScheduleTable t = daily(0, 6, 30, 600);
+
+  uint32_t day = localTime(2026, 3, 3, 0, 0);
+  ClockRun r(t, day + 6 * 3600 + 40 * 60);
+  r.run(DAY_S);
+  report("arranque", r);
+
+  check("arranque", r.count(0, day + 6 * 3600 + 1800) == 0, "se ejecutó un turno anterior al arranque");
+  check("arranque", r.count(0, day + DAY_S + 6 * 3600 + 1800) == 1, "no se ejecutó el turno del día siguiente");
+}
+
+// ReadSensorsTask en bajo consumo con la hora en milisegundos: revisa el
+// horario con cada muestra y cuando vence la alarma, y duerme hasta la
+// siguiente muestra o, con capTurns, hasta el siguiente turno
+struct NapResult
+{
+  uint32_t fired;
+  uint32_t maxLateMs;
+  uint32_t sleeps;
+  uint32_t samples;
+};
+
+static NapResult napWeek(const ScheduleTable &t, uint32_t start, bool capTurns)
+{
+  ScheduleEngine engine;
+  engine.load(t);
+  ScheduleEvent events[SCHEDULE_ZONES];
+  NapResult result = {0, 0, 0, 0};
+  uint64_t nowMs = (uint64_t)start * 1000, endMs = nowMs + 7 * DAY_S * 1000;
+  uint64_t lastSample = nowMs - LOW_POWER_SAMPLE_MS;
+
+  while (nowMs < endMs)
+  {
+    uint32_t now = (uint32_t)(nowMs / 1000); // El RTC entrega segundos enteros
+    bool sampled = nowMs - lastSample >= LOW_POWER_SAMPLE_MS;
+    if (sampled)
+    {
+      lastSample = nowMs;
+      result.samples++;
+    }
+    if (sampled || (capTurns && engine.msUntilNext(now) == 0))
+    {
+      uint8_t count = engine.poll(now, events);
+      for (uint8_t i = 0; i < count; i++)
+      {
+        uint32_t late = (uint32_t)(nowMs - (uint64_t)events[i].dueAt * 1000);
+        if (late > result.maxLateMs)
+          result.maxLateMs = late;
+        result.fired++;
+      }
+    }
+
+    uint32_t untilSample = (uint32_t)(lastSample + LOW_POWER_SAMPLE_MS - nowMs);
+    uint32_t sleep = powerSleepMs(untilSample, capTurns ? engine.msUntilNext(now) : SCHEDULE_NONE);
+    if (sleep > 0)
+    {
+      result.sleeps++;
+      nowMs += sleep;
+    }
+    else
+      nowMs += untilSample > 0 && untilSample < AWAKE_STEP_MS ? untilSample : AWAKE_STEP_MS;
+  }
+  return result;
+}
+
+static void lowPower(void)
+{
+  // Turnos en minutos que no coinciden con la muestra
+  ScheduleTable t = daily(0, 6, 31, 600);
+  for (uint8_t d = 0; d < 7; d++)
+  {
+    t.add(1, d * 1440 + 13 * 60 + 7, 300);
+    t.add(1, d * 1440 + 19 * 60 + 58, 300);
+  }
+
+  uint32_t start = localTime(2026, 5, 4, 0, 0) + 17;
+  NapResult capped = napWeek(t, start, true);
+  NapResult uncapped = napWeek(t, start, false);
+  printf("siesta    disparos %5u  atraso máx %6.1f s  siestas %4u  muestras %4u\n", capped.fired,
+         capped.maxLateMs / 1000.0, capped.sleeps, capped.samples);
+  printf("          sin tope: atraso máx %6.1f s\n", uncapped.maxLateMs / 1000.0);
+
+  check("siesta", capped.fired == 21, "no se ejecutaron todos los turnos");
+  check("siesta", capped.maxLateMs < 1000 + POWER_SETTLE_MS, "un turno salió tarde durmiendo");
+  // Cada turno agrega pocas siestas: la del turno y las cortas que corrigen
+  // el segundo entero del RTC
+  check("siesta", capped.sleeps <= capped.samples + 4 * capped.fired, "se despierta de más");
+  check("siesta", uncapped.maxLateMs > 60000, "sin el tope los turnos deberían atrasarse");
+}
+
+static void benchArm(unsigned long iterations)
+{
+  ScheduleTable t;
+  t.clear();
+  std::mt19937 rng(1);
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+    while (t.count[z] < SCHEDULE_MAX_SLOTS)
+      t.add(z, rng() % SCHEDULE_MINUTES_PER_WEEK, 60);
+
+  ScheduleEngine engine;
+  ScheduleEvent events[SCHEDULE_ZONES];
+  uint32_t base = localTime(2026, 1, 1, 0, 0);
+  uint32_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    // load() obliga a armar todas las zonas en el siguiente poll()
+    engine.load(t);
+    engine.poll(base + (uint32_t)(i * 7919 % (7 * DAY_S)), events);
+    sum += engine.nextDue();
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("armar %d zonas con %d turnos: %.1f ns (%u)\n", SCHEDULE_ZONES, SCHEDULE_MAX_SLOTS,
+         std::chrono::duration<double, std::nano>(end - start).count() / iterations, sum & 1);
+}
+
+int main(int argc, char **argv)
+{
+  year();
+  springForward();
+  fallBack();
+  outage();
+  rtcSetBack();
+  coldStart();
+  lowPower();
+  benchArm(argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000UL);
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+/*
+  Prueba de escritorio de la pantalla (SiRIM/LcdDisplay.h).
+
+  Alimenta una hora de muestras sintéticas (una cada 5 s, con los relevadores
+  cambiando de vez en cuando) a dos formas de dibujar el carrusel sobre el
+  LCD simulado de host/, que cuenta los bytes que saldrían por el bus I2C:
+    - repintar    como manejarCarrusel() de CodigoIoTV1.0BETA: clear() y
+                  todos los renglones en cada vuelta de 100 ms
+    - diferencias LcdDisplay: sólo las celdas que cambiaron, cada 100 ms y
+                  cada LCD_REFRESH_MS
+
+  Verifica que lo que queda en el módulo sea siempre la página del
+  framebuffer, que después del primero no haya más clear() (el parpadeo) y
+  el texto de cada página para una muestra conocida.
+
+  Compilar:
+    g++ -std=c++17 -O2 -Ihost -I../SiRIM -o sim_lcd sim_lcd.cpp
+  Uso:
+    ./sim_lcd [segundos]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include "LcdDisplay.h"
+
+#define SAMPLE_MS 5000
+#define LEGACY_LOOP_MS 100
+#define I2C_HZ 100000
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static DisplaySnapshot knownSnapshot(void)
+{
+  DisplaySnapshot view;
+  memset(&view, 0, sizeof(view));
+  view.data.temperature = 24.5f;
+  view.data.humidity = 61.0f;
+  view.data.lightIntensity = 37;
+  view.data.waterPercent = 80;
+  view.data.timestamp = 1718000000 + 3600 * 6 + 5 * 60; // 10/6/2024 6:13 + 6:05
+  view.mode = ACTUATION_TIMER;
+  view.lightThreshold = 100;
+  view.soilThreshold = 40;
+  view.relays = 0x02;
+  view.backlight = true;
+  return view;
+}
+
+// Renglón del framebuffer como cadena
+static std::string frameRow(const LcdFrame &frame, uint8_t row)
+{
+  std::string text;
+  for (uint8_t c = 0; c < LCD_COLUMNS; c++)
+    text += frame.cell(row, c);
+  return text;
+}
+
+static void checkPages(void)
+{
+  static const char *const expected[LCD_PAGE_COUNT][LCD_ROWS] = {
+      {"Temp: 24.5 C    ", "Hum. Amb: 61%   "}, {"Luz: 37%        ", "N. agua: 80%    "},
+      {"Modo: horario   ", "Zonas: OFF ON   "}, {"Luz Umbral: 100 ", "Hum. Umbral: 40 "},
+      {"Hora: 12:18     ", "Dia: 10/6/2024  "},
+  };
+  DisplaySnapshot view = knownSnapshot();
+  LcdFrame frame;
+  for (uint8_t p = 0; p < LCD_PAGE_COUNT; p++)
+  {
+    LcdDisplay::renderPage(p, view, frame);
+    for (uint8_t r = 0; r < LCD_ROWS; r++)
+      if (frameRow(frame, r) != expected[p][r])
+      {
+        printf("  página %u renglón %u: \"%s\", se esperaba \"%s\"\n", p, r, frameRow(frame, r).c_str(),
+               expected[p][r]);
+        failures++;
+      }
+  }
+
+  // Sin lectura del DHT y con un valor más corto se borra lo que sobraba
+  view.data.temperature = NAN;
+  LcdDisplay::renderPage(0, view, frame);
+  check("páginas", frameRow(frame, 0) == "Temp: -- C      ", "temperatura sin lectura");
+}
+
+// Muestras sintéticas: caminatas aleatorias con la resolución de los sensores
+class Stream
+{
+private:
+  std::mt19937 rng{7};
+  std::normal_distribution<float> noise{0.0f, 1.0f};
+
+public:
+  DisplaySnapshot view = knownSnapshot();
+
+  void next(void)
+  {
+    view.data.temperature = roundf((view.data.temperature + 0.05f * noise(rng)) * 10) / 10;
+    view.data.humidity = roundf(view.data.humidity + 0.3f * noise(rng));
+    view.data.lightIntensity = (int16_t)fminf(100, fmaxf(0, view.data.lightIntensity + roundf(noise(rng))));
+    if (rng() % 60 == 0)
+      view.data.waterPercent--;
+    if (rng() % 120 == 0)
+      view.relays ^= 1 << (rng() % SCHEDULE_ZONES);
+    view.data.timestamp += SAMPLE_MS / 1000;
+  }
+};
+
+struct Result
+{
+  uint64_t bytes;
+  uint64_t clears;
+  uint64_t passes;
+  uint64_t worstPassBytes;
+};
+
+// Como manejarCarrusel(): cada vuelta borra y vuelve a escribir la página
+static void legacyPage(LiquidCrystal_I2C &lcd, uint8_t page, const DisplaySnapshot &view)
+{
+  const SensorsData &d = view.data;
+  CivilTime t = TelemetryEncoder::civilFromUnix(d.timestamp);
+  lcd.clear();
+  switch (page)
+  {
+  case 0:
+    lcd.setCursor(0, 0);
+    lcd.print("Temp: ");
+    lcd.print(d.temperature);
+    lcd.print(" C");
+    lcd.setCursor(0, 1);
+    lcd.print("Hum. Amb: ");
+    lcd.print(d.humidity);
+    lcd.print("%");
+    break;
+  case 1:
+    lcd.setCursor(0, 0);
+    lcd.print("Luz: ");
+    lcd.print((int)d.lightIntensity);
+    lcd.print("%");
+    lcd.setCursor(0, 1);
+    lcd.print("N. agua: ");
+    lcd.print((int)d.waterPercent);
+    lcd.print("%");
+    break;
+  case 2:
+    lcd.setCursor(0, 0);
+    lcd.print("Modo: ");
+    lcd.print(view.mode == ACTUATION_MANUAL ? "manual" : "auto");
+    lcd.setCursor(0, 1);
+    lcd.print("Bomba: ");
+    lcd.print(view.relays ? "ON" : "OFF");
+    break;
+  case 3:
+    lcd.setCursor(0, 0);
+    lcd.print("Luz Umbral: ");
+    lcd.print((int)view.lightThreshold);
+    lcd.setCursor(0, 1);
+    lcd.print("Hum. Umbral: ");
+    lcd.print((int)view.soilThreshold);
+    break;
+  default:
+    lcd.setCursor(0, 0);
+    lcd.print("Hora: ");
+    lcd.print((int)t.hour);
+    lcd.print(":");
+    if (t.minute < 10)
+      lcd.print("0");
+    lcd.print((int)t.minute);
+    lcd.setCursor(0, 1);
+    lcd.print("Dia: ");
+    lcd.print((int)t.day);
+    lcd.print("/");
+    lcd.print((int)t.month);
+    lcd.print("/");
+    lcd.print((int)t.year);
+    break;
+  }
+}
+
+static Result run(const char *name, uint32_t seconds, uint32_t refreshMs, bool diff)
+{
+  LiquidCrystal_I2C lcd(0x27, 16, 2);
+  LcdDisplay display(lcd);
+  Stream stream;
+  Result result = {0, 0, 0, 0};
+  uint64_t startBytes = lcd.busBytes;
+  uint64_t startClears = lcd.clears;
+  uint8_t page = 0;
+  uint32_t pageAt = 0;
+
+  for (uint32_t now = 0; now < seconds * 1000; now += refreshMs)
+  {
+    if (now % SAMPLE_MS < refreshMs)
+      stream.next();
+    uint64_t before = lcd.busBytes;
+    if (diff)
+    {
+      display.show(stream.view, now);
+      // Lo que quedó en el módulo es exactamente el framebuffer
+      for (uint8_t r = 0; r < LCD_ROWS; r++)
+        if (lcd.line(r) != frameRow(display.framebuffer(), r))
+        {
+          check(name, false, "el módulo no coincide con el framebuffer");
+          break;
+        }
+    }
+    else
+    {
+      if (now - pageAt >= LCD_PAGE_MS)
+      {
+        page = (page + 1) % LCD_PAGE_COUNT;
+        pageAt = now;
+      }
+      legacyPage(lcd, page, stream.view);
+    }
+    uint64_t passBytes = lcd.busBytes - before;
+    if (passBytes > result.worstPassBytes)
+      result.worstPassBytes = passBytes;
+    result.passes++;
+  }
+  result.bytes = lcd.busBytes - startBytes;
+  result.clears = lcd.clears - startClears;
+  return result;
+}
+
+static void report(const char *name, uint32_t seconds, const Result &r)
+{
+  double bytesPerSecond = (double)r.bytes / seconds;
+  printf("%-26s %8.1f B/s  bus %5.1f ms/s  peor vuelta %4llu B (%4.1f ms)  clear %llu\n", name, bytesPerSecond,
+         bytesPerSecond * 9 * 1000 / I2C_HZ, (unsigned long long)r.worstPassBytes,
+         r.worstPassBytes * 9 * 1000.0 / I2C_HZ, (unsigned long long)r.clears);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 3600;
+  if (seconds == 0)
+  {
+    fprintf(stderr, "uso: %s [segundos]\n", argv[0]);
+    return 2;
+  }
+
+  checkPages();
+
+  Result legacy = run("repintar", seconds, LEGACY_LOOP_MS, false);
+  Result fast = run("diferencias 100 ms", seconds, LEGACY_LOOP_MS, true);
+  Result task = run("diferencias", seconds, LCD_REFRESH_MS, true);
+
+  printf("LCD 16x2, %u s, una muestra cada %u s, página cada %u s (%u B por carácter o comando)\n", seconds,
+         SAMPLE_MS / 1000, LCD_PAGE_MS / 1000, LiquidCrystal_I2C::BYTES_PER_WRITE);
+  report("repintar cada 100 ms", seconds, legacy);
+  report("diferencias cada 100 ms", seconds, fast);
+  char name[40];
+  snprintf(name, sizeof(name), "diferencias cada %u ms", LCD_REFRESH_MS);
+  report(name, seconds, task);
+
+  check("diferencias", fast.bytes * 10 < legacy.bytes, "no baja el tráfico ni a la décima parte");
+  check("diferencias", task.bytes <= fast.bytes, "refrescar menos seguido escribe más");
+  check("diferencias", fast.clears == 1 && task.clears == 1, "borra la pantalla después del primer flush");
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
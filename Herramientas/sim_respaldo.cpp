@@ -0,0 +1,274 @@
+/*
+  Prueba de escritorio del respaldo de mensajes (SiRIM/OutboundBacklog.h).
+
+  SpillQueue corre sobre SDBlockStorage y el SD simulado de host/ (un
+  directorio temporal), así que cada bloque pasa por un archivo real:
+    - corte       dos horas sin enlace con una muestra cada 5 s, como la
+                  tarea de red: sin conexión se respalda; al volver, el
+                  respaldo se reenvía al ritmo de ReplayPacer y las muestras
+                  nuevas se forman detrás mientras quede algo. Cada mensaje
+                  llega una vez, en el orden en que se generó
+    - reinicio    flush() y begin() sobre el mismo archivo recuperan todo en
+                  orden; después de consumir una parte, el reinicio repite a
+                  lo más el bloque que estaba a medias
+    - lleno       un anillo de 8 bloques: se pierden los más antiguos,
+                  droppedMessages lo cuenta y quedan los más nuevos en orden
+    - ritmo       ReplayPacer entrega la ráfaga y luego la tasa configurada
+
+  Compilar:
+    g++ -std=c++17 -O2 -Ihost -I../SiRIM -o sim_respaldo sim_respaldo.cpp
+  Uso:
+    ./sim_respaldo
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "SDStorage.h"
+#include "OutboundBacklog.h"
+
+#define SAMPLE_MS 5000
+#define OUTAGE_MS (2 * 3600 * 1000UL)
+#define REPLAY_RATE 5
+#define REPLAY_BURST 10
+#define FLUSH_MS 30000
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+// Mensaje n con largo variable, como la telemetría con y sin lecturas
+static std::string message(uint32_t n)
+{
+  char text[200];
+  int length = snprintf(text, sizeof(text), "{\"n\":%u,\"relleno\":\"", n);
+  for (uint32_t i = 0; i < 40 + n % 90; i++)
+    text[length++] = 'a' + i % 26;
+  text[length++] = '"';
+  text[length++] = '}';
+  return std::string(text, length);
+}
+
+static uint32_t numberOf(const char *text) { return (uint32_t)strtoul(text + 5, NULL, 10); }
+
+// Saca el mensaje más antiguo; false si no hay
+static bool take(SpillQueue &queue, uint32_t &n)
+{
+  char text[DATALOG_BLOCK_SIZE];
+  uint32_t timestamp;
+  uint16_t length;
+  if (!queue.front(text, sizeof(text), &timestamp, &length))
+    return false;
+  n = numberOf(text);
+  queue.pop();
+  return n == timestamp && std::string(text, length) == message(n);
+}
+
+static void outage(void)
+{
+  SDBlockStorage storage;
+  SpillQueue queue(storage);
+  ReplayPacer pacer(REPLAY_RATE, REPLAY_BURST);
+  check("corte", storage.begin("/corte.bin", 1024) && queue.begin(), "no abre el respaldo");
+
+  std::vector<uint32_t> delivered;
+  std::vector<bool> seen;
+  uint32_t next = 0, lastReplayed = 0, outOfOrder = 0, maxDepth = 0;
+  bool fifo = true, anyReplayed = false;
+  uint32_t end = OUTAGE_MS * 2;
+  for (uint32_t now = 0; now < end; now += 10)
+  {
+    bool online = now < 600000 || now >= 600000 + OUTAGE_MS;
+    if (now % SAMPLE_MS == 0)
+    {
+      // Como publishLive(): en vivo sólo si el respaldo ya salió
+      uint32_t n = next++;
+      if (online && queue.depth == 0)
+        delivered.push_back(n);
+      else
+      {
+        std::string text = message(n);
+        queue.push(text.data(), text.size(), n);
+      }
+    }
+    if (queue.depth > maxDepth)
+      maxDepth = queue.depth;
+    if (online)
+    {
+      while (pacer.tryTake(now))
+      {
+        uint32_t n;
+        if (!take(queue, n))
+          break;
+        if (anyReplayed && n != lastReplayed + 1)
+          fifo = false;
+        anyReplayed = true;
+        lastReplayed = n;
+        delivered.push_back(n);
+      }
+    }
+    if (now % FLUSH_MS == 0)
+      queue.flush();
+  }
+
+  seen.assign(next, false);
+  bool once = true;
+  for (size_t i = 0; i < delivered.size(); i++)
+  {
+    if (seen[delivered[i]])
+      once = false;
+    seen[delivered[i]] = true;
+    if (i > 0 && delivered[i] < delivered[i - 1])
+      outOfOrder++;
+  }
+  bool all = delivered.size() == next;
+  printf("corte        %5u muestras, respaldo máx %4u, %5u fuera de orden global, %u descartados\n", next, maxDepth,
+         outOfOrder, queue.droppedMessages);
+  check("corte", all && once, "no llegó cada mensaje exactamente una vez");
+  check("corte", fifo, "el respaldo no salió en orden FIFO");
+  check("corte", outOfOrder == 0, "una muestra en vivo salió antes que el respaldo");
+  check("corte", queue.depth == 0 && queue.droppedMessages == 0, "quedaron pendientes o hubo descartes");
+  check("corte", maxDepth >= OUTAGE_MS / SAMPLE_MS, "el respaldo no guardó todo el corte");
+}
+
+static void restart(void)
+{
+  const uint32_t total = 500;
+  {
+    SDBlockStorage storage;
+    SpillQueue queue(storage);
+    check("reinicio", storage.begin("/reinicio.bin", 256) && queue.begin(), "no abre el respaldo");
+    for (uint32_t n = 0; n < total; n++)
+    {
+      std::string text = message(n);
+      queue.push(text.data(), text.size(), n);
+    }
+    check("reinicio", queue.flush(), "flush() falló");
+    storage.end();
+  }
+
+  // Reinicio: todo vuelve en orden; se consume una parte y se reinicia otra vez
+  uint32_t consumed = 0;
+  {
+    SDBlockStorage storage;
+    SpillQueue queue(storage);
+    check("reinicio", storage.begin("/reinicio.bin", 256) && queue.begin(), "no reabre el respaldo");
+    check("reinicio", queue.depth == total, "la profundidad no sobrevivió al reinicio");
+    for (; consumed < total / 2 + 1; consumed++)
+    {
+      uint32_t n;
+      if (!take(queue, n) || n != consumed)
+      {
+        check("reinicio", false, "orden o contenido distinto después del reinicio");
+        break;
+      }
+    }
+    storage.end();
+  }
+
+  SDBlockStorage storage;
+  SpillQueue queue(storage);
+  check("reinicio", storage.begin("/reinicio.bin", 256) && queue.begin(), "no reabre el respaldo");
+  uint32_t first = 0, n = 0, count = 0;
+  bool ordered = true;
+  while (take(queue, n))
+  {
+    if (count == 0)
+      first = n;
+    else if (n != first + count)
+      ordered = false;
+    count++;
+  }
+  // Un bloque se borra de la SD sólo al consumirlo completo: lo que queda a
+  // medias se repite (al menos una vez)
+  uint32_t repeated = consumed - first;
+  printf("reinicio     %5u mensajes, %u consumidos antes del segundo reinicio, %u repetidos\n", total, consumed,
+         repeated);
+  check("reinicio", ordered && first + count == total, "se perdió o desordenó algo en el segundo reinicio");
+  check("reinicio", first <= consumed && repeated < DATALOG_BLOCK_SIZE / SPILL_ENTRY_HEADER_SIZE,
+        "repitió más que el bloque a medias");
+}
+
+static void full(void)
+{
+  const uint32_t blocks = 8, total = 400;
+  SDBlockStorage storage;
+  SpillQueue queue(storage);
+  check("lleno", storage.begin("/lleno.bin", blocks) && queue.begin(), "no abre el respaldo");
+  for (uint32_t n = 0; n < total; n++)
+  {
+    std::string text = message(n);
+    queue.push(text.data(), text.size(), n);
+  }
+  uint32_t depth = queue.depth;
+  printf("lleno        %5u mensajes en %u bloques: %u pendientes, %u descartados\n", total, blocks, depth,
+         queue.droppedMessages);
+  check("lleno", queue.droppedMessages > 0 && queue.droppedMessages + depth == total,
+        "los descartes no cuadran con lo que se guardó");
+
+  // Quedan los más nuevos, en orden y hasta el último
+  uint32_t n, expected = queue.droppedMessages, count = 0;
+  bool ordered = true;
+  while (take(queue, n))
+  {
+    if (n != expected++)
+      ordered = false;
+    count++;
+  }
+  check("lleno", ordered && count == depth && expected == total, "no quedaron los más nuevos en orden");
+}
+
+static void pace(void)
+{
+  ReplayPacer pacer(REPLAY_RATE, REPLAY_BURST);
+  // Después de un rato quieto la cubeta está llena: la ráfaga sale de una vez
+  uint32_t burst = 0;
+  while (pacer.tryTake(100000))
+    burst++;
+  uint32_t taken = 0;
+  for (uint32_t now = 100000; now <= 160000; now += 10)
+    while (pacer.tryTake(now))
+      taken++;
+  pacer.setRate(1);
+  uint32_t slow = 0;
+  for (uint32_t now = 160010; now <= 220000; now += 10)
+    while (pacer.tryTake(now))
+      slow++;
+  printf("ritmo        ráfaga %u, %u en 60 s a %u/s, %u en 60 s a 1/s\n", burst, taken, REPLAY_RATE, slow);
+  check("ritmo", burst == REPLAY_BURST, "la ráfaga no es la configurada");
+  check("ritmo", taken >= 60 * REPLAY_RATE - 1 && taken <= 60 * REPLAY_RATE + 1, "la tasa no es la configurada");
+  check("ritmo", slow >= 59 && slow <= 61, "setRate() no cambió la tasa");
+}
+
+int main(void)
+{
+  char temporary[] = "/tmp/sirim-respaldo-XXXXXX";
+  const char *root = mkdtemp(temporary);
+  if (root == NULL)
+  {
+    perror("mkdtemp");
+    return 1;
+  }
+  SD.setRoot(root);
+
+  outage();
+  restart();
+  full();
+  pace();
+
+  std::string command = std::string("rm -rf '") + root + "'";
+  if (system(command.c_str()) != 0)
+    fprintf(stderr, "no se pudo borrar %s\n", root);
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
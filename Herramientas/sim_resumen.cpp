@@ -0,0 +1,287 @@
+/*
+  Prueba de escritorio de los resúmenes por ventana (SiRIM/Rollup.h).
+
+  Alimenta al agregador con una muestra cada 5 s (SENSOR_READ_INTERVAL) y
+  compara cada ventana cerrada contra el cálculo por lotes en double (dos
+  pasadas sobre las muestras guardadas):
+    - semana   siete días con valores realistas, lecturas NaN del DHT11 y
+               suelo o tanque sin lectura (-1, READING_INVALID)
+    - deriva   un día entero alrededor de 1000 con variación pequeña, el peor
+               caso para la precisión de float
+    - salto    el RTC se atrasa una hora y luego se adelanta un día
+    - formato  empaquetar/desempaquetar, JSON en el peor caso y periodOf()
+  y mide el costo de agregar una muestra.
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_resumen sim_resumen.cpp
+  Uso:
+    ./sim_resumen [iteraciones]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "Rollup.h"
+
+#define SAMPLE_PERIOD_S 5
+#define DAY_S 86400UL
+#define START_TIME 1767225600UL // 2026-01-01 00:00 (hora local del RTC)
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+// Guarda las muestras de cada ventana abierta y verifica las que se cierran
+class WindowRun
+{
+public:
+  RollupAggregator aggregator;
+  std::vector<SensorsData> samples[ROLLUP_WINDOWS];
+  uint32_t closed[ROLLUP_WINDOWS] = {0};
+  double worstError = 0; // Error relativo máximo de promedio y desviación
+  bool exact = true;     // Mínimo, máximo y conteos iguales
+
+  void add(const SensorsData &data)
+  {
+    uint8_t done = aggregator.add(data);
+    for (uint8_t w = 0; w < ROLLUP_WINDOWS; w++)
+    {
+      if (done & (1 << w))
+      {
+        verify(aggregator.completed(w), samples[w]);
+        samples[w].clear();
+        closed[w]++;
+      }
+      samples[w].push_back(data);
+    }
+  }
+
+  void verify(const Rollup &rollup, const std::vector<SensorsData> &batch)
+  {
+    exact = exact && rollup.samples == batch.size();
+    for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+    {
+      std::vector<double> values;
+      for (const SensorsData &d : batch)
+      {
+        float v[ROLLUP_CHANNELS];
+        RollupAggregator::channelValues(d, v);
+        if (!isnan(v[c]))
+          values.push_back(v[c]);
+      }
+
+      const RunningStats &s = rollup.channels[c];
+      exact = exact && s.count == values.size();
+      if (values.empty())
+        continue;
+
+      double mean = 0, lo = values[0], hi = values[0];
+      for (double v : values)
+      {
+        mean += v;
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+      }
+      mean /= values.size();
+      double m2 = 0;
+      for (double v : values)
+        m2 += (v - mean) * (v - mean);
+      double sd = values.size() > 1 ? sqrt(m2 / (values.size() - 1)) : 0;
+
+      exact = exact && s.min == (float)lo && s.max == (float)hi;
+      // Relativo a la escala de los datos: una desviación casi cero no cuenta
+      double scale = fabs(mean) + sd + 1e-3;
+      double error = fabs(s.mean - mean) / scale;
+      error = fmax(error, fabs(s.stddev() - sd) / (sd + 1e-2 * scale));
+      worstError = fmax(worstError, error);
+    }
+  }
+};
+
+static void report(const char *scenario, WindowRun &r)
+{
+  printf("%-8s minutos %6lu  horas %4lu  días %2lu  error relativo %.2e\n", scenario, (unsigned long)r.closed[0],
+         (unsigned long)r.closed[1], (unsigned long)r.closed[2], r.worstError);
+}
+
+static SensorsData sample(uint32_t t, std::mt19937 &rng)
+{
+  std::normal_distribution<float> noise(0, 1);
+  float hour = (t % DAY_S) / 3600.0f;
+  float daylight = sinf((hour - 6) / 12 * 3.14159265f);
+  SensorsData d;
+  d.temperature = 24 + 6 * daylight + 0.3f * noise(rng);
+  d.humidity = 60 - 15 * daylight + noise(rng);
+  d.soilMoisture1 = (int16_t)(45 + 5 * noise(rng));
+  d.soilMoisture2 = (int16_t)(50 + 5 * noise(rng));
+  d.lightIntensity = (int16_t)(daylight > 0 ? 100 * daylight : 0);
+  d.waterLevel = 30;
+  d.waterPercent = (int16_t)(70 + noise(rng));
+  d.timestamp = t;
+  // El DHT11 falla de vez en cuando
+  if (rng() % 50 == 0)
+    d.temperature = d.humidity = NAN;
+  // Sonda o ultrasónico sin lectura (READING_INVALID de ZoneController.h)
+  if (rng() % 200 == 0)
+    d.soilMoisture1 = d.waterPercent = -1;
+  return d;
+}
+
+static void week(void)
+{
+  std::mt19937 rng(1);
+  WindowRun r;
+  for (uint32_t t = START_TIME; t < START_TIME + 7 * DAY_S + SAMPLE_PERIOD_S; t += SAMPLE_PERIOD_S)
+    r.add(sample(t, rng));
+  report("semana", r);
+
+  check("semana", r.exact, "mínimo, máximo o conteos distintos al cálculo por lotes");
+  check("semana", r.worstError < 1e-4, "promedio o desviación fuera de tolerancia");
+  check("semana", r.closed[ROLLUP_MINUTE] == 7 * 1440 && r.closed[ROLLUP_HOUR] == 7 * 24 && r.closed[ROLLUP_DAY] == 7,
+        "no se cerraron todas las ventanas");
+  const Rollup &day = r.aggregator.completed(ROLLUP_DAY);
+  check("semana", day.start % DAY_S == 0 && day.samples == DAY_S / SAMPLE_PERIOD_S,
+        "la ventana diaria no va de medianoche a medianoche");
+  check("semana", day.channels[2].min >= 0 && day.channels[5].min >= 0 && day.channels[5].count < day.samples,
+        "una lectura sin dato entró al resumen");
+}
+
+static void drift(void)
+{
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+  WindowRun r;
+  for (uint32_t t = START_TIME; t < START_TIME + DAY_S + SAMPLE_PERIOD_S; t += SAMPLE_PERIOD_S)
+  {
+    SensorsData d = sample(t, rng);
+    d.temperature = 1000 + noise(rng);
+    r.add(d);
+  }
+  report("deriva", r);
+  check("deriva", r.worstError < 1e-3, "la desviación perdió precisión con un promedio grande");
+}
+
+static void clockJump(void)
+{
+  std::mt19937 rng(3);
+  WindowRun r;
+  uint32_t t = START_TIME + 10 * 3600;
+  for (uint32_t end = t + 1800; t < end; t += SAMPLE_PERIOD_S)
+    r.add(sample(t, rng));
+
+  // Atrasar una hora: la ventana abierta se cierra con lo que tenía
+  t -= 3600;
+  uint32_t before = r.closed[ROLLUP_HOUR];
+  r.add(sample(t, rng));
+  check("salto", r.closed[ROLLUP_HOUR] == before + 1, "el atraso no cerró la hora");
+  check("salto", r.aggregator.current(ROLLUP_HOUR).start == t - t % 3600, "la nueva hora no se alineó al reloj");
+
+  // Adelantar un día: un solo cierre por ventana, sin rellenar los huecos
+  for (uint32_t end = t + 600; t < end; t += SAMPLE_PERIOD_S)
+    r.add(sample(t, rng));
+  uint32_t days = r.closed[ROLLUP_DAY];
+  uint32_t minutes = r.closed[ROLLUP_MINUTE];
+  r.add(sample(t + DAY_S, rng));
+  report("salto", r);
+  check("salto", r.closed[ROLLUP_DAY] == days + 1 && r.closed[ROLLUP_MINUTE] == minutes + 1,
+        "el salto debe cerrar una sola ventana de cada periodo");
+  check("salto", r.exact && r.worstError < 1e-4, "resúmenes distintos al cálculo por lotes");
+}
+
+static void format(void)
+{
+  // Peor caso: todos los canales con los valores más largos posibles
+  Rollup worst;
+  worst.start = UINT32_MAX;
+  worst.period = DAY_S;
+  worst.samples = UINT32_MAX;
+  for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+  {
+    RunningStats &s = worst.channels[c];
+    s.reset();
+    s.add(-32768);
+    s.add(32767);
+    s.min = -32768;
+  }
+  char json[ROLLUP_MESSAGE_SIZE];
+  size_t length = 0;
+  bool fits = RollupEncoder::encode(worst, json, sizeof(json), &length);
+  printf("formato  JSON peor caso %zu de %d bytes, registro %d bytes\n", length, ROLLUP_MESSAGE_SIZE,
+         ROLLUP_RECORD_SIZE);
+  check("formato", fits, "el resumen no cabe en el mensaje MQTT");
+  check("formato", RollupEncoder::periodOf(json, length) == DAY_S, "periodOf no reconoce el resumen");
+  check("formato", RollupEncoder::periodOf("{\"temperaturaAmbiente\":1}", 25) == 0, "periodOf confunde la telemetría");
+
+  // Ida y vuelta por el registro de la SD, con un canal sin lecturas
+  std::mt19937 rng(4);
+  RollupAggregator a;
+  for (uint32_t t = START_TIME; t <= START_TIME + 60; t += SAMPLE_PERIOD_S)
+  {
+    SensorsData d = sample(t, rng);
+    d.temperature = NAN;
+    a.add(d);
+  }
+  const Rollup &in = a.completed(ROLLUP_MINUTE);
+  uint8_t record[ROLLUP_RECORD_SIZE];
+  Rollup out;
+  RollupEncoder::pack(in, record);
+  RollupEncoder::unpack(record, out);
+  bool same = out.start == in.start && out.period == in.period && out.samples == in.samples;
+  for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+  {
+    const RunningStats &x = in.channels[c], &y = out.channels[c];
+    same = same && (x.count == 0) == (y.count == 0);
+    if (x.count > 0)
+      same = same && x.min == y.min && x.max == y.max && x.mean == y.mean && fabsf(x.stddev() - y.stddev()) < 1e-6f;
+  }
+  check("formato", same, "el registro no reproduce el resumen");
+
+  char a1[ROLLUP_MESSAGE_SIZE], a2[ROLLUP_MESSAGE_SIZE];
+  RollupEncoder::encode(in, a1, sizeof(a1));
+  RollupEncoder::encode(out, a2, sizeof(a2));
+  check("formato", strcmp(a1, a2) == 0, "el JSON del registro recuperado es distinto");
+  check("formato", strstr(a1, "\"temperaturaAmbiente\":null") != NULL, "un canal sin lecturas debe ser null");
+}
+
+static void benchAdd(unsigned long iterations)
+{
+  std::mt19937 rng(5);
+  std::vector<SensorsData> data;
+  for (uint32_t i = 0; i < 1024; i++)
+    data.push_back(sample(START_TIME + i * SAMPLE_PERIOD_S, rng));
+
+  RollupAggregator a;
+  uint32_t closed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    SensorsData d = data[i & 1023];
+    d.timestamp = START_TIME + i * SAMPLE_PERIOD_S;
+    closed += a.add(d) != 0;
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("agregar una muestra a %d ventanas: %.1f ns (%u)\n", ROLLUP_WINDOWS,
+         std::chrono::duration<double, std::nano>(end - start).count() / iterations, closed & 1);
+}
+
+int main(int argc, char **argv)
+{
+  week();
+  drift();
+  clockJump();
+  format();
+  benchAdd(argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000UL);
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,491 @@
+/*
+  Prueba de escritorio de la serie por día en la SD (SiRIM/SeriesStore.h) y
+  de las consultas por rango (SiRIM/RangeQuery.h).
+
+  Usa SDPartitionStorage sobre el SD simulado de host/ (un directorio
+  temporal) y compara cada consulta contra el recorrido de todas las
+  muestras guardadas:
+    - año          400 días con una muestra por minuto: consultas al azar,
+                   retención de 365 días y lecturas para llegar a la primera
+                   muestra (búsqueda binaria en el índice)
+    - corte        el nodo se reinicia con un bloque incompleto y sin parte
+                   del índice; al reabrir el día se reconstruye
+    - atraso       el RTC se atrasa media hora dentro del mismo día
+    - flujo        ventana, confirmaciones, cancelación, abandono y tamaño de
+                   cada parte de QueryStream
+    - flota        dos nodos reciben la misma consulta por sus tópicos
+                   (makeNodeTopic) y sus respuestas no se mezclan
+  y mide el costo de una consulta de una hora en un día de muestras cada 5 s.
+
+  Compilar:
+    g++ -std=c++17 -O2 -Ihost -I../SiRIM -o sim_serie sim_serie.cpp
+  Uso:
+    ./sim_serie [consultas]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "SDStorage.h"
+#include "RangeQuery.h"
+#include "Connectivity.h"
+
+#define DAY_S 86400UL
+#define START_TIME 1767225600UL   // 2026-01-01 00:00 (hora local del RTC)
+#define CHUNK_SIZE (1024 - 64)    // MQTT_BUFFER_SIZE - 64, como en DualCore.h
+#define QUERY_TOPIC "ucol/iot/consulta"                // Como en WiFiMQTT.h
+#define QUERY_REPLY_TOPIC "ucol/iot/consulta/respuesta"
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static SensorsData sample(uint32_t t, std::mt19937 &rng)
+{
+  SensorsData d;
+  d.temperature = 20 + (rng() % 100) / 10.0f;
+  d.humidity = 50 + (rng() % 300) / 10.0f;
+  d.soilMoisture1 = (int16_t)(rng() % 100);
+  d.soilMoisture2 = (int16_t)(rng() % 100);
+  d.lightIntensity = (int16_t)(rng() % 100);
+  d.waterLevel = 30;
+  d.waterPercent = (int16_t)(rng() % 100);
+  d.timestamp = t;
+  return d;
+}
+
+// Un nodo con su SD: la serie, sus particiones y todo lo que se le agregó
+class SeriesRun
+{
+public:
+  SDPartitionStorage storage;
+  SeriesStore store;
+  std::vector<SensorsData> written;
+
+  SeriesRun(const char *directory) : store(storage)
+  {
+    storage.begin(directory);
+    store.begin();
+  }
+
+  void append(const SensorsData &d)
+  {
+    store.append(d);
+    written.push_back(d);
+  }
+
+  // Lo que debe devolver la consulta: en orden de escritura y sólo días retenidos
+  std::vector<uint32_t> expected(uint32_t from, uint32_t to, uint32_t oldestDay)
+  {
+    std::vector<uint32_t> out;
+    for (const SensorsData &d : written)
+      if (d.timestamp >= from && d.timestamp <= to && d.timestamp / DAY_S >= oldestDay)
+        out.push_back(d.timestamp);
+    return out;
+  }
+
+  std::vector<uint32_t> query(uint32_t from, uint32_t to)
+  {
+    SeriesQuery q(store);
+    std::vector<uint32_t> out;
+    SensorsData d;
+    q.start(from, to);
+    while (q.next(d))
+      out.push_back(d.timestamp);
+    return out;
+  }
+
+  // Lecturas de la SD hasta tener la primera muestra del rango
+  uint32_t readsToFirst(uint32_t from, uint32_t to)
+  {
+    SeriesQuery q(store);
+    SensorsData d;
+    uint32_t before = store.blocksRead;
+    q.start(from, to);
+    q.next(d);
+    return store.blocksRead - before;
+  }
+};
+
+static std::string freshDirectory(const char *root, const char *name)
+{
+  std::string dir = std::string("/") + name;
+  std::string full = std::string(root) + dir;
+  std::string command = "rm -rf '" + full + "'";
+  if (system(command.c_str()) != 0)
+    perror("rm");
+  return dir;
+}
+
+static void year(const char *root, unsigned queries)
+{
+  std::string dir = freshDirectory(root, "anio");
+  SeriesRun r(dir.c_str());
+  std::mt19937 rng(1);
+  const uint32_t days = 400;
+  for (uint32_t t = START_TIME; t < START_TIME + days * DAY_S; t += 60)
+    r.append(sample(t, rng));
+  r.store.flush();
+
+  uint32_t newest = (START_TIME + (days - 1) * DAY_S) / DAY_S;
+  uint32_t oldest = r.storage.oldestDay();
+  printf("año      %zu muestras, %lu bloques, %lu particiones borradas, días retenidos %lu\n", r.written.size(),
+         (unsigned long)r.store.blocksWritten, (unsigned long)r.store.partitionsRemoved,
+         (unsigned long)(newest - oldest + 1));
+  check("año", oldest == newest - SERIES_RETENTION_DAYS + 1, "la retención no dejó 365 días");
+  check("año", r.store.partitionsRemoved == days - SERIES_RETENTION_DAYS, "particiones borradas de más o de menos");
+  check("año", r.store.writeErrors == 0, "errores de escritura");
+
+  uint32_t mismatches = 0;
+  std::uniform_int_distribution<uint32_t> at(START_TIME - DAY_S, START_TIME + (days + 1) * DAY_S);
+  std::uniform_int_distribution<uint32_t> span(0, 3 * DAY_S);
+  for (unsigned i = 0; i < queries; i++)
+  {
+    uint32_t from = at(rng);
+    uint32_t to = from + span(rng);
+    if (r.query(from, to) != r.expected(from, to, oldest))
+      mismatches++;
+  }
+  printf("         %u consultas al azar, %lu distintas al recorrido completo\n", queries, (unsigned long)mismatches);
+  check("año", mismatches == 0, "consultas distintas al recorrido completo");
+  check("año", r.query(START_TIME, START_TIME + 10 * DAY_S).empty(), "devolvió muestras de días borrados");
+  check("año", r.query(START_TIME + 398 * DAY_S + 100, START_TIME + 398 * DAY_S + 90).empty(), "rango invertido");
+}
+
+// Un día de muestras cada 5 s: 864 bloques, 14 bloques del índice
+static void dayOfFiveSeconds(SeriesRun &r, uint32_t day, std::mt19937 &rng)
+{
+  for (uint32_t t = day; t < day + DAY_S; t += 5)
+    r.append(sample(t, rng));
+}
+
+static void seek(const char *root)
+{
+  std::string dir = freshDirectory(root, "busqueda");
+  SeriesRun r(dir.c_str());
+  std::mt19937 rng(2);
+  dayOfFiveSeconds(r, START_TIME, rng);
+  dayOfFiveSeconds(r, START_TIME + DAY_S, rng);
+  r.store.flush();
+
+  // Leer el día cerrado desde la SD, no desde la RAM del día abierto
+  uint32_t worst = 0;
+  for (uint32_t h = 0; h < 24; h++)
+  {
+    uint32_t reads = r.readsToFirst(START_TIME + h * 3600 + 1, START_TIME + h * 3600 + 600);
+    worst = reads > worst ? reads : worst;
+  }
+  uint32_t blocks = DAY_S / 5 / DATALOG_RECORDS_PER_BLOCK;
+  printf("búsqueda lecturas hasta la primera muestra: máximo %lu de %lu bloques del día\n", (unsigned long)worst,
+         (unsigned long)blocks);
+  // Último bloque del índice + log2(864) + el bloque de datos
+  check("búsqueda", worst <= 2 + 10 + 1, "la primera muestra no se encontró con búsqueda binaria");
+}
+
+static void crash(const char *root)
+{
+  std::string dir = freshDirectory(root, "corte");
+  std::mt19937 rng(3);
+  std::vector<SensorsData> all;
+  uint32_t t = START_TIME + 3600;
+  {
+    SeriesRun r(dir.c_str());
+    for (uint32_t i = 0; i < 20 * 70 + 7; i++, t += 5)
+      r.append(sample(t, rng));
+    // El bloque incompleto quedó en la SD; sin flush sólo se pierden esas 7 muestras
+    r.store.flush();
+    all = r.written;
+  }
+
+  // Las 70 entradas del índice se perdieron (archivo vacío)
+  std::string idx = std::string(root) + dir + "/20260101.idx";
+  if (truncate(idx.c_str(), 0) != 0)
+    perror("truncate");
+
+  SeriesRun r(dir.c_str());
+  r.written = all;
+  for (uint32_t i = 0; i < 13 + 40; i++, t += 5)
+    r.append(sample(t, rng));
+  uint32_t day = START_TIME / DAY_S;
+  std::vector<uint32_t> got = r.query(START_TIME, START_TIME + DAY_S - 1);
+  printf("corte    %zu de %zu muestras después del reinicio, %lu entradas del índice\n", got.size(), r.written.size(),
+         (unsigned long)r.store.indexEntries(day));
+  check("corte", got == r.expected(START_TIME, START_TIME + DAY_S - 1, 0), "se perdieron muestras al reabrir el día");
+  check("corte", r.store.indexEntries(day) == 73, "el índice no se reconstruyó");
+  check("corte", r.store.outOfOrder == 0, "la reconstrucción contó muestras fuera de orden");
+  check("corte", r.readsToFirst(t - 60, t) <= 2 + 7 + 1, "el índice reconstruido no sirve para buscar");
+}
+
+static void setBack(const char *root)
+{
+  std::string dir = freshDirectory(root, "atraso");
+  SeriesRun r(dir.c_str());
+  std::mt19937 rng(4);
+  uint32_t t = START_TIME + 10 * 3600;
+  for (uint32_t end = t + 3600; t < end; t += 5)
+    r.append(sample(t, rng));
+  // El RTC se ajusta media hora hacia atrás y se repite ese tramo
+  t -= 1800;
+  for (uint32_t end = t + 3600; t < end; t += 5)
+    r.append(sample(t, rng));
+  r.store.flush();
+
+  uint32_t from = START_TIME + 10 * 3600 + 2400, to = from + 600;
+  std::vector<uint32_t> got = r.query(from, to);
+  printf("atraso   %zu muestras en el tramo repetido, %lu fuera de orden\n", got.size(),
+         (unsigned long)r.store.outOfOrder);
+  check("atraso", got == r.expected(from, to, 0), "faltan muestras escritas después del atraso");
+  // Las repetidas antes de la última del primer tramo (10:30 a 10:59:50)
+  check("atraso", r.store.outOfOrder == 359, "no se contaron las muestras fuera de orden");
+  from = START_TIME + 10 * 3600;
+  to = from + 60;
+  check("atraso", r.query(from, to) == r.expected(from, to, 0), "el inicio del tramo cambió con el atraso");
+}
+
+static bool request(QueryStream &stream, const char *json, uint32_t nowMs, char *reply)
+{
+  QueryRequest q;
+  if (QueryRequestParser::parse((const uint8_t *)json, strlen(json), q) != CONFIG_OK)
+    return false;
+  reply[0] = '\0';
+  stream.handle(q, nowMs, reply, 64);
+  return true;
+}
+
+static void flow(const char *root)
+{
+  std::string dir = freshDirectory(root, "flujo");
+  SeriesRun r(dir.c_str());
+  std::mt19937 rng(5);
+  dayOfFiveSeconds(r, START_TIME, rng);
+
+  QueryStream stream(r.store);
+  char chunk[CHUNK_SIZE];
+  char reply[64];
+  uint32_t now = 0;
+
+  // Sin confirmar sólo salen "ventana" partes
+  check("flujo", request(stream, "{\"id\":1,\"desde\":1767232800,\"hasta\":1767236400,\"ventana\":3}", now, reply),
+        "solicitud válida rechazada");
+  uint32_t parts = 0;
+  while (stream.ready(now) && parts < 10)
+    parts += stream.nextChunk(chunk, sizeof(chunk)) > 0;
+  check("flujo", parts == 3, "se enviaron más partes que la ventana");
+  check("flujo", strstr(chunk, "\"campos\"") == NULL, "\"campos\" fuera de la parte 0");
+
+  // Otra consulta mientras ésta sigue: ocupado
+  request(stream, "{\"id\":2,\"desde\":0}", now, reply);
+  check("flujo", strstr(reply, "ocupado") != NULL, "una segunda consulta no se rechazó");
+
+  // Confirmar la parte 1 da crédito para dos más; la 7 aún no se envía y no cuenta
+  request(stream, "{\"id\":1,\"ack\":7}", now, reply);
+  check("flujo", !stream.ready(now), "un ack de una parte no enviada dio crédito");
+  request(stream, "{\"id\":1,\"ack\":1}", now, reply);
+  parts = 0;
+  while (stream.ready(now) && parts < 10)
+    parts += stream.nextChunk(chunk, sizeof(chunk)) > 0;
+  check("flujo", parts == 2, "el ack no abrió la ventana");
+
+  // Sin confirmaciones la consulta se abandona
+  now += QUERY_ACK_TIMEOUT_MS;
+  check("flujo", !stream.ready(now) && !stream.isActive() && stream.timeouts == 1, "la consulta no se abandonó");
+
+  // Completa, confirmando cada parte: todas las muestras una vez, partes dentro del buffer
+  request(stream, "{\"id\":3,\"desde\":1767232800,\"hasta\":1767236400,\"ventana\":2}", now, reply);
+  size_t largest = 0, rows = 0;
+  uint32_t part = 0;
+  bool finished = false;
+  while (stream.ready(now))
+  {
+    size_t length = stream.nextChunk(chunk, sizeof(chunk));
+    check("flujo", length > 0, "una parte no cupo en el buffer");
+    largest = length > largest ? length : largest;
+    for (const char *p = strstr(chunk, "\"muestras\":["); p != NULL && (p = strstr(p + 1, "[1767")) != NULL;)
+      rows++;
+    finished = strstr(chunk, "\"fin\":true") != NULL;
+    char ack[48];
+    snprintf(ack, sizeof(ack), "{\"id\":3,\"ack\":%lu}", (unsigned long)part++);
+    request(stream, ack, now, reply);
+  }
+  size_t expected = r.expected(1767232800, 1767236400, 0).size();
+  printf("flujo    %lu partes, la mayor de %zu de %d bytes, %zu de %zu muestras\n", (unsigned long)part, largest,
+         CHUNK_SIZE, rows, expected);
+  check("flujo", finished && stream.completed == 1, "la última parte no trae \"fin\"");
+  check("flujo", rows == expected, "muestras de más o de menos en las partes");
+
+  // Cancelar y errores inmediatos
+  request(stream, "{\"id\":4,\"desde\":0}", now, reply);
+  request(stream, "{\"id\":4,\"cancelar\":true}", now, reply);
+  check("flujo", !stream.isActive() && stream.canceled == 1, "cancelar no detuvo la consulta");
+  request(stream, "{\"id\":5,\"desde\":10,\"hasta\":5}", now, reply);
+  check("flujo", strstr(reply, "rango") != NULL, "un rango invertido no se rechazó");
+  QueryRequest q;
+  check("flujo", QueryRequestParser::parse((const uint8_t *)"{\"desde\":1}", 11, q) == CONFIG_EMPTY,
+        "una solicitud sin id se aceptó");
+  check("flujo", QueryRequestParser::parse((const uint8_t *)"{\"id\":1,\"desde\":1,\"ventana\":99}", 31, q) == CONFIG_RANGE,
+        "una ventana fuera de rango se aceptó");
+}
+
+// Un nodo de la flota: su serie, su QueryStream y sus tópicos de consulta
+struct FleetNode
+{
+  SeriesRun run;
+  QueryStream stream;
+  char queryTopic[MQTT_NODE_TOPIC_SIZE];
+  char replyTopic[MQTT_NODE_TOPIC_SIZE];
+  uint32_t received = 0;
+
+  FleetNode(const char *directory, uint8_t lastOctet) : run(directory), stream(run.store)
+  {
+    const uint8_t mac[6] = {0x24, 0x0a, 0xc4, 0x5a, 0x10, lastOctet};
+    char clientId[MQTT_CLIENT_ID_SIZE];
+    makeClientId(clientId, sizeof(clientId), mac);
+    makeNodeTopic(queryTopic, sizeof(queryTopic), QUERY_TOPIC, clientId);
+    makeNodeTopic(replyTopic, sizeof(replyTopic), QUERY_REPLY_TOPIC, clientId);
+  }
+};
+
+// Broker mínimo: entrega por tópico exacto a los nodos suscritos y guarda lo que publican
+static void deliver(std::vector<FleetNode *> &nodes, std::map<std::string, std::vector<std::string>> &published,
+                    const std::string &topic, const char *json, uint32_t nowMs)
+{
+  for (FleetNode *node : nodes)
+  {
+    if (topic != node->queryTopic)
+      continue;
+    char reply[64];
+    node->received++;
+    if (request(node->stream, json, nowMs, reply) && reply[0] != '\0')
+      published[node->replyTopic].push_back(reply);
+  }
+}
+
+static void fleet(const char *root)
+{
+  std::string dirA = freshDirectory(root, "flota-a");
+  std::string dirB = freshDirectory(root, "flota-b");
+  FleetNode a(dirA.c_str(), 0x01), b(dirB.c_str(), 0x02);
+  std::vector<FleetNode *> nodes = {&a, &b};
+  std::map<std::string, std::vector<std::string>> published;
+
+  // Mismo día en los dos nodos, el segundo desfasado 2 s para reconocer sus muestras
+  std::mt19937 rng(7);
+  dayOfFiveSeconds(a.run, START_TIME, rng);
+  for (uint32_t t = START_TIME + 2; t < START_TIME + DAY_S; t += 5)
+    b.run.append(sample(t, rng));
+  check("flota", strcmp(a.queryTopic, b.queryTopic) != 0 && strcmp(a.replyTopic, b.replyTopic) != 0,
+        "dos nodos comparten tópico de consulta");
+
+  // El tópico de toda la flota ya no llega a nadie; el mismo id va a cada nodo por el suyo
+  const char *json = "{\"id\":7,\"desde\":1767232800,\"hasta\":1767236400,\"ventana\":2}";
+  deliver(nodes, published, QUERY_TOPIC, json, 0);
+  check("flota", a.received == 0 && b.received == 0, "un nodo recibió una consulta a toda la flota");
+  deliver(nodes, published, a.queryTopic, json, 0);
+  deliver(nodes, published, b.queryTopic, json, 0);
+  check("flota", a.received == 1 && b.received == 1, "una consulta llegó a un nodo que no era el suyo");
+
+  // Las partes de los dos nodos salen intercaladas; el tablero confirma cada una por el tópico del nodo
+  char chunk[CHUNK_SIZE];
+  bool sending = true;
+  while (sending)
+  {
+    sending = false;
+    for (FleetNode *node : nodes)
+    {
+      if (!node->stream.ready(0) || node->stream.nextChunk(chunk, sizeof(chunk)) == 0)
+        continue;
+      sending = true;
+      published[node->replyTopic].push_back(chunk);
+      unsigned long id, part;
+      char ack[48];
+      if (sscanf(chunk, "{\"id\":%lu,\"parte\":%lu", &id, &part) == 2)
+      {
+        snprintf(ack, sizeof(ack), "{\"id\":%lu,\"ack\":%lu}", id, part);
+        deliver(nodes, published, node->queryTopic, ack, 0);
+      }
+    }
+  }
+
+  for (size_t n = 0; n < nodes.size(); n++)
+  {
+    const std::vector<std::string> &parts = published[nodes[n]->replyTopic];
+    size_t rows = 0, foreign = 0;
+    for (const std::string &part : parts)
+    {
+      check("flota", part.find("ocupado") == std::string::npos, "un nodo contestó ocupado");
+      for (const char *p = strstr(part.c_str(), "\"muestras\":["); p != NULL && (p = strstr(p + 1, "[1767")) != NULL;)
+      {
+        rows++;
+        foreign += (strtoul(p + 1, NULL, 10) - START_TIME) % 5 != n * 2;
+      }
+    }
+    size_t expected = nodes[n]->run.expected(1767232800, 1767236400, 0).size();
+    printf("flota    %s: %zu partes, %zu de %zu muestras, %zu ajenas\n", nodes[n]->replyTopic, parts.size(), rows,
+           expected, foreign);
+    check("flota", !parts.empty() && parts.back().find("\"fin\":true") != std::string::npos,
+          "la última parte de un nodo no trae \"fin\"");
+    check("flota", rows == expected && foreign == 0, "las respuestas de dos nodos se mezclaron");
+  }
+  check("flota", published.size() == nodes.size(), "se publicó en un tópico que no es de un nodo");
+}
+
+static void benchQuery(const char *root)
+{
+  std::string dir = freshDirectory(root, "costo");
+  SeriesRun r(dir.c_str());
+  std::mt19937 rng(6);
+  dayOfFiveSeconds(r, START_TIME, rng);
+  dayOfFiveSeconds(r, START_TIME + DAY_S, rng);
+
+  const unsigned rounds = 200;
+  uint32_t before = r.store.blocksRead;
+  size_t rows = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < rounds; i++)
+  {
+    uint32_t from = START_TIME + (i % 24) * 3600;
+    rows += r.query(from, from + 3599).size();
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("consulta de una hora (720 muestras): %.1f us, %.1f lecturas de bloque (%zu)\n",
+         std::chrono::duration<double, std::micro>(end - start).count() / rounds,
+         (double)(r.store.blocksRead - before) / rounds, rows / rounds);
+}
+
+int main(int argc, char **argv)
+{
+  char temporary[] = "/tmp/sirim-serie-XXXXXX";
+  const char *root = mkdtemp(temporary);
+  if (root == NULL)
+  {
+    perror("mkdtemp");
+    return 1;
+  }
+  SD.setRoot(root);
+
+  year(root, argc > 1 ? strtoul(argv[1], NULL, 10) : 300);
+  seek(root);
+  crash(root);
+  setBack(root);
+  flow(root);
+  fleet(root);
+  benchQuery(root);
+
+  std::string command = std::string("rm -rf '") + root + "'";
+  if (system(command.c_str()) != 0)
+    perror("rm");
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+/*
+  Prueba de escritorio de la medición del HC-SR04 (SiRIM/Ultrasonic.h).
+
+  Alimenta EchoCapture con trazas de flancos del pin ECHO, en microsegundos
+  desde el disparo, y recoge el resultado como WaterLevelSensor::service():
+  cada ULTRASONIC_INTERVAL_US toma el pulso terminado o vence la espera, y
+  pasa el ancho a UltrasonicFilter.
+    - limpio      ecos estables se convierten a la distancia correcta
+    - sin eco     sin flancos o con el pin atorado en alto la medición vence
+                  a los ULTRASONIC_TIMEOUT_US y no ensucia la mediana; un
+                  flanco tardío ya no cuenta
+    - rango       pulsos de menos de 2 cm o más de 4 m se descartan y se
+                  cuentan en rejected
+    - mediana     un eco falso (rebote en la pared del tanque) no mueve la
+                  mediana y sale del anillo tras ULTRASONIC_SAMPLES lecturas
+    - mudo        el sensor deja de contestar después de ecos válidos: tras
+                  ULTRASONIC_MAX_MISSES disparos seguidos la mediana y el
+                  porcentaje vuelven a NAN, y regresan con el siguiente eco
+    - porcentaje  calibración del tanque: 17 cm = 0 %, 6 cm = 100 %, con tope
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o sim_ultrasonico sim_ultrasonico.cpp
+  Uso:
+    ./sim_ultrasonico
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "Ultrasonic.h"
+
+#define INTERVAL_US 60000 // ULTRASONIC_INTERVAL_US de WaterLevelSensor.h
+#define BURST_US 450      // El HC-SR04 sube ECHO después de mandar la ráfaga
+#define TOLERANCE_CM 0.05f
+
+static int failures = 0;
+
+static void check(const char *scenario, bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FALLA %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+static bool near(float value, float expected, float tolerance) { return fabsf(value - expected) <= tolerance; }
+
+struct Edge
+{
+  uint32_t atUs; // Desde el disparo
+  bool level;
+};
+
+// Ancho de pulso que produce un objeto a distanceCm
+static uint32_t echoWidth(float distanceCm) { return (uint32_t)lroundf(distanceCm * 2 / SOUND_SPEED_CM_PER_US); }
+
+static std::vector<Edge> echo(float distanceCm)
+{
+  return {{BURST_US, true}, {BURST_US + echoWidth(distanceCm), false}};
+}
+
+// Un ciclo de WaterLevelSensor::service(): dispara, llegan los flancos y se
+// recoge el resultado en la siguiente llamada
+class Rig
+{
+public:
+  EchoCapture capture;
+  UltrasonicFilter filter;
+  uint32_t now = 1000000;
+  uint32_t timeouts = 0;
+  uint32_t pulses = 0;
+
+  void cycle(const std::vector<Edge> &edges)
+  {
+    uint32_t trigger = now;
+    capture.arm(trigger);
+    for (const Edge &edge : edges)
+      capture.onEdge(edge.level, trigger + edge.atUs);
+    now += INTERVAL_US;
+    collect();
+  }
+
+  void collect(void)
+  {
+    uint32_t width;
+    if (capture.takePulse(width))
+    {
+      pulses++;
+      filter.addEcho(width);
+    }
+    else if (capture.expire(now))
+    {
+      timeouts++;
+      filter.addMiss();
+    }
+  }
+};
+
+static void clean(void)
+{
+  Rig rig;
+  const float distances[] = {6.0f, 10.0f, 17.0f, 120.0f, 350.0f};
+  bool exact = true;
+  for (float distance : distances)
+  {
+    rig.filter.clear();
+    for (int i = 0; i < ULTRASONIC_SAMPLES; i++)
+      rig.cycle(echo(distance));
+    float measured = rig.filter.median();
+    printf("limpio       %6.1f cm -> pulso %5u us -> %6.2f cm\n", distance, echoWidth(distance), measured);
+    if (!near(measured, distance, TOLERANCE_CM))
+      exact = false;
+  }
+  check("limpio", exact, "la distancia no corresponde al ancho del pulso");
+  check("limpio", rig.pulses == 5 * ULTRASONIC_SAMPLES && rig.timeouts == 0 && rig.filter.rejected == 0,
+        "se perdió o descartó un eco limpio");
+
+  // Flancos antes de armar o una bajada sin subida no cuentan
+  Rig noisy;
+  noisy.capture.onEdge(true, noisy.now - 100);
+  noisy.cycle({{10, false}, {BURST_US, true}, {BURST_US + echoWidth(10), false}});
+  check("limpio", noisy.pulses == 1 && near(noisy.filter.median(), 10, TOLERANCE_CM),
+        "un flanco suelto cambió el pulso");
+}
+
+static void missing(void)
+{
+  Rig rig;
+  rig.cycle(echo(10));
+
+  // Sin flancos: a los 29.9 ms sigue esperando, a los 30 ms vence
+  uint32_t trigger = rig.now;
+  rig.capture.arm(trigger);
+  rig.now = trigger + ULTRASONIC_TIMEOUT_US - 100;
+  rig.collect();
+  bool waiting = rig.capture.isBusy() && rig.timeouts == 0;
+  rig.now = trigger + ULTRASONIC_TIMEOUT_US;
+  rig.collect();
+  check("sin eco", waiting, "venció antes de ULTRASONIC_TIMEOUT_US");
+  check("sin eco", !rig.capture.isBusy() && rig.timeouts == 1, "no venció sin eco");
+
+  // Un flanco que llega después de vencer no produce pulso
+  rig.capture.onEdge(false, rig.now + 10);
+  uint32_t width;
+  check("sin eco", !rig.capture.takePulse(width), "un flanco tardío produjo un pulso");
+
+  // ECHO atorado en alto: sube y nunca baja
+  rig.now += INTERVAL_US;
+  rig.cycle({{BURST_US, true}});
+  check("sin eco", rig.timeouts == 2, "el pin atorado en alto no venció");
+
+  // La mediana sigue siendo la del único eco bueno
+  printf("sin eco      %u vencidas, %u pulsos, mediana %.2f cm\n", rig.timeouts, rig.pulses, rig.filter.median());
+  check("sin eco", rig.pulses == 1 && near(rig.filter.median(), 10, TOLERANCE_CM),
+        "una medición vencida llegó al filtro");
+}
+
+static void range(void)
+{
+  Rig rig;
+  rig.cycle(echo(1.0f));   // Más cerca que el mínimo del sensor
+  rig.cycle(echo(450.0f)); // Más lejos que el máximo
+  rig.cycle({{BURST_US, true}, {BURST_US + 28000, false}}); // ~476 cm, todavía antes de vencer
+  bool empty = isnan(rig.filter.median());
+  rig.cycle(echo(ULTRASONIC_MIN_CM + 0.1f));
+  rig.cycle(echo(ULTRASONIC_MAX_CM - 1.0f));
+  printf("rango        %u pulsos, %u descartados, mediana %.2f cm\n", rig.pulses, rig.filter.rejected,
+         rig.filter.median());
+  check("rango", empty, "un pulso fuera de rango llegó a la mediana");
+  check("rango", rig.filter.rejected == 3 && rig.pulses == 5, "no se contaron los descartes");
+  check("rango", near(rig.filter.median(), (ULTRASONIC_MIN_CM + 0.1f + ULTRASONIC_MAX_CM - 1.0f) / 2, 0.1f),
+        "los extremos válidos no se promediaron");
+}
+
+static void median(void)
+{
+  Rig rig;
+  const float readings[] = {10.0f, 10.2f, 60.0f, 9.9f, 10.1f};
+  for (float distance : readings)
+    rig.cycle(echo(distance));
+  float filtered = rig.filter.median();
+  float mean = 0;
+  for (float distance : readings)
+    mean += distance / ULTRASONIC_SAMPLES;
+  printf("mediana      con un eco falso de 60 cm: mediana %.2f cm, promedio %.2f cm\n", filtered, mean);
+  check("mediana", near(filtered, 10.1f, TOLERANCE_CM), "el eco falso movió la mediana");
+
+  // Dos ecos falsos de cinco todavía no la mueven
+  rig.cycle(echo(3.0f));
+  check("mediana", near(rig.filter.median(), 10.1f, TOLERANCE_CM), "dos ecos falsos movieron la mediana");
+
+  // Al cambiar el nivel, las lecturas viejas salen del anillo
+  for (int i = 0; i < ULTRASONIC_SAMPLES; i++)
+    rig.cycle(echo(12.0f));
+  check("mediana", near(rig.filter.median(), 12, TOLERANCE_CM), "las lecturas viejas siguen en la mediana");
+
+  // Con un número par de muestras se promedian las dos centrales
+  UltrasonicFilter pair;
+  pair.addDistance(10);
+  pair.addDistance(14);
+  check("mediana", near(pair.median(), 12, 0.001f), "con dos muestras no promedió");
+  check("mediana", isnan(UltrasonicFilter().median()), "sin muestras no devolvió NAN");
+}
+
+static void silent(void)
+{
+  Rig rig;
+  for (int i = 0; i < ULTRASONIC_SAMPLES; i++)
+    rig.cycle(echo(11.5f));
+
+  // Un disparo perdido entre ecos buenos no acumula
+  rig.cycle({});
+  rig.cycle(echo(11.5f));
+  for (int i = 0; i < ULTRASONIC_MAX_MISSES - 1; i++)
+    rig.cycle({});
+  bool held = near(rig.filter.median(), 11.5f, TOLERANCE_CM) && rig.filter.expired == 0;
+
+  // El sensor se calla: al disparo ULTRASONIC_MAX_MISSES seguido se olvida el nivel
+  rig.cycle({});
+  float level = rig.filter.median();
+  printf("mudo         %u vencidas, mediana %.2f cm, %.1f %%, olvidos %u\n", rig.timeouts, level,
+         UltrasonicFilter::tankPercent(level), rig.filter.expired);
+  check("mudo", held, "se olvidó el nivel antes de ULTRASONIC_MAX_MISSES disparos seguidos");
+  check("mudo", isnan(level) && isnan(UltrasonicFilter::tankPercent(level)) && rig.filter.expired == 1,
+        "el nivel quedó congelado con el sensor mudo");
+
+  // Sigue mudo: no se cuentan más olvidos; vuelve con el siguiente eco
+  for (int i = 0; i < 3 * ULTRASONIC_MAX_MISSES; i++)
+    rig.cycle({});
+  check("mudo", rig.filter.expired == 1, "se contó un olvido sin muestras");
+  rig.cycle(echo(9.0f));
+  check("mudo", near(rig.filter.median(), 9, TOLERANCE_CM), "el nivel no volvió con el eco");
+
+  // Sólo ecos fuera de rango también cuenta como sensor mudo
+  for (int i = 0; i < ULTRASONIC_MAX_MISSES; i++)
+    rig.cycle(echo(1.0f));
+  check("mudo", isnan(rig.filter.median()) && rig.filter.expired == 2, "ecos fuera de rango congelaron el nivel");
+}
+
+static void percent(void)
+{
+  struct
+  {
+    float distance;
+    float percent;
+  } table[] = {{TANK_EMPTY_CM, 0}, {TANK_FULL_CM, 100}, {11.5f, 50}, {14.8f, 20}, {25.0f, 0}, {3.0f, 100}};
+  bool mapped = true;
+  for (auto &row : table)
+  {
+    float value = UltrasonicFilter::tankPercent(row.distance);
+    printf("porcentaje   %5.1f cm -> %5.1f %%\n", row.distance, value);
+    if (!near(value, row.percent, 0.01f))
+      mapped = false;
+  }
+  check("porcentaje", mapped, "la calibración 17/6 cm no da 0..100 %");
+  check("porcentaje", isnan(UltrasonicFilter::tankPercent(NAN)), "sin lectura no devolvió NAN");
+
+  // De punta a punta: flancos de un tanque a la mitad
+  Rig rig;
+  for (int i = 0; i < ULTRASONIC_SAMPLES; i++)
+    rig.cycle(echo(11.5f));
+  check("porcentaje", near(UltrasonicFilter::tankPercent(rig.filter.median()), 50, 0.5f),
+        "los flancos de un tanque a la mitad no dan 50 %");
+}
+
+int main(void)
+{
+  clean();
+  missing();
+  range();
+  median();
+  silent();
+  percent();
+
+  printf("%d fallas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,398 @@
+/*
+  Simulador de SiRIM en Linux con reloj virtual.
+
+  Compila el firmware tal cual (SiRIM.ino y sus módulos) contra la capa de
+  abstracción de host/: Arduino.h, FreeRTOS, WiFi, PubSubClient, DHT,
+  RTClib, LiquidCrystal_I2C, Preferences y SD tienen la misma interfaz que en
+  el ESP32, pero sus implementaciones leen un modelo del invernadero
+  (host/SimPlant.h) y un broker simulado (host/SimNetwork.h). Las tareas de
+  FreeRTOS son corrutinas sobre un reloj virtual (host/SimKernel.h), así que
+  se ejecuta el ReadSensorsTask y la decisión de riego reales y meses de
+  operación tardan segundos.
+
+  Modo rápido (por omisión): el bloque del ADC se entrega cada segundo y la
+  luz, el tanque, el socket MQTT y la pantalla se atienden cada segundo en
+  lugar de cada 20-500 ms. El resto de los periodos (muestras, DHT, reporte, respaldo) son
+  los del firmware; en bajo consumo los sensores se asientan 2 s antes de
+  cada muestra para alcanzar dos bloques del ADC. Con -DSIM_TIEMPO_REAL se
+  usan los periodos originales.
+
+  La sección de energía aplica el modelo de PowerManager.h a lo que midió
+  el firmware (tiempo dormido, despierto y con radio) y estima los mA·h por
+  día de otras configuraciones con la duración medida de cada muestra y de
+  cada ventana de radio. Para medir el bajo consumo se activa por MQTT:
+    ./simulador -j '0:{"energia":{"bajoConsumo":true,"muestraSeg":60,"radioCada":10}}'
+
+  La salida estándar es determinista para una semilla y sirve para comparar
+  corridas (regresiones); el tiempo real de la corrida va a stderr.
+
+  Compilar:
+    g++ -std=c++17 -O2 -Ihost -I../SiRIM -o simulador simulador.cpp
+  Con -DFIREBASE_SINK=1 también se envían los lotes a Firebase, a un servidor
+  simulado que contesta 204 a cada PATCH (host/WiFiClientSecure.h).
+  Uso:
+    ./simulador [-d días] [-s semilla] [-r dirSD] [-c hora:min] [-w hora:min]
+                [-j hora:json] [-q hora:json] [-x sd|rtc[:hora]] [-l serial.txt] [-m]
+
+    -c  Corte del broker a partir de la hora indicada (desde el arranque)
+    -w  Corte del WiFi
+    -j  Mensaje publicado en ucol/iot/config a esa hora
+    -q  Consulta publicada en ucol/iot/consulta/<client ID> a esa hora; el cliente
+        simulado confirma cada parte 200 ms después de recibirla
+    -x  Arranca sin microSD o sin RTC; con hora, aparece a esa hora (el
+        firmware la reintenta) y sin hora falta toda la corrida
+    -l  Guarda lo que el firmware imprime por Serial
+    -m  Prueba de memoria: termina con error si el firmware usa el heap
+        después de la primera hora (con -DSTATIC_ALLOCATION=0 se ven las
+        asignaciones del arranque que evita el modo estático)
+
+  Siempre termina con error si las métricas, el diagnóstico, los tiempos de
+  lectura o, con -DFIREBASE_SINK=1, los contadores de Firebase no se
+  publicaron (en corridas de más de dos intervalos), o si el mayor de ellos
+  deja menos de DOCUMENT_HEADROOM bytes libres en su buffer: un documento que
+  no cabe no se publica.
+*/
+
+#ifndef SIM_TIEMPO_REAL
+#define ADC_SERVICE_PERIOD 1000
+#define LIGHT_READ_PERIOD 1000
+#define WATER_READ_PERIOD 1000
+#define MQTT_SERVICE_INTERVAL 1000
+#define LCD_REFRESH_MS 1000
+#define POWER_SETTLE_MS 2000
+#define SIM_ADC_FRAME_US 1000000
+#else
+#define SIM_ADC_FRAME_US 0
+#endif
+
+#include "../SiRIM/SiRIM.ino"
+
+#define DOCUMENT_HEADROOM 64 // Margen para que crezcan los contadores
+#include "SimPlant.h"
+#include <chrono>
+#include <unistd.h>
+
+#define SIM_HOUR_US 3600000000ULL
+
+static bool parseWindow(const char *text, uint64_t &start, uint64_t &end)
+{
+  double hour, minutes;
+  if (sscanf(text, "%lf:%lf", &hour, &minutes) != 2 || hour < 0 || minutes <= 0)
+    return false;
+  start = (uint64_t)(hour * SIM_HOUR_US);
+  end = start + (uint64_t)(minutes * 60e6);
+  return true;
+}
+
+static void loopTask(void *parameters)
+{
+  setup();
+  // loop() está vacío: el trabajo lo hacen las tareas que crea setup()
+  vTaskDelete(NULL);
+}
+
+// Tópico propio del nodo simulado; se calcula como en WifiMqtt::startConnections
+// para poder inyectar mensajes antes de que el firmware arranque
+static std::string nodeTopic(const char *base)
+{
+  uint8_t mac[6];
+  char clientId[MQTT_CLIENT_ID_SIZE], topic[MQTT_NODE_TOPIC_SIZE];
+  WiFi.macAddress(mac);
+  makeClientId(clientId, sizeof(clientId), mac);
+  makeNodeTopic(topic, sizeof(topic), base, clientId);
+  return topic;
+}
+
+// Confirma cada parte de una consulta como lo haría un tablero
+static void acknowledgeQuery(const std::string &topic, const std::string &payload)
+{
+  if (topic != queryReplyTopic)
+    return;
+  unsigned long id, part;
+  if (sscanf(payload.c_str(), "{\"id\":%lu,\"parte\":%lu", &id, &part) != 2)
+    return;
+  char ack[64];
+  snprintf(ack, sizeof(ack), "{\"id\":%lu,\"ack\":%lu}", id, part);
+  simNetwork.inject(simKernel.micros() + 200000, queryTopic, ack);
+}
+
+// Documentos propios del nodo y el buffer en que DualCore.h los arma
+static int checkDocuments(double days)
+{
+  static const struct
+  {
+    const char *topic;
+    uint32_t intervalMs;
+    size_t buffer;
+  } documents[] = {
+      {metricsTopic, METRICS_INTERVAL, MQTT_BUFFER_SIZE - 64},
+      {diagnosticsTopic, DIAGNOSTICS_INTERVAL, MQTT_BUFFER_SIZE - 64},
+      {sensorTimesTopic, SENSOR_TIMES_INTERVAL, MQTT_BUFFER_SIZE - 64},
+#if FIREBASE_SINK
+      {firebaseTopic, METRICS_INTERVAL, 256},
+#endif
+  };
+  int failures = 0;
+  for (const auto &document : documents)
+  {
+    const char *topic = document.topic;
+    size_t limit = document.buffer - 1 - DOCUMENT_HEADROOM; // finish() deja el terminador
+    const SimTopicStats &stats = simNetwork.topics[topic];
+    if (stats.messages == 0 && days * 86400000.0 > 2.0 * document.intervalMs)
+    {
+      fprintf(stderr, "documento: %s no se publicó\n", topic);
+      failures++;
+    }
+    else if (stats.maxBytes > limit)
+    {
+      fprintf(stderr, "documento: %s llegó a %zu bytes (límite %zu)\n", topic, stats.maxBytes, limit);
+      failures++;
+    }
+  }
+  return failures;
+}
+
+static void printReport(double days, SimPlant &plant)
+{
+  printf("== SiRIM simulado: %.2f días ==\n", days);
+
+  // Hitos del arranque (ms desde el encendido) tal como los publicó el nodo
+  printf("\n-- Arranque --\n");
+  for (uint8_t m = 0; m < BOOT_MILESTONES; m++)
+  {
+    BootMilestone milestone = (BootMilestone)m;
+    BootState state = bootTimeline.state(milestone);
+    printf("  %-12s %s", BootTimeline::name(milestone),
+           state == BOOT_DONE ? "" : state == BOOT_FAILED ? "sin respuesta " : "pendiente\n");
+    if (state != BOOT_PENDING)
+      printf("%8lu ms\n", (unsigned long)bootTimeline.atMs(milestone));
+  }
+  printf("muestras sin SD: en RAM %u, descartadas %lu\n%s\n", IrrigationControl::pendingInRAM(),
+         (unsigned long)IrrigationControl::pendingDropped, simNetwork.topics[bootTopic].last.c_str());
+
+  printf("\n-- Núcleo --\n");
+  printf("cambios de contexto %llu, eventos %llu\n", (unsigned long long)simKernel.switches,
+         (unsigned long long)simKernel.eventsFired);
+  for (SimTask *task : simKernel.allTasks())
+    printf("  %-20s activaciones %10llu  pila sin usar %6zu B\n", task->name, (unsigned long long)task->switches,
+           simKernel.stackUnused(task));
+
+  // Después de la primera hora el firmware no debería pedir memoria
+  printf("\n-- Memoria --\n");
+  printf("heap del firmware: %llu asignaciones (%llu B); en régimen: %llu (%llu B) en %llu activaciones\n",
+         (unsigned long long)simHeap.allocations, (unsigned long long)simHeap.bytes,
+         (unsigned long long)simHeap.steadyAllocations, (unsigned long long)simHeap.steadyBytes,
+         (unsigned long long)simKernel.switches);
+  if (simHeap.steadyAllocations > 0)
+    printf("  la primera en régimen: %s, %zu B\n", simHeap.firstSteadyTask, simHeap.firstSteadySize);
+
+  printf("\n-- Planificador de sensores --\n");
+  for (uint8_t i = 0; i < sensorScheduler.size(); i++)
+  {
+    SensorEntry &e = sensorScheduler.entry(i);
+    printf("  %-8s lecturas %9lu  prom %7lu us  max %7lu us  tarde %lu\n", e.name, (unsigned long)e.duration.count,
+           (unsigned long)e.duration.meanUs(), (unsigned long)e.duration.maxUs, (unsigned long)e.deadlineMisses);
+  }
+
+  printf("\n-- Reporte y colas --\n");
+  printf("enviados %lu, suprimidos %lu, latidos %lu, eventos %lu\n", (unsigned long)reportFilter.sent,
+         (unsigned long)reportFilter.suppressed, (unsigned long)reportFilter.heartbeats,
+         (unsigned long)reportFilter.events);
+  // ConfigCores crea primero la cola de MQTT
+  if (!simQueues().empty())
+    printf("cola MQTT: máximo %zu de %zu\n", simQueues()[0]->maxDepth, simQueues()[0]->capacity);
+  printf("respaldo: pendientes %lu, bytes en SD %lu, descartados %lu\n", (unsigned long)backlog.depth,
+         (unsigned long)backlog.spilledBytes, (unsigned long)backlog.droppedMessages);
+  printf("serie: bloques escritos %lu, errores %lu, particiones borradas %lu, fuera de orden %lu\n",
+         (unsigned long)series.blocksWritten, (unsigned long)series.writeErrors,
+         (unsigned long)series.partitionsRemoved, (unsigned long)series.outOfOrder);
+  printf("consultas: iniciadas %lu, completas %lu, canceladas %lu, abandonadas %lu, rechazadas %lu, bloques leídos %lu\n",
+         (unsigned long)queryStream.started, (unsigned long)queryStream.completed,
+         (unsigned long)queryStream.canceled, (unsigned long)queryStream.timeouts,
+         (unsigned long)queryStream.rejected, (unsigned long)series.blocksRead);
+  printf("resúmenes: bloques escritos %lu, errores %lu\n", (unsigned long)rollupLog.blocksWritten,
+         (unsigned long)rollupLog.writeErrors);
+
+  printf("\n-- Red --\n");
+  printf("asociaciones WiFi %llu, conexiones MQTT %llu, publicaciones rechazadas %llu\n",
+         (unsigned long long)WiFi.begins, (unsigned long long)simNetwork.connects,
+         (unsigned long long)simNetwork.rejected);
+  for (const auto &topic : simNetwork.topics)
+    printf("  %-48s mensajes %8llu  bytes %10llu  máx %5zu\n", topic.first.c_str(),
+           (unsigned long long)topic.second.messages, (unsigned long long)topic.second.bytes, topic.second.maxBytes);
+
+  // Último estado publicado por la tarea de actuación (relevadores, latencia, horario)
+  printf("\n-- Riego --\n%s\n", simNetwork.topics[irrigationTopic].last.c_str());
+
+  // Último resumen diario (Rollup.h)
+  printf("\n-- Resumen diario --\n%s\n", simNetwork.topics[rollupDayTopic].last.c_str());
+
+  // Pilas, heap, colas e histogramas de latencia, como los ve el broker
+  printf("\n-- Diagnóstico --\n%s\n", simNetwork.topics[diagnosticsTopic].last.c_str());
+
+#if FIREBASE_SINK
+  // Contadores del lote a Firebase y lo que llegó al servidor simulado (host/WiFiClientSecure.h)
+  printf("\n-- Firebase --\n%s\n", simNetwork.topics[firebaseTopic].last.c_str());
+  printf("peticiones HTTPS %llu, bytes %llu\n", (unsigned long long)WiFiClientSecure::requests,
+         (unsigned long long)WiFiClientSecure::bytesWritten);
+#endif
+
+  printf("\n-- Energía --\n");
+  double hours = powerLedger.elapsedMs / 3.6e6;
+  printf("modo normal %.1f h, dormido %.1f h (%llu veces), radio %.1f h en %lu ventanas (%lu fallidas)\n",
+         powerLedger.normalMs / 3.6e6, powerLedger.sleepMs / 3.6e6, (unsigned long long)powerLedger.sleeps,
+         powerLedger.radioMs / 3.6e6, (unsigned long)powerLedger.windows, (unsigned long)powerLedger.failedWindows);
+  printf("consumo medido %.1f mA·h/día en %.1f h (núcleo: %llu light sleep, %.1f h)\n",
+         powerLedger.mAhPerDay(DEFAULT_POWER_PROFILE), hours, (unsigned long long)simKernel.lightSleeps,
+         simKernel.sleptUs / 3.6e9);
+
+  // Duración medida de una muestra despierta y de una ventana; sin bajo consumo, las típicas
+  double lowPowerMs = (double)(powerLedger.elapsedMs - powerLedger.normalMs);
+  float awakePerSample = powerLedger.samples > 0
+                             ? (float)((lowPowerMs - powerLedger.sleepMs - powerLedger.radioMs) / powerLedger.samples)
+                             : POWER_SETTLE_MS + 50.0f;
+  float radioPerWindow = powerLedger.windows > 0 ? (float)powerLedger.radioMs / powerLedger.windows : 3000.0f;
+  printf("por muestra %.0f ms despierto, por ventana %.0f ms de radio\n", awakePerSample, radioPerWindow);
+  PowerConfig normal = DEFAULT_POWER_CONFIG;
+  printf("  %-22s %6.1f mA·h/día\n", "normal", PowerModel::mAhPerDay(DEFAULT_POWER_PROFILE, normal, 0, 0));
+  static const uint16_t sampleSeconds[] = {30, 60, 300};
+  static const uint8_t radioEvery[] = {1, 5, 10, 30};
+  for (uint16_t seconds : sampleSeconds)
+    for (uint8_t every : radioEvery)
+    {
+      PowerConfig config = {true, seconds, 10, every};
+      char name[32];
+      snprintf(name, sizeof(name), "muestra %us radio x%u", seconds, every);
+      printf("  %-22s %6.1f mA·h/día\n", name,
+             PowerModel::mAhPerDay(DEFAULT_POWER_PROFILE, config, awakePerSample, radioPerWindow));
+    }
+
+  printf("\n-- Periféricos --\n");
+  printf("DHT11 %llu, RTC %llu, ecos %llu (sin respuesta %lu, nivel olvidado %lu), bloques ADC %llu, analogRead %llu\n",
+         (unsigned long long)dht.transactions, (unsigned long long)rtc.reads, (unsigned long long)plant.echoes,
+         (unsigned long)WaterLevelSensor::timeouts, (unsigned long)WaterLevelSensor::expired(),
+         (unsigned long long)simBoard.adcFrames,
+         (unsigned long long)simBoard.analogReads);
+  printf("LCD: comandos %llu, caracteres %llu, bus I2C %llu bytes (%.1f B/s); NVS: escrituras %llu; Serial: %llu bytes\n",
+         (unsigned long long)lcd.commands, (unsigned long long)lcd.characters, (unsigned long long)lcd.busBytes,
+         powerLedger.elapsedMs > 0 ? lcd.busBytes * 1000.0 / powerLedger.elapsedMs : 0.0,
+         (unsigned long long)Preferences::writes, (unsigned long long)Serial.bytesWritten);
+
+  printf("\n-- Planta --\n");
+  printf("suelo final %.1f %% / %.1f %% (mínimo %.1f %%), tanque %.1f L\n", plant.soil[0], plant.soil[1], plant.minSoil,
+         plant.tankLiters);
+  printf("riego %.0f s / %.0f s, agua usada %.1f L, lluvias %lu, rellenados %lu\n", plant.irrigationSeconds[0],
+         plant.irrigationSeconds[1], plant.litersUsed, (unsigned long)plant.rainEvents, (unsigned long)plant.refills);
+}
+
+int main(int argc, char **argv)
+{
+  double days = 30;
+  uint32_t seed = 1;
+  const char *root = NULL;
+  FILE *serialLog = NULL;
+  uint64_t start, end;
+  bool soak = false;
+  int option;
+
+  while ((option = getopt(argc, argv, "d:s:r:c:w:j:q:x:l:m")) != -1)
+  {
+    switch (option)
+    {
+    case 'd':
+      days = atof(optarg);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      root = optarg;
+      break;
+    case 'c':
+    case 'w':
+      if (!parseWindow(optarg, start, end))
+      {
+        fprintf(stderr, "Corte inválido: %s (hora:minutos)\n", optarg);
+        return 2;
+      }
+      simNetwork.outages.push_back(SimOutage{start, end, option == 'w'});
+      break;
+    case 'j':
+    case 'q':
+    {
+      const char *json = strchr(optarg, ':');
+      if (json == NULL)
+      {
+        fprintf(stderr, "Mensaje inválido: %s (hora:json)\n", optarg);
+        return 2;
+      }
+      std::string topic = option == 'j' ? std::string(env.topicRX) : nodeTopic(MQTT_QUERY_TOPIC);
+      simNetwork.inject((uint64_t)(atof(optarg) * SIM_HOUR_US), topic, json + 1);
+      break;
+    }
+    case 'x':
+    {
+      const char *hour = strchr(optarg, ':');
+      uint64_t until = hour != NULL ? (uint64_t)(atof(hour + 1) * SIM_HOUR_US) : UINT64_MAX;
+      if (strncmp(optarg, "sd", 2) == 0 && (optarg[2] == '\0' || optarg[2] == ':'))
+        SD.absentUntilUs = until;
+      else if (strncmp(optarg, "rtc", 3) == 0 && (optarg[3] == '\0' || optarg[3] == ':'))
+        rtc.absentUntilUs = until;
+      else
+      {
+        fprintf(stderr, "Periférico inválido: %s (sd o rtc, con :hora opcional)\n", optarg);
+        return 2;
+      }
+      break;
+    }
+    case 'l':
+      serialLog = fopen(optarg, "w");
+      break;
+    case 'm':
+      soak = true;
+      break;
+    default:
+      fprintf(stderr, "Uso: %s [-d días] [-s semilla] [-r dirSD] [-c hora:min] [-w hora:min] [-j hora:json] [-q hora:json] [-x sd|rtc[:hora]] [-l serial] [-m]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  // La "microSD" es un directorio del anfitrión; por omisión uno temporal
+  char temporary[] = "/tmp/sirim-sd-XXXXXX";
+  if (root == NULL && (root = mkdtemp(temporary)) == NULL)
+  {
+    perror("mkdtemp");
+    return 1;
+  }
+  SD.setRoot(root);
+  Serial.output = serialLog;
+  simNetwork.onPublish = acknowledgeQuery;
+
+  simBoard.rng.seed(seed);
+  simBoard.adcMinFrameUs = SIM_ADC_FRAME_US;
+  SimPlantPins pins = {TRIGGER, ECHO, LDR_PIN, {SOIL_MOISTURE1_PIN, SOIL_MOISTURE2_PIN}, {RELAY1_PIN, RELAY2_PIN}};
+  SimPlant plant(pins, seed);
+  plant.begin();
+
+  simHeap.steadyFromUs = SIM_HOUR_US;
+  simKernel.spawn("loopTask", loopTask, NULL);
+  auto wallStart = std::chrono::steady_clock::now();
+  simKernel.run((uint64_t)(days * 24 * SIM_HOUR_US));
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  printReport(days, plant);
+  fprintf(stderr, "\n%.2f s reales, %.0fx más rápido que el tiempo real (SD en %s)\n", wall,
+          days * 86400 / (wall > 0 ? wall : 1e-9), root);
+
+  if (serialLog != NULL)
+    fclose(serialLog);
+  if (checkDocuments(days) > 0)
+    return 1;
+  if (soak && simHeap.steadyAllocations > 0)
+  {
+    fprintf(stderr, "prueba de memoria: %llu asignaciones en régimen\n", (unsigned long long)simHeap.steadyAllocations);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,217 @@
+/*
+  Herramienta de la telemetría binaria (SiRIM/TelemetryPacket.h).
+
+  TelemetryPacket.h es la biblioteca de decodificación: basta incluirlo en el
+  servicio de ingesta (no depende de Arduino). Esta herramienta:
+
+    prueba        Ida y vuelta codificar/decodificar con valores límite, NAN
+                  y paquetes cortos o de otra versión.
+    bench [n]     Bytes por muestra y muestras por segundo del paquete binario
+                  contra el JSON de TelemetryEncoder.
+    decodificar   Lee mensajes en hexadecimal (uno por línea, como los imprime
+                  mosquitto_sub -F %x) y escribe una línea JSON por muestra;
+                  un lote del modo de bajo consumo trae varios paquetes.
+
+  Compilar:
+    g++ -std=c++17 -O2 -I../SiRIM -o telemetria_binaria telemetria_binaria.cpp
+  Uso:
+    ./telemetria_binaria prueba
+    ./telemetria_binaria bench 1000000
+    mosquitto_sub -t 'ucol/iot/sensores/bin/+' -F %x | ./telemetria_binaria decodificar
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "TelemetryPacket.h"
+#include "TelemetryEncoder.h"
+
+static int failures = 0;
+
+static void check(bool condition, const char *what)
+{
+  if (!condition)
+  {
+    printf("FALLA: %s\n", what);
+    failures++;
+  }
+}
+
+static bool sameFloat(float a, float b, float tolerance)
+{
+  if (isnan(a) || isnan(b))
+    return isnan(a) && isnan(b);
+  return fabsf(a - b) <= tolerance;
+}
+
+static void roundTrip(const SensorsData &in, uint16_t sequence, bool manual, bool irrigating, const char *what)
+{
+  uint8_t packet[TELEMETRY_PACKET_SIZE];
+  TelemetryRecord out;
+  check(TelemetryPacket::encode(in, sequence, manual, irrigating, packet, sizeof(packet)) == TELEMETRY_PACKET_SIZE, what);
+  check(TelemetryPacket::decode(packet, sizeof(packet), out) == TELEMETRY_OK, what);
+  check(out.sequence == sequence && out.manualIrrigation == manual && out.irrigating == irrigating, what);
+  check(out.data.timestamp == in.timestamp, what);
+  check(sameFloat(out.data.temperature, in.temperature, 0.005f), what);
+  check(sameFloat(out.data.humidity, in.humidity, 0.005f), what);
+  check(out.data.soilMoisture1 == in.soilMoisture1 && out.data.soilMoisture2 == in.soilMoisture2, what);
+  check(out.data.lightIntensity == in.lightIntensity, what);
+  check(sameFloat(out.data.waterLevel, in.waterLevel, 0.05f), what);
+  check(out.data.waterPercent == in.waterPercent, what);
+}
+
+static int runTests(void)
+{
+  SensorsData typical = {24.37f, 61.2f, 43, 47, 80, 11.8f, 47, 1718000000};
+  roundTrip(typical, 1, false, false, "muestra típica");
+  roundTrip(typical, 65535, true, true, "banderas y secuencia máxima");
+
+  SensorsData extremes = {-40.0f, 100.0f, 0, 100, 0, 400.0f, 100, 0xFFFFFFFF};
+  roundTrip(extremes, 0, false, true, "valores límite");
+
+  SensorsData missing = {NAN, NAN, 0, 0, 0, NAN, 0, 1718000000};
+  roundTrip(missing, 7, false, false, "sensores sin respuesta");
+
+  // Fuera de rango: satura sin producir el valor reservado
+  SensorsData huge = {1000.0f, -1000.0f, 0, 0, 0, 5000.0f, 0, 0};
+  uint8_t packet[TELEMETRY_PACKET_SIZE + 4];
+  TelemetryRecord out;
+  TelemetryPacket::encode(huge, 0, false, false, packet, sizeof(packet));
+  TelemetryPacket::decode(packet, TELEMETRY_PACKET_SIZE, out);
+  check(sameFloat(out.data.temperature, INT16_MAX / 100.0f, 0.01f), "temperatura saturada");
+  check(sameFloat(out.data.humidity, -INT16_MAX / 100.0f, 0.01f), "humedad saturada");
+  check(sameFloat(out.data.waterLevel, INT16_MAX / 10.0f, 0.1f), "nivel saturado");
+
+  // Campos agregados al final por una versión futura se ignoran
+  check(TelemetryPacket::decode(packet, sizeof(packet), out) == TELEMETRY_OK, "paquete más largo");
+  check(TelemetryPacket::decode(packet, TELEMETRY_PACKET_SIZE - 1, out) == TELEMETRY_TOO_SHORT, "paquete corto");
+  check(TelemetryPacket::encode(typical, 0, false, false, packet, TELEMETRY_PACKET_SIZE - 1) == 0, "buffer chico");
+  packet[0] = TELEMETRY_PACKET_VERSION + 1;
+  check(TelemetryPacket::decode(packet, TELEMETRY_PACKET_SIZE, out) == TELEMETRY_UNKNOWN_VERSION, "otra versión");
+
+  // Un JSON nunca se confunde con un paquete
+  const char *json = "{\"fecha\":\"1/1/2024\",\"hora\":\"0:0:0\",\"temperaturaAmbiente\":20}";
+  check(!TelemetryPacket::isPacket((const uint8_t *)json, strlen(json)), "JSON no es paquete");
+
+  printf("%s\n", failures == 0 ? "Todas las pruebas pasaron" : "Hubo fallas");
+  return failures == 0 ? 0 : 1;
+}
+
+static int runBench(unsigned long iterations)
+{
+  SensorsData data = {24.37f, 61.2f, 43, 47, 80, 11.8f, 47, 1718000000};
+  char json[256];
+  uint8_t packet[TELEMETRY_PACKET_SIZE];
+  size_t jsonBytes = 0;
+  volatile uint32_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    data.timestamp++;
+    size_t length = 0;
+    TelemetryEncoder::encode(data, false, json, sizeof(json), &length);
+    jsonBytes = length;
+    sink += json[length / 2];
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    data.timestamp++;
+    TelemetryPacket::encode(data, (uint16_t)i, false, false, packet, sizeof(packet));
+    sink += packet[5];
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  TelemetryRecord record;
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    packet[4] = (uint8_t)i;
+    TelemetryPacket::decode(packet, sizeof(packet), record);
+    sink += record.data.timestamp;
+  }
+  auto decoded = std::chrono::steady_clock::now();
+
+  double jsonNs = std::chrono::duration<double, std::nano>(middle - start).count() / iterations;
+  double binNs = std::chrono::duration<double, std::nano>(end - middle).count() / iterations;
+  double decodeNs = std::chrono::duration<double, std::nano>(decoded - end).count() / iterations;
+
+  printf("%-22s %6s %12s %14s\n", "formato", "bytes", "ns/muestra", "muestras/s");
+  printf("%-22s %6zu %12.1f %14.0f\n", "JSON (codificar)", jsonBytes, jsonNs, 1e9 / jsonNs);
+  printf("%-22s %6d %12.1f %14.0f\n", "binario (codificar)", TELEMETRY_PACKET_SIZE, binNs, 1e9 / binNs);
+  printf("%-22s %6d %12.1f %14.0f\n", "binario (decodificar)", TELEMETRY_PACKET_SIZE, decodeNs, 1e9 / decodeNs);
+  printf("Reducción de bytes: %.1fx\n", (double)jsonBytes / TELEMETRY_PACKET_SIZE);
+  return sink == 0xFFFFFFFF; // Evita que el compilador elimine los ciclos
+}
+
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static int runDecoder(void)
+{
+  char line[2048];
+  uint8_t message[1024];
+  unsigned long lineNumber = 0;
+  int32_t lastSequence = -1;
+
+  while (fgets(line, sizeof(line), stdin) != NULL)
+  {
+    lineNumber++;
+    size_t length = 0;
+    for (char *p = line; p[0] != '\0' && p[1] != '\0' && length < sizeof(message); p += 2)
+    {
+      int high = hexValue(p[0]);
+      int low = hexValue(p[1]);
+      if (high < 0 || low < 0)
+        break;
+      message[length++] = (uint8_t)(high << 4 | low);
+    }
+
+    // Un paquete suelto o un lote de paquetes seguidos
+    size_t count = TelemetryPacket::batchCount(message, length);
+    for (size_t i = 0; i < (count > 0 ? count : 1); i++)
+    {
+      TelemetryRecord record;
+      TelemetryDecodeStatus status = TelemetryPacket::decode(message + i * TELEMETRY_PACKET_SIZE,
+                                                             count > 1 ? TELEMETRY_PACKET_SIZE : length, record);
+      if (status != TELEMETRY_OK)
+      {
+        fprintf(stderr, "línea %lu: %s\n", lineNumber,
+                status == TELEMETRY_TOO_SHORT ? "paquete corto" : "versión desconocida");
+        break;
+      }
+      if (lastSequence >= 0 && record.sequence != (uint16_t)(lastSequence + 1))
+        fprintf(stderr, "línea %lu: se perdieron %u paquetes\n", lineNumber,
+                (unsigned)(uint16_t)(record.sequence - lastSequence - 1));
+      lastSequence = record.sequence;
+
+      // Mismo documento que publica el nodo en modo JSON
+      char json[256];
+      if (TelemetryEncoder::encode(record.data, record.manualIrrigation, json, sizeof(json)))
+        printf("%s\n", json);
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && strcmp(argv[1], "prueba") == 0)
+    return runTests();
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    return runBench(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000);
+  if (argc > 1 && strcmp(argv[1], "decodificar") == 0)
+    return runDecoder();
+
+  fprintf(stderr, "Uso: %s prueba | bench [n] | decodificar\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,138 @@
+#ifndef AnalogFilter_h
+#define AnalogFilter_h
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+  Filtrado y calibración de las entradas analógicas (humedad de suelo y LDR).
+
+  El ADC entrega bloques ya promediados (sobremuestreo); AnalogChannel
+  descarta picos con la mediana de los últimos 3 bloques y los suaviza con
+  un promedio exponencial en punto fijo, de modo que leer el valor no cuesta
+  más que una suma. CalibrationTable convierte la lectura cruda a porcentaje
+  con una tabla lineal por tramos propia de cada sonda.
+
+  No depende de Arduino para poder probarse en el escritorio con señales
+  sintéticas (Herramientas/sim_adc.cpp).
+*/
+
+#define ADC_OVERSAMPLE 16    // Conversiones por bloque cuando se leen una a una
+#define ADC_EMA_SHIFT 3      // Peso del bloque nuevo: 1/8
+#define ADC_FIXED_SHIFT 4    // Fracción del acumulador (1/16 de cuenta)
+#define CAL_MAX_POINTS 8
+
+struct CalibrationPoint
+{
+  uint16_t raw; // Lectura cruda del ADC (12 bits)
+  float value;  // Valor calibrado (%)
+};
+
+// Se guarda tal cual en NVS; los puntos van ordenados por lectura cruda
+struct CalibrationTable
+{
+  uint8_t count;
+  CalibrationPoint points[CAL_MAX_POINTS];
+
+  bool isValid(void) const
+  {
+    if (count < 2 || count > CAL_MAX_POINTS)
+      return false;
+    for (uint8_t i = 1; i < count; i++)
+      if (points[i].raw <= points[i - 1].raw)
+        return false;
+    return true;
+  }
+
+  // Interpolación lineal entre los puntos vecinos; fuera de la tabla se
+  // satura al primer o último valor
+  float apply(float raw) const
+  {
+    if (isnan(raw))
+      return NAN;
+    if (raw <= points[0].raw)
+      return points[0].value;
+    for (uint8_t i = 1; i < count; i++)
+    {
+      if (raw <= points[i].raw)
+      {
+        const CalibrationPoint &a = points[i - 1];
+        const CalibrationPoint &b = points[i];
+        return a.value + (raw - a.raw) * (b.value - a.value) / (b.raw - a.raw);
+      }
+    }
+    return points[count - 1].value;
+  }
+};
+
+class AnalogChannel
+{
+private:
+  uint16_t recent[3];
+  uint8_t recentCount = 0;
+  uint8_t next = 0;
+  int32_t ema = 0; // Lectura filtrada con ADC_FIXED_SHIFT bits de fracción
+
+  static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+  {
+    if (a > b)
+    {
+      uint16_t t = a;
+      a = b;
+      b = t;
+    }
+    if (b > c)
+      b = c;
+    return a > b ? a : b;
+  }
+
+public:
+  // Bloques recibidos
+  uint32_t blocks = 0;
+
+  // Promedio de un bloque de conversiones
+  void addBlock(uint16_t mean)
+  {
+    recent[next] = mean;
+    next = (next + 1) % 3;
+    if (recentCount < 3)
+      recentCount++;
+
+    uint16_t x = recentCount < 3 ? mean : median3(recent[0], recent[1], recent[2]);
+    int32_t fixed = (int32_t)x << ADC_FIXED_SHIFT;
+    if (blocks == 0)
+      ema = fixed;
+    else
+      ema += (fixed - ema) >> ADC_EMA_SHIFT;
+    blocks++;
+  }
+
+  // Conversiones sueltas, cuando el ADC no promedia por su cuenta
+  void addSamples(const uint16_t *samples, uint8_t n)
+  {
+    if (n == 0)
+      return;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < n; i++)
+      sum += samples[i];
+    addBlock((uint16_t)((sum + n / 2) / n));
+  }
+
+  // Lectura cruda filtrada; NAN si todavía no hay datos
+  float raw(void) const
+  {
+    if (blocks == 0)
+      return NAN;
+    return ema / (float)(1 << ADC_FIXED_SHIFT);
+  }
+
+  void clear(void)
+  {
+    recentCount = 0;
+    next = 0;
+    ema = 0;
+    blocks = 0;
+  }
+};
+
+#endif
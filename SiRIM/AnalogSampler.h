@@ -0,0 +1,165 @@
+#ifndef AnalogSampler_h
+#define AnalogSampler_h
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "AnalogFilter.h"
+
+// Frecuencia total del ADC en modo continuo (el mínimo del ESP32 es 20 kHz)
+#define ADC_SAMPLE_FREQ 20000
+// Conversiones por pin en cada bloque del DMA: 3 pins x 256 a 20 kHz son
+// ~38 ms, más que el periodo con que se llama service()
+#define ADC_FRAME_CONVERSIONS 256
+
+// Con el core 3.x el ADC convierte por DMA y entrega bloques promediados;
+// con versiones anteriores service() hace las conversiones del bloque
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define ADC_CONTINUOUS 1
+#else
+#define ADC_CONTINUOUS 0
+#endif
+
+enum AnalogProbe
+{
+  PROBE_SOIL1,
+  PROBE_SOIL2,
+  PROBE_LIGHT,
+  ANALOG_PROBES
+};
+
+// Muestreo de las sondas analógicas en segundo plano. service() sólo pasa
+// el último bloque del ADC a los filtros; value() entrega el porcentaje
+// calibrado con la tabla de cada sonda, guardada en NVS.
+class AnalogSampler
+{
+private:
+  static uint8_t pins[ANALOG_PROBES];
+  static AnalogChannel channels[ANALOG_PROBES];
+  static CalibrationTable tables[ANALOG_PROBES];
+  static Preferences prefs;
+  static volatile bool frameReady;
+
+  static void ARDUINO_ISR_ATTR onFrame(void);
+  static void loadCalibration(void);
+
+public:
+  // Nombre de cada sonda; también es su clave en NVS
+  static const char *const names[ANALOG_PROBES];
+
+  // Bloques del DMA que se sobrescribieron antes de leerlos (tarea atrasada)
+  static uint32_t overruns;
+
+  static bool begin(uint8_t soil1, uint8_t soil2, uint8_t light);
+  static void service(void);
+  // El DMA del ADC no corre en light sleep; se detiene antes de dormir
+  static void suspend(void);
+  static void resume(void);
+  static float raw(AnalogProbe probe) { return channels[probe].raw(); }
+  static float value(AnalogProbe probe) { return tables[probe].apply(channels[probe].raw()); }
+
+  // Valida la tabla y la guarda en NVS
+  static bool setCalibration(AnalogProbe probe, const CalibrationTable &table);
+  static const CalibrationTable &calibration(AnalogProbe probe) { return tables[probe]; }
+};
+
+uint8_t AnalogSampler::pins[ANALOG_PROBES];
+AnalogChannel AnalogSampler::channels[ANALOG_PROBES];
+CalibrationTable AnalogSampler::tables[ANALOG_PROBES];
+Preferences AnalogSampler::prefs;
+volatile bool AnalogSampler::frameReady = false;
+uint32_t AnalogSampler::overruns = 0;
+const char *const AnalogSampler::names[ANALOG_PROBES] = {"suelo1", "suelo2", "luz"};
+
+// Tablas de fábrica: humedad de suelo con los puntos aire/agua que usaba
+// map(..., 790, 390, 0, 100); LDR en toda la escala de 12 bits
+static const CalibrationTable DEFAULT_SOIL_CALIBRATION = {2, {{390, 100.0f}, {790, 0.0f}}};
+static const CalibrationTable DEFAULT_LIGHT_CALIBRATION = {2, {{0, 0.0f}, {4095, 100.0f}}};
+
+void ARDUINO_ISR_ATTR AnalogSampler ::onFrame(void)
+{
+  if (frameReady)
+    overruns++;
+  frameReady = true;
+}
+
+void AnalogSampler ::loadCalibration(void)
+{
+  prefs.begin("calibracion", false);
+  for (uint8_t i = 0; i < ANALOG_PROBES; i++)
+  {
+    CalibrationTable saved;
+    bool hasSaved = prefs.getBytes(names[i], &saved, sizeof(saved)) == sizeof(saved) && saved.isValid();
+    if (hasSaved)
+      tables[i] = saved;
+    else
+      tables[i] = i == PROBE_LIGHT ? DEFAULT_LIGHT_CALIBRATION : DEFAULT_SOIL_CALIBRATION;
+  }
+}
+
+bool AnalogSampler ::begin(uint8_t soil1, uint8_t soil2, uint8_t light)
+{
+  pins[PROBE_SOIL1] = soil1;
+  pins[PROBE_SOIL2] = soil2;
+  pins[PROBE_LIGHT] = light;
+  loadCalibration();
+
+  analogReadResolution(12);
+#if ADC_CONTINUOUS
+  analogContinuousSetWidth(12);
+  analogContinuousSetAtten(ADC_11db);
+  if (!analogContinuous(pins, ANALOG_PROBES, ADC_FRAME_CONVERSIONS, ADC_SAMPLE_FREQ, &onFrame))
+    return false;
+  return analogContinuousStart();
+#else
+  for (uint8_t i = 0; i < ANALOG_PROBES; i++)
+    pinMode(pins[i], INPUT);
+  return true;
+#endif
+}
+
+void AnalogSampler ::service(void)
+{
+#if ADC_CONTINUOUS
+  // El ADC ya promedió ADC_FRAME_CONVERSIONS conversiones por pin
+  adc_continuous_data_t *result = NULL;
+  if (!frameReady || !analogContinuousRead(&result, 0))
+    return;
+  frameReady = false;
+  for (uint8_t i = 0; i < ANALOG_PROBES; i++)
+    channels[i].addBlock((uint16_t)result[i].avg_read_raw);
+#else
+  uint16_t samples[ADC_OVERSAMPLE];
+  for (uint8_t i = 0; i < ANALOG_PROBES; i++)
+  {
+    for (uint8_t j = 0; j < ADC_OVERSAMPLE; j++)
+      samples[j] = analogRead(pins[i]);
+    channels[i].addSamples(samples, ADC_OVERSAMPLE);
+  }
+#endif
+}
+
+void AnalogSampler ::suspend(void)
+{
+#if ADC_CONTINUOUS
+  analogContinuousStop();
+#endif
+}
+
+void AnalogSampler ::resume(void)
+{
+#if ADC_CONTINUOUS
+  // El bloque que quedó a medias antes de dormir no sirve
+  frameReady = false;
+  analogContinuousStart();
+#endif
+}
+
+bool AnalogSampler ::setCalibration(AnalogProbe probe, const CalibrationTable &table)
+{
+  if (probe >= ANALOG_PROBES || !table.isValid())
+    return false;
+  tables[probe] = table;
+  return prefs.putBytes(names[probe], &table, sizeof(table)) == sizeof(table);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef BootTimeline_h
+#define BootTimeline_h
+
+#include <stdint.h>
+
+/*
+  Hitos del arranque, en milisegundos desde el encendido, sin depender de
+  Arduino.
+
+  Cada etapa corre en la tarea que la necesita (ver DualCore.h): los sensores
+  y los relevadores no esperan a la microSD, al RTC, al LCD ni a la red. Una
+  etapa cuyo periférico no responde se marca como fallida y el nodo sigue
+  degradado; si el periférico aparece después, el hito se marca con esa hora
+  y la falla se quita.
+
+  Cada hito lo escribe una sola tarea, así que no hace falta candado: quien
+  lee a lo más ve un hito un momento tarde.
+*/
+
+enum BootMilestone : uint8_t
+{
+  BOOT_SENSORS,         // Sensores, ADC y relevadores listos
+  BOOT_FIRST_SAMPLE,    // Primera muestra armada
+  BOOT_FIRST_ACTUATION, // Primera instantánea aplicada a los relevadores
+  BOOT_DISPLAY,         // LCD inicializado
+  BOOT_CLOCK,           // RTC encontrado y en marcha
+  BOOT_STORAGE,         // microSD con la serie, el respaldo y los resúmenes abiertos
+  BOOT_ONLINE,          // Primera conexión al broker
+  BOOT_FIRST_PUBLISH,   // Primera muestra aceptada por el broker
+  BOOT_MILESTONES
+};
+
+enum BootState : uint8_t
+{
+  BOOT_PENDING,
+  BOOT_DONE,
+  BOOT_FAILED
+};
+
+class BootTimeline
+{
+private:
+  volatile uint32_t at[BOOT_MILESTONES];
+  volatile BootState states[BOOT_MILESTONES];
+
+public:
+  BootTimeline(void)
+  {
+    for (uint8_t m = 0; m < BOOT_MILESTONES; m++)
+    {
+      at[m] = 0;
+      states[m] = BOOT_PENDING;
+    }
+  }
+
+  // Devuelve true si el hito no estaba cumplido (pendiente o fallido)
+  bool mark(BootMilestone milestone, uint32_t nowMs)
+  {
+    if (states[milestone] == BOOT_DONE)
+      return false;
+    at[milestone] = nowMs;
+    states[milestone] = BOOT_DONE;
+    return true;
+  }
+
+  // Devuelve true sólo la primera vez: los reintentos fallidos no cambian nada
+  bool fail(BootMilestone milestone, uint32_t nowMs)
+  {
+    if (states[milestone] != BOOT_PENDING)
+      return false;
+    at[milestone] = nowMs;
+    states[milestone] = BOOT_FAILED;
+    return true;
+  }
+
+  BootState state(BootMilestone milestone) const { return states[milestone]; }
+  // Hora en que se cumplió o falló
+  uint32_t atMs(BootMilestone milestone) const { return at[milestone]; }
+
+  // Las etapas locales ya terminaron, bien o degradadas; la red puede tardar
+  bool settled(void) const
+  {
+    for (uint8_t m = 0; m < BOOT_ONLINE; m++)
+    {
+      if (states[m] == BOOT_PENDING)
+        return false;
+    }
+    return true;
+  }
+
+  // Cambia cada vez que un hito cambia de estado (dos bits por hito)
+  uint32_t signature(void) const
+  {
+    uint32_t bits = 0;
+    for (uint8_t m = 0; m < BOOT_MILESTONES; m++)
+      bits |= (uint32_t)states[m] << (2 * m);
+    return bits;
+  }
+
+  static const char *name(BootMilestone milestone)
+  {
+    static const char *const names[BOOT_MILESTONES] = {"sensores", "muestra", "actuacion", "pantalla",
+                                                       "reloj",    "sd",      "broker",    "publicacion"};
+    return names[milestone];
+  }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef ButtonDebouncer_h
+#define ButtonDebouncer_h
+
+#include <stdint.h>
+
+/*
+  Antirrebote y gestos de un botón, sin depender de Arduino.
+
+  La interrupción del pin sólo llama a edge() con la hora; poll() se llama
+  desde una tarea cuando vence la espera que devolvió la vez anterior o
+  cuando llega un flanco nuevo. El nivel se acepta cuando lleva
+  BUTTON_DEBOUNCE_MS sin flancos, así que cada botón tiene su propio
+  antirrebote y un pulso de ruido más corto no cuenta como toque.
+
+  Gestos:
+    BUTTON_PRESS   al asentarse la pulsación, sin esperar a soltar
+    BUTTON_LONG    sigue presionado BUTTON_LONG_MS después de PRESS
+    BUTTON_DOUBLE  en lugar de PRESS, si llega antes de BUTTON_DOUBLE_MS
+                   de haber soltado un toque corto
+
+  PRESS sale en cuanto se asienta el nivel para no agregar la ventana del
+  doble toque a cada acción; quien use DOUBLE ya recibió el PRESS del primer
+  toque.
+*/
+
+#define BUTTON_DEBOUNCE_MS 20
+#define BUTTON_LONG_MS 1000
+#define BUTTON_DOUBLE_MS 300
+
+enum ButtonGesture : uint8_t
+{
+  BUTTON_PRESS,
+  BUTTON_LONG,
+  BUTTON_DOUBLE
+};
+
+struct ButtonEvent
+{
+  uint8_t button;
+  ButtonGesture gesture;
+  uint32_t edgeMs; // Primer flanco del toque, para medir la latencia
+};
+
+class ButtonDebouncer
+{
+private:
+  // Escritos por la interrupción
+  volatile uint32_t lastEdgeMs = 0;
+  volatile uint32_t burstStartMs = 0; // Primer flanco después de un periodo quieto
+  volatile uint32_t edges = 0;
+
+  bool stable = false; // Nivel aceptado: presionado
+  uint32_t pressedAt = 0;
+  uint32_t releasedAt = 0;
+  bool longSent = false;
+  bool lastWasPress = false; // El toque vigente salió como PRESS (no DOUBLE)
+  bool doubleArmed = false;  // El siguiente toque puede ser DOUBLE
+  uint32_t seenEdges = 0;    // Flancos ya revisados por poll()
+
+public:
+  // Métricas
+  uint32_t accepted = 0; // Cambios de nivel aceptados
+  uint32_t glitches = 0; // Ráfagas que se asentaron en el mismo nivel (ruido)
+
+  // Nivel del pin al arrancar: un botón presionado no produce un toque
+  void begin(bool pressed) { stable = pressed; }
+
+  // Desde la interrupción, en cada flanco
+  void edge(uint32_t nowMs)
+  {
+    if (edges == 0 || nowMs - lastEdgeMs >= BUTTON_DEBOUNCE_MS)
+      burstStartMs = nowMs;
+    lastEdgeMs = nowMs;
+    edges = edges + 1;
+  }
+
+  uint32_t edgeCount(void) const { return edges; }
+  bool pressed(void) const { return stable; }
+  // Suelto y sin flancos pendientes de revisar: se puede dormir
+  bool idle(void) const { return !stable && seenEdges == edges; }
+
+  // Con el nivel actual del pin. Devuelve true si hay un gesto y deja en
+  // waitMs cuánto falta para la siguiente revisión (0: hasta otro flanco).
+  bool poll(bool level, uint32_t nowMs, ButtonEvent &event, uint32_t &waitMs);
+};
+
+bool ButtonDebouncer ::poll(bool level, uint32_t nowMs, ButtonEvent &event, uint32_t &waitMs)
+{
+  waitMs = 0;
+  uint32_t quiet = nowMs - lastEdgeMs;
+  if (edges > 0 && quiet < BUTTON_DEBOUNCE_MS)
+  {
+    // Todavía rebota
+    waitMs = BUTTON_DEBOUNCE_MS - quiet;
+    return false;
+  }
+
+  uint32_t seen = edges;
+  if (seen != seenEdges && level == stable)
+    glitches++;
+  seenEdges = seen;
+
+  bool emitted = false;
+  if (level != stable)
+  {
+    stable = level;
+    accepted++;
+    if (level)
+    {
+      bool isDouble = doubleArmed && nowMs - releasedAt <= BUTTON_DOUBLE_MS;
+      event.gesture = isDouble ? BUTTON_DOUBLE : BUTTON_PRESS;
+      event.edgeMs = burstStartMs;
+      emitted = true;
+      pressedAt = nowMs;
+      longSent = false;
+      lastWasPress = !isDouble;
+      doubleArmed = false;
+    }
+    else
+    {
+      releasedAt = nowMs;
+      // Después de un toque largo o de un doble, el siguiente vuelve a ser PRESS
+      doubleArmed = lastWasPress && !longSent;
+    }
+  }
+
+  if (stable && !longSent)
+  {
+    uint32_t held = nowMs - pressedAt;
+    if (held < BUTTON_LONG_MS)
+      waitMs = BUTTON_LONG_MS - held;
+    else if (!emitted)
+    {
+      event.gesture = BUTTON_LONG;
+      event.edgeMs = burstStartMs;
+      emitted = true;
+      longSent = true;
+    }
+    else
+      waitMs = 1; // El LONG sale en la siguiente revisión
+  }
+  return emitted;
+}
+
+#endif
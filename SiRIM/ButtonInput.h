@@ -0,0 +1,129 @@
+#ifndef ButtonInput_h
+#define ButtonInput_h
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "ButtonDebouncer.h"
+
+#define BUTTON_COUNT 2
+
+// Botones a tierra con la resistencia interna: presionado es LOW. Cada flanco
+// entra por interrupción y despierta a la tarea que llama a service(); el
+// antirrebote corre en esa tarea con la espera que devuelve service(), así
+// que nadie vuelve a leer los pines en el ciclo principal.
+class ButtonInput
+{
+private:
+  static uint8_t pins[BUTTON_COUNT];
+  static ButtonDebouncer debouncers[BUTTON_COUNT];
+  static SemaphoreHandle_t wake;
+
+  static void IRAM_ATTR onEdge(uint8_t button);
+  static void IRAM_ATTR button0ISR(void) { onEdge(0); }
+  static void IRAM_ATTR button1ISR(void) { onEdge(1); }
+
+public:
+  static void begin(uint8_t pin0, uint8_t pin1, SemaphoreHandle_t semaphore);
+  // Gestos que ya se asentaron; waitMs es cuánto esperar al semáforo antes de
+  // volver a llamar (0: hasta el siguiente flanco)
+  static uint8_t service(ButtonEvent *events, uint8_t max, uint32_t &waitMs);
+  // Antes de light sleep: despertar con un botón suelto que se presione
+  static void armWakeup(void);
+  // Después de light sleep: un flanco durante el sueño no siempre llega a la
+  // interrupción, así que se compara el nivel con el aceptado
+  static void resync(void);
+  // Ningún botón presionado ni rebotando
+  static bool idle(void);
+
+  static const ButtonDebouncer &debouncer(uint8_t button) { return debouncers[button]; }
+};
+
+uint8_t ButtonInput::pins[BUTTON_COUNT] = {0};
+ButtonDebouncer ButtonInput::debouncers[BUTTON_COUNT];
+SemaphoreHandle_t ButtonInput::wake = NULL;
+
+void IRAM_ATTR ButtonInput ::onEdge(uint8_t button)
+{
+  debouncers[button].edge(millis());
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(wake, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void ButtonInput ::begin(uint8_t pin0, uint8_t pin1, SemaphoreHandle_t semaphore)
+{
+  static void (*const handlers[BUTTON_COUNT])(void) = {button0ISR, button1ISR};
+  pins[0] = pin0;
+  pins[1] = pin1;
+  wake = semaphore;
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    pinMode(pins[b], INPUT_PULLUP);
+    debouncers[b].begin(digitalRead(pins[b]) == LOW);
+    attachInterrupt(digitalPinToInterrupt(pins[b]), handlers[b], CHANGE);
+  }
+  esp_sleep_enable_gpio_wakeup();
+}
+
+uint8_t ButtonInput ::service(ButtonEvent *events, uint8_t max, uint32_t &waitMs)
+{
+  uint8_t count = 0;
+  waitMs = 0;
+  uint32_t now = millis();
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    ButtonEvent event;
+    uint32_t wait;
+    if (debouncers[b].poll(digitalRead(pins[b]) == LOW, now, event, wait) && count < max)
+    {
+      event.button = b;
+      events[count++] = event;
+    }
+    if (wait != 0 && (waitMs == 0 || wait < waitMs))
+      waitMs = wait;
+  }
+  return count;
+}
+
+void ButtonInput ::armWakeup(void)
+{
+  if (wake == NULL)
+    return;
+  // Con nivel bajo como disparo, un botón que sigue presionado despertaría al
+  // chip de inmediato: sólo se arman los que están sueltos
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    if (debouncers[b].pressed())
+      gpio_wakeup_disable((gpio_num_t)pins[b]);
+    else
+      gpio_wakeup_enable((gpio_num_t)pins[b], GPIO_INTR_LOW_LEVEL);
+  }
+}
+
+void ButtonInput ::resync(void)
+{
+  if (wake == NULL)
+    return;
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    if ((digitalRead(pins[b]) == LOW) != debouncers[b].pressed())
+    {
+      debouncers[b].edge(millis());
+      xSemaphoreGive(wake);
+    }
+  }
+}
+
+bool ButtonInput ::idle(void)
+{
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    if (!debouncers[b].idle())
+      return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ConfigMailbox_h
+#define ConfigMailbox_h
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/*
+  Buzón de configuración entre núcleos sin candados (seqlock con doble búfer).
+
+  Un solo escritor (la tarea de red, dentro del callback MQTT) y lectores en
+  el otro núcleo. El escritor copia la configuración nueva en la ranura que no
+  está publicada y después incrementa la versión; la ranura vigente es
+  version & 1. El lector copia la ranura vigente y vuelve a leer la versión:
+  si cambió, el escritor pudo haber reutilizado esa ranura a media copia y se
+  reintenta. Como hay dos ranuras, eso sólo pasa si llegan dos publicaciones
+  durante una sola copia.
+
+  Ninguno de los dos espera al otro: publish() nunca se bloquea y la
+  consulta del lector en su ciclo es una sola lectura atómica cuando no hay
+  nada nuevo. T debe poder copiarse con memcpy.
+*/
+
+template <typename T>
+class ConfigMailbox
+{
+private:
+  T slots[2];
+  std::atomic<uint32_t> version{0}; // Publicaciones hechas; 0 = vacío
+  uint32_t seen = 0;                // Última versión entregada al lector
+
+public:
+  // Reintentos del lector por una publicación concurrente; lo lee otra tarea
+  std::atomic<uint32_t> retries{0};
+
+  // Sólo desde la tarea que escribe
+  void publish(const T &value)
+  {
+    uint32_t next = version.load(std::memory_order_relaxed) + 1;
+    // Lado escritor del seqlock: la copia no puede adelantarse a lo anterior
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy((void *)&slots[next & 1], &value, sizeof(T));
+    version.store(next, std::memory_order_release);
+  }
+
+  // Copia consistente de la última publicación (false si nunca hubo una)
+  bool read(T &out, uint32_t *readVersion = NULL)
+  {
+    while (true)
+    {
+      uint32_t before = version.load(std::memory_order_acquire);
+      if (before == 0)
+        return false;
+      memcpy((void *)&out, (const void *)&slots[before & 1], sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (version.load(std::memory_order_relaxed) == before)
+      {
+        if (readVersion != NULL)
+          *readVersion = before;
+        return true;
+      }
+      retries.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Para el ciclo del lector: true sólo si hay una publicación nueva
+  bool take(T &out)
+  {
+    if (version.load(std::memory_order_acquire) == seen)
+      return false;
+    return read(out, &seen);
+  }
+
+  uint32_t publications(void) { return version.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef Connectivity_h
+#define Connectivity_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+  Administrador de conectividad WiFi/MQTT sin bloqueos.
+
+  update() se llama en cada vuelta de la tarea de red y nunca espera: inicia
+  un intento, revisa si terminó o si venció su tiempo límite y programa el
+  siguiente con retroceso exponencial con variación aleatoria, para que un
+  corte del AP o del broker no ponga a todos los nodos a reintentar a la vez.
+
+  Al conectarse guarda el canal y BSSID del AP; el siguiente intento los usa
+  para saltarse el escaneo. Si ese intento rápido falla, se vuelve a escanear.
+
+  La capa de enlace es una interfaz para poder probar la máquina de estados
+  en el escritorio con un enlace simulado.
+*/
+
+#define CONN_WIFI_TIMEOUT 10000  // Tiempo límite de un intento WiFi (ms)
+#define CONN_BACKOFF_BASE 500    // Primer reintento (ms)
+#define CONN_BACKOFF_MAX 60000   // Máxima espera entre reintentos (ms)
+
+// Client ID del broker: prefijo + MAC. Dos nodos con el mismo ID se
+// desconectan uno al otro en cada reconexión.
+#define MQTT_CLIENT_PREFIX "sirim-"
+#define MQTT_CLIENT_ID_SIZE 19 // Prefijo, 12 dígitos hexadecimales y '\0'
+
+// La telemetría de cada nodo va en <tópico base>/<client ID>: el último
+// nivel lo identifica (el JSON y los paquetes no traen identificador)
+#define MQTT_NODE_TOPIC_SIZE 64
+
+enum ConnState
+{
+  CONN_IDLE,
+  CONN_WIFI_CONNECTING,
+  CONN_WIFI_BACKOFF,
+  CONN_MQTT_CONNECTING,
+  CONN_MQTT_BACKOFF,
+  CONN_ONLINE
+};
+
+// Último AP al que se conectó el nodo
+struct ApCache
+{
+  uint8_t bssid[6];
+  int32_t channel;
+  bool valid;
+};
+
+class LinkLayer
+{
+public:
+  virtual ~LinkLayer() {}
+  // channel = 0 y bssid = NULL piden un escaneo completo
+  virtual void wifiBegin(int32_t channel, const uint8_t *bssid) = 0;
+  virtual bool wifiConnected(void) = 0;
+  virtual void wifiDisconnect(void) = 0;
+  virtual bool wifiApInfo(ApCache &ap) = 0;
+  // Un intento de conexión al broker; debe estar acotado por el socket
+  virtual bool mqttConnect(void) = 0;
+  virtual bool mqttConnected(void) = 0;
+  virtual uint32_t random32(void) = 0;
+};
+
+class ConnectivityManager
+{
+private:
+  LinkLayer &link;
+  ConnState current = CONN_IDLE;
+  uint32_t attemptStart = 0;
+  uint32_t nextAttempt = 0;
+  uint8_t wifiFailures = 0;
+  uint8_t mqttFailures = 0;
+  bool usingCache = false;
+  bool cacheDirty = false;
+  ApCache cache;
+
+  uint32_t backoffDelay(uint8_t failures);
+  void startWiFi(uint32_t nowMs);
+  void enter(ConnState next, uint32_t nowMs);
+
+public:
+  // Estadísticas
+  uint32_t wifiConnects = 0;
+  uint32_t mqttConnects = 0;
+  uint32_t lastWiFiConnectMs = 0; // Duración del último intento WiFi exitoso
+  uint32_t onlineSince = 0;
+
+  ConnectivityManager(LinkLayer &linkLayer) : link(linkLayer) { memset(&cache, 0, sizeof(cache)); }
+
+  void begin(const ApCache *savedAp);
+  ConnState update(uint32_t nowMs);
+  ConnState state(void) { return current; }
+  bool isOnline(void) { return current == CONN_ONLINE; }
+
+  // Devuelve true (una sola vez) cuando hay un AP nuevo que conviene guardar
+  bool takeCacheUpdate(ApCache &ap);
+};
+
+void makeClientId(char *buffer, size_t size, const uint8_t mac[6]);
+void makeNodeTopic(char *buffer, size_t size, const char *base, const char *clientId);
+
+void ConnectivityManager ::begin(const ApCache *savedAp)
+{
+  if (savedAp != NULL && savedAp->valid)
+    cache = *savedAp;
+  current = CONN_IDLE;
+  wifiFailures = 0;
+  mqttFailures = 0;
+}
+
+uint32_t ConnectivityManager ::backoffDelay(uint8_t failures)
+{
+  // Mitad fija y mitad aleatoria: base * 2^fallos, con tope
+  uint32_t delay = CONN_BACKOFF_BASE;
+  for (uint8_t i = 1; i < failures && delay < CONN_BACKOFF_MAX; i++)
+    delay *= 2;
+  if (delay > CONN_BACKOFF_MAX)
+    delay = CONN_BACKOFF_MAX;
+  return delay / 2 + link.random32() % (delay / 2 + 1);
+}
+
+void ConnectivityManager ::enter(ConnState next, uint32_t nowMs)
+{
+  current = next;
+  attemptStart = nowMs;
+}
+
+void ConnectivityManager ::startWiFi(uint32_t nowMs)
+{
+  usingCache = cache.valid;
+  if (usingCache)
+    link.wifiBegin(cache.channel, cache.bssid);
+  else
+    link.wifiBegin(0, NULL);
+  enter(CONN_WIFI_CONNECTING, nowMs);
+}
+
+ConnState ConnectivityManager ::update(uint32_t nowMs)
+{
+  switch (current)
+  {
+  case CONN_IDLE:
+    startWiFi(nowMs);
+    break;
+
+  case CONN_WIFI_CONNECTING:
+    if (link.wifiConnected())
+    {
+      wifiConnects++;
+      wifiFailures = 0;
+      lastWiFiConnectMs = nowMs - attemptStart;
+
+      ApCache ap;
+      if (link.wifiApInfo(ap) && (!cache.valid || ap.channel != cache.channel || memcmp(ap.bssid, cache.bssid, 6) != 0))
+      {
+        cache = ap;
+        cache.valid = true;
+        cacheDirty = true;
+      }
+      enter(CONN_MQTT_CONNECTING, nowMs);
+    }
+    else if (nowMs - attemptStart >= CONN_WIFI_TIMEOUT)
+    {
+      link.wifiDisconnect();
+      if (usingCache)
+      {
+        // El AP pudo cambiar de canal; el siguiente intento escanea
+        cache.valid = false;
+        startWiFi(nowMs);
+      }
+      else
+      {
+        wifiFailures++;
+        nextAttempt = nowMs + backoffDelay(wifiFailures);
+        enter(CONN_WIFI_BACKOFF, nowMs);
+      }
+    }
+    break;
+
+  case CONN_WIFI_BACKOFF:
+    if ((int32_t)(nowMs - nextAttempt) >= 0)
+      startWiFi(nowMs);
+    break;
+
+  case CONN_MQTT_CONNECTING:
+    if (!link.wifiConnected())
+    {
+      enter(CONN_WIFI_CONNECTING, nowMs);
+      usingCache = false;
+    }
+    else if (link.mqttConnect())
+    {
+      mqttConnects++;
+      mqttFailures = 0;
+      onlineSince = nowMs;
+      enter(CONN_ONLINE, nowMs);
+    }
+    else
+    {
+      mqttFailures++;
+      nextAttempt = nowMs + backoffDelay(mqttFailures);
+      enter(CONN_MQTT_BACKOFF, nowMs);
+    }
+    break;
+
+  case CONN_MQTT_BACKOFF:
+    if (!link.wifiConnected())
+      enter(CONN_WIFI_CONNECTING, nowMs);
+    else if ((int32_t)(nowMs - nextAttempt) >= 0)
+      enter(CONN_MQTT_CONNECTING, nowMs);
+    break;
+
+  case CONN_ONLINE:
+    if (!link.wifiConnected())
+    {
+      // No se fuerza la desconexión: se espera a que el enlace regrese
+      // dentro del tiempo límite antes de reiniciar el WiFi
+      usingCache = false;
+      enter(CONN_WIFI_CONNECTING, nowMs);
+    }
+    else if (!link.mqttConnected())
+    {
+      mqttFailures = 1;
+      nextAttempt = nowMs + backoffDelay(mqttFailures);
+      enter(CONN_MQTT_BACKOFF, nowMs);
+    }
+    break;
+  }
+  return current;
+}
+
+void makeClientId(char *buffer, size_t size, const uint8_t mac[6])
+{
+  snprintf(buffer, size, MQTT_CLIENT_PREFIX "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+void makeNodeTopic(char *buffer, size_t size, const char *base, const char *clientId)
+{
+  snprintf(buffer, size, "%s/%s", base, clientId);
+}
+
+bool ConnectivityManager ::takeCacheUpdate(ApCache &ap)
+{
+  if (!cacheDirty)
+    return false;
+  cacheDirty = false;
+  ap = cache;
+  return true;
+}
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef Datalog_h
+#define Datalog_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "SensorsData.h"
+
+/*
+  Bitácora binaria por bloques.
+
+  En lugar de abrir, anexar y cerrar /datalog.txt en cada muestra, las lecturas
+  se acumulan en RAM como registros de tamaño fijo y se escriben de 512 en 512
+  bytes (un sector) sobre un archivo preasignado que funciona como anillo.
+
+  Formato de bloque (little endian):
+    0   uint32 magic      DATALOG_MAGIC
+    4   uint32 sequence   Número de bloque, crece de forma monótona
+    8   uint16 count      Registros válidos en el bloque
+    10  uint8  recordSize DATALOG_RECORD_SIZE
+    11  uint8  version    DATALOG_VERSION
+    12  uint32 crc        CRC-32 del bloque completo con este campo en cero
+    16  registros...
+
+  Un corte de energía sólo puede perder el bloque que estaba en RAM o el que se
+  estaba escribiendo; el resto se valida con su CRC al arrancar.
+
+  RecordLog implementa el anillo para cualquier registro de tamaño fijo;
+  Datalog lo usa con las muestras y RollupLog (Rollup.h) con los resúmenes,
+  cada uno con su magic. La serie por día de la SD (SeriesStore.h) usa el
+  mismo bloque de muestras con la secuencia contada dentro de cada día.
+*/
+
+#define DATALOG_BLOCK_SIZE 512
+#define DATALOG_HEADER_SIZE 16
+#define DATALOG_RECORD_SIZE 24
+#define DATALOG_RECORDS_PER_BLOCK ((DATALOG_BLOCK_SIZE - DATALOG_HEADER_SIZE) / DATALOG_RECORD_SIZE)
+#define DATALOG_MAGIC 0x474F4C53UL // "SLOG"
+#define DATALOG_VERSION 1
+
+// Acceso a un archivo preasignado por bloques de DATALOG_BLOCK_SIZE bytes.
+// En el ESP32 lo implementa SDBlockStorage (SDStorage.h); en el escritorio el
+// mismo código corre sobre el SD simulado de Herramientas/host.
+class BlockStorage
+{
+public:
+  virtual ~BlockStorage() {}
+  virtual bool readBlock(uint32_t index, uint8_t *buffer) = 0;
+  virtual bool writeBlock(uint32_t index, const uint8_t *buffer) = 0;
+  virtual uint32_t blockCount(void) = 0;
+};
+
+/*-- Utilidades de codificación --*/
+
+static inline void putU16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void putU32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t getU16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t getU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void putF32(uint8_t *p, float v)
+{
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  putU32(p, bits);
+}
+
+static inline float getF32(const uint8_t *p)
+{
+  uint32_t bits = getU32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// CRC-32 (polinomio 0xEDB88320) con tabla de 16 entradas para no gastar RAM
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length)
+{
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+// Todos los bloques guardan su CRC-32 en el byte 12 del encabezado
+static void storeBlockCrc(uint8_t *buffer)
+{
+  putU32(buffer + 12, 0);
+  putU32(buffer + 12, crc32Update(0, buffer, DATALOG_BLOCK_SIZE));
+}
+
+static bool checkBlockCrc(const uint8_t *buffer)
+{
+  uint8_t header[DATALOG_HEADER_SIZE];
+  memcpy(header, buffer, sizeof(header));
+  putU32(header + 12, 0);
+  uint32_t crc = crc32Update(0, header, sizeof(header));
+  crc = crc32Update(crc, buffer + DATALOG_HEADER_SIZE, DATALOG_BLOCK_SIZE - DATALOG_HEADER_SIZE);
+  return crc == getU32(buffer + 12);
+}
+
+// Anillo de registros de tamaño fijo sobre bloques sellados con CRC
+class RecordLog
+{
+private:
+  BlockStorage &storage;
+  uint32_t magic;
+  uint8_t recordSize;
+  uint8_t version;
+  uint8_t block[DATALOG_BLOCK_SIZE];
+  uint32_t writeIndex = 0; // Bloque del archivo donde se escribirá el buffer
+  uint32_t sequence = 0;   // Secuencia del bloque en RAM
+  uint16_t count = 0;      // Registros en el bloque en RAM
+  bool ready = false;
+
+  bool writeCurrentBlock(void);
+
+public:
+  // Estadísticas de uso
+  uint32_t blocksWritten = 0;
+  uint32_t writeErrors = 0;
+
+  RecordLog(BlockStorage &blockStorage, uint32_t blockMagic, uint8_t size, uint8_t formatVersion)
+      : storage(blockStorage), magic(blockMagic), recordSize(size), version(formatVersion)
+  {
+  }
+
+  // Busca el último bloque válido y continúa a partir de él
+  bool begin(void);
+
+  // Agrega un registro; sólo escribe en el archivo cuando el bloque se llena
+  bool appendRecord(const uint8_t *record);
+
+  // Escribe el bloque parcial (por ejemplo antes de reiniciar)
+  bool flush(void);
+
+  bool isReady(void) { return ready; }
+  uint16_t pendingRecords(void) { return count; }
+  uint16_t recordsPerBlock(void) { return (DATALOG_BLOCK_SIZE - DATALOG_HEADER_SIZE) / recordSize; }
+
+  // Formato de bloques, compartido con el decodificador
+  static void sealBlock(uint8_t *buffer, uint32_t magic, uint8_t recordSize, uint8_t version, uint32_t sequence,
+                        uint16_t count);
+  static bool isValidBlock(const uint8_t *buffer, uint32_t magic, uint8_t recordSize);
+};
+
+class Datalog : public RecordLog
+{
+public:
+  Datalog(BlockStorage &blockStorage) : RecordLog(blockStorage, DATALOG_MAGIC, DATALOG_RECORD_SIZE, DATALOG_VERSION) {}
+
+  // Agrega una muestra; sólo escribe en el archivo cuando el bloque se llena
+  bool append(const SensorsData &data)
+  {
+    uint8_t record[DATALOG_RECORD_SIZE];
+    packRecord(data, record);
+    return appendRecord(record);
+  }
+
+  // Formato de registros y bloques, compartido con el decodificador
+  static void packRecord(const SensorsData &data, uint8_t *out);
+  static void unpackRecord(const uint8_t *in, SensorsData &data);
+  static void sealBlock(uint8_t *buffer, uint32_t sequence, uint16_t count)
+  {
+    RecordLog::sealBlock(buffer, DATALOG_MAGIC, DATALOG_RECORD_SIZE, DATALOG_VERSION, sequence, count);
+  }
+  static bool isValidBlock(const uint8_t *buffer)
+  {
+    return RecordLog::isValidBlock(buffer, DATALOG_MAGIC, DATALOG_RECORD_SIZE);
+  }
+};
+
+bool RecordLog ::begin(void)
+{
+  ready = false;
+  count = 0;
+  uint32_t blocks = storage.blockCount();
+  if (blocks == 0)
+    return false;
+
+  // Se toma el bloque válido con la secuencia más alta; el siguiente es el
+  // punto de escritura. Un bloque roto por un apagón simplemente se sobreescribe.
+  bool found = false;
+  uint32_t lastSequence = 0;
+  uint32_t lastIndex = 0;
+  for (uint32_t i = 0; i < blocks; i++)
+  {
+    if (!storage.readBlock(i, block))
+      return false;
+    if (!isValidBlock(block, magic, recordSize))
+      continue;
+    uint32_t seq = getU32(block + 4);
+    if (!found || seq > lastSequence)
+    {
+      found = true;
+      lastSequence = seq;
+      lastIndex = i;
+    }
+  }
+
+  if (found)
+  {
+    writeIndex = (lastIndex + 1) % blocks;
+    sequence = lastSequence + 1;
+  }
+  else
+  {
+    writeIndex = 0;
+    sequence = 0;
+  }
+
+  memset(block, 0, sizeof(block));
+  ready = true;
+  return true;
+}
+
+bool RecordLog ::appendRecord(const uint8_t *record)
+{
+  if (!ready)
+    return false;
+
+  memcpy(block + DATALOG_HEADER_SIZE + count * recordSize, record, recordSize);
+  count++;
+
+  if (count < recordsPerBlock())
+    return true;
+
+  bool ok = writeCurrentBlock();
+  // El bloque se descarta aunque falle la escritura para no detener el muestreo
+  writeIndex = (writeIndex + 1) % storage.blockCount();
+  sequence++;
+  count = 0;
+  memset(block, 0, sizeof(block));
+  return ok;
+}
+
+bool RecordLog ::flush(void)
+{
+  if (!ready || count == 0)
+    return true;
+
+  // El bloque parcial se vuelve a escribir en la misma posición cuando se llene
+  return writeCurrentBlock();
+}
+
+bool RecordLog ::writeCurrentBlock(void)
+{
+  sealBlock(block, magic, recordSize, version, sequence, count);
+  if (!storage.writeBlock(writeIndex, block))
+  {
+    writeErrors++;
+    return false;
+  }
+  blocksWritten++;
+  return true;
+}
+
+void RecordLog ::sealBlock(uint8_t *buffer, uint32_t magic, uint8_t recordSize, uint8_t version, uint32_t sequence,
+                           uint16_t count)
+{
+  putU32(buffer + 0, magic);
+  putU32(buffer + 4, sequence);
+  putU16(buffer + 8, count);
+  buffer[10] = recordSize;
+  buffer[11] = version;
+  storeBlockCrc(buffer);
+}
+
+bool RecordLog ::isValidBlock(const uint8_t *buffer, uint32_t magic, uint8_t recordSize)
+{
+  if (getU32(buffer) != magic || buffer[10] != recordSize)
+    return false;
+  if (getU16(buffer + 8) > (DATALOG_BLOCK_SIZE - DATALOG_HEADER_SIZE) / recordSize)
+    return false;
+  return checkBlockCrc(buffer);
+}
+
+void Datalog ::packRecord(const SensorsData &data, uint8_t *out)
+{
+  putU32(out + 0, data.timestamp);
+  putF32(out + 4, data.temperature);
+  putF32(out + 8, data.humidity);
+  putF32(out + 12, data.waterLevel);
+  putU16(out + 16, (uint16_t)data.soilMoisture1);
+  putU16(out + 18, (uint16_t)data.soilMoisture2);
+  putU16(out + 20, (uint16_t)data.lightIntensity);
+  putU16(out + 22, (uint16_t)data.waterPercent);
+}
+
+void Datalog ::unpackRecord(const uint8_t *in, SensorsData &data)
+{
+  data.timestamp = getU32(in + 0);
+  data.temperature = getF32(in + 4);
+  data.humidity = getF32(in + 8);
+  data.waterLevel = getF32(in + 12);
+  data.soilMoisture1 = (int16_t)getU16(in + 16);
+  data.soilMoisture2 = (int16_t)getU16(in + 18);
+  data.lightIntensity = (int16_t)getU16(in + 20);
+  data.waterPercent = (int16_t)getU16(in + 22);
+}
+
+#endif
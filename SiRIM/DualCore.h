@@ -3,8 +3,24 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <Preferences.h>
+#include <esp_sleep.h>
 #include "WiFiMQTT.h"
 #include "IrrigationControl.h"
+#include "OutboundBacklog.h"
+#include "Instrumentation.h"
+#include "SensorScheduler.h"
+#include "ReportFilter.h"
+#include "NodeConfig.h"
+#include "ConfigMailbox.h"
+#include "ZoneController.h"
+#include "PowerManager.h"
+#include "Rollup.h"
+#include "RangeQuery.h"
+#include "LcdDisplay.h"
+#include "ButtonInput.h"
+#include "BootTimeline.h"
 
 // Claves de los núcleos
 #define NUCLEO_PRIMARIO 0X01
@@ -13,19 +29,109 @@
 // Definición del intervalo de lectura en milisegundos
 #define SENSOR_READ_INTERVAL 5000  // 5 segundos
 
-struct SensorsData {
-  float temperature;
-  float himidity;
-  float soilMoisture;
-  uint32_t timestamp;
-};
+// Respaldo en la microSD de mensajes que no se pudieron publicar
+#define BACKLOG_PATH "/backlog.bin"
+#define BACKLOG_BLOCKS 1024             // 512 KiB, unos 2000 mensajes
+#define BACKLOG_REPLAY_RATE 5           // Mensajes por segundo al reconectar
+#define BACKLOG_REPLAY_BURST 10
+#define BACKLOG_FLUSH_INTERVAL 30000    // Guardar el bloque en RAM cada 30 s
+#define IRRIGATION_STATUS_INTERVAL 900000 // Latido del estado de los relevadores; los cambios salen al momento
+#define METRICS_INTERVAL 900000          // Respaldo, reporte, configuración y energía cada 15 minutos
+#define DIAGNOSTICS_INTERVAL 1800000     // Pilas, CPU, heap, colas y latencias cada 30 minutos
+#define SENSOR_TIMES_INTERVAL 3600000    // Duración de cada lectura cada hora
+
+// Resúmenes por minuto, hora y día en la microSD (4 por bloque, unos 22 días)
+#define ROLLUP_PATH "/resumen.bin"
+#define ROLLUP_BLOCKS 8192
+
+// Formato de la telemetría: JSON en telemetryTopic, binario en binaryTopic o ambos (WiFiMQTT.h)
+#define TELEMETRY_JSON 0x01
+#define TELEMETRY_BINARY 0x02
+#define TELEMETRY_FORMAT TELEMETRY_JSON
+
+// Cadencia de la tarea de red
+#ifndef MQTT_SERVICE_INTERVAL
+#define MQTT_SERVICE_INTERVAL 10        // Máxima espera en línea antes de atender el socket (ms)
+#endif
+#define MQTT_RECONNECT_INTERVAL 100     // Espera sin conexión; los reintentos los programa Connectivity.h (ms)
+#define MQTT_LOOP_EVERY 8               // Atender el socket cada N publicaciones seguidas
+
+// Pila de cada tarea (bytes); el tópico de diagnóstico reporta lo que sobra
+#define WIFI_TASK_STACK 10000
+#define SENSOR_TASK_STACK 10000
+#define ACTUATION_TASK_STACK 4096
+#define MQTT_QUEUE_LENGTH 10
+
+// Tareas, colas y semáforos en memoria estática (.bss): después del arranque
+// el firmware no pide memoria al heap. Con STATIC_ALLOCATION 0 se crean con
+// las funciones dinámicas de FreeRTOS, como antes.
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION 1
+#endif
+
+// Tarea de actuación: dueña de los relevadores, con prioridad sobre las demás
+#define ACTUATION_TASK_PRIORITY 3
+#define ACTUATION_QUEUE_LENGTH 4
+#define ACTUATION_TICK_MS 250           // Revisar turnos y límites aunque no lleguen lecturas
+
+// Tarea de pantalla: por debajo de todas, sólo escribe lo que cambió en el LCD
+#define DISPLAY_TASK_PRIORITY 0
+#define DISPLAY_TASK_STACK 3072
+
+// Tarea de botones: despierta con cada flanco y en cuanto vence el antirrebote;
+// arriba de sensores y pantalla para que el gesto salga a tiempo
+#define BUTTON_TASK_PRIORITY 2
+#define BUTTON_TASK_STACK 2048
+#define BUTTON_QUEUE_LENGTH 4
+#define BUTTON_PAGE 0 // BTN_PIN1: toque, página siguiente; doble, la primera; largo, modo manual
+#define BUTTON_PUMP 1 // BTN_PIN2: en modo manual, cada toque prende o apaga el riego
+
+// Arranque por etapas: sensores y relevadores en su tarea sin esperar a nadie;
+// RTC y microSD en una tarea que reintenta hasta tenerlos y termina; el LCD
+// en la tarea de pantalla y la red en la suya
+#define BOOT_TASK_PRIORITY 1
+#define BOOT_TASK_STACK 4096
+#define BOOT_RETRY_MS 5000              // Primer reintento de un periférico que no respondió
+#define BOOT_RETRY_MAX_MS 60000         // Los siguientes duplican la espera hasta este tope
+#define BOOT_SAMPLE_SETTLE_MS 1000      // Filtros del ADC y mediana del ultrasónico llenos
 
 struct MQTTMessage {
-    char message[256];  // Ajusta el tamaño según tus necesidades
+    char message[ROLLUP_MESSAGE_SIZE]; // El resumen es el mensaje más largo
+    uint16_t length;    // Bytes del mensaje (el binario no termina en '\0')
+    uint32_t timestamp; // Timestamp (RTC) de la muestra
+    uint32_t enqueuedAt; // micros() al entrar a la cola, para medir la latencia
 };
 
+// Relojes para el planificador de sensores
+uint32_t schedulerMillis( void ){ return millis(); }
+uint32_t schedulerMicros( void ){ return micros(); }
+
 WifiMqtt Wireless;
 IrrigationControl iCtrl;
+SensorScheduler sensorScheduler(schedulerMillis, schedulerMicros);
+ReportFilter reportFilter;
+Preferences reportPrefs;
+SDBlockStorage backlogStorage;
+SpillQueue backlog(backlogStorage);
+ReplayPacer replayPacer(BACKLOG_REPLAY_RATE, BACKLOG_REPLAY_BURST);
+RollupAggregator rollups;
+QueryStream queryStream(series);
+SDBlockStorage rollupStorage;
+RollupLog rollupLog(rollupStorage);
+LcdDisplay lcdDisplay(lcd);
+
+#if FIREBASE_SINK
+// Telemetría a Firebase: la tarea de sensores llena la cola y la de red envía los lotes
+FirebaseBatcher firebaseBatcher;
+TlsHttpStream firebaseStream;
+FirebaseClient firebaseClient(firebaseStream);
+FirebaseRecord firebaseBatch[FIREBASE_BATCH_MAX];
+#endif
+
+// Lote del modo de bajo consumo; en RTC_NOINIT para que un reinicio no lo pierda
+RTC_NOINIT_ATTR SampleBatch sampleBatch;
+PowerLedger powerLedger;
+BootTimeline bootTimeline;
 
 class DualCoreESP32{
   public:
@@ -36,38 +142,271 @@ class DualCoreESP32{
     // Tareas primer núcleo
     TaskHandle_t SendDataTask_t;
     TaskHandle_t ReciveDataTask_t;
-    TaskHandle_t WiFiMQTTTask_t;
+    static TaskHandle_t WiFiMQTTTask_t;
 
     // Tareas segundo núcleo
-    TaskHandle_t ReadSensorsTask_t;
+    static TaskHandle_t ReadSensorsTask_t;
+    static TaskHandle_t ActuationTask_t;
+    static TaskHandle_t DisplayTask_t;
+    static TaskHandle_t ButtonTask_t;
+    static TaskHandle_t BootTask_t;
+
+    // Tiempo activo de cada tarea, para el uso de CPU por tarea y por núcleo
+    static TaskMeter wifiMeter;
+    static TaskMeter sensorsMeter;
+    static TaskMeter actuationMeter;
+    static TaskMeter displayMeter;
+    static TaskMeter buttonMeter;
+
+    // Duración de cada etapa de la muestra y de cada publicación
+    static LatencyHistogram sampleTime;
+    static LatencyHistogram encodeTime;
+    static LatencyHistogram sdWriteTime;
+    static LatencyHistogram publishTime;
+
+    // Nivel máximo de la cola MQTT y envíos que la encontraron llena
+    static volatile uint32_t mqttQueueMax;
+    static volatile uint32_t mqttQueueFull;
 
     // Queues
     static QueueHandle_t mqttQueue;
+    static QueueHandle_t actuationQueue; // Instantáneas de sensores hacia los relevadores
+
+    // Gestos de los botones: a la pantalla las páginas, a la tarea de sensores
+    // lo que cambia el riego
+    static SemaphoreHandle_t buttonWake;
+    static QueueHandle_t displayButtons;
+    static QueueHandle_t controlButtons;
+    static uint32_t buttonsDropped;
+
+    // Configuración vigente (reporte y riego); sólo la modifica la tarea de red
+    // y llega a la tarea de sensores por el buzón, sin candados
+    static NodeConfig nodeConfig;
+    static ConfigMailbox<NodeConfig> configMailbox;
+    static uint32_t configRejected;
+
+    // Latencia desde que llega el mensaje de configuración hasta que se aplica
+    static LatencyStats configLatency;
+
+    // Relevadores; sólo los modifica la tarea de actuación
+    static ZoneController zoneController;
+    static volatile uint8_t relayState;
+    static volatile uint32_t relayChanges;
+    static uint32_t actuationDropped;
+
+    // Latencia desde la lectura del sensor hasta la escritura del relevador
+    static LatencyStats actuationLatency;
+
+    // Respaldo de mensajes (compartido entre ambos núcleos)
+    static SemaphoreHandle_t backlogMutex;
+    static uint32_t lastLiveTimestamp;
+    static uint32_t replayLag;
+
+    // Latencia desde que la muestra entra a la cola hasta que se publica
+    static LatencyStats publishLatency;
+
+    // Bajo consumo: la tarea de sensores pide una ventana de radio; la de red
+    // la cierra al terminar
+    static SemaphoreHandle_t radioRequest;
+    static volatile bool radioActive;
+
+    // Serie de la SD: la tarea de sensores agrega y la de red atiende consultas
+    static SemaphoreHandle_t seriesMutex;
+
+    // Última muestra y modo para la pantalla; la escribe la tarea de sensores
+    static ConfigMailbox<DisplaySnapshot> displayMailbox;
+
+    // Respaldo y resúmenes abiertos; antes no se tocan desde otras tareas
+    static volatile bool storageReady;
+    // La tarea de arranque está usando el SPI o el I2C: no entrar a light sleep
+    static volatile bool booting;
+
+#if FIREBASE_SINK
+    static SemaphoreHandle_t firebaseMutex;
+    static void serveFirebase( void );
+    static void publishFirebaseMetrics( void );
+#endif
+
+    static bool publishPayload( const char *message, uint16_t length );
+    static void publishLive( const MQTTMessage &msg );
+    static void enqueueMessage( MQTTMessage &msg, uint32_t timestamp );
+    static bool backlogPending( void );
+    static void spillMessage( const MQTTMessage &msg );
+    static void replayBacklog( void );
+    static bool publishBatch( void );
+    static void batchSample( bool irrigating );
+    static void rollupSample( const SensorsData &data, const RollupConfig &config, bool lowPower );
+    static void lightSleep( uint32_t ms );
+    static void publishMetrics( void );
+    static void publishDiagnostics( void );
+    static void publishSensorTimes( void );
+    static void publishIrrigationStatus( void );
+    static void onConfigMessage( const uint8_t *payload, unsigned int length );
+    static void onQueryMessage( const uint8_t *payload, unsigned int length );
+    static void serveQuery( void );
+    static void sendSnapshot( uint32_t sampledAt, const uint16_t *turnSeconds );
+    static void sendDisplay( bool backlight );
+    static void onFreshReadings( uint32_t readAt );
+    static bool onControlButton( const ButtonEvent &event );
+    static void bootMark( BootMilestone milestone, bool ok = true );
+    static bool openStorage( void );
+    static void publishBoot( void );
 
     static void WiFiMQTTTask( void * pvParameters );
     static void SendDataTask( void *pvParameters );
     static void ReciveDataTask( void * pvParameters );
     static void ReadSensorsTask( void *pvParameters );
+    static void ActuationTask( void *pvParameters );
+    static void DisplayTask( void *pvParameters );
+    static void ButtonTask( void *pvParameters );
+    static void BootTask( void *pvParameters );
 };
 
+TaskHandle_t DualCoreESP32::WiFiMQTTTask_t = NULL;
+TaskHandle_t DualCoreESP32::ReadSensorsTask_t = NULL;
+TaskHandle_t DualCoreESP32::ActuationTask_t = NULL;
+TaskHandle_t DualCoreESP32::DisplayTask_t = NULL;
+TaskHandle_t DualCoreESP32::ButtonTask_t = NULL;
+TaskHandle_t DualCoreESP32::BootTask_t = NULL;
+TaskMeter DualCoreESP32::wifiMeter;
+TaskMeter DualCoreESP32::sensorsMeter;
+TaskMeter DualCoreESP32::actuationMeter;
+TaskMeter DualCoreESP32::displayMeter;
+TaskMeter DualCoreESP32::buttonMeter;
+LatencyHistogram DualCoreESP32::sampleTime;
+LatencyHistogram DualCoreESP32::encodeTime;
+LatencyHistogram DualCoreESP32::sdWriteTime;
+LatencyHistogram DualCoreESP32::publishTime;
+volatile uint32_t DualCoreESP32::mqttQueueMax = 0;
+volatile uint32_t DualCoreESP32::mqttQueueFull = 0;
+
+#if STATIC_ALLOCATION
+// Pilas (bytes en el ESP32), bloques de control y almacenamiento de las colas
+static StackType_t wifiTaskStack[WIFI_TASK_STACK];
+static StaticTask_t wifiTaskBuffer;
+static StackType_t sensorTaskStack[SENSOR_TASK_STACK];
+static StaticTask_t sensorTaskBuffer;
+static StackType_t actuationTaskStack[ACTUATION_TASK_STACK];
+static StaticTask_t actuationTaskBuffer;
+static StackType_t displayTaskStack[DISPLAY_TASK_STACK];
+static StaticTask_t displayTaskBuffer;
+static StackType_t buttonTaskStack[BUTTON_TASK_STACK];
+static StaticTask_t buttonTaskBuffer;
+static StackType_t bootTaskStack[BOOT_TASK_STACK]; // Queda sin usar cuando la tarea termina
+static StaticTask_t bootTaskBuffer;
+static uint8_t mqttQueueStorage[MQTT_QUEUE_LENGTH * sizeof(MQTTMessage)];
+static StaticQueue_t mqttQueueBuffer;
+static uint8_t actuationQueueStorage[ACTUATION_QUEUE_LENGTH * sizeof(ActuationSnapshot)];
+static StaticQueue_t actuationQueueBuffer;
+static uint8_t displayButtonsStorage[BUTTON_QUEUE_LENGTH * sizeof(ButtonEvent)];
+static StaticQueue_t displayButtonsBuffer;
+static uint8_t controlButtonsStorage[BUTTON_QUEUE_LENGTH * sizeof(ButtonEvent)];
+static StaticQueue_t controlButtonsBuffer;
+static StaticSemaphore_t buttonWakeBuffer;
+static StaticSemaphore_t backlogMutexBuffer;
+static StaticSemaphore_t radioRequestBuffer;
+static StaticSemaphore_t seriesMutexBuffer;
+#if FIREBASE_SINK
+static StaticSemaphore_t firebaseMutexBuffer;
+#endif
+#define TASK_MEMORY(stack, buffer) stack, &buffer
+#else
+#define TASK_MEMORY(stack, buffer) NULL, NULL
+#endif
+
+// Crea la tarea en la memoria que recibe o, sin STATIC_ALLOCATION, en el heap
+static TaskHandle_t startTask( TaskFunction_t code, const char *name, uint32_t stackSize, UBaseType_t priority,
+                               BaseType_t core, StackType_t *stack, StaticTask_t *buffer ){
+#if STATIC_ALLOCATION
+  return xTaskCreateStaticPinnedToCore(code, name, stackSize, NULL, priority, stack, buffer, core);
+#else
+  TaskHandle_t handle = NULL;
+  xTaskCreatePinnedToCore(code, name, stackSize, NULL, priority, &handle, core);
+  return handle;
+#endif
+}
+
 // Inicializar la cola estática
 QueueHandle_t DualCoreESP32::mqttQueue = NULL;
+QueueHandle_t DualCoreESP32::actuationQueue = NULL;
+SemaphoreHandle_t DualCoreESP32::buttonWake = NULL;
+QueueHandle_t DualCoreESP32::displayButtons = NULL;
+QueueHandle_t DualCoreESP32::controlButtons = NULL;
+uint32_t DualCoreESP32::buttonsDropped = 0;
+NodeConfig DualCoreESP32::nodeConfig = {DEFAULT_REPORT_CONFIG, DEFAULT_IRRIGATION_CONFIG, {}, DEFAULT_POWER_CONFIG,
+                                        DEFAULT_ROLLUP_CONFIG, DEFAULT_FIREBASE_CONFIG, 0};
+ConfigMailbox<NodeConfig> DualCoreESP32::configMailbox;
+uint32_t DualCoreESP32::configRejected = 0;
+LatencyStats DualCoreESP32::configLatency;
+ZoneController DualCoreESP32::zoneController;
+volatile uint8_t DualCoreESP32::relayState = 0;
+volatile uint32_t DualCoreESP32::relayChanges = 0;
+uint32_t DualCoreESP32::actuationDropped = 0;
+LatencyStats DualCoreESP32::actuationLatency;
+SemaphoreHandle_t DualCoreESP32::backlogMutex = NULL;
+uint32_t DualCoreESP32::lastLiveTimestamp = 0;
+uint32_t DualCoreESP32::replayLag = 0;
+LatencyStats DualCoreESP32::publishLatency;
+SemaphoreHandle_t DualCoreESP32::radioRequest = NULL;
+volatile bool DualCoreESP32::radioActive = true;
+SemaphoreHandle_t DualCoreESP32::seriesMutex = NULL;
+ConfigMailbox<DisplaySnapshot> DualCoreESP32::displayMailbox;
+volatile bool DualCoreESP32::storageReady = false;
+volatile bool DualCoreESP32::booting = false;
+#if FIREBASE_SINK
+SemaphoreHandle_t DualCoreESP32::firebaseMutex = NULL;
+#endif
 
 void DualCoreESP32 :: ConfigCores( void ){
   // Inicializar colas
-  mqttQueue = xQueueCreate(10, sizeof(MQTTMessage));
+#if STATIC_ALLOCATION
+  mqttQueue = xQueueCreateStatic(MQTT_QUEUE_LENGTH, sizeof(MQTTMessage), mqttQueueStorage, &mqttQueueBuffer);
+  actuationQueue = xQueueCreateStatic(ACTUATION_QUEUE_LENGTH, sizeof(ActuationSnapshot), actuationQueueStorage,
+                                      &actuationQueueBuffer);
+  backlogMutex = xSemaphoreCreateMutexStatic(&backlogMutexBuffer);
+  radioRequest = xSemaphoreCreateBinaryStatic(&radioRequestBuffer);
+  seriesMutex = xSemaphoreCreateMutexStatic(&seriesMutexBuffer);
+  displayButtons = xQueueCreateStatic(BUTTON_QUEUE_LENGTH, sizeof(ButtonEvent), displayButtonsStorage,
+                                      &displayButtonsBuffer);
+  controlButtons = xQueueCreateStatic(BUTTON_QUEUE_LENGTH, sizeof(ButtonEvent), controlButtonsStorage,
+                                      &controlButtonsBuffer);
+  buttonWake = xSemaphoreCreateBinaryStatic(&buttonWakeBuffer);
+#if FIREBASE_SINK
+  firebaseMutex = xSemaphoreCreateMutexStatic(&firebaseMutexBuffer);
+#endif
+#else
+  mqttQueue = xQueueCreate(MQTT_QUEUE_LENGTH, sizeof(MQTTMessage));
+  actuationQueue = xQueueCreate(ACTUATION_QUEUE_LENGTH, sizeof(ActuationSnapshot));
+  backlogMutex = xSemaphoreCreateMutex();
+  radioRequest = xSemaphoreCreateBinary();
+  seriesMutex = xSemaphoreCreateMutex();
+  displayButtons = xQueueCreate(BUTTON_QUEUE_LENGTH, sizeof(ButtonEvent));
+  controlButtons = xQueueCreate(BUTTON_QUEUE_LENGTH, sizeof(ButtonEvent));
+  buttonWake = xSemaphoreCreateBinary();
+#if FIREBASE_SINK
+  firebaseMutex = xSemaphoreCreateMutex();
+#endif
+#endif
 
   Serial.println("Entro a ConfigCores");
 
+  // Muestras de bajo consumo que no alcanzaron a publicarse antes del reinicio
+  uint16_t recovered = sampleBatch.begin();
+  if(recovered > 0){
+    Serial.print("Lote recuperado: ");
+    Serial.print(recovered);
+    Serial.println(" muestras");
+  }
+  powerLedger.begin(millis());
+
   // Conexión a Wifi y MQTT
-  xTaskCreatePinnedToCore(
+  WiFiMQTTTask_t = startTask(
     this->WiFiMQTTTask,
     "WirelessConnections",
-    10000,
-    NULL,
+    WIFI_TASK_STACK,
     1,
-    &WiFiMQTTTask_t,
-    NUCLEO_PRIMARIO
+    NUCLEO_PRIMARIO,
+    TASK_MEMORY(wifiTaskStack, wifiTaskBuffer)
   );
 
   // // Envío de datos al MQTT y guardado en MicroSD
@@ -93,101 +432,1364 @@ void DualCoreESP32 :: ConfigCores( void ){
   // );
 
   // Leer sensores y generar el JSON
-  xTaskCreatePinnedToCore(
+  ReadSensorsTask_t = startTask(
     this->ReadSensorsTask,
     "ReadSensors",
-    10000,
-    NULL,
+    SENSOR_TASK_STACK,
     1,
-    &ReadSensorsTask_t,
-    NUCLEO_SECUNDARIO
+    NUCLEO_SECUNDARIO,
+    TASK_MEMORY(sensorTaskStack, sensorTaskBuffer)
+  );
+
+  // Relevadores: en el mismo núcleo que los sensores y con más prioridad,
+  // así cada instantánea se atiende en cuanto entra a la cola; las
+  // reconexiones del otro núcleo no la detienen
+  ActuationTask_t = startTask(
+    this->ActuationTask,
+    "Actuation",
+    ACTUATION_TASK_STACK,
+    ACTUATION_TASK_PRIORITY,
+    NUCLEO_SECUNDARIO,
+    TASK_MEMORY(actuationTaskStack, actuationTaskBuffer)
+  );
+
+  // Pantalla: con el bus I2C del RTC, sólo corre cuando las demás esperan
+  DisplayTask_t = startTask(
+    this->DisplayTask,
+    "Display",
+    DISPLAY_TASK_STACK,
+    DISPLAY_TASK_PRIORITY,
+    NUCLEO_SECUNDARIO,
+    TASK_MEMORY(displayTaskStack, displayTaskBuffer)
+  );
+
+  // Botones: las interrupciones sólo marcan el flanco y la despiertan
+  ButtonTask_t = startTask(
+    this->ButtonTask,
+    "Buttons",
+    BUTTON_TASK_STACK,
+    BUTTON_TASK_PRIORITY,
+    NUCLEO_SECUNDARIO,
+    TASK_MEMORY(buttonTaskStack, buttonTaskBuffer)
+  );
+
+  // RTC y microSD: en el núcleo de la red para no quitarle tiempo a los
+  // sensores mientras recorre el respaldo
+  BootTask_t = startTask(
+    this->BootTask,
+    "Boot",
+    BOOT_TASK_STACK,
+    BOOT_TASK_PRIORITY,
+    NUCLEO_PRIMARIO,
+    TASK_MEMORY(bootTaskStack, bootTaskBuffer)
   );
 
 }
 
 void DualCoreESP32 :: WiFiMQTTTask( void * pvParameters ){
   Serial.println("Entro a WiFiMQTTTask");
+
+  // Configuración guardada; la tarea de sensores la toma del buzón
+  reportPrefs.begin("reporte", false);
+  ReportConfig savedReport;
+  if(reportPrefs.getBytes("bandas", &savedReport, sizeof(savedReport)) == sizeof(savedReport)){
+    nodeConfig.report = savedReport;
+  }
+  ChangeConfiguration savedIrrigation;
+  if(reportPrefs.getBytes("riego", &savedIrrigation, sizeof(savedIrrigation)) == sizeof(savedIrrigation)){
+    nodeConfig.irrigation = savedIrrigation;
+  }
+  ScheduleTable savedSchedule;
+  if(reportPrefs.getBytes("horario", &savedSchedule, sizeof(savedSchedule)) == sizeof(savedSchedule) &&
+     savedSchedule.valid()){
+    nodeConfig.schedule = savedSchedule;
+  }
+  PowerConfig savedPower;
+  if(reportPrefs.getBytes("energia", &savedPower, sizeof(savedPower)) == sizeof(savedPower)){
+    nodeConfig.power = savedPower;
+  }
+  RollupConfig savedRollup;
+  if(reportPrefs.getBytes("resumen", &savedRollup, sizeof(savedRollup)) == sizeof(savedRollup)){
+    nodeConfig.rollup = savedRollup;
+  }
+  FirebaseConfig savedFirebase;
+  if(reportPrefs.getBytes("firebase", &savedFirebase, sizeof(savedFirebase)) == sizeof(savedFirebase)){
+    nodeConfig.firebase = savedFirebase;
+  }
+  // Una orden de regar no sobrevive a un reinicio
+  nodeConfig.irrigation.setIrrigationStatus = false;
+  nodeConfig.receivedAt = micros();
+  configMailbox.publish(nodeConfig);
+
+  Wireless.setConfigHandler(onConfigMessage);
+  Wireless.setQueryHandler(onQueryMessage);
   Wireless.startConnections();
 
+#if FIREBASE_SINK
+  // La MAC entra en la clave de cada muestra
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  firebaseBatcher.configure(nodeConfig.firebase);
+  firebaseClient.begin(env.firebase_host, FIREBASE_PORT, env.firebase_auth, FIREBASE_PATH, mac);
+#endif
+
   // Buffer para recibir mensajes de la cola
   MQTTMessage receivedMessage;
+  unsigned long lastFlush = 0;
+  unsigned long lastMetrics = 0;
+  unsigned long lastIrrigationStatus = 0;
+  unsigned long lastDiagnostics = 0;
+  unsigned long lastSensorTimes = 0;
+  uint32_t publishedRelayChanges = 0;
 
+  // El arranque cuenta como la primera ventana de radio
+  bool radioOn = true;
+  bool batchSent = false;
+  unsigned long windowStart = millis();
+  unsigned long onlineAt = 0;
+  powerLedger.radioOn(windowStart);
+  uint32_t bootReported = 0;
+
+  wifiMeter.wake(micros());
   while(true){
-    if(!Wireless.isWiFiConnected()){
-      Serial.println("WiFi Desconectado");
-      Wireless.reconnectWiFi();
-    } else{
-      if(!Wireless.isMQTTConnected()){
-        Serial.println("MQTT Desconectado");
-        Wireless.reconnectMQTT();
-      } else {
-        // Verificar si hay mensajes para publicar en la cola
-        if(xQueueReceive(mqttQueue, &receivedMessage, 0) == pdTRUE) {
-            // Publicar el mensaje si hay conexión MQTT
-            Wireless.publishMessage(receivedMessage.message);
+    // Bajo consumo: el radio sigue apagado hasta que la tarea de sensores pide una ventana
+    if(!radioOn){
+      wifiMeter.block(micros());
+      xSemaphoreTake(radioRequest, portMAX_DELAY);
+      wifiMeter.wake(micros());
+      radioOn = true;
+      batchSent = false;
+      windowStart = millis();
+      onlineAt = 0;
+      powerLedger.radioOn(windowStart);
+      Wireless.resumeConnections();
+    }
+
+    // Conexión WiFi/MQTT sin bloqueos: cada vuelta sólo avanza la máquina de estados
+    bool online = Wireless.serviceConnections();
+    if(online && bootTimeline.state(BOOT_ONLINE) == BOOT_PENDING){
+      bootMark(BOOT_ONLINE);
+    }
+
+    // La tarea duerme hasta que llega un mensaje; el tiempo máximo de espera
+    // es la cadencia con la que se atiende el socket (entrantes y keepalive)
+    TickType_t wait = pdMS_TO_TICKS(online ? MQTT_SERVICE_INTERVAL : MQTT_RECONNECT_INTERVAL);
+    wifiMeter.block(micros());
+    bool received = xQueueReceive(mqttQueue, &receivedMessage, wait) == pdTRUE;
+    wifiMeter.wake(micros());
+    if(received){
+      // Vaciar todo lo pendiente en la misma activación
+      uint16_t drained = 0;
+      do {
+        if(online){
+          publishLive(receivedMessage);
+          if(++drained % MQTT_LOOP_EVERY == 0){
+            mqttClient.loop();
+          }
+        } else {
+          // Sin conexión: mover la cola a la SD para que no se llene
+          spillMessage(receivedMessage);
         }
+      } while(xQueueReceive(mqttQueue, &receivedMessage, 0) == pdTRUE);
+    }
+
+    if(online){
+      // Lo que juntó el modo de bajo consumo, también lo que quedó de antes de un
+      // reinicio; espera a que salga el respaldo, que es más antiguo
+      batchSent = !backlogPending() && publishBatch();
+
+      // Reenviar el respaldo a la tasa configurada
+      replayBacklog();
+
+      // Una parte de la consulta en curso si hay crédito y la cola está vacía
+      serveQuery();
+
+#if FIREBASE_SINK
+      // Un lote a Firebase si ya toca; bloquea la tarea mientras dura el PATCH
+      serveFirebase();
+#endif
+
+      // Cada ventana de radio publica métricas y riego en cuanto se conecta
+      bool windowOpened = onlineAt == 0;
+      if(windowOpened){
+        onlineAt = millis();
+      }
+
+      if(millis() - lastMetrics >= METRICS_INTERVAL || windowOpened){
+        lastMetrics = millis();
+        publishMetrics();
+#if FIREBASE_SINK
+        publishFirebaseMetrics();
+#endif
+      }
+
+      // Los cambios de los relevadores se avisan en cuanto ocurren; sin cambios sólo sale el latido
+      if(relayChanges != publishedRelayChanges || millis() - lastIrrigationStatus >= IRRIGATION_STATUS_INTERVAL ||
+         windowOpened){
+        lastIrrigationStatus = millis();
+        publishedRelayChanges = relayChanges;
+        publishIrrigationStatus();
+      }
+
+      // El diagnóstico y los tiempos de lectura no se adelantan en cada ventana
+      if(millis() - lastDiagnostics >= DIAGNOSTICS_INTERVAL){
+        lastDiagnostics = millis();
+        publishDiagnostics();
       }
-    //  Serial.println("Todo bien");
+
+      if(millis() - lastSensorTimes >= SENSOR_TIMES_INTERVAL){
+        lastSensorTimes = millis();
+        publishSensorTimes();
+      }
+
+      // Hitos del arranque cuando las etapas locales terminaron o alguna cambió
+      if(bootTimeline.settled() && bootTimeline.signature() != bootReported){
+        bootReported = bootTimeline.signature();
+        publishBoot();
+      }
+    }
+
+    if(millis() - lastFlush >= BACKLOG_FLUSH_INTERVAL){
+      lastFlush = millis();
+      xSemaphoreTake(backlogMutex, portMAX_DELAY);
+      backlog.flush();
+      xSemaphoreGive(backlogMutex);
     }
+
     mqttClient.loop();
-    vTaskDelay(1000/portTICK_PERIOD_MS);
+
+    // Cerrar la ventana tras escuchar la configuración, o si no hubo conexión
+    if(nodeConfig.power.lowPower){
+      bool listened = online && millis() - onlineAt >= POWER_LISTEN_MS;
+      bool timedOut = !online && millis() - windowStart >= POWER_WINDOW_TIMEOUT_MS;
+      if(listened || timedOut){
+        xSemaphoreTake(backlogMutex, portMAX_DELAY);
+        backlog.flush();
+        xSemaphoreGive(backlogMutex);
+
+#if FIREBASE_SINK
+        firebaseClient.stop();
+#endif
+        Wireless.stopConnections();
+        powerLedger.radioOff(millis(), online && batchSent);
+        radioOn = false;
+        // Una petición que llegó con la ventana abierta ya quedó atendida
+        xSemaphoreTake(radioRequest, 0);
+        radioActive = false;
+      }
+    }
+  }
+}
+
+// El primer byte distingue un paquete binario de un JSON, también en el respaldo
+bool DualCoreESP32 :: publishPayload( const char *message, uint16_t length ){
+  uint32_t start = micros();
+  bool published;
+  if(TelemetryPacket::isPacket((const uint8_t *)message, length)){
+    published = Wireless.publishMessage(binaryTopic, (const uint8_t *)message, length);
+  } else if(uint32_t period = RollupEncoder::periodOf(message, length)){
+    published = Wireless.publishMessage(rollupTopic(period), message);
+  } else {
+    published = Wireless.publishMessage(message);
+  }
+  publishTime.record(micros() - start);
+  // En vivo o desde el respaldo: la primera muestra que sale del nodo
+  if(published && bootTimeline.state(BOOT_FIRST_PUBLISH) != BOOT_DONE){
+    bootMark(BOOT_FIRST_PUBLISH);
+  }
+  return published;
+}
+
+void DualCoreESP32 :: publishLive( const MQTTMessage &msg ){
+  lastLiveTimestamp = msg.timestamp;
+
+  // Mientras quede respaldo lo nuevo se forma detrás, para que todo salga en orden
+  if(backlogPending()){
+    spillMessage(msg);
+    return;
+  }
+
+  // Publicar el mensaje; si falla se respalda para reenviarlo
+  if(publishPayload(msg.message, msg.length)){
+    publishLatency.record(micros() - msg.enqueuedAt);
+  } else {
+    spillMessage(msg);
+  }
+}
+
+bool DualCoreESP32 :: backlogPending( void ){
+  xSemaphoreTake(backlogMutex, portMAX_DELAY);
+  bool pending = backlog.depth > 0;
+  xSemaphoreGive(backlogMutex);
+  return pending;
+}
+
+void DualCoreESP32 :: spillMessage( const MQTTMessage &msg ){
+  xSemaphoreTake(backlogMutex, portMAX_DELAY);
+  if(!backlog.push(msg.message, msg.length, msg.timestamp)){
+    Serial.println("Respaldo no disponible, mensaje descartado");
+  }
+  xSemaphoreGive(backlogMutex);
+}
+
+void DualCoreESP32 :: replayBacklog( void ){
+  MQTTMessage pending;
+
+  while(replayPacer.tryTake(millis())){
+    xSemaphoreTake(backlogMutex, portMAX_DELAY);
+    bool available = backlog.front(pending.message, sizeof(pending.message), &pending.timestamp, &pending.length);
+    xSemaphoreGive(backlogMutex);
+
+    // El mensaje sólo se quita del respaldo cuando el broker lo aceptó
+    if(!available || !publishPayload(pending.message, pending.length)){
+      break;
+    }
+
+    xSemaphoreTake(backlogMutex, portMAX_DELAY);
+    backlog.pop();
+    xSemaphoreGive(backlogMutex);
+
+    replayLag = lastLiveTimestamp > pending.timestamp ? lastLiveTimestamp - pending.timestamp : 0;
+  }
+}
+
+// Publica el lote en mensajes de hasta "lote" paquetes; true si quedó vacío
+bool DualCoreESP32 :: publishBatch( void ){
+  uint8_t payload[POWER_MESSAGE_MAX_SAMPLES * TELEMETRY_PACKET_SIZE];
+
+  while(true){
+    xSemaphoreTake(backlogMutex, portMAX_DELAY);
+    uint16_t samples = sampleBatch.copy(payload, nodeConfig.power.batchSize);
+    xSemaphoreGive(backlogMutex);
+    if(samples == 0){
+      return true;
+    }
+
+    // Las muestras sólo se quitan del lote cuando el broker las aceptó
+    uint32_t start = micros();
+    bool published = Wireless.publishMessage(binaryTopic, payload, samples * TELEMETRY_PACKET_SIZE);
+    publishTime.record(micros() - start);
+    if(!published){
+      return false;
+    }
+    if(bootTimeline.state(BOOT_FIRST_PUBLISH) != BOOT_DONE){
+      bootMark(BOOT_FIRST_PUBLISH);
+    }
+    xSemaphoreTake(backlogMutex, portMAX_DELAY);
+    sampleBatch.drop(samples);
+    xSemaphoreGive(backlogMutex);
+  }
+}
+
+void DualCoreESP32 :: batchSample( bool irrigating ){
+  uint8_t packet[TELEMETRY_PACKET_SIZE];
+  uint32_t start = micros();
+  iCtrl.createPacket(sampleBatch.sequence++, irrigating, packet, sizeof(packet));
+  encodeTime.record(micros() - start);
+
+  bool lost = false;
+  xSemaphoreTake(backlogMutex, portMAX_DELAY);
+  if(sampleBatch.full()){
+    // El radio no ha podido salir: la muestra más antigua pasa a la SD
+    uint8_t oldest[TELEMETRY_PACKET_SIZE];
+    sampleBatch.copy(oldest, 1);
+    lost = !backlog.push((const char *)oldest, sizeof(oldest), getU32(oldest + 4));
+    sampleBatch.drop(1);
+  }
+  sampleBatch.push(packet);
+  xSemaphoreGive(backlogMutex);
+
+  if(lost){
+    Serial.println("Respaldo no disponible, muestra descartada");
+  }
+}
+
+void DualCoreESP32 :: lightSleep( uint32_t ms ){
+  // El DMA del ADC y el UART no siguen en light sleep
+  AnalogSampler::suspend();
+  Serial.flush();
+
+  unsigned long before = millis();
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+  ButtonInput::armWakeup();
+  esp_light_sleep_start();
+  powerLedger.addSleep(millis() - before);
+  ButtonInput::resync();
+
+  AnalogSampler::resume();
+  // Al despertar todas las lecturas tocan, sin contar el sueño como retraso
+  sensorScheduler.restart();
+}
+
+// Guarda en la SD y publica los resúmenes de las ventanas que se cerraron.
+// En bajo consumo el de cada minuto sólo se guarda: tendría una o dos
+// muestras y obligaría a encender el radio.
+void DualCoreESP32 :: rollupSample( const SensorsData &data, const RollupConfig &config, bool lowPower ){
+  uint8_t closed = rollups.add(data);
+  for(uint8_t w = 0; w < ROLLUP_WINDOWS && closed != 0; w++){
+    if(!(closed & (1 << w))){
+      continue;
+    }
+    const Rollup &rollup = rollups.completed(w);
+    if(storageReady){
+      rollupLog.append(rollup);
+    }
+    if(!config.publish[w] || (lowPower && w == ROLLUP_MINUTE)){
+      continue;
+    }
+
+    // Pasa por la cola como la telemetría para usar el respaldo si no hay red
+    MQTTMessage msg;
+    size_t length;
+    if(RollupEncoder::encode(rollup, msg.message, sizeof(msg.message), &length)){
+      msg.length = length;
+      enqueueMessage(msg, rollup.start);
+    } else {
+      Serial.println("Resumen truncado, no se publica");
+    }
   }
 }
 
+void DualCoreESP32 :: enqueueMessage( MQTTMessage &msg, uint32_t timestamp ){
+  msg.timestamp = timestamp;
+  msg.enqueuedAt = micros();
+  if(xQueueSend(mqttQueue, &msg, 0) != pdTRUE){
+    // Cola llena: se respalda en la SD en lugar de perder la muestra
+    mqttQueueFull++;
+    spillMessage(msg);
+  }
+  uint32_t depth = uxQueueMessagesWaiting(mqttQueue);
+  if(depth > mqttQueueMax){
+    mqttQueueMax = depth;
+  }
+}
+
+void DualCoreESP32 :: publishMetrics( void ){
+  char payload[MQTT_BUFFER_SIZE - 64]; // El encabezado MQTT y el tópico caben en el resto
+
+  xSemaphoreTake(backlogMutex, portMAX_DELAY);
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+  w.beginObject("respaldo");
+  w.key("pendientes");
+  w.number(backlog.depth);
+  w.key("bytesSD");
+  w.number(backlog.spilledBytes);
+  w.key("descartados");
+  w.number(backlog.droppedMessages);
+  w.key("retrasoSeg");
+  w.number(backlog.depth > 0 ? replayLag : (uint32_t)0);
+  w.key("tasaReenvio");
+  w.number(replayPacer.rate());
+  w.endObject();
+  xSemaphoreGive(backlogMutex);
+
+  // Latencia cola -> broker de la última ventana
+  w.beginObject("reporte");
+  w.key("enviados");
+  w.number(reportFilter.sent);
+  w.key("suprimidos");
+  w.number(reportFilter.suppressed);
+  w.key("latidos");
+  w.number(reportFilter.heartbeats);
+  w.key("eventos");
+  w.number(reportFilter.events);
+  w.endObject();
+
+  w.beginObject("publicacion");
+  w.key("mensajes");
+  w.number(publishLatency.count);
+  w.key("latenciaPromUs");
+  w.number(publishLatency.meanUs());
+  w.key("latenciaMaxUs");
+  w.number(publishLatency.maxUs);
+  w.endObject();
+
+  // Configuración remota desde el arranque
+  w.beginObject("config");
+  w.key("aplicadas");
+  w.number(configLatency.count);
+  w.key("latenciaPromUs");
+  w.number(configLatency.meanUs());
+  w.key("latenciaMaxUs");
+  w.number(configLatency.maxUs);
+  w.key("reintentos");
+  w.number(configMailbox.retries.load(std::memory_order_relaxed));
+  w.key("rechazadas");
+  w.number(configRejected);
+  w.endObject();
+
+  // Tiempo dormido y con radio desde el arranque, y el consumo que implica
+  w.beginObject("energia");
+  w.key("bajoConsumo");
+  w.boolean(nodeConfig.power.lowPower);
+  w.key("muestras");
+  w.number(powerLedger.samples);
+  w.key("dormidoSeg");
+  w.number((uint32_t)(powerLedger.sleepMs / 1000));
+  w.key("radioSeg");
+  w.number((uint32_t)(powerLedger.radioMs / 1000));
+  w.key("ventanas");
+  w.number(powerLedger.windows);
+  w.key("fallidas");
+  w.number(powerLedger.failedWindows);
+  w.key("lote");
+  w.number((uint32_t)sampleBatch.count);
+  w.key("mAhDia");
+  w.number(powerLedger.mAhPerDay(DEFAULT_POWER_PROFILE), 1);
+  w.endObject();
+
+  w.endObject();
+  publishLatency.reset();
+
+  if(w.finish()){
+    Wireless.publishMessage(metricsTopic, payload);
+  } else {
+    Serial.println("Métricas truncadas");
+  }
+}
+
+#if FIREBASE_SINK
+// Lotes a Firebase desde el arranque; aparte para que las métricas quepan con
+// o sin FIREBASE_SINK
+void DualCoreESP32 :: publishFirebaseMetrics( void ){
+  char payload[256];
+  xSemaphoreTake(firebaseMutex, portMAX_DELAY);
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+  w.key("enviadas");
+  w.number(firebaseBatcher.sent);
+  w.key("lotes");
+  w.number(firebaseBatcher.batches);
+  w.key("fallidos");
+  w.number(firebaseBatcher.failedBatches);
+  w.key("descartadas");
+  w.number(firebaseBatcher.dropped);
+  w.key("pendientes");
+  w.number((uint32_t)firebaseBatcher.pending());
+  w.key("conexiones");
+  w.number(firebaseClient.connections);
+  w.key("bytes");
+  w.number(firebaseClient.bytesSent);
+  w.endObject();
+  xSemaphoreGive(firebaseMutex);
+
+  if(w.finish()){
+    Wireless.publishMessage(firebaseTopic, payload);
+  } else {
+    Serial.println("Métricas de Firebase truncadas");
+  }
+}
+#endif
+
+// Duración de cada lectura desde el arranque y fallas del ultrasónico, aparte
+// de las métricas para no repetirlas en cada mensaje
+void DualCoreESP32 :: publishSensorTimes( void ){
+  char payload[MQTT_BUFFER_SIZE - 64];
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+  for(uint8_t i = 0; i < sensorScheduler.size(); i++){
+    SensorEntry &e = sensorScheduler.entry(i);
+    w.beginObject(e.name);
+    w.key("lecturas");
+    w.number(e.duration.count);
+    w.key("promUs");
+    w.number(e.duration.meanUs());
+    w.key("maxUs");
+    w.number(e.duration.maxUs);
+    w.key("tarde");
+    w.number(e.deadlineMisses);
+    w.endObject();
+  }
+  // Disparos sin eco, ecos fuera de rango y niveles olvidados (ver Ultrasonic.h)
+  w.beginObject("ultrasonico");
+  w.key("sinEco");
+  w.number(WaterLevelSensor::timeouts);
+  w.key("fueraDeRango");
+  w.number(WaterLevelSensor::rejected());
+  w.key("olvidos");
+  w.number(WaterLevelSensor::expired());
+  w.endObject();
+  w.endObject();
+
+  if(w.finish()){
+    Wireless.publishMessage(sensorTimesTopic, payload);
+  } else {
+    Serial.println("Tiempos de lectura truncados");
+  }
+}
+
+// Uso de CPU de una tarea desde el reporte anterior (%)
+static float cpuShare( const TaskMeter &meter, uint32_t &lastBusy, uint32_t window ){
+  uint32_t busy = meter.busyUs;
+  float share = window > 0 ? (busy - lastBusy) * 100.0f / window : 0;
+  lastBusy = busy;
+  return share;
+}
+
+static void writeHistogram( JsonWriter &w, const char *name, LatencyHistogram &h ){
+  w.beginObject(name);
+  w.key("n");
+  w.number(h.count);
+  w.key("promUs");
+  w.number(h.meanUs());
+  w.key("maxUs");
+  w.number(h.maxUs);
+  w.beginArray("h");
+  for(uint8_t i = 0; i < LATENCY_BUCKETS; i++){
+    w.number(h.buckets[i]);
+  }
+  w.endArray();
+  w.endObject();
+}
+
+void DualCoreESP32 :: publishDiagnostics( void ){
+  static uint32_t lastAt = 0;
+
+  struct {
+    const char *name;
+    TaskHandle_t handle;
+    const TaskMeter &meter;
+    uint8_t core;
+  } tasks[] = {
+    {"red", WiFiMQTTTask_t, wifiMeter, NUCLEO_PRIMARIO},
+    {"sensores", ReadSensorsTask_t, sensorsMeter, NUCLEO_SECUNDARIO},
+    {"actuacion", ActuationTask_t, actuationMeter, NUCLEO_SECUNDARIO},
+    {"pantalla", DisplayTask_t, displayMeter, NUCLEO_SECUNDARIO},
+    {"botones", ButtonTask_t, buttonMeter, NUCLEO_SECUNDARIO},
+  };
+  static uint32_t lastBusy[sizeof(tasks) / sizeof(tasks[0])] = {0};
+
+  char payload[MQTT_BUFFER_SIZE - 64];
+  JsonWriter w(payload, sizeof(payload));
+  uint32_t now = micros();
+  uint32_t window = lastAt > 0 ? now - lastAt : 0;
+  lastAt = now;
+  float coreCpu[2] = {0, 0};
+
+  // Pila mínima libre y CPU de cada tarea desde el reporte anterior; el núcleo
+  // y el tamaño de la pila son fijos (*_TASK_STACK) y no se repiten
+  w.beginObject();
+  w.beginObject("tareas");
+  for(uint8_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++){
+    float cpu = cpuShare(tasks[i].meter, lastBusy[i], window);
+    coreCpu[tasks[i].core] += cpu;
+    w.beginObject(tasks[i].name);
+    w.key("pilaLibre");
+    w.number((uint32_t)(tasks[i].handle != NULL ? uxTaskGetStackHighWaterMark(tasks[i].handle) : 0));
+    w.key("cpu");
+    w.number(cpu);
+    w.endObject();
+  }
+  w.endObject();
+  w.beginArray("cpuNucleo");
+  w.number(coreCpu[0]);
+  w.number(coreCpu[1]);
+  w.endArray();
+
+  // Fragmentación: qué tanto del heap libre no cabe en el bloque más grande
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largest = ESP.getMaxAllocHeap();
+  w.beginObject("heap");
+  w.key("libre");
+  w.number(freeHeap);
+  w.key("minimo");
+  w.number(ESP.getMinFreeHeap());
+  w.key("bloqueMax");
+  w.number(largest);
+  w.key("fragmentacion");
+  w.number((uint32_t)(freeHeap > 0 && largest < freeHeap ? 100 - (uint64_t)largest * 100 / freeHeap : 0));
+  w.endObject();
+
+  w.beginObject("colas");
+  w.beginObject("mqtt");
+  w.key("nivel");
+  w.number((uint32_t)uxQueueMessagesWaiting(mqttQueue));
+  w.key("max");
+  w.number(mqttQueueMax);
+  w.key("llena");
+  w.number(mqttQueueFull);
+  w.endObject();
+  w.beginObject("actuacion");
+  w.key("nivel");
+  w.number((uint32_t)uxQueueMessagesWaiting(actuationQueue));
+  w.key("descartadas");
+  w.number(actuationDropped);
+  w.endObject();
+  w.endObject();
+
+  // Escrituras al LCD desde el arranque y el tráfico I2C que implican
+  const LcdFrame &frame = lcdDisplay.framebuffer();
+  w.beginObject("lcd");
+  w.key("pasadas");
+  w.number(frame.flushes);
+  w.key("escrituras");
+  w.number(frame.writes);
+  w.key("bytesI2C");
+  w.number(frame.writes * LCD_I2C_BYTES);
+  w.endObject();
+
+  // Ráfagas de ruido que el antirrebote descartó y gestos que no cupieron en las colas
+  w.beginObject("botones");
+  w.key("ruido");
+  w.number(ButtonInput::debouncer(BUTTON_PAGE).glitches + ButtonInput::debouncer(BUTTON_PUMP).glitches);
+  w.key("descartados");
+  w.number(buttonsDropped);
+  w.endObject();
+
+  // Histogramas desde el arranque; bordesUs son los límites de las cubetas
+  w.beginArray("bordesUs");
+  for(uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++){
+    w.number(LATENCY_BUCKET_EDGES_US[i]);
+  }
+  w.endArray();
+  w.beginObject("latencias");
+  writeHistogram(w, "muestra", sampleTime);
+  writeHistogram(w, "codificar", encodeTime);
+  writeHistogram(w, "sd", sdWriteTime);
+  writeHistogram(w, "publicar", publishTime);
+  w.endObject();
+  w.endObject();
+
+  if(w.finish()){
+    Wireless.publishMessage(diagnosticsTopic, payload);
+  } else {
+    Serial.println("Diagnóstico truncado");
+  }
+}
+
+// Milisegundos desde el encendido hasta cada hito cumplido; las etapas sin
+// respuesta van en "fallas" con lo que espera en RAM por falta de SD
+void DualCoreESP32 :: publishBoot( void ){
+  char payload[256];
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+  w.beginObject("ms");
+  for(uint8_t m = 0; m < BOOT_MILESTONES; m++){
+    if(bootTimeline.state((BootMilestone)m) == BOOT_DONE){
+      w.key(BootTimeline::name((BootMilestone)m));
+      w.number(bootTimeline.atMs((BootMilestone)m));
+    }
+  }
+  w.endObject();
+  w.beginArray("fallas");
+  for(uint8_t m = 0; m < BOOT_MILESTONES; m++){
+    if(bootTimeline.state((BootMilestone)m) == BOOT_FAILED){
+      w.string(BootTimeline::name((BootMilestone)m));
+    }
+  }
+  w.endArray();
+  w.key("muestrasEnRAM");
+  w.number((uint32_t)IrrigationControl::pendingInRAM());
+  w.key("descartadas");
+  w.number(IrrigationControl::pendingDropped);
+  w.endObject();
+
+  if(w.finish()){
+    Wireless.publishMessage(bootTopic, payload);
+  }
+}
+
+void DualCoreESP32 :: publishIrrigationStatus( void ){
+  char payload[512];
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+
+  // Estado de cada zona; lo escribe la tarea de actuación, aquí sólo se lee
+  char name[8] = "zona1";
+  for(uint8_t z = 0; z < SCHEDULE_ZONES; z++){
+    const ZoneState &zone = zoneController.zone(z);
+    name[4] = '1' + z;
+    w.beginObject(name);
+    w.key("encendida");
+    w.boolean((relayState >> z) & 1);
+    w.key("causa");
+    w.string(ZoneController::describe(zone.cause));
+    w.key("encendidos");
+    w.number(zone.starts);
+    w.key("minutos");
+    w.number(zone.onMs / 60000);
+    w.endObject();
+  }
+
+  w.key("tanqueBajo");
+  w.boolean(zoneController.isTankLow());
+  w.key("bloqueosTanque");
+  w.number(zoneController.interlockTrips);
+  w.key("cortesMaximo");
+  w.number(zoneController.maxRunCutoffs);
+  w.key("sinLecturas");
+  w.number(zoneController.staleCutoffs);
+
+  // Lectura del sensor -> relevador, desde el arranque
+  w.key("latenciaPromUs");
+  w.number(actuationLatency.meanUs());
+  w.key("latenciaMaxUs");
+  w.number(actuationLatency.maxUs);
+  w.key("descartadas");
+  w.number(actuationDropped);
+
+  const ScheduleEngine &schedule = iCtrl.irrigationSchedule();
+  uint32_t nextTurn = schedule.nextDue();
+  w.beginObject("horario");
+  w.key("turnos");
+  w.number(schedule.fired);
+  w.key("atrasados");
+  w.number(schedule.late);
+  w.key("omitidos");
+  w.number(schedule.skipped);
+  w.key("saltosReloj");
+  w.number(schedule.clockJumps);
+  w.key("siguiente");
+  w.number(nextTurn == SCHEDULE_NONE ? (uint32_t)0 : nextTurn);
+  w.endObject();
+  w.endObject();
+
+  if(w.finish()){
+    Wireless.publishMessage(irrigationTopic, payload);
+  }
+}
+
+// Mensaje en ucol/iot/config; se ejecuta dentro de mqttClient.loop()
+void DualCoreESP32 :: onConfigMessage( const uint8_t *payload, unsigned int length ){
+  // Se valida en el búfer de PubSubClient; si algo no cuadra no cambia nada
+  NodeConfig next = nodeConfig;
+  ConfigStatus status = NodeConfigParser::parse(payload, length, next, SENSOR_READ_INTERVAL);
+  if(status != CONFIG_OK){
+    configRejected++;
+    Serial.print("Configuración rechazada: ");
+    Serial.println(NodeConfigParser::describe(status));
+    return;
+  }
+
+  // Sólo se escribe en la NVS la sección que cambió
+  ChangeConfiguration persisted = next.irrigation;
+  persisted.setIrrigationStatus = false;
+  bool reportChanged = !sameConfig(next.report, nodeConfig.report);
+  bool irrigationChanged = !sameConfig(next.irrigation, nodeConfig.irrigation);
+  bool scheduleChanged = !next.schedule.equals(nodeConfig.schedule);
+  bool powerChanged = !sameConfig(next.power, nodeConfig.power);
+  bool rollupChanged = !sameConfig(next.rollup, nodeConfig.rollup);
+  bool firebaseChanged = !sameConfig(next.firebase, nodeConfig.firebase);
+
+  next.receivedAt = micros();
+  nodeConfig = next;
+  configMailbox.publish(nodeConfig);
+
+  if(reportChanged){
+    reportPrefs.putBytes("bandas", &nodeConfig.report, sizeof(nodeConfig.report));
+  }
+  if(irrigationChanged){
+    reportPrefs.putBytes("riego", &persisted, sizeof(persisted));
+  }
+  if(scheduleChanged){
+    reportPrefs.putBytes("horario", &nodeConfig.schedule, sizeof(nodeConfig.schedule));
+  }
+  if(powerChanged){
+    reportPrefs.putBytes("energia", &nodeConfig.power, sizeof(nodeConfig.power));
+  }
+  if(rollupChanged){
+    reportPrefs.putBytes("resumen", &nodeConfig.rollup, sizeof(nodeConfig.rollup));
+  }
+  if(firebaseChanged){
+    reportPrefs.putBytes("firebase", &nodeConfig.firebase, sizeof(nodeConfig.firebase));
+#if FIREBASE_SINK
+    xSemaphoreTake(firebaseMutex, portMAX_DELAY);
+    firebaseBatcher.configure(nodeConfig.firebase);
+    xSemaphoreGive(firebaseMutex);
+#endif
+  }
+  Serial.println("Configuración actualizada");
+}
+
+// Llega en mqttClient.loop(), dentro de la tarea de red
+void DualCoreESP32 :: onQueryMessage( const uint8_t *payload, unsigned int length ){
+  QueryRequest request;
+  ConfigStatus status = QueryRequestParser::parse(payload, length, request);
+  if(status != CONFIG_OK){
+    Serial.print("Consulta rechazada: ");
+    Serial.println(NodeConfigParser::describe(status));
+    return;
+  }
+
+  char reply[64];
+  xSemaphoreTake(seriesMutex, portMAX_DELAY);
+  bool respond = queryStream.handle(request, millis(), reply, sizeof(reply));
+  xSemaphoreGive(seriesMutex);
+  if(respond){
+    Wireless.publishMessage(queryReplyTopic, reply);
+  }
+}
+
+void DualCoreESP32 :: serveQuery( void ){
+  if(!queryStream.ready(millis()) || uxQueueMessagesWaiting(mqttQueue) > 0){
+    return;
+  }
+  char payload[MQTT_BUFFER_SIZE - 64];
+  xSemaphoreTake(seriesMutex, portMAX_DELAY);
+  size_t length = queryStream.nextChunk(payload, sizeof(payload));
+  xSemaphoreGive(seriesMutex);
+  // Una parte perdida se nota en "parte"; quien consulta puede pedir de nuevo
+  if(length > 0){
+    Wireless.publishMessage(queryReplyTopic, payload);
+  }
+}
+
+#if FIREBASE_SINK
+void DualCoreESP32 :: serveFirebase( void ){
+  xSemaphoreTake(firebaseMutex, portMAX_DELAY);
+  uint8_t n = firebaseBatcher.due(millis()) ? firebaseBatcher.peek(firebaseBatch, FIREBASE_BATCH_MAX) : 0;
+  xSemaphoreGive(firebaseMutex);
+  if(n == 0){
+    return;
+  }
+
+  // La cola sigue recibiendo muestras mientras sale el lote
+  int status = firebaseClient.send(firebaseBatch, n);
+  bool ok = FirebaseClient::succeeded(status);
+  xSemaphoreTake(firebaseMutex, portMAX_DELAY);
+  if(ok){
+    firebaseBatcher.commit();
+  } else {
+    firebaseBatcher.fail(millis());
+  }
+  xSemaphoreGive(firebaseMutex);
+
+  if(!ok){
+    Serial.print("Firebase: lote rechazado, estado ");
+    Serial.println(status);
+  }
+}
+#endif
+
 void DualCoreESP32 :: ReadSensorsTask ( void * pvParameters){
-  // Inicializar controlador de riego
+  // Sólo sensores y relevadores; la SD, el RTC y el LCD llegan después
   iCtrl.init();
+  bootMark(BOOT_SENSORS);
+
+  // Cada sensor se lee con su propio periodo
+  iCtrl.registerSensors(sensorScheduler);
 
-  // Variable para almacenar el tiempo de la última lectura
-  unsigned long lastReadTime = 0;
+  // La primera muestra sale en cuanto se asientan las lecturas, no un
+  // intervalo completo después
+  unsigned long lastReadTime = millis() + BOOT_SAMPLE_SETTLE_MS - SENSOR_READ_INTERVAL;
 
   // Estructura para mensaje MQTT
   MQTTMessage mqttMessage;
 
+  // Modo de energía vigente y muestras desde la última ventana de radio
+  PowerConfig power = DEFAULT_POWER_CONFIG;
+  uint8_t samplesSinceRadio = 0;
+
+  // Qué resúmenes se publican y si también van las muestras en vivo
+  RollupConfig rollupConfig = DEFAULT_ROLLUP_CONFIG;
+
+  // Cada lectura de suelo o tanque va a los relevadores en cuanto se toma
+  iCtrl.onFreshReadings(onFreshReadings);
+
+  // Turnos del horario que aún no llegan a la tarea de actuación
+  uint16_t turnSeconds[SCHEDULE_ZONES] = {0};
+
+  // Cambios de los relevadores que ya pasaron por el filtro del reporte
+  uint32_t reportedRelayChanges = relayChanges;
+
   while(true){
+    sensorsMeter.wake(micros());
+    bool forceSnapshot = false;
+    bool sampled = false;
+
+    // Nueva configuración recibida por MQTT (una lectura atómica si no hay)
+    NodeConfig newConfig;
+    if(configMailbox.take(newConfig)){
+      reportFilter.configure(newConfig.report);
+      iCtrl.changeConfigurationParameters(newConfig.irrigation);
+      iCtrl.changeSchedule(newConfig.schedule);
+      configLatency.record(micros() - newConfig.receivedAt);
+      if(newConfig.power.lowPower != power.lowPower){
+        // La luz del LCD la apaga la tarea de pantalla con la siguiente instantánea
+        Serial.println(newConfig.power.lowPower ? "Modo de bajo consumo" : "Modo normal");
+      }
+      power = newConfig.power;
+      rollupConfig = newConfig.rollup;
+      // El modo o los umbrales pudieron cambiar
+      forceSnapshot = true;
+    }
+
+    // Botones: modo manual y riego
+    ButtonEvent button;
+    while(xQueueReceive(controlButtons, &button, 0) == pdTRUE){
+      if(onControlButton(button)){
+        forceSnapshot = true;
+      }
+    }
+
+    // Lecturas individuales que ya tocan
+    uint32_t untilNextRead = sensorScheduler.runDue();
+
     // Obtener el tiempo actual
     unsigned long currentTime = millis();
+    uint32_t sampleInterval = power.lowPower ? power.sampleSeconds * 1000UL : SENSOR_READ_INTERVAL;
+
+    // Un cambio de los relevadores pasa por el filtro del reporte en cuanto
+    // ActuationTask lo avisa, sin esperar a la siguiente muestra
+    bool sampleDue = currentTime - lastReadTime >= sampleInterval;
+    bool relaysChanged = relayChanges != reportedRelayChanges;
+    if(sampleDue || relaysChanged){
+      reportedRelayChanges = relayChanges;
+      uint32_t sampleStart = micros();
+
+      // Armar la muestra con el último valor de cada sensor; sólo la muestra
+      // periódica va a la bitácora y a los resúmenes
+      SensorsData data = iCtrl.getSensorsData();
+      if(sampleDue){
+        lastReadTime = currentTime; 
+        sampled = true;
+        uint32_t sdStart = micros();
+        xSemaphoreTake(seriesMutex, portMAX_DELAY);
+        iCtrl.saveDataInSD(data);
+        xSemaphoreGive(seriesMutex);
+        sdWriteTime.record(micros() - sdStart);
 
-    if(currentTime - lastReadTime >= SENSOR_READ_INTERVAL){
-      lastReadTime = currentTime; 
+        // Ventanas de minuto, hora y día que cierra esta muestra
+        rollupSample(data, rollupConfig, power.lowPower);
+      }
+
+      // El estado real de los relevadores, no sólo la decisión
+      bool irrigating = relayState != 0;
 
-      // Realizar la lectura de sensores
-      iCtrl.readAllSensors();
+      // Sólo se publica si algo cambió, cambió el riego o se cumplió el latido;
+      // la muestra ya quedó en la bitácora de todos modos
+      bool report = reportFilter.evaluate(data, irrigating, currentTime) != REPORT_NONE;
 
-      // Crear y guardar JSON
-      String json = iCtrl.createJSON();
-      iCtrl.saveDataInSD(json);
+#if FIREBASE_SINK
+      if(report){
+        xSemaphoreTake(firebaseMutex, portMAX_DELAY);
+        firebaseBatcher.add(data, iCtrl.isManualIrrigationActivated(), currentTime);
+        xSemaphoreGive(firebaseMutex);
+      }
+#endif
 
-      // Evaluación si es hora de regar
-      if(iCtrl.isManualIrrigationActivated()){
-        if(iCtrl.irrigationStatus){
-          // El usuario activó la opción de regar
-          Serial.println("Activación manual");
+      if(power.lowPower){
+        // La muestra espera en el lote; el radio sale cada "radioCada" muestras
+        if(report){
+          batchSample(irrigating);
         }
-      } else {
-        if(iCtrl.isTimerIrrigationActivated()){
-          if(iCtrl.evaluateIfIsTimeToWater()){
-            // Es hora de regar...
-            Serial.println("Activación por alarma");
-          }
+      }
+      if(power.lowPower && sampled){
+        powerLedger.samples++;
+        if(++samplesSinceRadio >= power.radioEvery && !radioActive){
+          samplesSinceRadio = 0;
+          // Se marca aquí para no dormirse antes de que la tarea de red despierte
+          radioActive = true;
+          xSemaphoreGive(radioRequest);
+        }
+      }
+
+      // Generar el JSON directamente en el mensaje MQTT y enviarlo a la cola
+      bool live = report && !power.lowPower && !rollupConfig.rollupOnly;
+      if(live && (TELEMETRY_FORMAT & TELEMETRY_JSON)){
+        uint32_t encodeStart = micros();
+        bool encoded = iCtrl.createJSON(mqttMessage.message, sizeof(mqttMessage.message));
+        encodeTime.record(micros() - encodeStart);
+        if(encoded){
+          mqttMessage.length = strlen(mqttMessage.message);
+          enqueueMessage(mqttMessage, data.timestamp);
         } else {
-          if(iCtrl.evaluateIrrigationDecision()){
-            // Se llegó a valores mínimos de los sensores
-            Serial.println("Activación por parámetros de entrada");
-          }
+          Serial.println("JSON truncado, la muestra no se publica");
+        }
+      }
+
+      // Paquete binario para el tópico paralelo
+      if(live && (TELEMETRY_FORMAT & TELEMETRY_BINARY)){
+        uint32_t encodeStart = micros();
+        mqttMessage.length = iCtrl.createPacket(sampleBatch.sequence++, irrigating,
+                                                (uint8_t *)mqttMessage.message, sizeof(mqttMessage.message));
+        encodeTime.record(micros() - encodeStart);
+        enqueueMessage(mqttMessage, data.timestamp);
+      }
+
+      // De la lectura de la muestra hasta que queda en la cola o en el lote
+      if(sampled){
+        sampleTime.record(micros() - sampleStart);
+        if(bootTimeline.state(BOOT_FIRST_SAMPLE) == BOOT_PENDING){
+          bootMark(BOOT_FIRST_SAMPLE);
         }
       }
-      // Copiar el JSON al mensaje MQTT
-      strncpy(mqttMessage.message, json.c_str(), sizeof(mqttMessage.message) - 1);
-      mqttMessage.message[sizeof(mqttMessage.message) - 1] = '\0';  // Asegurar terminación null
-      
-      // Enviar a la cola MQTT
-      xQueueSend(mqttQueue, &mqttMessage, 0);
     }
 
-    vTaskDelay(100/portTICK_PERIOD_MS);
+    // Las alarmas del horario avanzan con cada muestra aunque no esté en modo
+    // temporizador, para que al activarlo no se disparen turnos viejos; la
+    // tarea de actuación sólo los usa en ese modo. Entre muestras se revisan
+    // cuando vence la alarma, porque en bajo consumo la muestra puede tardar
+    // minutos
+    if(sampled || iCtrl.msUntilNextTurn() == 0){
+      ScheduleEvent turns[SCHEDULE_ZONES];
+      uint8_t dueTurns = iCtrl.evaluateIfIsTimeToWater(turns);
+      for(uint8_t i = 0; i < dueTurns; i++){
+        turnSeconds[turns[i].zone] = turns[i].seconds;
+        forceSnapshot = true;
+      }
+    }
+
+    // Cambió la configuración o empieza un turno
+    if(forceSnapshot){
+      sendSnapshot(micros(), turnSeconds);
+      memset(turnSeconds, 0, sizeof(turnSeconds));
+    }
+
+    // La pantalla sólo cambia con una muestra nueva o con la configuración
+    if(sampled || forceSnapshot){
+      sendDisplay(!power.lowPower);
+    }
+
+    powerLedger.update(millis(), power.lowPower);
+
+    // Dormir hasta la siguiente lectura o la siguiente muestra
+    unsigned long elapsed = millis() - lastReadTime;
+    uint32_t untilSample = elapsed >= sampleInterval ? 0 : sampleInterval - elapsed;
+
+    // Bajo consumo: light sleep hasta POWER_SETTLE_MS antes de la siguiente
+    // muestra o del siguiente turno, salvo que se esté regando, el radio esté
+    // encendido, la tarea de actuación no haya tomado la última instantánea,
+    // haya un botón a medio gesto o la tarea de arranque esté hablando con la
+    // SD o el RTC
+    uint32_t sleepFor = power.lowPower ? powerSleepMs(untilSample, iCtrl.msUntilNextTurn()) : 0;
+    if(sleepFor > 0 && relayState == 0 && !radioActive && uxQueueMessagesWaiting(actuationQueue) == 0 &&
+       ButtonInput::idle() && !booting){
+      sensorsMeter.block(micros());
+      lightSleep(sleepFor);
+      continue;
+    }
+    // Un botón o un cambio de los relevadores despiertan antes a la tarea
+    // (notificación de ButtonTask o de ActuationTask); se atienden arriba
+    uint32_t sleepMs = untilNextRead < untilSample ? untilNextRead : untilSample;
+    sensorsMeter.block(micros());
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs > 0 ? sleepMs : 1));
+  }
+}
+void DualCoreESP32 :: sendSnapshot( uint32_t sampledAt, const uint16_t *turnSeconds ){
+  ActuationSnapshot snapshot;
+  iCtrl.getActuationSnapshot(snapshot, sampledAt);
+  if(turnSeconds != NULL){
+    memcpy(snapshot.turnSeconds, turnSeconds, sizeof(snapshot.turnSeconds));
+  }
+
+  // La tarea de actuación tiene más prioridad: la cola sólo se llena si se colgó
+  if(xQueueSend(actuationQueue, &snapshot, 0) != pdTRUE){
+    actuationDropped++;
   }
 }
+
+// La luz del LCD es el consumo más grande después del radio: en bajo consumo
+// la pantalla se apaga y deja de refrescarse
+void DualCoreESP32 :: sendDisplay( bool backlight ){
+  DisplaySnapshot view;
+  iCtrl.getDisplaySnapshot(view);
+  view.relays = relayState;
+  view.backlight = backlight;
+  displayMailbox.publish(view);
+}
+
+// Desde el planificador, justo después de leer el suelo o el tanque
+void DualCoreESP32 :: onFreshReadings( uint32_t readAt ){
+  sendSnapshot(readAt, NULL);
+}
+
+// Toque largo en el de páginas: entra o sale del modo manual. Toque en el de
+// riego: en modo manual prende o apaga; el doble toque no hace nada, así un
+// toque nervioso no prende y apaga la bomba. Devuelve si cambió el riego.
+bool DualCoreESP32 :: onControlButton( const ButtonEvent &event ){
+  if(event.button == BUTTON_PAGE && event.gesture == BUTTON_LONG){
+    bool manual = !iCtrl.isManualIrrigationActivated();
+    iCtrl.setManualIrrigation(manual);
+    Serial.println(manual ? "Modo manual (botón)" : "Modo manual desactivado (botón)");
+    return true;
+  }
+  if(event.button == BUTTON_PUMP && event.gesture == BUTTON_PRESS && iCtrl.isManualIrrigationActivated()){
+    iCtrl.irrigationStatus = !iCtrl.irrigationStatus;
+    Serial.println(iCtrl.irrigationStatus ? "Riego manual encendido (botón)" : "Riego manual apagado (botón)");
+    return true;
+  }
+  return false;
+}
+
+// Marca el hito y lo avisa por Serial sólo cuando cambia
+void DualCoreESP32 :: bootMark( BootMilestone milestone, bool ok ){
+  uint32_t now = millis();
+  if(!(ok ? bootTimeline.mark(milestone, now) : bootTimeline.fail(milestone, now))){
+    return;
+  }
+  Serial.print("Arranque: ");
+  Serial.print(BootTimeline::name(milestone));
+  Serial.print(ok ? " a los " : " sin respuesta a los ");
+  Serial.print(now);
+  Serial.println(" ms");
+}
+
+// Serie, respaldo y resúmenes, cada uno con el candado de quien lo usa. Si
+// alguno no abre, la microSD no queda lista y BootTask reintenta todo
+bool DualCoreESP32 :: openStorage( void ){
+  if(!IrrigationControl::initStorage()){
+    return false;
+  }
+  xSemaphoreTake(seriesMutex, portMAX_DELAY);
+  bool seriesOpened = seriesStorage.begin(SERIES_DIRECTORY) && series.begin();
+  xSemaphoreGive(seriesMutex);
+  if(!seriesOpened){
+    Serial.println("Error inicializando " SERIES_DIRECTORY);
+  }
+
+  // Recorre el anillo del respaldo; mientras, la tarea de red espera para respaldar
+  xSemaphoreTake(backlogMutex, portMAX_DELAY);
+  bool backlogOpened = backlogStorage.begin(BACKLOG_PATH, BACKLOG_BLOCKS) && backlog.begin();
+  xSemaphoreGive(backlogMutex);
+  if(!backlogOpened){
+    Serial.println("Error inicializando " BACKLOG_PATH);
+  }
+  bool rollupOpened = rollupStorage.begin(ROLLUP_PATH, ROLLUP_BLOCKS) && rollupLog.begin();
+  if(!rollupOpened){
+    Serial.println("Error inicializando " ROLLUP_PATH);
+  }
+  if(!seriesOpened || !backlogOpened || !rollupOpened){
+    return false;
+  }
+  storageReady = true;
+  return true;
+}
+
+// RTC y microSD. Lo que no responde se reintenta con esperas cada vez más
+// largas; la tarea termina cuando tiene ambos.
+void DualCoreESP32 :: BootTask( void * pvParameters ){
+  uint32_t retryMs = BOOT_RETRY_MS;
+  while(true){
+    booting = true;
+    if(!iCtrl.hasClock()){
+      bootMark(BOOT_CLOCK, iCtrl.initClock());
+    }
+    if(!storageReady){
+      bootMark(BOOT_STORAGE, openStorage());
+    }
+    booting = false;
+    if(iCtrl.hasClock() && storageReady){
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(retryMs));
+    retryMs = retryMs * 2 < BOOT_RETRY_MAX_MS ? retryMs * 2 : BOOT_RETRY_MAX_MS;
+  }
+  BootTask_t = NULL;
+  vTaskDelete(NULL);
+}
+
+void DualCoreESP32 :: ActuationTask( void * pvParameters ){
+  ActuationSnapshot snapshot;
+  uint8_t relays = 0;
+
+  actuationMeter.wake(micros());
+  while(true){
+    actuationMeter.block(micros());
+    bool fresh = xQueueReceive(actuationQueue, &snapshot, pdMS_TO_TICKS(ACTUATION_TICK_MS)) == pdTRUE;
+    actuationMeter.wake(micros());
+    if(fresh){
+      zoneController.update(snapshot, millis());
+    }
+
+    // Se escriben siempre, no sólo al cambiar, por si un relevador se reinició
+    uint8_t next = zoneController.evaluate(millis());
+    for(uint8_t z = 0; z < SCHEDULE_ZONES; z++){
+      IrrigationControl::setRelay(z, (next >> z) & 1);
+    }
+    if(fresh){
+      actuationLatency.record(micros() - snapshot.sampledAt);
+      if(bootTimeline.state(BOOT_FIRST_ACTUATION) == BOOT_PENDING){
+        bootMark(BOOT_FIRST_ACTUATION);
+      }
+    }
+    relayState = next;
+
+    if(next != relays){
+      // Imprimir después de escribir los relevadores para no retrasarlos
+      for(uint8_t z = 0; z < SCHEDULE_ZONES; z++){
+        if(((next ^ relays) >> z) & 1){
+          Serial.print("Zona ");
+          Serial.print(z + 1);
+          Serial.print((next >> z) & 1 ? " encendida (" : " apagada (");
+          Serial.print(ZoneController::describe(zoneController.zone(z).cause));
+          Serial.println(")");
+        }
+      }
+      relays = next;
+      relayChanges++;
+      // La tarea de sensores reporta el cambio sin esperar a la siguiente muestra
+      xTaskNotifyGive(ReadSensorsTask_t);
+    }
+  }
+}
+
+void DualCoreESP32 :: ButtonTask( void * pvParameters ){
+  ButtonInput::begin(BTN_PIN1, BTN_PIN2, buttonWake);
+
+  ButtonEvent events[BUTTON_COUNT];
+  uint32_t waitMs = 0;
+  buttonMeter.wake(micros());
+  while(true){
+    buttonMeter.block(micros());
+    // Sin gesto en curso espera al siguiente flanco; si no, al antirrebote o al toque largo
+    xSemaphoreTake(buttonWake, waitMs > 0 ? pdMS_TO_TICKS(waitMs) : portMAX_DELAY);
+    buttonMeter.wake(micros());
+    uint8_t count = ButtonInput::service(events, BUTTON_COUNT, waitMs);
+    for(uint8_t i = 0; i < count; i++){
+      bool control = events[i].button == BUTTON_PUMP || events[i].gesture == BUTTON_LONG;
+      if(xQueueSend(control ? controlButtons : displayButtons, &events[i], 0) != pdTRUE){
+        buttonsDropped++;
+      } else if(control){
+        xTaskNotifyGive(ReadSensorsTask_t);
+      }
+    }
+  }
+}
+
+void DualCoreESP32 :: DisplayTask( void * pvParameters ){
+  // El LCD no tiene forma de avisar que falta: la pantalla sigue aunque no esté
+  iCtrl.initDisplay();
+  bootMark(BOOT_DISPLAY);
+
+  DisplaySnapshot view;
+  uint32_t viewAt = 0;
+  bool ready = false;
+  ButtonEvent button;
+
+  displayMeter.wake(micros());
+  while(true){
+    displayMeter.block(micros());
+    // Un toque en el botón de páginas se dibuja sin esperar la pasada
+    bool pressed = xQueueReceive(displayButtons, &button, pdMS_TO_TICKS(LCD_REFRESH_MS)) == pdTRUE;
+    displayMeter.wake(micros());
+
+    if(pressed){
+      if(button.gesture == BUTTON_DOUBLE){
+        lcdDisplay.firstPage(millis());
+      } else {
+        lcdDisplay.nextPage(millis());
+      }
+    }
+
+    if(displayMailbox.take(view)){
+      ready = true;
+      viewAt = millis();
+    }
+    // Hasta la primera muestra queda el "Iniciando..."
+    if(!ready){
+      continue;
+    }
+
+    // Los relevadores se ven en cuanto cambian y el reloj avanza entre muestras
+    DisplaySnapshot now = view;
+    now.relays = relayState;
+    now.data.timestamp += (millis() - viewAt) / 1000;
+    lcdDisplay.show(now, millis());
+  }
+}
+
 // void DualCoreESP32 :: SendDataTask ( void * pvParameters){
    
    
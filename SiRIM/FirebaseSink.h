@@ -0,0 +1,460 @@
+#ifndef FirebaseSink_h
+#define FirebaseSink_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SensorsData.h"
+#include "TelemetryEncoder.h"
+
+/*
+  Telemetría a Firebase Realtime Database por lotes.
+
+  En lugar de un push por muestra, cada uno con su propia petición HTTPS y su
+  propio saludo TLS, se juntan hasta "lote" muestras y se escriben con un
+  solo PATCH multirruta sobre FIREBASE_PATH:
+
+    PATCH /sirim/telemetria.json?print=silent&auth=... HTTP/1.1
+    {"-O0aFjF-2EA6X5Bb---0": {"temperaturaAmbiente": 24.5, ...}, ...}
+
+  Cada muestra lleva el mismo JSON que se publica por MQTT (TelemetryEncoder)
+  y una clave que genera el nodo con el formato de los push ID de Firebase:
+  8 caracteres con los milisegundos del timestamp (ordenan por fecha), 8 con
+  la MAC y 4 con un contador. La clave no cambia entre intentos, así que
+  reintentar un lote que sí se escribió (se perdió la respuesta) sobrescribe
+  lo mismo en lugar de duplicarlo. Con print=silent la base contesta 204 sin
+  cuerpo.
+
+  La conexión HTTP/1.1 queda abierta entre lotes (keep-alive) y sólo se
+  vuelve a abrir si el servidor la cerró o una petición falló. Un lote sale
+  al juntar "lote" muestras o cuando la más antigua lleva "latenciaSeg"
+  esperando; tras un error se reintenta el mismo lote con retroceso
+  exponencial. Con la cola llena se descarta la muestra más antigua.
+
+  FirebaseBatcher (cola y política) no conoce la red y FirebaseClient arma
+  la petición sobre un HttpStream: WiFiClientSecure en el ESP32 (ver
+  WiFiMQTT.h) o un socket en el escritorio (Herramientas/carga_firebase.cpp).
+*/
+
+#define FIREBASE_BATCH_MAX 32      // Muestras por PATCH
+#define FIREBASE_QUEUE_RECORDS 64  // Muestras pendientes en RAM
+#define FIREBASE_MAX_LATENCY_S 3600
+#define FIREBASE_KEY_SIZE 20       // Caracteres de la clave, sin '\0'
+#define FIREBASE_RETRY_BASE_MS 2000
+#define FIREBASE_RETRY_MAX_MS 300000
+#define FIREBASE_WRITE_BUFFER 512  // Se juntan los pedazos de la petición en un registro TLS
+#define FIREBASE_READ_BUFFER 256
+#define FIREBASE_RECORD_JSON 256   // JSON de una muestra
+
+// Sección "firebase" de la configuración
+struct FirebaseConfig
+{
+  uint8_t batchSize;          // Muestras por lote
+  uint16_t maxLatencySeconds; // Espera máxima de una muestra antes de enviar el lote
+};
+
+static const FirebaseConfig DEFAULT_FIREBASE_CONFIG = {10, 60};
+
+struct FirebaseRecord
+{
+  SensorsData data;
+  uint32_t sequence; // Contador del nodo, parte de la clave
+  uint32_t addedMs;  // millis() al entrar a la cola
+  bool manualIrrigation;
+};
+
+// Transporte de bytes de la petición; read() espera un tiempo acotado
+class HttpStream
+{
+public:
+  virtual ~HttpStream() {}
+  virtual bool connect(const char *host, uint16_t port) = 0;
+  virtual bool connected(void) = 0;
+  virtual void stop(void) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+  // Bytes leídos; 0 si venció el tiempo de espera o se cerró la conexión
+  virtual size_t read(uint8_t *buffer, size_t size) = 0;
+};
+
+class FirebaseBatcher
+{
+private:
+  FirebaseRecord records[FIREBASE_QUEUE_RECORDS];
+  uint8_t head = 0;
+  uint8_t count = 0;
+  uint8_t inFlight = 0; // Registros entregados por peek() que aún no se confirman
+  uint32_t sequence = 0;
+  FirebaseConfig config = DEFAULT_FIREBASE_CONFIG;
+  uint8_t failures = 0;
+  uint32_t retryAt = 0;
+
+public:
+  // Métricas
+  uint32_t sent = 0;          // Muestras confirmadas por la base
+  uint32_t batches = 0;
+  uint32_t failedBatches = 0;
+  uint32_t dropped = 0;       // Descartadas con la cola llena
+
+  void configure(const FirebaseConfig &next) { config = next; }
+  const FirebaseConfig &configuration(void) const { return config; }
+  uint8_t pending(void) const { return count; }
+
+  void add(const SensorsData &data, bool manualIrrigation, uint32_t nowMs);
+
+  // Hay un lote completo, la muestra más antigua ya esperó lo suficiente y
+  // no se está esperando un reintento
+  bool due(uint32_t nowMs) const;
+
+  // Copia las muestras del siguiente lote (las más antiguas) sin quitarlas
+  uint8_t peek(FirebaseRecord *out, uint8_t max);
+
+  // Resultado del lote que entregó peek()
+  void commit(void);
+  void fail(uint32_t nowMs);
+};
+
+class FirebaseClient
+{
+private:
+  HttpStream &stream;
+  const char *host = "";
+  uint16_t port = 443;
+  const char *auth = "";
+  const char *path = "";
+  uint8_t mac[6] = {0};
+  bool keepAlive = true;
+
+  uint8_t out[FIREBASE_WRITE_BUFFER];
+  size_t outUsed = 0;
+  bool writeError = false;
+  uint8_t in[FIREBASE_READ_BUFFER];
+  size_t inUsed = 0;
+  size_t inPos = 0;
+
+  void put(const char *data, size_t length);
+  void put(const char *text) { put(text, strlen(text)); }
+  bool flushOut(void);
+  int nextByte(void);
+  bool readLine(char *line, size_t size);
+  bool skipBody(int32_t length);
+  static bool headerIs(const char *line, const char *name);
+  int request(const FirebaseRecord *records, uint8_t n, bool &closeAfter);
+
+public:
+  // Métricas
+  uint32_t connections = 0;
+  uint32_t requests = 0;
+  uint32_t bytesSent = 0;
+  uint32_t bytesReceived = 0;
+  int lastStatus = 0;
+
+  FirebaseClient(HttpStream &httpStream) : stream(httpStream) {}
+
+  // host sin esquema ("proyecto.firebaseio.com"), path sin '/' inicial ni ".json"
+  void begin(const char *databaseHost, uint16_t databasePort, const char *secret, const char *databasePath,
+             const uint8_t nodeMac[6]);
+  // Sin keep-alive cada lote abre su propia conexión (para comparar)
+  void setKeepAlive(bool enable) { keepAlive = enable; }
+  void stop(void) { stream.stop(); }
+
+  // Escribe el lote con un PATCH; devuelve el código HTTP o -1 si falló el transporte
+  int send(const FirebaseRecord *records, uint8_t n);
+  static bool succeeded(int status) { return status >= 200 && status < 300; }
+
+  // Clave de la muestra (FIREBASE_KEY_SIZE caracteres y '\0')
+  static void makeKey(const FirebaseRecord &record, const uint8_t mac[6], char *key);
+};
+
+/*-- FirebaseBatcher --*/
+
+void FirebaseBatcher ::add(const SensorsData &data, bool manualIrrigation, uint32_t nowMs)
+{
+  if (count == FIREBASE_QUEUE_RECORDS)
+  {
+    // Se pierde la más antigua; si iba en el lote en curso, el lote se achica
+    head = (head + 1) % FIREBASE_QUEUE_RECORDS;
+    count--;
+    if (inFlight > 0)
+      inFlight--;
+    dropped++;
+  }
+  FirebaseRecord &r = records[(head + count) % FIREBASE_QUEUE_RECORDS];
+  r.data = data;
+  r.sequence = sequence++;
+  r.addedMs = nowMs;
+  r.manualIrrigation = manualIrrigation;
+  count++;
+}
+
+bool FirebaseBatcher ::due(uint32_t nowMs) const
+{
+  if (count == 0 || (failures > 0 && (int32_t)(nowMs - retryAt) < 0))
+    return false;
+  return count >= config.batchSize || nowMs - records[head].addedMs >= config.maxLatencySeconds * 1000UL;
+}
+
+uint8_t FirebaseBatcher ::peek(FirebaseRecord *out, uint8_t max)
+{
+  uint8_t n = count < config.batchSize ? count : config.batchSize;
+  if (n > max)
+    n = max;
+  for (uint8_t i = 0; i < n; i++)
+    out[i] = records[(head + i) % FIREBASE_QUEUE_RECORDS];
+  inFlight = n;
+  return n;
+}
+
+void FirebaseBatcher ::commit(void)
+{
+  head = (head + inFlight) % FIREBASE_QUEUE_RECORDS;
+  count -= inFlight;
+  sent += inFlight;
+  inFlight = 0;
+  failures = 0;
+  batches++;
+}
+
+void FirebaseBatcher ::fail(uint32_t nowMs)
+{
+  inFlight = 0;
+  failedBatches++;
+  uint32_t delay = FIREBASE_RETRY_BASE_MS;
+  for (uint8_t i = 0; i < failures && delay < FIREBASE_RETRY_MAX_MS; i++)
+    delay *= 2;
+  if (delay > FIREBASE_RETRY_MAX_MS)
+    delay = FIREBASE_RETRY_MAX_MS;
+  if (failures < 255)
+    failures++;
+  retryAt = nowMs + delay;
+}
+
+/*-- FirebaseClient --*/
+
+void FirebaseClient ::begin(const char *databaseHost, uint16_t databasePort, const char *secret,
+                            const char *databasePath, const uint8_t nodeMac[6])
+{
+  host = databaseHost;
+  port = databasePort;
+  auth = secret != NULL ? secret : "";
+  path = databasePath;
+  memcpy(mac, nodeMac, sizeof(mac));
+}
+
+void FirebaseClient ::makeKey(const FirebaseRecord &record, const uint8_t mac[6], char *key)
+{
+  // Alfabeto de los push ID: en orden ASCII, así las claves ordenan como los números
+  static const char PUSH_CHARS[] = "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+  uint64_t ms = (uint64_t)record.data.timestamp * 1000;
+  for (int8_t i = 7; i >= 0; i--, ms >>= 6)
+    key[i] = PUSH_CHARS[ms & 63];
+  uint64_t node = 0;
+  for (uint8_t i = 0; i < 6; i++)
+    node = (node << 8) | mac[i];
+  for (int8_t i = 15; i >= 8; i--, node >>= 6)
+    key[i] = PUSH_CHARS[node & 63];
+  uint32_t sequence = record.sequence;
+  for (int8_t i = 19; i >= 16; i--, sequence >>= 6)
+    key[i] = PUSH_CHARS[sequence & 63];
+  key[FIREBASE_KEY_SIZE] = '\0';
+}
+
+void FirebaseClient ::put(const char *data, size_t length)
+{
+  while (length > 0 && !writeError)
+  {
+    size_t n = sizeof(out) - outUsed < length ? sizeof(out) - outUsed : length;
+    memcpy(out + outUsed, data, n);
+    outUsed += n;
+    data += n;
+    length -= n;
+    if (outUsed == sizeof(out))
+      flushOut();
+  }
+}
+
+bool FirebaseClient ::flushOut(void)
+{
+  if (outUsed > 0 && !writeError)
+  {
+    writeError = stream.write(out, outUsed) != outUsed;
+    bytesSent += outUsed;
+  }
+  outUsed = 0;
+  return !writeError;
+}
+
+int FirebaseClient ::nextByte(void)
+{
+  if (inPos == inUsed)
+  {
+    inUsed = stream.read(in, sizeof(in));
+    inPos = 0;
+    bytesReceived += inUsed;
+    if (inUsed == 0)
+      return -1;
+  }
+  return in[inPos++];
+}
+
+// Una línea sin "\r\n"; lo que no cabe se descarta
+bool FirebaseClient ::readLine(char *line, size_t size)
+{
+  size_t length = 0;
+  int c;
+  while ((c = nextByte()) >= 0 && c != '\n')
+  {
+    if (c != '\r' && length + 1 < size)
+      line[length++] = (char)c;
+  }
+  line[length] = '\0';
+  return c == '\n';
+}
+
+bool FirebaseClient ::skipBody(int32_t length)
+{
+  for (int32_t i = 0; i < length; i++)
+    if (nextByte() < 0)
+      return false;
+  return true;
+}
+
+// Nombre del encabezado sin distinguir mayúsculas; name en minúsculas
+bool FirebaseClient ::headerIs(const char *line, const char *name)
+{
+  size_t i = 0;
+  for (; name[i] != '\0'; i++)
+  {
+    char c = line[i];
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    if (c != name[i])
+      return false;
+  }
+  return line[i] == ':';
+}
+
+int FirebaseClient ::request(const FirebaseRecord *records, uint8_t n, bool &closeAfter)
+{
+  // Largo del cuerpo: se codifica dos veces en lugar de guardar el lote en RAM
+  char json[FIREBASE_RECORD_JSON];
+  size_t bodyLength = 2;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    size_t length = 0;
+    TelemetryEncoder::encode(records[i].data, records[i].manualIrrigation, json, sizeof(json), &length);
+    bodyLength += (i > 0 ? 1 : 0) + FIREBASE_KEY_SIZE + 3 + length;
+  }
+
+  char line[128];
+  outUsed = 0;
+  writeError = false;
+  inUsed = inPos = 0;
+  put("PATCH /");
+  put(path);
+  put(".json?print=silent");
+  if (auth[0] != '\0')
+  {
+    put("&auth=");
+    put(auth);
+  }
+  put(" HTTP/1.1\r\nHost: ");
+  put(host);
+  snprintf(line, sizeof(line), "\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+           (unsigned)bodyLength, keepAlive ? "keep-alive" : "close");
+  put(line);
+
+  put("{", 1);
+  char key[FIREBASE_KEY_SIZE + 1];
+  for (uint8_t i = 0; i < n; i++)
+  {
+    size_t length = 0;
+    TelemetryEncoder::encode(records[i].data, records[i].manualIrrigation, json, sizeof(json), &length);
+    makeKey(records[i], mac, key);
+    if (i > 0)
+      put(",", 1);
+    put("\"", 1);
+    put(key, FIREBASE_KEY_SIZE);
+    put("\":", 2);
+    put(json, length);
+  }
+  put("}", 1);
+  if (!flushOut())
+    return -1;
+  requests++;
+
+  // Línea de estado, encabezados y el cuerpo (se descarta)
+  int status = -1;
+  if (!readLine(line, sizeof(line)) || sscanf(line, "HTTP/1.%*d %d", &status) != 1)
+    return -1;
+  int32_t contentLength = -1;
+  bool chunked = false;
+  closeAfter = !keepAlive;
+  while (true)
+  {
+    if (!readLine(line, sizeof(line)))
+      return -1;
+    if (line[0] == '\0')
+      break;
+    const char *value = strchr(line, ':');
+    value = value != NULL ? value + 1 : line;
+    while (*value == ' ')
+      value++;
+    if (headerIs(line, "content-length"))
+      contentLength = atol(value);
+    else if (headerIs(line, "transfer-encoding"))
+      chunked = strstr(value, "chunked") != NULL;
+    else if (headerIs(line, "connection"))
+      closeAfter = closeAfter || strstr(value, "close") != NULL;
+  }
+
+  if (chunked)
+  {
+    int32_t size;
+    do
+    {
+      if (!readLine(line, sizeof(line)))
+        return -1;
+      size = strtol(line, NULL, 16);
+      if (!skipBody(size) || !readLine(line, sizeof(line)))
+        return -1;
+    } while (size > 0);
+  }
+  else if (contentLength > 0 && !skipBody(contentLength))
+    return -1;
+  else if (contentLength < 0 && status != 204 && status != 304)
+  {
+    // Sin largo el cuerpo termina al cerrar la conexión
+    while (nextByte() >= 0)
+      ;
+    closeAfter = true;
+  }
+  return status;
+}
+
+int FirebaseClient ::send(const FirebaseRecord *records, uint8_t n)
+{
+  int status = -1;
+  // Una conexión reutilizada pudo haberla cerrado el servidor: un intento más con una nueva
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    bool reused = stream.connected();
+    if (!reused)
+    {
+      if (!stream.connect(host, port))
+        break;
+      connections++;
+    }
+    bool closeAfter = false;
+    status = request(records, n, closeAfter);
+    if (status < 0 || closeAfter)
+      stream.stop();
+    if (status >= 0 || !reused)
+      break;
+  }
+  lastStatus = status;
+  return status;
+}
+
+#endif
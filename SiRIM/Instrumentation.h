@@ -0,0 +1,75 @@
+#ifndef Instrumentation_h
+#define Instrumentation_h
+
+#include <stdint.h>
+
+/*
+  Contadores baratos para la ruta caliente. Cada objeto lo escribe una sola
+  tarea; la tarea de red los lee sin candados para el tópico de diagnóstico
+  (un conteo de 32 bits se lee completo, a lo más se ve una muestra atrasada).
+*/
+
+// Estadísticas de latencia en microsegundos para una ventana de medición.
+// Sólo hace sumas y comparaciones para poder llamarse en la ruta caliente.
+class LatencyStats
+{
+public:
+  uint32_t count = 0;
+  uint32_t maxUs = 0;
+  uint32_t lastUs = 0;
+  uint64_t totalUs = 0;
+
+  void record(uint32_t us)
+  {
+    count++;
+    lastUs = us;
+    totalUs += us;
+    if (us > maxUs)
+      maxUs = us;
+  }
+
+  uint32_t meanUs(void) { return count > 0 ? (uint32_t)(totalUs / count) : 0; }
+
+  void reset(void)
+  {
+    count = 0;
+    maxUs = 0;
+    totalUs = 0;
+  }
+};
+
+// Cubetas fijas de latencia: < 100 us, < 300 us, ..., < 300 ms y el resto
+#define LATENCY_BUCKETS 9
+static const uint32_t LATENCY_BUCKET_EDGES_US[LATENCY_BUCKETS - 1] = {100,   300,   1000,   3000,
+                                                                      10000, 30000, 100000, 300000};
+
+// Histograma desde el arranque; no se reinicia para que quien lo lee pueda
+// restar dos reportes sin carreras con la tarea que escribe
+class LatencyHistogram : public LatencyStats
+{
+public:
+  uint32_t buckets[LATENCY_BUCKETS] = {0};
+
+  void record(uint32_t us)
+  {
+    LatencyStats::record(us);
+    uint8_t i = 0;
+    while (i < LATENCY_BUCKETS - 1 && us >= LATENCY_BUCKET_EDGES_US[i])
+      i++;
+    buckets[i]++;
+  }
+};
+
+// Tiempo activo de una tarea: desde que despierta hasta que vuelve a
+// bloquearse. busyUs se desborda cada 71 minutos; se usan diferencias.
+class TaskMeter
+{
+public:
+  volatile uint32_t busyUs = 0;
+  uint32_t wokeAt = 0;
+
+  void wake(uint32_t nowUs) { wokeAt = nowUs; }
+  void block(uint32_t nowUs) { busyUs += nowUs - wokeAt; }
+};
+
+#endif
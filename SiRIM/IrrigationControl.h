@@ -9,12 +9,21 @@
 #include <LiquidCrystal_I2C.h>
 #include <DHT.h>
 #include <RTClib.h>
-#include <ArduinoJson.h>
+#include "SensorsData.h"
+#include "TelemetryEncoder.h"
+#include "TelemetryPacket.h"
+#include "WaterLevelSensor.h"
+#include "AnalogSampler.h"
+#include "SensorScheduler.h"
+#include "SDStorage.h"
+#include "NodeConfig.h"
+#include "IrrigationSchedule.h"
+#include "ZoneController.h"
+#include "LcdDisplay.h"
 
 // Pines y configuración de dispositivos
 #define TRIGGER 26
 #define ECHO 25
-#define VELOCIDAD_SONIDO 0.034
 #define LDR_PIN 35
 #define SOIL_MOISTURE1_PIN 34
 #define SOIL_MOISTURE2_PIN 33
@@ -25,225 +34,425 @@
 #define SPI_MOSI 23
 #define SPI_MISO 19
 #define SPI_SCK 18
-#define BTN_PIN1 = 15;
-#define BTN_PIN2 = 17;
+#define BTN_PIN1 15 // Páginas del LCD
+#define BTN_PIN2 27 // Riego manual; el 17 es RELAY2_PIN
+
+// Periodos de lectura por sensor (ms); el simulador puede definirlos antes
+#ifndef LIGHT_READ_PERIOD
+#define LIGHT_READ_PERIOD 500
+#endif
+#define SOIL_READ_PERIOD 1000
+#define DHT_READ_PERIOD 2000 // El DHT11 no entrega datos nuevos más rápido
+#ifndef WATER_READ_PERIOD
+#define WATER_READ_PERIOD 100
+#endif
+#define RTC_READ_PERIOD 1000
+#ifndef ADC_SERVICE_PERIOD
+#define ADC_SERVICE_PERIOD 20 // Paso de los bloques del ADC a los filtros
+#endif
+
+// Serie de tiempo en la microSD, un archivo por día (ver SeriesStore.h)
+#define SERIES_DIRECTORY "/serie"
+
+// Muestras que esperan en RAM mientras no hay microSD (unos 5 min a 5 s)
+#define PENDING_SAMPLES 64
 
 // Instancias de las clases
 LiquidCrystal_I2C lcd(0x27, 16, 2);
 DHT dht(DHT_PIN, DHT11);
 RTC_DS1307 rtc;
+SDPartitionStorage seriesStorage;
+SeriesStore series(seriesStorage);
 
-struct ChangeConfiguration
-{
-  String setIrrigationTime;
-  int setLightThreshold;
-  int setSoilMoistureThreshold;
-  bool setManualIrrigationMode;
-  bool setTimerIrrigationMode;
-  bool setIrrigationStatus;
-};
+// Recibe el micros() de la lectura
+typedef void (*ReadingsHandler)(uint32_t readAt);
 
 class IrrigationControl
 {
 private:
-  int counterForTimer = 0;
   // Lectura de los Sensores
   DateTime currentDate;
-  int s_soilMoisture1;
-  int s_soilMoisture2;
-  int s_lightIntensity;
+  // Sin RTC la hora sale de la compilación más el tiempo encendido
+  volatile bool clockReady = false;
+  // READING_INVALID hasta que el ADC (o el ultrasónico) entrega la primera lectura
+  int s_soilMoisture1 = READING_INVALID;
+  int s_soilMoisture2 = READING_INVALID;
+  int s_lightIntensity = READING_INVALID;
   float s_airHumidity;
   float s_airTemperature;
   float s_waterLevel;
+  int s_waterPercent = READING_INVALID;
 
   /*-- Parámetros de configuración para gestionar el riego (se modifica por medio de mensaje MQTT en JSON) --*/
-  String irrigationAtTime = "";
-  int secondsSetForWatering = 10;
+  int minLightThreshold = DEFAULT_IRRIGATION_CONFIG.setLightThreshold;
+  int minSoilMoistureThreshold = DEFAULT_IRRIGATION_CONFIG.setSoilMoistureThreshold;
+
+  // Aviso de lecturas nuevas de suelo o tanque (para la tarea de actuación)
+  ReadingsHandler readingsHandler = NULL;
+  void freshReading(void)
+  {
+    if (readingsHandler != NULL)
+    {
+      readingsHandler(micros());
+    }
+  }
 
-  int minLightThreshold = 100;
-  int minSoilMoistureThreshold = 100;
+  // Turnos de riego por zona (RELAY1_PIN, RELAY2_PIN)
+  ScheduleEngine schedule;
 
   // Condiciones para riego
   bool manualIrrigationActivated = false;
   bool timerIrrigationActivated = false;
 
+  // Lecturas individuales que ejecuta el planificador
+  static void sampleLight(void *context);
+  static void sampleSoil1(void *context);
+  static void sampleSoil2(void *context);
+  static void sampleAir(void *context);
+  static void sampleWaterLevel(void *context);
+  static void sampleClock(void *context);
+  static void sampleAnalog(void *context);
+
+  // Muestras sin guardar porque la SD todavía no está lista
+  static SensorsData pendingSamples[PENDING_SAMPLES];
+  static uint8_t pendingHead;
+  static uint8_t pendingCount;
+
 public:
   // Estado de riego
   bool irrigationStatus = false;
 
   /*--- Funciones para la Lógica de riego ---*/
 
-  // Inicializar todos los pines y componentes
+  // Sensores y relevadores: lo único que necesita la primera muestra
   static void init();
+  // Las demás etapas no detienen el arranque; cada una corre en otra tarea y
+  // devuelve false si el periférico no responde, para reintentarla después
+  static void initDisplay(void);
+  bool initClock(void);
+  static bool initStorage(void);
+  bool hasClock(void) { return clockReady; }
 
   // Leer datos de sensores
-  static int readSoilMoisture(int pinSensor);
-  static int readLightIntensity(int pinSensor);
+  static int readSoilMoisture(AnalogProbe probe);
+  static int readLightIntensity(void);
   static float readAirHumidity(void);
   static float readAirTemperature(void);
   static float readWaterLevel(void);
 
+  // Registrar cada sensor con su propio periodo en el planificador
+  void registerSensors(SensorScheduler &scheduler);
+
   // Funciones adicionales
-  void readAllSensors(void);
   void clearAllReadings(void);
-  String currentHour(void);
-  static void saveDataInSD(const String &data);
-  String createJSON(void);
-  void changeConfigurationParameters(ChangeConfiguration newConfig);
+  SensorsData getSensorsData(void);
+  static void saveDataInSD(const SensorsData &data);
+  static uint8_t pendingInRAM(void) { return pendingCount; }
+  static uint32_t pendingDropped; // Muestras que no alcanzaron a llegar a la SD
+  bool createJSON(char *buffer, size_t size);
+  size_t createPacket(uint16_t sequence, bool irrigating, uint8_t *buffer, size_t size);
+  void changeConfigurationParameters(const ChangeConfiguration &newConfig);
+  void changeSchedule(const ScheduleTable &table);
+  const ScheduleEngine &irrigationSchedule(void) { return schedule; }
 
   // Funciones para condicionales de riego
   bool isManualIrrigationActivated(void);
+  void setManualIrrigation(bool activated);
   bool isTimerIrrigationActivated(void);
-  bool evaluateIrrigationDecision(void);
-  bool evaluateIfIsTimeToWater(void);
+  uint8_t evaluateIfIsTimeToWater(ScheduleEvent *events);
+  // Milisegundos hasta el siguiente turno (SCHEDULE_NONE sin reloj o sin turnos)
+  uint32_t msUntilNextTurn(void);
+  void onFreshReadings(ReadingsHandler handler) { readingsHandler = handler; }
+  void getActuationSnapshot(ActuationSnapshot &snapshot, uint32_t sampledAt);
+  void getDisplaySnapshot(DisplaySnapshot &view);
+  static void setRelay(uint8_t zone, bool on);
 };
 
+SensorsData IrrigationControl::pendingSamples[PENDING_SAMPLES];
+uint8_t IrrigationControl::pendingHead = 0;
+uint8_t IrrigationControl::pendingCount = 0;
+uint32_t IrrigationControl::pendingDropped = 0;
+
 void IrrigationControl ::init(void)
 {
-  // Inicialización de componentes
-  lcd.init();
-  lcd.backlight();
-  lcd.print("Iniciando...");
-
-  pinMode(TRIGGER, OUTPUT);
-  pinMode(ECHO, INPUT);
-  pinMode(LDR_PIN, INPUT);
-  pinMode(SOIL_MOISTURE1_PIN, INPUT);
-  pinMode(SOIL_MOISTURE2_PIN, INPUT);
+  // Los relevadores quedan apagados antes que nada
   pinMode(RELAY1_PIN, OUTPUT);
   pinMode(RELAY2_PIN, OUTPUT);
+  setRelay(0, false);
+  setRelay(1, false);
 
-  dht.begin();
-  SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI);
-
-  if (!SD.begin(SD_CS))
+  WaterLevelSensor::begin(TRIGGER, ECHO);
+  if (!AnalogSampler::begin(SOIL_MOISTURE1_PIN, SOIL_MOISTURE2_PIN, LDR_PIN))
   {
-    Serial.println("Error inicializando tarjeta SD");
-    while (true)
-      ;
+    Serial.println("Error inicializando el ADC continuo");
   }
+  dht.begin();
+}
 
+void IrrigationControl ::initDisplay(void)
+{
+  lcd.init();
+  lcd.backlight();
+  lcd.print("Iniciando...");
+}
+
+bool IrrigationControl ::initClock(void)
+{
   if (!rtc.begin())
   {
-    Serial.println("Error inicializando RTC");
-    while (true)
-      ;
+    return false;
   }
-
   if (!rtc.isrunning())
   {
     rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
   }
+  clockReady = true;
+  return true;
+}
 
-  lcd.clear();
-  lcd.print("Sistema Listo");
-  delay(2000);
+// Sólo la tarjeta; la serie se abre con su candado (ver DualCore.h)
+bool IrrigationControl ::initStorage(void)
+{
+  static bool spiStarted = false;
+  if (!spiStarted)
+  {
+    SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI);
+    spiStarted = true;
+  }
+  if (!SD.begin(SD_CS))
+  {
+    SD.end();
+    return false;
+  }
+  return true;
 }
 
-void IrrigationControl ::changeConfigurationParameters(ChangeConfiguration newConfig)
+void IrrigationControl ::changeConfigurationParameters(const ChangeConfiguration &newConfig)
 {
-  irrigationAtTime = newConfig.setIrrigationTime;
+  // Llega ya validada por NodeConfigParser
   minLightThreshold = newConfig.setLightThreshold;
   minSoilMoistureThreshold = newConfig.setSoilMoistureThreshold;
   manualIrrigationActivated = newConfig.setManualIrrigationMode;
   timerIrrigationActivated = newConfig.setTimerIrrigationMode;
   irrigationStatus = newConfig.setIrrigationStatus;
 }
-String IrrigationControl ::currentHour(void)
+void IrrigationControl ::changeSchedule(const ScheduleTable &table)
 {
-  return String(currentDate.hour()) + ":" + String(currentDate.minute());
+  // Volver a armar sólo si cambió, para no perder un turno a punto de dispararse
+  if (!table.equals(schedule.schedule()))
+  {
+    schedule.load(table);
+  }
 }
 /*-- Funciones para condicionales de riego --*/
 bool IrrigationControl ::isManualIrrigationActivated(void)
 {
   return manualIrrigationActivated;
 }
+// Desde el botón; dura hasta la siguiente configuración por MQTT
+void IrrigationControl ::setManualIrrigation(bool activated)
+{
+  manualIrrigationActivated = activated;
+  if (!activated)
+  {
+    irrigationStatus = false;
+  }
+}
 bool IrrigationControl ::isTimerIrrigationActivated(void)
 {
   return timerIrrigationActivated;
 }
 
-// Determinar riego por valores de lectura en los sensores
-bool IrrigationControl ::evaluateIrrigationDecision(void)
+// Lecturas y modo de riego para la tarea de actuación
+void IrrigationControl ::getActuationSnapshot(ActuationSnapshot &snapshot, uint32_t sampledAt)
 {
-  int medianSoilMoisture = (s_soilMoisture1 + s_soilMoisture2) / 2;
+  snapshot.soil[0] = s_soilMoisture1;
+  snapshot.soil[1] = s_soilMoisture2;
+  snapshot.light = s_lightIntensity;
+  snapshot.waterPercent = s_waterPercent;
+  snapshot.soilThreshold = minSoilMoistureThreshold;
+  snapshot.lightThreshold = minLightThreshold;
+  snapshot.mode = manualIrrigationActivated ? ACTUATION_MANUAL : (timerIrrigationActivated ? ACTUATION_TIMER : ACTUATION_AUTO);
+  snapshot.manualOn = irrigationStatus;
+  memset(snapshot.turnSeconds, 0, sizeof(snapshot.turnSeconds));
+  snapshot.sampledAt = sampledAt;
+}
+
+void IrrigationControl ::setRelay(uint8_t zone, bool on)
+{
+  static const uint8_t relayPins[SCHEDULE_ZONES] = {RELAY1_PIN, RELAY2_PIN};
+  digitalWrite(relayPins[zone], on ? HIGH : LOW);
+}
 
-  return s_lightIntensity < minLightThreshold && medianSoilMoisture < minSoilMoistureThreshold;
+// Última muestra y modo para la tarea de pantalla
+void IrrigationControl ::getDisplaySnapshot(DisplaySnapshot &view)
+{
+  view.data = getSensorsData();
+  view.mode = manualIrrigationActivated ? ACTUATION_MANUAL : (timerIrrigationActivated ? ACTUATION_TIMER : ACTUATION_AUTO);
+  view.lightThreshold = minLightThreshold;
+  view.soilThreshold = minSoilMoistureThreshold;
 }
-bool IrrigationControl ::evaluateIfIsTimeToWater(void)
+
+// Turnos que tocan según la hora del RTC; cada zona sólo compara con su alarma.
+// Sin RTC no hay turnos: la hora de respaldo no es la del invernadero.
+uint8_t IrrigationControl ::evaluateIfIsTimeToWater(ScheduleEvent *events)
 {
-  if (currentHour() == irrigationAtTime && counterForTimer == 0)
+  if (!clockReady)
   {
-    counterForTimer++;
-    return true;
+    return 0;
   }
-  else if (currentHour() != irrigationAtTime)
+  return schedule.poll(currentDate.unixtime(), events);
+}
+
+uint32_t IrrigationControl ::msUntilNextTurn(void)
+{
+  if (!clockReady)
   {
-    counterForTimer = 0;
+    return SCHEDULE_NONE;
   }
-  return false;
+  return schedule.msUntilNext(currentDate.unixtime());
 }
 
 /*-- Funciones para JSON y Memoria SD --*/
 
-String IrrigationControl ::createJSON(void)
+bool IrrigationControl ::createJSON(char *buffer, size_t size)
 {
-  // Crear JSON con estructura deseada
-  DynamicJsonDocument doc(512);
-  doc["fecha"] = String(currentDate.day()) + "/" + String(currentDate.month()) + "/" + String(currentDate.year());
-  doc["hora"] = String(currentDate.hour()) + ":" + String(currentDate.minute()) + ":" + String(currentDate.second());
-  doc["temperaturaAmbiente"] = s_airTemperature;
-  doc["humedadAmbiente"] = s_airHumidity;
-  doc["humedadSuelo"]["sensor1"] = s_soilMoisture1;
-  doc["humedadSuelo"]["sensor2"] = s_soilMoisture2;
-  doc["iluminacion"] = s_lightIntensity;
-  doc["riegoManual"] = false; // Cambiar a `true` si controlas riego manual
-  doc["nivelAgua"] = s_waterLevel;
+  // Se escribe directamente en el buffer del llamador, sin usar el heap
+  return TelemetryEncoder::encode(getSensorsData(), manualIrrigationActivated, buffer, size);
+}
 
-  // Convertir JSON a cadena
-  String jsonString;
-  serializeJson(doc, jsonString);
+size_t IrrigationControl ::createPacket(uint16_t sequence, bool irrigating, uint8_t *buffer, size_t size)
+{
+  // Mismos datos que el JSON en TELEMETRY_PACKET_SIZE bytes
+  return TelemetryPacket::encode(getSensorsData(), sequence, manualIrrigationActivated, irrigating, buffer, size);
+}
 
-  return jsonString;
+SensorsData IrrigationControl ::getSensorsData(void)
+{
+  SensorsData data;
+  data.temperature = s_airTemperature;
+  data.humidity = s_airHumidity;
+  // La telemetría conserva el 0 de siempre para una lectura faltante
+  data.soilMoisture1 = s_soilMoisture1 < 0 ? 0 : s_soilMoisture1;
+  data.soilMoisture2 = s_soilMoisture2 < 0 ? 0 : s_soilMoisture2;
+  data.lightIntensity = s_lightIntensity < 0 ? 0 : s_lightIntensity;
+  data.waterLevel = s_waterLevel;
+  data.waterPercent = s_waterPercent;
+  data.timestamp = currentDate.unixtime();
+  return data;
 }
 
-void IrrigationControl ::saveDataInSD(const String &data)
+void IrrigationControl ::saveDataInSD(const SensorsData &data)
 {
-  // Abrir el archivo en modo escritura/apéndice
-  File file = SD.open("/datalog.txt", FILE_APPEND);
-  if (file)
+  // Sin SD la muestra espera en RAM; si se llena se pierde la más antigua
+  if (!series.isReady())
   {
-    file.println(data); // Escribir datos en el archivo
-    file.close();       // Cerrar el archivo
-    Serial.println("Datos guardados en datalog.txt:");
-    Serial.println(data);
+    if (pendingCount == PENDING_SAMPLES)
+    {
+      pendingHead = (pendingHead + 1) % PENDING_SAMPLES;
+      pendingCount--;
+      pendingDropped++;
+    }
+    pendingSamples[(pendingHead + pendingCount) % PENDING_SAMPLES] = data;
+    pendingCount++;
+    return;
   }
-  else
+
+  // Lo que esperaba en RAM va antes, para no desordenar la serie
+  for (; pendingCount > 0; pendingCount--)
   {
-    Serial.println("Error al abrir datalog.txt para escritura.");
+    series.append(pendingSamples[pendingHead]);
+    pendingHead = (pendingHead + 1) % PENDING_SAMPLES;
+  }
+
+  // La muestra se guarda en RAM; sólo se escribe en la SD cada bloque completo
+  if (!series.append(data))
+  {
+    Serial.println("Error al escribir en " SERIES_DIRECTORY);
   }
 }
 
 /* Funciones para lecturas de los sensores */
-void IrrigationControl ::readAllSensors(void)
+void IrrigationControl ::registerSensors(SensorScheduler &scheduler)
+{
+  // nombre, periodo, plazo (ms), costo estimado (us)
+  scheduler.add("luz", LIGHT_READ_PERIOD, 100, 100, sampleLight, this);
+  scheduler.add("suelo1", SOIL_READ_PERIOD, 200, 100, sampleSoil1, this);
+  scheduler.add("suelo2", SOIL_READ_PERIOD, 200, 100, sampleSoil2, this);
+  scheduler.add("dht", DHT_READ_PERIOD, 1000, 25000, sampleAir, this);
+  scheduler.add("agua", WATER_READ_PERIOD, 50, 50, sampleWaterLevel, this);
+  scheduler.add("rtc", RTC_READ_PERIOD, 500, 1000, sampleClock, this);
+  scheduler.add("adc", ADC_SERVICE_PERIOD, 10, 20, sampleAnalog, this);
+}
+
+void IrrigationControl ::sampleLight(void *context)
 {
-  s_lightIntensity = readLightIntensity(LDR_PIN);
-  s_soilMoisture1 = readSoilMoisture(SOIL_MOISTURE1_PIN);
-  s_soilMoisture2 = readSoilMoisture(SOIL_MOISTURE2_PIN);
-  s_airTemperature = readAirTemperature();
-  s_airHumidity = readAirHumidity();
-  s_waterLevel = readWaterLevel();
-  currentDate = rtc.now();
+  IrrigationControl *self = (IrrigationControl *)context;
+  self->s_lightIntensity = readLightIntensity();
+}
+
+void IrrigationControl ::sampleSoil1(void *context)
+{
+  IrrigationControl *self = (IrrigationControl *)context;
+  self->s_soilMoisture1 = readSoilMoisture(PROBE_SOIL1);
+  self->freshReading();
+}
+
+void IrrigationControl ::sampleSoil2(void *context)
+{
+  IrrigationControl *self = (IrrigationControl *)context;
+  self->s_soilMoisture2 = readSoilMoisture(PROBE_SOIL2);
+  self->freshReading();
+}
+
+void IrrigationControl ::sampleAir(void *context)
+{
+  // Temperatura y humedad salen de la misma transacción del DHT11
+  IrrigationControl *self = (IrrigationControl *)context;
+  self->s_airTemperature = readAirTemperature();
+  self->s_airHumidity = readAirHumidity();
+}
+
+void IrrigationControl ::sampleWaterLevel(void *context)
+{
+  // Dispara el ultrasónico y recoge el eco anterior (ver WaterLevelSensor.h)
+  IrrigationControl *self = (IrrigationControl *)context;
+  WaterLevelSensor::service();
+  self->s_waterLevel = readWaterLevel();
+  // Sin ecos vigentes no se inventa un 0: la actuación lo toma por tanque sin lectura
+  self->s_waterPercent = isnan(self->s_waterLevel) ? READING_INVALID : (int)WaterLevelSensor::percent();
+  self->freshReading();
+}
+
+void IrrigationControl ::sampleClock(void *context)
+{
+  IrrigationControl *self = (IrrigationControl *)context;
+  if (self->clockReady)
+  {
+    self->currentDate = rtc.now();
+  }
+  else
+  {
+    // La misma hora con la que se ajusta un DS1307 detenido
+    self->currentDate = DateTime(F(__DATE__), F(__TIME__)) + TimeSpan(millis() / 1000);
+  }
+}
+
+void IrrigationControl ::sampleAnalog(void *context)
+{
+  // Pasa el último bloque sobremuestreado del ADC a los filtros
+  AnalogSampler::service();
 }
 
 void IrrigationControl ::clearAllReadings(void)
 {
-  s_lightIntensity = 0;
-  s_soilMoisture1 = 0;
-  s_soilMoisture2 = 0;
+  s_lightIntensity = READING_INVALID;
+  s_soilMoisture1 = READING_INVALID;
+  s_soilMoisture2 = READING_INVALID;
   s_airTemperature = 0;
   s_airHumidity = 0;
   s_waterLevel = 0;
+  s_waterPercent = READING_INVALID;
 }
 
 float IrrigationControl ::readAirHumidity(void)
@@ -258,31 +467,24 @@ float IrrigationControl ::readAirTemperature(void)
   return dht.readTemperature();
 }
 
-int IrrigationControl ::readSoilMoisture(int pinSensor)
+int IrrigationControl ::readSoilMoisture(AnalogProbe probe)
 {
-  // Código para obtener la humedad del suelo
-  // map(soilMoistureValue, AirValue, WaterValue, 0, 100) <- Cambiar por nuestras lecturas
-  return map(analogRead(pinSensor), 790, 390, 0, 100);
+  // Lectura filtrada y calibrada con la tabla de la sonda (ver AnalogSampler.h).
+  // Sin datos no se inventa un 0: la zona lo tomaría por suelo seco
+  float percent = AnalogSampler::value(probe);
+  return isnan(percent) ? READING_INVALID : (int)lroundf(percent);
 }
 
 float IrrigationControl ::readWaterLevel(void)
 {
-  // Código para obtener el nivel del agua
-  digitalWrite(TRIGGER, LOW);
-  delayMicroseconds(2);
-
-  digitalWrite(TRIGGER, HIGH);
-  delayMicroseconds(10);
-
-  digitalWrite(TRIGGER, LOW);
-
-  return (pulseIn(ECHO, HIGH) * VELOCIDAD_SONIDO / 2);
+  // Mediana de las últimas mediciones; no espera al eco
+  return WaterLevelSensor::distance();
 }
 
-int IrrigationControl ::readLightIntensity(int pinSensor)
+int IrrigationControl ::readLightIntensity(void)
 {
-  // map(fotoresistencia, minReading, maxReading, minValue, maxValue);
-  return map(analogRead(pinSensor), 0, 1000, 0, 100);
+  float percent = AnalogSampler::value(PROBE_LIGHT);
+  return isnan(percent) ? READING_INVALID : (int)lroundf(percent);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,296 @@
+#ifndef IrrigationSchedule_h
+#define IrrigationSchedule_h
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Horario de riego por zona (una zona por relevador).
+
+  Cada zona tiene una tabla ordenada de turnos: minuto de la semana
+  (0 = domingo 0:00, como DateTime::dayOfTheWeek) y duración en segundos.
+  En lugar de comparar la hora en cada ciclo, cada zona arma una alarma con
+  la hora absoluta de su siguiente turno (búsqueda binaria en la tabla);
+  poll() sólo compara esa hora con el reloj y, al dispararse, arma la
+  siguiente.
+
+  El reloj es la hora local del RTC, que puede saltar:
+    - Hacia adelante (corte de energía, horario de verano, ajuste): de los
+      turnos que quedaron atrás sólo se ejecuta el último, y sólo si no tiene
+      más de SCHEDULE_LATE_LIMIT_S de atraso; los demás se cuentan como
+      omitidos.
+    - Hacia atrás (fin del horario de verano, ajuste): se vuelve a armar
+      desde la hora nueva, pero sin repetir un turno que se ejecutó hace
+      menos de SCHEDULE_REPEAT_GUARD_S.
+*/
+
+#define SCHEDULE_ZONES 2
+#define SCHEDULE_MAX_SLOTS 16 // Por zona
+#define SCHEDULE_MINUTES_PER_WEEK 10080
+#define SCHEDULE_SECONDS_PER_WEEK 604800UL
+#define SCHEDULE_LATE_LIMIT_S 3600
+#define SCHEDULE_REPEAT_GUARD_S 7200
+#define SCHEDULE_NONE 0xFFFFFFFFUL
+
+struct ScheduleSlot
+{
+  uint16_t minuteOfWeek;
+  uint16_t seconds;
+};
+
+// Sólo tipos simples: viaja en NodeConfig y se guarda tal cual en la NVS
+struct ScheduleTable
+{
+  uint8_t count[SCHEDULE_ZONES];
+  ScheduleSlot slots[SCHEDULE_ZONES][SCHEDULE_MAX_SLOTS];
+
+  void clear(void) { memset(this, 0, sizeof(*this)); }
+  // Inserta en orden; si el minuto ya existe sólo cambia la duración
+  bool add(uint8_t zone, uint16_t minuteOfWeek, uint16_t seconds);
+  bool equals(const ScheduleTable &other) const;
+  bool valid(void) const;
+};
+
+struct ScheduleEvent
+{
+  uint8_t zone;
+  uint16_t seconds;
+  uint32_t dueAt; // Hora local del turno
+  uint32_t late;  // Segundos de atraso al dispararse
+};
+
+class ScheduleEngine
+{
+private:
+  ScheduleTable table;
+  uint32_t dueAt[SCHEDULE_ZONES];
+  uint16_t dueSeconds[SCHEDULE_ZONES];
+  uint32_t lastFired[SCHEDULE_ZONES];
+  uint32_t lastPoll = 0;
+  bool pending = true; // Armar en el siguiente poll()
+
+  void arm(uint8_t zone, uint32_t from);
+  void rearm(uint32_t now);
+
+public:
+  // Estadísticas
+  uint32_t fired = 0;
+  uint32_t late = 0;    // Disparados con más de un minuto de atraso
+  uint32_t skipped = 0; // Omitidos por un salto del reloj
+  uint32_t clockJumps = 0;
+
+  ScheduleEngine(void)
+  {
+    table.clear();
+    for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+    {
+      dueAt[z] = SCHEDULE_NONE;
+      lastFired[z] = 0;
+    }
+  }
+
+  // Las alarmas se arman con la hora del siguiente poll()
+  void load(const ScheduleTable &newTable)
+  {
+    table = newTable;
+    pending = true;
+  }
+  const ScheduleTable &schedule(void) const { return table; }
+
+  // Turnos que tocan a la hora local now (a lo más uno por zona)
+  uint8_t poll(uint32_t now, ScheduleEvent *events);
+
+  // Hora local del siguiente turno de cualquier zona (SCHEDULE_NONE si no hay)
+  uint32_t nextDue(void) const;
+
+  // Milisegundos desde la hora local now hasta el siguiente turno, para no
+  // dormir encima de él: 0 si ya toca o falta armar las alarmas (hay que
+  // llamar a poll()), SCHEDULE_NONE si no hay turnos
+  uint32_t msUntilNext(uint32_t now) const;
+
+  static uint32_t weekStart(uint32_t localTime)
+  {
+    uint32_t days = localTime / 86400;
+    return (days - (days + 4) % 7) * 86400; // 1970-01-01 fue jueves
+  }
+  static uint16_t minuteOfWeek(uint32_t localTime) { return (localTime - weekStart(localTime)) / 60; }
+};
+
+bool ScheduleTable ::add(uint8_t zone, uint16_t minuteOfWeek, uint16_t seconds)
+{
+  if (zone >= SCHEDULE_ZONES || minuteOfWeek >= SCHEDULE_MINUTES_PER_WEEK || seconds == 0)
+    return false;
+
+  ScheduleSlot *s = slots[zone];
+  uint8_t n = count[zone];
+  uint8_t i = 0;
+  while (i < n && s[i].minuteOfWeek < minuteOfWeek)
+    i++;
+  if (i < n && s[i].minuteOfWeek == minuteOfWeek)
+  {
+    s[i].seconds = seconds;
+    return true;
+  }
+  if (n >= SCHEDULE_MAX_SLOTS)
+    return false;
+  memmove(&s[i + 1], &s[i], (n - i) * sizeof(ScheduleSlot));
+  s[i].minuteOfWeek = minuteOfWeek;
+  s[i].seconds = seconds;
+  count[zone] = n + 1;
+  return true;
+}
+
+bool ScheduleTable ::equals(const ScheduleTable &other) const
+{
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    if (count[z] != other.count[z])
+      return false;
+    for (uint8_t i = 0; i < count[z]; i++)
+      if (slots[z][i].minuteOfWeek != other.slots[z][i].minuteOfWeek || slots[z][i].seconds != other.slots[z][i].seconds)
+        return false;
+  }
+  return true;
+}
+
+bool ScheduleTable ::valid(void) const
+{
+  // Para lo que se lee de la NVS: ordenada, sin repetidos y dentro de la semana
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    if (count[z] > SCHEDULE_MAX_SLOTS)
+      return false;
+    for (uint8_t i = 0; i < count[z]; i++)
+    {
+      if (slots[z][i].minuteOfWeek >= SCHEDULE_MINUTES_PER_WEEK || slots[z][i].seconds == 0)
+        return false;
+      if (i > 0 && slots[z][i].minuteOfWeek <= slots[z][i - 1].minuteOfWeek)
+        return false;
+    }
+  }
+  return true;
+}
+
+void ScheduleEngine ::arm(uint8_t zone, uint32_t from)
+{
+  // Primer turno que empieza en from o después
+  uint8_t n = table.count[zone];
+  if (n == 0)
+  {
+    dueAt[zone] = SCHEDULE_NONE;
+    return;
+  }
+
+  const ScheduleSlot *s = table.slots[zone];
+  uint32_t base = weekStart(from);
+  uint32_t key = (from - base + 59) / 60;
+  uint8_t lo = 0, hi = n;
+  while (lo < hi)
+  {
+    uint8_t mid = (lo + hi) / 2;
+    if (s[mid].minuteOfWeek < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == n)
+  {
+    lo = 0;
+    base += SCHEDULE_SECONDS_PER_WEEK;
+  }
+  dueAt[zone] = base + s[lo].minuteOfWeek * 60UL;
+  dueSeconds[zone] = s[lo].seconds;
+}
+
+void ScheduleEngine ::rearm(uint32_t now)
+{
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    uint32_t from = now;
+    if (lastFired[z] != 0 && lastFired[z] >= now && lastFired[z] - now < SCHEDULE_REPEAT_GUARD_S)
+      from = lastFired[z] + 60;
+    arm(z, from);
+  }
+}
+
+uint8_t ScheduleEngine ::poll(uint32_t now, ScheduleEvent *events)
+{
+  if (lastPoll != 0 && now < lastPoll)
+  {
+    clockJumps++;
+    pending = true;
+  }
+  lastPoll = now;
+  if (pending)
+  {
+    rearm(now);
+    pending = false;
+  }
+
+  uint8_t count = 0;
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    if (dueAt[z] == SCHEDULE_NONE || now < dueAt[z])
+      continue;
+
+    // Tras un salto largo no hace falta recorrer semana por semana
+    if (now - dueAt[z] > SCHEDULE_SECONDS_PER_WEEK)
+    {
+      skipped++;
+      arm(z, now - SCHEDULE_LATE_LIMIT_S);
+    }
+
+    // Si quedaron varios turnos atrás, sólo cuenta el último
+    uint32_t due = dueAt[z];
+    uint16_t seconds = dueSeconds[z];
+    arm(z, due + 60);
+    while (dueAt[z] <= now)
+    {
+      skipped++;
+      due = dueAt[z];
+      seconds = dueSeconds[z];
+      arm(z, due + 60);
+    }
+
+    if (now - due > SCHEDULE_LATE_LIMIT_S)
+    {
+      skipped++;
+      continue;
+    }
+    lastFired[z] = due;
+    fired++;
+    if (now - due >= 60)
+      late++;
+    events[count].zone = z;
+    events[count].seconds = seconds;
+    events[count].dueAt = due;
+    events[count].late = now - due;
+    count++;
+  }
+  return count;
+}
+
+uint32_t ScheduleEngine ::nextDue(void) const
+{
+  uint32_t next = SCHEDULE_NONE;
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+    if (dueAt[z] < next)
+      next = dueAt[z];
+  return next;
+}
+
+uint32_t ScheduleEngine ::msUntilNext(uint32_t now) const
+{
+  if (pending)
+    return 0;
+  uint32_t next = nextDue();
+  if (next == SCHEDULE_NONE)
+    return SCHEDULE_NONE;
+  if (next <= now)
+    return 0;
+  // La hora del RTC va en segundos enteros: se despierta a lo más 1 s antes
+  uint32_t seconds = next - now;
+  return seconds >= SCHEDULE_NONE / 1000 ? SCHEDULE_NONE - 1 : seconds * 1000;
+}
+
+#endif
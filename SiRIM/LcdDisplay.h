@@ -0,0 +1,305 @@
+#ifndef LcdDisplay_h
+#define LcdDisplay_h
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <LiquidCrystal_I2C.h>
+#include "SensorsData.h"
+#include "TelemetryEncoder.h"
+#include "ZoneController.h"
+
+/*
+  Pantalla LCD 16x2 con un framebuffer en RAM.
+
+  Cada página se escribe completa en LcdFrame y flush() sólo manda al módulo
+  las celdas que cambiaron desde la última vez: un setCursor al inicio de
+  cada tramo y los caracteres del tramo. Con el adaptador I2C (PCF8574 en
+  modo de 4 bits) cada carácter o comando son seis escrituras al expansor,
+  unos 12 bytes y ~1 ms de bus a 100 kHz. Repintar todo con clear() como
+  manejarCarrusel() de CodigoIoTV1.0BETA cuesta ~40 ms y parpadea; un dígito
+  que cambió cuesta dos escrituras.
+
+  Las páginas del carrusel son la tabla LCD_PAGES: cada renglón es una
+  etiqueta, el valor de DisplaySnapshot que muestra y sus unidades. La hora
+  sale del timestamp de la muestra, no de rtc.now(), así que la pantalla no
+  le quita el bus al RTC.
+
+  Sólo la tarea de pantalla (DualCore.h) escribe en el LCD después de
+  IrrigationControl::init(); las demás tareas le mandan DisplaySnapshot por
+  un ConfigMailbox.
+*/
+
+#define LCD_COLUMNS 16
+#define LCD_ROWS 2
+#define LCD_PAGE_MS 4000    // Tiempo de cada página del carrusel
+#ifndef LCD_REFRESH_MS
+#define LCD_REFRESH_MS 250  // Pasada de la tarea de pantalla
+#endif
+#define LCD_I2C_BYTES 12    // Bytes en el bus por carácter o comando (dirección + dato, 6 veces)
+
+// Lo que la pantalla necesita de las demás tareas; se copia con memcpy
+struct DisplaySnapshot
+{
+  SensorsData data;
+  uint8_t mode; // ActuationMode
+  int16_t lightThreshold;
+  int16_t soilThreshold;
+  uint8_t relays; // Bit por zona
+  bool backlight; // Apagada en bajo consumo: tampoco se refresca
+};
+
+enum LcdValue : uint8_t
+{
+  LCD_TEMPERATURE,
+  LCD_HUMIDITY,
+  LCD_LIGHT,
+  LCD_WATER_PERCENT,
+  LCD_MODE,
+  LCD_ZONES,
+  LCD_LIGHT_THRESHOLD,
+  LCD_SOIL_THRESHOLD,
+  LCD_TIME,
+  LCD_DATE
+};
+
+struct LcdLine
+{
+  const char *label;
+  LcdValue value;
+  uint8_t decimals;
+  const char *unit;
+};
+
+struct LcdPage
+{
+  LcdLine rows[LCD_ROWS];
+};
+
+// Las cinco pantallas de manejarCarrusel(); "Bomba" pasa a las dos zonas
+static const LcdPage LCD_PAGES[] = {
+    {{{"Temp: ", LCD_TEMPERATURE, 1, " C"}, {"Hum. Amb: ", LCD_HUMIDITY, 0, "%"}}},
+    {{{"Luz: ", LCD_LIGHT, 0, "%"}, {"N. agua: ", LCD_WATER_PERCENT, 0, "%"}}},
+    {{{"Modo: ", LCD_MODE, 0, ""}, {"Zonas: ", LCD_ZONES, 0, ""}}},
+    {{{"Luz Umbral: ", LCD_LIGHT_THRESHOLD, 0, ""}, {"Hum. Umbral: ", LCD_SOIL_THRESHOLD, 0, ""}}},
+    {{{"Hora: ", LCD_TIME, 0, ""}, {"Dia: ", LCD_DATE, 0, ""}}},
+};
+
+#define LCD_PAGE_COUNT (sizeof(LCD_PAGES) / sizeof(LCD_PAGES[0]))
+
+class LcdFrame
+{
+private:
+  char cells[LCD_ROWS][LCD_COLUMNS];
+  char shown[LCD_ROWS][LCD_COLUMNS]; // Lo que tiene el módulo
+  bool known = false;                // shown es válido (después del primer clear)
+
+public:
+  // Métricas: cada comando o carácter que salió al módulo
+  uint32_t writes = 0;
+  uint32_t flushes = 0;
+
+  LcdFrame(void) { clear(); }
+
+  // Sólo el framebuffer; el módulo no cambia hasta flush()
+  void clear(void) { memset(cells, ' ', sizeof(cells)); }
+  // Texto desde la columna, recortado al renglón
+  void print(uint8_t row, uint8_t column, const char *text);
+  // El módulo se reinició o alguien más escribió en él
+  void invalidate(void) { known = false; }
+
+  // Manda las celdas que cambiaron; devuelve las escrituras hechas
+  uint32_t flush(LiquidCrystal_I2C &lcd);
+
+  char cell(uint8_t row, uint8_t column) const { return cells[row][column]; }
+};
+
+class LcdDisplay
+{
+private:
+  LiquidCrystal_I2C &lcd;
+  LcdFrame frame;
+  uint8_t page = 0;
+  uint32_t pageAt = 0;
+  bool started = false;
+  bool lit = true;
+
+  static void formatValue(JsonWriter &w, const LcdLine &line, const DisplaySnapshot &view);
+
+public:
+  LcdDisplay(LiquidCrystal_I2C &device) : lcd(device) {}
+
+  // Dibuja la página vigente (rota cada LCD_PAGE_MS) y manda sólo lo que cambió
+  void show(const DisplaySnapshot &view, uint32_t nowMs);
+  // Adelanta el carrusel o vuelve a la primera página (botón)
+  void nextPage(uint32_t nowMs);
+  void firstPage(uint32_t nowMs);
+
+  static void renderPage(uint8_t page, const DisplaySnapshot &view, LcdFrame &frame);
+
+  uint8_t currentPage(void) const { return page; }
+  const LcdFrame &framebuffer(void) const { return frame; }
+};
+
+/*-- LcdFrame --*/
+
+void LcdFrame ::print(uint8_t row, uint8_t column, const char *text)
+{
+  if (row >= LCD_ROWS)
+    return;
+  while (*text && column < LCD_COLUMNS)
+    cells[row][column++] = *text++;
+}
+
+uint32_t LcdFrame ::flush(LiquidCrystal_I2C &lcd)
+{
+  uint32_t before = writes;
+  if (!known)
+  {
+    lcd.clear();
+    memset(shown, ' ', sizeof(shown));
+    known = true;
+    writes++;
+  }
+
+  for (uint8_t r = 0; r < LCD_ROWS; r++)
+  {
+    int8_t cursor = -1; // Columna donde quedó el cursor del módulo en este renglón
+    for (uint8_t c = 0; c < LCD_COLUMNS; c++)
+    {
+      if (cells[r][c] == shown[r][c])
+        continue;
+      // El cursor avanza solo; sólo un salto necesita setCursor
+      if (cursor != c)
+      {
+        lcd.setCursor(c, r);
+        writes++;
+      }
+      lcd.write((uint8_t)cells[r][c]);
+      writes++;
+      shown[r][c] = cells[r][c];
+      cursor = c + 1;
+    }
+  }
+  flushes++;
+  return writes - before;
+}
+
+/*-- LcdDisplay --*/
+
+void LcdDisplay ::formatValue(JsonWriter &w, const LcdLine &line, const DisplaySnapshot &view)
+{
+  const SensorsData &d = view.data;
+  switch (line.value)
+  {
+  case LCD_TEMPERATURE:
+  case LCD_HUMIDITY:
+  {
+    float value = line.value == LCD_TEMPERATURE ? d.temperature : d.humidity;
+    if (isnan(value))
+      w.raw("--");
+    else
+      w.number(value, line.decimals);
+    break;
+  }
+  case LCD_LIGHT:
+    w.number((int32_t)d.lightIntensity);
+    break;
+  case LCD_WATER_PERCENT:
+    w.number((int32_t)d.waterPercent);
+    break;
+  case LCD_MODE:
+    w.raw(view.mode == ACTUATION_MANUAL ? "manual" : view.mode == ACTUATION_TIMER ? "horario" : "auto");
+    break;
+  case LCD_ZONES:
+    for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+      w.raw((view.relays >> z) & 1 ? (z == 0 ? "ON" : " ON") : (z == 0 ? "OFF" : " OFF"));
+    break;
+  case LCD_LIGHT_THRESHOLD:
+    w.number((int32_t)view.lightThreshold);
+    break;
+  case LCD_SOIL_THRESHOLD:
+    w.number((int32_t)view.soilThreshold);
+    break;
+  case LCD_TIME:
+  case LCD_DATE:
+  {
+    CivilTime t = TelemetryEncoder::civilFromUnix(d.timestamp);
+    if (line.value == LCD_TIME)
+    {
+      // H:MM como el carrusel original
+      w.digits(t.hour);
+      w.raw(t.minute < 10 ? ":0" : ":");
+      w.digits(t.minute);
+    }
+    else
+    {
+      w.digits(t.day);
+      w.raw("/");
+      w.digits(t.month);
+      w.raw("/");
+      w.digits(t.year);
+    }
+    break;
+  }
+  }
+}
+
+void LcdDisplay ::renderPage(uint8_t page, const DisplaySnapshot &view, LcdFrame &frame)
+{
+  frame.clear();
+  for (uint8_t r = 0; r < LCD_ROWS; r++)
+  {
+    const LcdLine &line = LCD_PAGES[page % LCD_PAGE_COUNT].rows[r];
+    char text[LCD_COLUMNS + 1];
+    JsonWriter w(text, sizeof(text));
+    w.raw(line.label);
+    formatValue(w, line, view);
+    w.raw(line.unit);
+    w.finish();
+    frame.print(r, 0, text);
+  }
+}
+
+void LcdDisplay ::show(const DisplaySnapshot &view, uint32_t nowMs)
+{
+  if (view.backlight != lit)
+  {
+    lit = view.backlight;
+    if (lit)
+      lcd.backlight();
+    else
+      lcd.noBacklight();
+    frame.writes++;
+  }
+  // Con la luz apagada no se ve: no se gasta el bus
+  if (!lit)
+    return;
+
+  if (!started)
+  {
+    started = true;
+    pageAt = nowMs;
+  }
+  else if (nowMs - pageAt >= LCD_PAGE_MS)
+  {
+    page = (page + 1) % LCD_PAGE_COUNT;
+    pageAt = nowMs;
+  }
+  renderPage(page, view, frame);
+  frame.flush(lcd);
+}
+
+void LcdDisplay ::nextPage(uint32_t nowMs)
+{
+  page = (page + 1) % LCD_PAGE_COUNT;
+  pageAt = nowMs;
+}
+
+void LcdDisplay ::firstPage(uint32_t nowMs)
+{
+  page = 0;
+  pageAt = nowMs;
+}
+
+#endif
@@ -0,0 +1,823 @@
+#ifndef NodeConfig_h
+#define NodeConfig_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "ReportFilter.h"
+#include "IrrigationSchedule.h"
+#include "PowerManager.h"
+#include "Rollup.h"
+#include "FirebaseSink.h"
+#include "ZoneController.h"
+
+/*
+  Configuración remota del nodo (tópico ucol/iot/config).
+
+    {"reporte": {"activo": true, "temperaturaAmbiente": 0.5, "humedadAmbiente": 2,
+                 "humedadSuelo": 2, "iluminacion": 5, "nivelAgua": 1.0,
+                 "porcentajeAgua": 5, "latidoSeg": 300},
+     "riego":   {"umbralLuz": 100, "umbralSuelo": 40,
+                 "manual": false, "temporizador": true, "regar": false},
+     "horario": [{"zona": 1, "dias": "LMXJV", "hora": "6:30", "segundos": 600},
+                 {"zona": 2, "hora": "19:00", "segundos": 300}],
+     "energia": {"bajoConsumo": true, "muestraSeg": 60, "lote": 10, "radioCada": 10},
+     "resumen": {"soloResumen": false, "minuto": true, "hora": true, "dia": true},
+     "firebase": {"lote": 10, "latenciaSeg": 60}}
+
+  Las secciones y los campos que no vienen conservan su valor; las claves
+  desconocidas se ignoran. "horario" reemplaza todos los turnos: sin "zona"
+  aplica a todas, sin "dias" (D L M X J V S) a toda la semana, y [] borra el
+  horario. Por compatibilidad, "hora" y "segundos" dentro de "riego" dejan un
+  solo turno diario en todas las zonas ("hora" vacía lo borra) y "segundos"
+  solo cambia la duración de los turnos existentes. "energia" activa el modo
+  de bajo consumo (ver PowerManager.h); con el radio apagado la
+  configuración sólo llega en las ventanas, así que conviene publicarla
+  retenida. "resumen" elige qué resúmenes por ventana se publican (ver
+  Rollup.h); con "soloResumen" las muestras en vivo ya no se publican.
+  "firebase" fija el tamaño del lote y la espera máxima de la telemetría que
+  se escribe en Firebase (ver FirebaseSink.h). "umbralSuelo" llega hasta
+  100 - ZONE_HYSTERESIS: más arriba la zona nunca alcanzaría la humedad para
+  apagarse.
+
+  El mensaje se recorre en su propio búfer: las claves se comparan en el
+  lugar y los números se convierten sin copiarlos, así que no se crea
+  ningún String ni documento JSON. Un campo con el tipo equivocado o fuera
+  de rango rechaza todo el mensaje y la configuración queda como estaba.
+*/
+
+#define IRRIGATION_MAX_SECONDS 3600
+#define IRRIGATION_DEFAULT_SECONDS 10
+#define CONFIG_MAX_DEPTH 8
+
+// Parámetros de riego que llegan por MQTT (sólo tipos simples, se copia con memcpy)
+struct ChangeConfiguration
+{
+  int16_t setLightThreshold;
+  int16_t setSoilMoistureThreshold;
+  bool setManualIrrigationMode;
+  bool setTimerIrrigationMode;
+  bool setIrrigationStatus;
+};
+
+// Umbrales de CodigoIoTV1.0BETA mientras no llegue configuración; con 100 el
+// suelo nunca supera el umbral más ZONE_HYSTERESIS y las zonas no se apagan
+static const ChangeConfiguration DEFAULT_IRRIGATION_CONFIG = {50, 50, false, false, false};
+
+// Lo que la tarea de red entrega a la tarea de control por ConfigMailbox
+struct NodeConfig
+{
+  ReportConfig report;
+  ChangeConfiguration irrigation;
+  ScheduleTable schedule;
+  PowerConfig power;
+  RollupConfig rollup;
+  FirebaseConfig firebase;
+  uint32_t receivedAt; // micros() al recibir el mensaje, para medir la latencia
+};
+
+// Comparación campo por campo (memcmp vería el relleno entre campos)
+inline bool sameConfig(const ReportConfig &a, const ReportConfig &b)
+{
+  return a.enabled == b.enabled && a.temperature == b.temperature && a.humidity == b.humidity &&
+         a.soilMoisture == b.soilMoisture && a.light == b.light && a.waterLevel == b.waterLevel &&
+         a.waterPercent == b.waterPercent && a.heartbeatMs == b.heartbeatMs;
+}
+
+inline bool sameConfig(const ChangeConfiguration &a, const ChangeConfiguration &b)
+{
+  return a.setLightThreshold == b.setLightThreshold && a.setSoilMoistureThreshold == b.setSoilMoistureThreshold &&
+         a.setManualIrrigationMode == b.setManualIrrigationMode &&
+         a.setTimerIrrigationMode == b.setTimerIrrigationMode && a.setIrrigationStatus == b.setIrrigationStatus;
+}
+
+inline bool sameConfig(const PowerConfig &a, const PowerConfig &b)
+{
+  return a.lowPower == b.lowPower && a.sampleSeconds == b.sampleSeconds && a.batchSize == b.batchSize &&
+         a.radioEvery == b.radioEvery;
+}
+
+inline bool sameConfig(const RollupConfig &a, const RollupConfig &b)
+{
+  for (uint8_t i = 0; i < ROLLUP_WINDOWS; i++)
+    if (a.publish[i] != b.publish[i])
+      return false;
+  return a.rollupOnly == b.rollupOnly;
+}
+
+inline bool sameConfig(const FirebaseConfig &a, const FirebaseConfig &b)
+{
+  return a.batchSize == b.batchSize && a.maxLatencySeconds == b.maxLatencySeconds;
+}
+
+enum ConfigStatus
+{
+  CONFIG_OK,
+  CONFIG_EMPTY,  // Sin secciones conocidas
+  CONFIG_SYNTAX, // JSON mal formado
+  CONFIG_TYPE,   // Un campo con el tipo equivocado
+  CONFIG_RANGE   // Un valor fuera de rango
+};
+
+/*-- Recorrido del JSON en el lugar --*/
+
+class JsonScanner
+{
+private:
+  const char *p;
+  const char *end;
+  bool error = false;
+
+  void skipSpace(void)
+  {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+      p++;
+  }
+  bool expect(char c)
+  {
+    skipSpace();
+    if (p >= end || *p != c)
+      return fail();
+    p++;
+    return true;
+  }
+  bool fail(void)
+  {
+    error = true;
+    return false;
+  }
+  bool skipString(void);
+  bool skipValue(uint8_t depth);
+
+public:
+  JsonScanner(const uint8_t *data, size_t length) : p((const char *)data), end((const char *)data + length) {}
+
+  bool failed(void) { return error; }
+  bool atEnd(void)
+  {
+    skipSpace();
+    return p >= end;
+  }
+
+  char peek(void)
+  {
+    skipSpace();
+    return p < end ? *p : '\0';
+  }
+  bool beginObject(void) { return expect('{'); }
+  bool beginArray(void) { return expect('['); }
+
+  // Siguiente elemento del arreglo actual; false al llegar a ']' o con error
+  bool nextItem(bool &first);
+
+  // Siguiente clave del objeto actual; false al llegar a '}' o con error
+  bool nextKey(const char *&key, size_t &keyLength, bool &first);
+  bool keyIs(const char *key, size_t keyLength, const char *name)
+  {
+    return strlen(name) == keyLength && memcmp(key, name, keyLength) == 0;
+  }
+
+  bool readNumber(float &out);
+  bool readNumber(double &out); // Enteros grandes (timestamps) sin perder precisión
+  bool readBool(bool &out);
+  // Texto sin secuencias de escape (no hacen falta en la configuración)
+  bool readString(const char *&text, size_t &length);
+  bool skip(void) { return skipValue(0); }
+};
+
+bool JsonScanner ::nextKey(const char *&key, size_t &keyLength, bool &first)
+{
+  skipSpace();
+  if (p < end && *p == '}')
+  {
+    p++;
+    return false;
+  }
+  if (!first && !expect(','))
+    return false;
+  first = false;
+  if (!readString(key, keyLength))
+    return false;
+  return expect(':');
+}
+
+bool JsonScanner ::nextItem(bool &first)
+{
+  skipSpace();
+  if (p < end && *p == ']')
+  {
+    p++;
+    return false;
+  }
+  if (!first && !expect(','))
+    return false;
+  first = false;
+  return true;
+}
+
+bool JsonScanner ::readString(const char *&text, size_t &length)
+{
+  if (!expect('"'))
+    return false;
+  text = p;
+  while (p < end && *p != '"')
+  {
+    if (*p == '\\')
+      return fail();
+    p++;
+  }
+  if (p >= end)
+    return fail();
+  length = p - text;
+  p++;
+  return true;
+}
+
+bool JsonScanner ::readNumber(float &out)
+{
+  double value;
+  if (!readNumber(value))
+    return false;
+  out = (float)value;
+  return true;
+}
+
+bool JsonScanner ::readNumber(double &out)
+{
+  skipSpace();
+  bool negative = p < end && *p == '-';
+  if (negative)
+    p++;
+  if (p >= end || *p < '0' || *p > '9')
+    return fail();
+
+  double value = 0;
+  while (p < end && *p >= '0' && *p <= '9')
+    value = value * 10 + (*p++ - '0');
+  if (p < end && *p == '.')
+  {
+    p++;
+    double scale = 0.1;
+    if (p >= end || *p < '0' || *p > '9')
+      return fail();
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+      value += (*p++ - '0') * scale;
+      scale /= 10;
+    }
+  }
+  if (p < end && (*p == 'e' || *p == 'E'))
+  {
+    p++;
+    bool negativeExponent = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+      p++;
+    if (p >= end || *p < '0' || *p > '9')
+      return fail();
+    int exponent = 0;
+    while (p < end && *p >= '0' && *p <= '9' && exponent < 100)
+      exponent = exponent * 10 + (*p++ - '0');
+    while (exponent-- > 0)
+      value = negativeExponent ? value / 10 : value * 10;
+  }
+  out = negative ? -value : value;
+  return true;
+}
+
+bool JsonScanner ::readBool(bool &out)
+{
+  skipSpace();
+  if (end - p >= 4 && memcmp(p, "true", 4) == 0)
+  {
+    p += 4;
+    out = true;
+    return true;
+  }
+  if (end - p >= 5 && memcmp(p, "false", 5) == 0)
+  {
+    p += 5;
+    out = false;
+    return true;
+  }
+  return fail();
+}
+
+bool JsonScanner ::skipValue(uint8_t depth)
+{
+  if (depth > CONFIG_MAX_DEPTH)
+    return fail();
+  char c = peek();
+  if (c == '"')
+  {
+    const char *text;
+    size_t length;
+    return readString(text, length);
+  }
+  if (c == '{' || c == '[')
+  {
+    p++;
+    bool object = c == '{';
+    if (peek() == (object ? '}' : ']'))
+    {
+      p++;
+      return true;
+    }
+    while (true)
+    {
+      if (object)
+      {
+        const char *key;
+        size_t keyLength;
+        if (!readString(key, keyLength) || !expect(':'))
+          return false;
+      }
+      if (!skipValue(depth + 1))
+        return false;
+      c = peek();
+      p++;
+      if (c == ',')
+        continue;
+      return c == (object ? '}' : ']') ? true : fail();
+    }
+  }
+  if (c == 't' || c == 'f')
+  {
+    bool ignored;
+    return readBool(ignored);
+  }
+  if (c == 'n')
+  {
+    if (end - p < 4 || memcmp(p, "null", 4) != 0)
+      return fail();
+    p += 4;
+    return true;
+  }
+  float ignored;
+  return readNumber(ignored);
+}
+
+/*-- Configuración --*/
+
+class NodeConfigParser
+{
+private:
+  static ConfigStatus number(JsonScanner &json, float &out);
+  static ConfigStatus boolean(JsonScanner &json, bool &out);
+  static ConfigStatus parseReport(JsonScanner &json, ReportConfig &report);
+  static ConfigStatus parseIrrigation(JsonScanner &json, ChangeConfiguration &irrigation, ScheduleTable &schedule);
+  static ConfigStatus parseSchedule(JsonScanner &json, ScheduleTable &schedule);
+  static ConfigStatus parseTurn(JsonScanner &json, ScheduleTable &schedule);
+  static ConfigStatus parsePower(JsonScanner &json, PowerConfig &power);
+  static ConfigStatus parseRollup(JsonScanner &json, RollupConfig &rollup);
+  static ConfigStatus parseFirebase(JsonScanner &json, FirebaseConfig &firebase);
+  static ConfigStatus time(JsonScanner &json, int16_t &minute);
+  static bool parseTime(const char *text, size_t length, int16_t &minute);
+  static bool parseDays(const char *text, size_t length, uint8_t &days);
+
+public:
+  // Aplica el mensaje sobre config; si no es válido, config no cambia
+  static ConfigStatus parse(const uint8_t *payload, size_t length, NodeConfig &config, uint32_t minHeartbeatMs);
+  static const char *describe(ConfigStatus status);
+};
+
+ConfigStatus NodeConfigParser ::number(JsonScanner &json, float &out)
+{
+  char c = json.peek();
+  if (c == '"' || c == '{' || c == '[' || c == 't' || c == 'f' || c == 'n')
+    return CONFIG_TYPE;
+  return json.readNumber(out) ? CONFIG_OK : CONFIG_SYNTAX;
+}
+
+ConfigStatus NodeConfigParser ::boolean(JsonScanner &json, bool &out)
+{
+  char c = json.peek();
+  if (c != 't' && c != 'f')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  return json.readBool(out) ? CONFIG_OK : CONFIG_SYNTAX;
+}
+
+ConfigStatus NodeConfigParser ::parseReport(JsonScanner &json, ReportConfig &report)
+{
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+  float soil = report.soilMoisture;
+  float light = report.light;
+  float waterPercent = report.waterPercent;
+  float heartbeatSeconds = report.heartbeatMs / 1000.0f;
+
+  char c = json.peek();
+  if (c != '{')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginObject();
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "activo"))
+      status = boolean(json, report.enabled);
+    else if (json.keyIs(key, keyLength, "temperaturaAmbiente"))
+      status = number(json, report.temperature);
+    else if (json.keyIs(key, keyLength, "humedadAmbiente"))
+      status = number(json, report.humidity);
+    else if (json.keyIs(key, keyLength, "humedadSuelo"))
+      status = number(json, soil);
+    else if (json.keyIs(key, keyLength, "iluminacion"))
+      status = number(json, light);
+    else if (json.keyIs(key, keyLength, "nivelAgua"))
+      status = number(json, report.waterLevel);
+    else if (json.keyIs(key, keyLength, "porcentajeAgua"))
+      status = number(json, waterPercent);
+    else if (json.keyIs(key, keyLength, "latidoSeg"))
+      status = number(json, heartbeatSeconds);
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed())
+    return CONFIG_SYNTAX;
+  if (soil > 100 || light > 100 || waterPercent > 100 || heartbeatSeconds < 0 || heartbeatSeconds > 86400)
+    return CONFIG_RANGE;
+  report.soilMoisture = (int16_t)soil;
+  report.light = (int16_t)light;
+  report.waterPercent = (int16_t)waterPercent;
+  report.heartbeatMs = (uint32_t)(heartbeatSeconds * 1000);
+  return CONFIG_OK;
+}
+
+bool NodeConfigParser ::parseTime(const char *text, size_t length, int16_t &minute)
+{
+  // "H:MM" o "HH:MM"; vacío = sin horario
+  if (length == 0)
+  {
+    minute = -1;
+    return true;
+  }
+  int hour = 0, minutes = 0;
+  size_t i = 0;
+  for (; i < length && i < 2 && text[i] >= '0' && text[i] <= '9'; i++)
+    hour = hour * 10 + (text[i] - '0');
+  if (i == 0 || i >= length || text[i] != ':' || length - i != 3)
+    return false;
+  for (i++; i < length; i++)
+  {
+    if (text[i] < '0' || text[i] > '9')
+      return false;
+    minutes = minutes * 10 + (text[i] - '0');
+  }
+  if (hour > 23 || minutes > 59)
+    return false;
+  minute = (int16_t)(hour * 60 + minutes);
+  return true;
+}
+
+ConfigStatus NodeConfigParser ::time(JsonScanner &json, int16_t &minute)
+{
+  const char *text;
+  size_t length;
+  char c = json.peek();
+  if (c != '"')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  if (!json.readString(text, length))
+    return CONFIG_SYNTAX;
+  return parseTime(text, length, minute) ? CONFIG_OK : CONFIG_RANGE;
+}
+
+bool NodeConfigParser ::parseDays(const char *text, size_t length, uint8_t &days)
+{
+  // Iniciales desde el domingo, como DateTime::dayOfTheWeek
+  static const char initials[] = "DLMXJVS";
+  days = 0;
+  for (size_t i = 0; i < length; i++)
+  {
+    char c = text[i] >= 'a' && text[i] <= 'z' ? text[i] - 'a' + 'A' : text[i];
+    const char *day = strchr(initials, c);
+    if (c == '\0' || day == NULL)
+      return false;
+    days |= 1 << (day - initials);
+  }
+  return days != 0;
+}
+
+ConfigStatus NodeConfigParser ::parseIrrigation(JsonScanner &json, ChangeConfiguration &irrigation, ScheduleTable &schedule)
+{
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+  float light = irrigation.setLightThreshold;
+  float soil = irrigation.setSoilMoistureThreshold;
+  float seconds = -1;
+  int16_t minute = 0;
+  bool hasTime = false;
+
+  char c = json.peek();
+  if (c != '{')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginObject();
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "hora"))
+    {
+      status = time(json, minute);
+      hasTime = true;
+    }
+    else if (json.keyIs(key, keyLength, "segundos"))
+      status = number(json, seconds);
+    else if (json.keyIs(key, keyLength, "umbralLuz"))
+      status = number(json, light);
+    else if (json.keyIs(key, keyLength, "umbralSuelo"))
+      status = number(json, soil);
+    else if (json.keyIs(key, keyLength, "manual"))
+      status = boolean(json, irrigation.setManualIrrigationMode);
+    else if (json.keyIs(key, keyLength, "temporizador"))
+      status = boolean(json, irrigation.setTimerIrrigationMode);
+    else if (json.keyIs(key, keyLength, "regar"))
+      status = boolean(json, irrigation.setIrrigationStatus);
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed())
+    return CONFIG_SYNTAX;
+  if ((seconds != -1 && (seconds < 1 || seconds > IRRIGATION_MAX_SECONDS)) || light < 0 || light > 100 || soil < 0 ||
+      soil > 100 - ZONE_HYSTERESIS)
+    return CONFIG_RANGE;
+  irrigation.setLightThreshold = (int16_t)light;
+  irrigation.setSoilMoistureThreshold = (int16_t)soil;
+
+  // Forma anterior: un solo turno diario para todas las zonas
+  if (hasTime)
+  {
+    schedule.clear();
+    for (uint8_t z = 0; minute >= 0 && z < SCHEDULE_ZONES; z++)
+      for (uint8_t d = 0; d < 7; d++)
+        schedule.add(z, d * 1440 + minute, seconds != -1 ? (uint16_t)seconds : IRRIGATION_DEFAULT_SECONDS);
+  }
+  else if (seconds != -1)
+  {
+    for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+      for (uint8_t i = 0; i < schedule.count[z]; i++)
+        schedule.slots[z][i].seconds = (uint16_t)seconds;
+  }
+  return CONFIG_OK;
+}
+
+ConfigStatus NodeConfigParser ::parseTurn(JsonScanner &json, ScheduleTable &schedule)
+{
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+  float zone = 0; // 0 = todas
+  float seconds = IRRIGATION_DEFAULT_SECONDS;
+  int16_t minute = -1;
+  uint8_t days = 0x7F;
+
+  char c = json.peek();
+  if (c != '{')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginObject();
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "zona"))
+      status = number(json, zone);
+    else if (json.keyIs(key, keyLength, "hora"))
+      status = time(json, minute);
+    else if (json.keyIs(key, keyLength, "segundos"))
+      status = number(json, seconds);
+    else if (json.keyIs(key, keyLength, "dias"))
+    {
+      const char *text;
+      size_t length;
+      if (json.peek() != '"')
+        status = CONFIG_TYPE;
+      else if (!json.readString(text, length))
+        status = CONFIG_SYNTAX;
+      else
+        status = parseDays(text, length, days) ? CONFIG_OK : CONFIG_RANGE;
+    }
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed())
+    return CONFIG_SYNTAX;
+  if (minute < 0 || zone < 0 || zone > SCHEDULE_ZONES || zone != (int)zone || seconds < 1 ||
+      seconds > IRRIGATION_MAX_SECONDS)
+    return CONFIG_RANGE;
+
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    if (zone != 0 && z != zone - 1)
+      continue;
+    for (uint8_t d = 0; d < 7; d++)
+      if ((days & (1 << d)) && !schedule.add(z, d * 1440 + minute, (uint16_t)seconds))
+        return CONFIG_RANGE; // Más de SCHEDULE_MAX_SLOTS turnos en la zona
+  }
+  return CONFIG_OK;
+}
+
+ConfigStatus NodeConfigParser ::parseSchedule(JsonScanner &json, ScheduleTable &schedule)
+{
+  bool first = true;
+  char c = json.peek();
+  if (c != '[')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginArray();
+  schedule.clear();
+  while (json.nextItem(first))
+  {
+    ConfigStatus status = parseTurn(json, schedule);
+    if (status != CONFIG_OK)
+      return status;
+  }
+  return json.failed() ? CONFIG_SYNTAX : CONFIG_OK;
+}
+
+ConfigStatus NodeConfigParser ::parsePower(JsonScanner &json, PowerConfig &power)
+{
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+  float sampleSeconds = power.sampleSeconds;
+  float batchSize = power.batchSize;
+  float radioEvery = power.radioEvery;
+
+  char c = json.peek();
+  if (c != '{')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginObject();
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "bajoConsumo"))
+      status = boolean(json, power.lowPower);
+    else if (json.keyIs(key, keyLength, "muestraSeg"))
+      status = number(json, sampleSeconds);
+    else if (json.keyIs(key, keyLength, "lote"))
+      status = number(json, batchSize);
+    else if (json.keyIs(key, keyLength, "radioCada"))
+      status = number(json, radioEvery);
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed())
+    return CONFIG_SYNTAX;
+  if (sampleSeconds < POWER_MIN_SAMPLE_SECONDS || sampleSeconds > POWER_MAX_SAMPLE_SECONDS || batchSize < 1 ||
+      batchSize > POWER_MESSAGE_MAX_SAMPLES || radioEvery < 1 || radioEvery > POWER_RADIO_MAX_EVERY)
+    return CONFIG_RANGE;
+  power.sampleSeconds = (uint16_t)sampleSeconds;
+  power.batchSize = (uint8_t)batchSize;
+  power.radioEvery = (uint8_t)radioEvery;
+  return CONFIG_OK;
+}
+
+ConfigStatus NodeConfigParser ::parseRollup(JsonScanner &json, RollupConfig &rollup)
+{
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+
+  char c = json.peek();
+  if (c != '{')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginObject();
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "soloResumen"))
+      status = boolean(json, rollup.rollupOnly);
+    else if (json.keyIs(key, keyLength, "minuto"))
+      status = boolean(json, rollup.publish[ROLLUP_MINUTE]);
+    else if (json.keyIs(key, keyLength, "hora"))
+      status = boolean(json, rollup.publish[ROLLUP_HOUR]);
+    else if (json.keyIs(key, keyLength, "dia"))
+      status = boolean(json, rollup.publish[ROLLUP_DAY]);
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  return json.failed() ? CONFIG_SYNTAX : CONFIG_OK;
+}
+
+ConfigStatus NodeConfigParser ::parseFirebase(JsonScanner &json, FirebaseConfig &firebase)
+{
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+  float batchSize = firebase.batchSize;
+  float maxLatencySeconds = firebase.maxLatencySeconds;
+
+  char c = json.peek();
+  if (c != '{')
+    return c == '\0' ? CONFIG_SYNTAX : CONFIG_TYPE;
+  json.beginObject();
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "lote"))
+      status = number(json, batchSize);
+    else if (json.keyIs(key, keyLength, "latenciaSeg"))
+      status = number(json, maxLatencySeconds);
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed())
+    return CONFIG_SYNTAX;
+  if (batchSize < 1 || batchSize > FIREBASE_BATCH_MAX || maxLatencySeconds < 1 ||
+      maxLatencySeconds > FIREBASE_MAX_LATENCY_S)
+    return CONFIG_RANGE;
+  firebase.batchSize = (uint8_t)batchSize;
+  firebase.maxLatencySeconds = (uint16_t)maxLatencySeconds;
+  return CONFIG_OK;
+}
+
+ConfigStatus NodeConfigParser ::parse(const uint8_t *payload, size_t length, NodeConfig &config, uint32_t minHeartbeatMs)
+{
+  JsonScanner json(payload, length);
+  NodeConfig next = config;
+  bool known = false;
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+
+  if (!json.beginObject())
+    return CONFIG_SYNTAX;
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status = CONFIG_OK;
+    if (json.keyIs(key, keyLength, "reporte"))
+    {
+      status = parseReport(json, next.report);
+      known = true;
+    }
+    else if (json.keyIs(key, keyLength, "riego"))
+    {
+      status = parseIrrigation(json, next.irrigation, next.schedule);
+      known = true;
+    }
+    else if (json.keyIs(key, keyLength, "horario"))
+    {
+      status = parseSchedule(json, next.schedule);
+      known = true;
+    }
+    else if (json.keyIs(key, keyLength, "energia"))
+    {
+      status = parsePower(json, next.power);
+      known = true;
+    }
+    else if (json.keyIs(key, keyLength, "resumen"))
+    {
+      status = parseRollup(json, next.rollup);
+      known = true;
+    }
+    else if (json.keyIs(key, keyLength, "firebase"))
+    {
+      status = parseFirebase(json, next.firebase);
+      known = true;
+    }
+    else if (!json.skip())
+      status = CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed() || !json.atEnd())
+    return CONFIG_SYNTAX;
+  if (!known)
+    return CONFIG_EMPTY;
+
+  const ReportConfig &r = next.report;
+  if (r.temperature < 0 || r.humidity < 0 || r.soilMoisture < 0 || r.light < 0 || r.waterLevel < 0 ||
+      r.waterPercent < 0 || r.heartbeatMs < minHeartbeatMs)
+    return CONFIG_RANGE;
+
+  config = next;
+  return CONFIG_OK;
+}
+
+const char *NodeConfigParser ::describe(ConfigStatus status)
+{
+  switch (status)
+  {
+  case CONFIG_OK:
+    return "aplicada";
+  case CONFIG_EMPTY:
+    return "sin secciones conocidas";
+  case CONFIG_SYNTAX:
+    return "JSON mal formado";
+  case CONFIG_TYPE:
+    return "tipo de dato incorrecto";
+  default:
+    return "valor fuera de rango";
+  }
+}
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef OutboundBacklog_h
+#define OutboundBacklog_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Datalog.h"
+
+/*
+  Respaldo de mensajes salientes para cortes de WiFi o del broker.
+
+  SpillQueue es una cola FIFO persistente sobre un archivo preasignado de la
+  microSD (mismo BlockStorage que la bitácora). Los mensajes se agrupan en un
+  bloque en RAM y se escriben de 512 en 512 bytes; al consumir un bloque
+  completo se borra en la tarjeta para que no se reenvíe tras un reinicio.
+
+  Garantías (ver Herramientas/sim_respaldo.cpp):
+    - El respaldo sale en orden FIFO y sin pérdidas mientras quepa en el anillo;
+      lleno, se sacrifica el bloque más antiguo y se cuenta en droppedMessages.
+    - Al volver la conexión, DualCore reenvía el respaldo al ritmo de
+      ReplayPacer y, mientras quede algo, forma los mensajes nuevos detrás
+      en lugar de publicarlos: el orden global se conserva a costa de que
+      lo nuevo espere a que el respaldo termine de salir.
+    - Entre reinicios la entrega es "al menos una vez": un bloque consumido a
+      medias vuelve completo después de begin().
+
+  Formato de bloque (little endian):
+    0   uint32 magic      SPILL_MAGIC
+    4   uint32 sequence   Número de bloque, crece de forma monótona
+    8   uint16 count      Mensajes en el bloque
+    10  uint16 used       Bytes ocupados incluyendo el encabezado
+    12  uint32 crc        CRC-32 del bloque completo con este campo en cero
+    16  mensajes: uint16 longitud, uint32 timestamp, bytes del mensaje
+*/
+
+#define SPILL_MAGIC 0x4C495053UL // "SPIL"
+#define SPILL_HEADER_SIZE 16
+#define SPILL_ENTRY_HEADER_SIZE 6
+#define SPILL_MAX_MESSAGE (DATALOG_BLOCK_SIZE - SPILL_HEADER_SIZE - SPILL_ENTRY_HEADER_SIZE)
+
+class SpillQueue
+{
+private:
+  BlockStorage &storage;
+  uint8_t writeBuffer[DATALOG_BLOCK_SIZE]; // Bloque en construcción (los más nuevos)
+  uint8_t readBuffer[DATALOG_BLOCK_SIZE];  // Bloque más antiguo cargado desde la SD
+  uint16_t writeUsed = SPILL_HEADER_SIZE;
+  uint16_t writeCount = 0;
+  uint16_t readOffset = 0;
+  uint16_t readRemaining = 0;
+  bool readLoaded = false;
+
+  uint32_t headIndex = 0;    // Bloque más antiguo pendiente en la SD
+  uint32_t tailIndex = 0;    // Siguiente bloque a escribir
+  uint32_t tailSequence = 0; // Secuencia del bloque en construcción
+  uint32_t storedBlocks = 0; // Bloques pendientes en la SD
+  bool ready = false;
+
+  void sealBlock(uint8_t *buffer);
+  bool sealAndStore(void);
+  static bool isSpillBlock(const uint8_t *buffer);
+  bool loadHead(void);
+  void releaseHead(void);
+
+public:
+  // Métricas
+  uint32_t depth = 0;           // Mensajes pendientes (RAM + SD)
+  uint32_t spilledBytes = 0;    // Bytes escritos en la SD desde el arranque
+  uint32_t droppedMessages = 0; // Perdidos por falta de espacio o bloques corruptos
+
+  SpillQueue(BlockStorage &blockStorage) : storage(blockStorage) {}
+
+  // Recupera los bloques pendientes de una ejecución anterior
+  bool begin(void);
+  bool isReady(void) { return ready; }
+
+  bool push(const char *message, uint16_t length, uint32_t timestamp);
+
+  // Copia el mensaje más antiguo sin quitarlo; pop() lo descarta una vez publicado.
+  // length recibe los bytes copiados (los mensajes binarios pueden tener ceros)
+  bool front(char *out, size_t size, uint32_t *timestamp, uint16_t *length = NULL);
+  void pop(void);
+
+  // Guarda el bloque en construcción para que sobreviva a un reinicio
+  bool flush(void);
+};
+
+// Limitador de tasa (cubeta de fichas) para reenviar el respaldo sin saturar
+// al broker ni retrasar las muestras en vivo.
+class ReplayPacer
+{
+private:
+  uint32_t ratePerSecond;
+  uint32_t burst;
+  uint32_t milliTokens;
+  uint32_t lastRefill = 0;
+
+public:
+  ReplayPacer(uint32_t messagesPerSecond, uint32_t maxBurst)
+      : ratePerSecond(messagesPerSecond), burst(maxBurst), milliTokens(maxBurst * 1000) {}
+
+  void setRate(uint32_t messagesPerSecond) { ratePerSecond = messagesPerSecond; }
+  uint32_t rate(void) { return ratePerSecond; }
+
+  // Devuelve true si se puede enviar un mensaje en el instante nowMs
+  bool tryTake(uint32_t nowMs);
+};
+
+/*-- SpillQueue --*/
+
+bool SpillQueue ::begin(void)
+{
+  ready = false;
+  depth = 0;
+  storedBlocks = 0;
+  readLoaded = false;
+  writeUsed = SPILL_HEADER_SIZE;
+  writeCount = 0;
+
+  uint32_t blocks = storage.blockCount();
+  if (blocks == 0)
+    return false;
+
+  // Los bloques vigentes forman un tramo contiguo del anillo
+  bool found = false;
+  uint32_t minSequence = 0, maxSequence = 0;
+  uint32_t minIndex = 0, maxIndex = 0;
+  for (uint32_t i = 0; i < blocks; i++)
+  {
+    if (!storage.readBlock(i, readBuffer))
+      return false;
+    if (!isSpillBlock(readBuffer))
+      continue;
+    uint32_t seq = getU32(readBuffer + 4);
+    depth += getU16(readBuffer + 8);
+    if (!found || seq < minSequence)
+    {
+      minSequence = seq;
+      minIndex = i;
+    }
+    if (!found || seq > maxSequence)
+    {
+      maxSequence = seq;
+      maxIndex = i;
+    }
+    found = true;
+  }
+
+  if (found)
+  {
+    headIndex = minIndex;
+    tailIndex = (maxIndex + 1) % blocks;
+    tailSequence = maxSequence + 1;
+    storedBlocks = maxSequence - minSequence + 1;
+  }
+  else
+  {
+    headIndex = tailIndex = 0;
+    tailSequence = 0;
+  }
+
+  memset(writeBuffer, 0, sizeof(writeBuffer));
+  ready = true;
+  return true;
+}
+
+bool SpillQueue ::push(const char *message, uint16_t length, uint32_t timestamp)
+{
+  if (!ready || length > SPILL_MAX_MESSAGE)
+  {
+    droppedMessages++;
+    return false;
+  }
+
+  if (writeUsed + SPILL_ENTRY_HEADER_SIZE + length > DATALOG_BLOCK_SIZE)
+  {
+    if (!sealAndStore())
+    {
+      droppedMessages++;
+      return false;
+    }
+  }
+
+  uint8_t *entry = writeBuffer + writeUsed;
+  putU16(entry, length);
+  putU32(entry + 2, timestamp);
+  memcpy(entry + SPILL_ENTRY_HEADER_SIZE, message, length);
+  writeUsed += SPILL_ENTRY_HEADER_SIZE + length;
+  writeCount++;
+  depth++;
+  return true;
+}
+
+void SpillQueue ::sealBlock(uint8_t *buffer)
+{
+  putU32(buffer + 0, SPILL_MAGIC);
+  putU32(buffer + 4, tailSequence);
+  putU16(buffer + 8, writeCount);
+  putU16(buffer + 10, writeUsed);
+  storeBlockCrc(buffer);
+}
+
+bool SpillQueue ::isSpillBlock(const uint8_t *buffer)
+{
+  return getU32(buffer) == SPILL_MAGIC && getU16(buffer + 10) <= DATALOG_BLOCK_SIZE && checkBlockCrc(buffer);
+}
+
+bool SpillQueue ::sealAndStore(void)
+{
+  uint32_t blocks = storage.blockCount();
+
+  // Anillo lleno: se sacrifica el bloque más antiguo
+  if (storedBlocks == blocks)
+  {
+    uint16_t lost = readLoaded ? readRemaining : 0;
+    if (!readLoaded && storage.readBlock(headIndex, readBuffer) && isSpillBlock(readBuffer))
+      lost = getU16(readBuffer + 8);
+    droppedMessages += lost;
+    depth -= lost;
+    readLoaded = false;
+    headIndex = (headIndex + 1) % blocks;
+    storedBlocks--;
+  }
+
+  sealBlock(writeBuffer);
+  if (!storage.writeBlock(tailIndex, writeBuffer))
+    return false;
+
+  spilledBytes += DATALOG_BLOCK_SIZE;
+  tailIndex = (tailIndex + 1) % blocks;
+  tailSequence++;
+  storedBlocks++;
+  writeUsed = SPILL_HEADER_SIZE;
+  writeCount = 0;
+  memset(writeBuffer, 0, sizeof(writeBuffer));
+  return true;
+}
+
+bool SpillQueue ::flush(void)
+{
+  if (!ready || writeCount == 0)
+    return true;
+
+  // Se escribe en la posición de cola sin avanzarla; al llenarse se reescribe
+  uint8_t sealed[DATALOG_BLOCK_SIZE];
+  memcpy(sealed, writeBuffer, sizeof(sealed));
+  sealBlock(sealed);
+  if (storedBlocks == storage.blockCount() || !storage.writeBlock(tailIndex, sealed))
+    return false;
+  spilledBytes += DATALOG_BLOCK_SIZE;
+  return true;
+}
+
+bool SpillQueue ::loadHead(void)
+{
+  while (storedBlocks > 0 && !readLoaded)
+  {
+    if (storage.readBlock(headIndex, readBuffer) && isSpillBlock(readBuffer) && getU16(readBuffer + 8) > 0)
+    {
+      readOffset = SPILL_HEADER_SIZE;
+      readRemaining = getU16(readBuffer + 8);
+      readLoaded = true;
+    }
+    else
+    {
+      // Bloque dañado o vacío: se salta
+      releaseHead();
+    }
+  }
+  return readLoaded;
+}
+
+void SpillQueue ::releaseHead(void)
+{
+  // Borrar el bloque consumido para que no se reenvíe después de un reinicio
+  uint8_t zeros[DATALOG_BLOCK_SIZE];
+  memset(zeros, 0, sizeof(zeros));
+  storage.writeBlock(headIndex, zeros);
+  headIndex = (headIndex + 1) % storage.blockCount();
+  storedBlocks--;
+  readLoaded = false;
+}
+
+bool SpillQueue ::front(char *out, size_t size, uint32_t *timestamp, uint16_t *length)
+{
+  if (!ready || size == 0)
+    return false;
+
+  const uint8_t *entry;
+  if (loadHead())
+    entry = readBuffer + readOffset;
+  else if (writeCount > 0)
+    entry = writeBuffer + SPILL_HEADER_SIZE;
+  else
+    return false;
+
+  uint16_t copied = getU16(entry);
+  if (copied >= size)
+    copied = size - 1;
+  memcpy(out, entry + SPILL_ENTRY_HEADER_SIZE, copied);
+  out[copied] = '\0';
+  if (timestamp != NULL)
+    *timestamp = getU32(entry + 2);
+  if (length != NULL)
+    *length = copied;
+  return true;
+}
+
+void SpillQueue ::pop(void)
+{
+  if (!ready)
+    return;
+
+  if (loadHead())
+  {
+    readOffset += SPILL_ENTRY_HEADER_SIZE + getU16(readBuffer + readOffset);
+    readRemaining--;
+    depth--;
+    if (readRemaining == 0)
+      releaseHead();
+  }
+  else if (writeCount > 0)
+  {
+    // Se consume directamente del bloque en construcción
+    uint16_t entrySize = SPILL_ENTRY_HEADER_SIZE + getU16(writeBuffer + SPILL_HEADER_SIZE);
+    memmove(writeBuffer + SPILL_HEADER_SIZE, writeBuffer + SPILL_HEADER_SIZE + entrySize,
+            writeUsed - SPILL_HEADER_SIZE - entrySize);
+    writeUsed -= entrySize;
+    memset(writeBuffer + writeUsed, 0, entrySize);
+    writeCount--;
+    depth--;
+  }
+}
+
+/*-- ReplayPacer --*/
+
+bool ReplayPacer ::tryTake(uint32_t nowMs)
+{
+  uint32_t elapsed = nowMs - lastRefill;
+  lastRefill = nowMs;
+
+  // ratePerSecond fichas por segundo = ratePerSecond milésimas por milisegundo
+  uint32_t limit = burst * 1000;
+  uint64_t refilled = (uint64_t)milliTokens + (uint64_t)elapsed * ratePerSecond;
+  milliTokens = refilled > limit ? limit : (uint32_t)refilled;
+
+  if (milliTokens < 1000)
+    return false;
+  milliTokens -= 1000;
+  return true;
+}
+
+#endif
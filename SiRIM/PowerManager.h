@@ -0,0 +1,227 @@
+#ifndef PowerManager_h
+#define PowerManager_h
+
+#include <stdint.h>
+#include <string.h>
+#include "TelemetryPacket.h"
+
+/*
+  Modo de bajo consumo para nodos con batería o panel solar.
+
+  Con "energia.bajoConsumo" el nodo ya no lee cada SENSOR_READ_INTERVAL con
+  el WiFi siempre encendido: duerme en light sleep entre muestras, despierta
+  POWER_SETTLE_MS antes de cada una para que la mediana del ultrasónico y el
+  filtro del ADC se asienten, y guarda la muestra como paquete binario
+  (TelemetryPacket.h) en un lote en la memoria RTC. El radio sólo se
+  enciende cada "radioCada" muestras: publica el lote en mensajes de "lote"
+  paquetes, las métricas y el estado del riego, escucha la configuración
+  POWER_LISTEN_MS y se apaga. Mientras algún relevador está encendido el
+  nodo no duerme.
+
+  El lote vive en RTC_NOINIT: sobrevive al watchdog y a un reinicio por
+  software, así que al arrancar se revisa (begin) en lugar de borrarse. Si
+  el radio no logra salir y el lote se llena, la muestra más antigua pasa al
+  respaldo de la SD.
+
+  PowerLedger lleva el tiempo dormido, despierto y con el radio encendido, y
+  PowerModel lo convierte a mA·h por día con las corrientes típicas de la
+  placa. El simulador (Herramientas/simulador.cpp) usa el mismo modelo para
+  comparar configuraciones.
+*/
+
+#define SAMPLE_BATCH_CAPACITY 64       // Muestras en la memoria RTC (22 B cada una)
+#define SAMPLE_BATCH_MAGIC 0x45544F4CUL // "LOTE"
+#define POWER_MESSAGE_MAX_SAMPLES 40   // 880 B: cabe en MQTT_BUFFER_SIZE
+#define POWER_RADIO_MAX_EVERY (SAMPLE_BATCH_CAPACITY / 2) // Deja lugar para una ventana fallida
+#define POWER_MIN_SAMPLE_SECONDS 5
+#define POWER_MAX_SAMPLE_SECONDS 3600
+
+#ifndef POWER_SETTLE_MS
+#define POWER_SETTLE_MS 600            // Sensores despiertos antes de tomar la muestra
+#endif
+#define POWER_MIN_SLEEP_MS 100         // Dormir menos no compensa despertar
+#define POWER_LISTEN_MS 1000           // En línea: esperar configuración antes de apagar el radio
+#define POWER_WINDOW_TIMEOUT_MS 15000  // Sin conexión: apagar y reintentar en la siguiente ventana
+
+struct PowerConfig
+{
+  bool lowPower;
+  uint16_t sampleSeconds; // Periodo de muestra en bajo consumo
+  uint8_t batchSize;      // Muestras por mensaje
+  uint8_t radioEvery;     // Encender el radio cada N muestras
+};
+
+static const PowerConfig DEFAULT_POWER_CONFIG = {false, 60, 10, 10};
+
+// Light sleep hasta POWER_SETTLE_MS antes de la siguiente muestra o del
+// siguiente turno del horario, lo que llegue antes; 0 si no vale la pena
+inline uint32_t powerSleepMs(uint32_t untilSampleMs, uint32_t untilTurnMs)
+{
+  uint32_t until = untilTurnMs < untilSampleMs ? untilTurnMs : untilSampleMs;
+  return until >= POWER_SETTLE_MS + POWER_MIN_SLEEP_MS ? until - POWER_SETTLE_MS : 0;
+}
+
+// Lote de paquetes en la memoria RTC; sin constructor para que el arranque
+// no lo borre
+struct SampleBatch
+{
+  uint32_t magic;
+  uint16_t head;     // Muestra más antigua
+  uint16_t count;
+  uint16_t sequence; // Secuencia del siguiente paquete; continúa tras un reinicio
+  uint8_t packets[SAMPLE_BATCH_CAPACITY][TELEMETRY_PACKET_SIZE];
+
+  // Revisa lo que quedó en la memoria RTC; devuelve las muestras recuperadas
+  uint16_t begin(void);
+  bool full(void) const { return count >= SAMPLE_BATCH_CAPACITY; }
+  bool push(const uint8_t *packet);
+  // Copia las muestras más antiguas seguidas en out; devuelve cuántas
+  uint16_t copy(uint8_t *out, uint16_t maxSamples) const;
+  void drop(uint16_t samples);
+};
+
+// Corrientes típicas (mA) a 3.3 V
+struct PowerProfile
+{
+  float sleepMa;       // ESP32 en light sleep
+  float awakeMa;       // CPU despierto con el radio apagado
+  float radioMa;       // Asociando y publicando
+  float connectedMa;   // Modo normal: WiFi asociado con modem sleep y CPU activo
+  float peripheralsMa; // Siempre alimentados: sondas de suelo, ultrasónico, RTC, SD
+  float backlightMa;   // Luz del LCD, que se apaga en bajo consumo
+};
+
+// Relevadores y bomba no cuentan: tienen su propia fuente
+static const PowerProfile DEFAULT_POWER_PROFILE = {0.8f, 40.0f, 120.0f, 60.0f, 14.0f, 20.0f};
+
+class PowerLedger
+{
+private:
+  uint32_t lastMs = 0;
+  uint32_t radioSince = 0;
+
+public:
+  uint64_t elapsedMs = 0;
+  uint64_t normalMs = 0; // Tiempo en modo normal
+  uint64_t sleepMs = 0;
+  uint64_t radioMs = 0;
+  uint32_t sleeps = 0;
+  uint32_t samples = 0; // Muestras en bajo consumo
+  uint32_t windows = 0;
+  uint32_t failedWindows = 0;
+
+  void begin(uint32_t nowMs) { lastMs = nowMs; }
+  // Lo llama la tarea de sensores en cada vuelta
+  void update(uint32_t nowMs, bool lowPower);
+  void addSleep(uint32_t ms)
+  {
+    sleepMs += ms;
+    sleeps++;
+  }
+  // Los llama la tarea de red
+  void radioOn(uint32_t nowMs) { radioSince = nowMs; }
+  void radioOff(uint32_t nowMs, bool published);
+
+  // Consumo promedio medido, en mA·h por día
+  float mAhPerDay(const PowerProfile &profile) const;
+};
+
+class PowerModel
+{
+public:
+  // Estimación para una configuración con lo que tarda cada muestra
+  // despierta y cada ventana de radio
+  static float mAhPerDay(const PowerProfile &profile, const PowerConfig &config, float awakePerSampleMs,
+                         float radioPerWindowMs);
+};
+
+uint16_t SampleBatch ::begin(void)
+{
+  if (magic != SAMPLE_BATCH_MAGIC || head >= SAMPLE_BATCH_CAPACITY || count > SAMPLE_BATCH_CAPACITY)
+  {
+    // Encendido en frío: la memoria RTC trae basura
+    magic = SAMPLE_BATCH_MAGIC;
+    head = 0;
+    count = 0;
+    sequence = 0;
+  }
+  return count;
+}
+
+bool SampleBatch ::push(const uint8_t *packet)
+{
+  if (full())
+    return false;
+  memcpy(packets[(head + count) % SAMPLE_BATCH_CAPACITY], packet, TELEMETRY_PACKET_SIZE);
+  count++;
+  return true;
+}
+
+uint16_t SampleBatch ::copy(uint8_t *out, uint16_t maxSamples) const
+{
+  uint16_t n = count < maxSamples ? count : maxSamples;
+  for (uint16_t i = 0; i < n; i++)
+    memcpy(out + i * TELEMETRY_PACKET_SIZE, packets[(head + i) % SAMPLE_BATCH_CAPACITY], TELEMETRY_PACKET_SIZE);
+  return n;
+}
+
+void SampleBatch ::drop(uint16_t samples)
+{
+  if (samples > count)
+    samples = count;
+  head = (head + samples) % SAMPLE_BATCH_CAPACITY;
+  count -= samples;
+}
+
+void PowerLedger ::update(uint32_t nowMs, bool lowPower)
+{
+  uint32_t delta = nowMs - lastMs;
+  lastMs = nowMs;
+  elapsedMs += delta;
+  if (!lowPower)
+    normalMs += delta;
+}
+
+void PowerLedger ::radioOff(uint32_t nowMs, bool published)
+{
+  radioMs += nowMs - radioSince;
+  windows++;
+  if (!published)
+    failedWindows++;
+}
+
+float PowerLedger ::mAhPerDay(const PowerProfile &p) const
+{
+  if (elapsedMs == 0)
+    return 0;
+
+  // Fuera del modo normal el tiempo está dormido, despierto o con el radio
+  double lowPowerMs = (double)(elapsedMs - normalMs);
+  double awakeMs = lowPowerMs - (double)sleepMs - (double)radioMs;
+  if (awakeMs < 0)
+    awakeMs = 0;
+  double mAms = normalMs * (double)(p.connectedMa + p.backlightMa) + sleepMs * (double)p.sleepMa +
+                radioMs * (double)p.radioMa + awakeMs * p.awakeMa + elapsedMs * (double)p.peripheralsMa;
+  return (float)(mAms / elapsedMs * 24);
+}
+
+float PowerModel ::mAhPerDay(const PowerProfile &p, const PowerConfig &config, float awakePerSampleMs,
+                             float radioPerWindowMs)
+{
+  if (!config.lowPower)
+    return (p.connectedMa + p.backlightMa + p.peripheralsMa) * 24;
+
+  // Un ciclo es una muestra; la ventana de radio se reparte entre radioCada muestras
+  double cycleMs = config.sampleSeconds * 1000.0;
+  double radioMs = (double)radioPerWindowMs / config.radioEvery;
+  double awakeMs = awakePerSampleMs;
+  if (awakeMs + radioMs > cycleMs)
+    awakeMs = cycleMs > radioMs ? cycleMs - radioMs : 0;
+  double sleepMs = cycleMs - awakeMs - radioMs;
+  if (sleepMs < 0)
+    sleepMs = 0;
+  double mA = (sleepMs * p.sleepMa + awakeMs * p.awakeMa + radioMs * p.radioMa) / cycleMs + p.peripheralsMa;
+  return (float)(mA * 24);
+}
+
+#endif
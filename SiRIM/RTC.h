@@ -2,7 +2,6 @@
 #define RTC_h
 
 #include <Wire.h> /* Librería para el uso del protocolo I2C. */
-#include <ArduinoJson.h>
 #include <RTClib.h>
 
 /*RTClib.h, requiere de la instalación de dos librerías:
@@ -16,13 +15,13 @@ class DS1307_RTC
   public:
       uint8_t hora = 0, minuto = 0, segundo = 0, dia = 0, mes = 0;
       uint16_t ano = 0;
-      String fecha = "", tiempo = "";
+      char fecha[11] = "", tiempo[9] = ""; /* dd/mm/aaaa y hh:mm:ss, sin String */
 
   public:
       void rtcInit(void);
       void getTime(void);
-      String formatDate(void);
-      String formatTime(void);
+      const char *formatDate(void);
+      const char *formatTime(void);
       void showTime(void);
       void showTimeJson(void);
 };
@@ -62,40 +61,16 @@ void DS1307_RTC::getTime(void)
 }
 
 /* Función que le da un formato legible a la fecha. */
-String DS1307_RTC::formatDate(void)
+const char *DS1307_RTC::formatDate(void)
 {
-
-    fecha = "";
-    if (dia < 10)
-        fecha += '0';
-    fecha += dia;
-    fecha += '/';
-    if (mes < 10)
-        fecha += '0';
-    fecha += mes;
-    fecha += '/';
-    fecha += ano;
+    snprintf(fecha, sizeof(fecha), "%02u/%02u/%04u", (unsigned)dia, (unsigned)mes, (unsigned)ano);
     return fecha;
 }
 
 /* Función que le da un formato legible al tiempo. */
-String DS1307_RTC::formatTime(void)
+const char *DS1307_RTC::formatTime(void)
 {
-
-    tiempo = "";
-    if (hora < 10)
-        tiempo += '0';
-    tiempo += hora;
-    tiempo += ':';
-
-    if (minuto < 10)
-        tiempo += '0';
-    tiempo += minuto;
-    tiempo += ':';
-
-    if (segundo < 10)
-        tiempo += '0';
-    tiempo += segundo;
+    snprintf(tiempo, sizeof(tiempo), "%02u:%02u:%02u", (unsigned)hora, (unsigned)minuto, (unsigned)segundo);
     return tiempo;
 }
 
@@ -0,0 +1,315 @@
+#ifndef RangeQuery_h
+#define RangeQuery_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SeriesStore.h"
+#include "NodeConfig.h"
+#include "TelemetryEncoder.h"
+
+/*
+  Consultas por rango de tiempo sobre la serie de la SD (SeriesStore.h) con
+  un par de tópicos de solicitud y respuesta por nodo (<id> es su client ID,
+  ver makeNodeTopic en Connectivity.h):
+
+    ucol/iot/consulta/<id>            {"id": 7, "desde": 1718000000, "hasta": 1718086400, "ventana": 4}
+                                      {"id": 7, "ack": 3}
+                                      {"id": 7, "cancelar": true}
+
+    ucol/iot/consulta/respuesta/<id>  {"id": 7, "parte": 0, "campos": [...], "muestras": [[...], ...]}
+                                      {"id": 7, "parte": 1, "muestras": [[...], ...]}
+                                      ...
+                                      {"id": 7, "parte": 12, "muestras": [...], "fin": true, "total": 190}
+                                      {"id": 7, "error": "ocupado"}
+
+  Así cada nodo sólo ve las consultas que le tocan y las partes de dos nodos
+  no se mezclan; el "id" sólo distingue consultas al mismo nodo.
+
+  Sin "hasta" la consulta llega hasta la última muestra. Cada muestra es un
+  arreglo en el orden de "campos" (sólo viene en la parte 0), en el orden de
+  la SD: cronológico salvo que el reloj se haya atrasado.
+
+  El control de flujo lo lleva quien consulta: el nodo envía hasta "ventana"
+  partes sin confirmar y espera un "ack" con el número de la última parte que
+  recibió. Si no llega ninguno en QUERY_ACK_TIMEOUT_MS la consulta se
+  abandona. Hay una sola consulta a la vez y sus partes salen sólo cuando la
+  cola de la telemetría en vivo está vacía.
+*/
+
+#define QUERY_WINDOW_DEFAULT 4
+#define QUERY_WINDOW_MAX 16
+#define QUERY_ACK_TIMEOUT_MS 30000
+#define QUERY_ROW_MAX 96  // Peor caso de una muestra en JSON
+#define QUERY_TAIL_MAX 48 // ],"fin":true,"total":4294967295}
+
+static const char *const QUERY_FIELDS[] = {"timestamp",    "temperaturaAmbiente", "humedadAmbiente", "humedadSuelo1",
+                                           "humedadSuelo2", "iluminacion",        "nivelAgua",       "porcentajeAgua"};
+
+enum QueryCommand
+{
+  QUERY_START,
+  QUERY_ACK,
+  QUERY_CANCEL
+};
+
+struct QueryRequest
+{
+  QueryCommand command;
+  uint32_t id;
+  uint32_t from;
+  uint32_t to;
+  uint8_t window;
+  uint32_t part; // Última parte recibida (ack)
+};
+
+class QueryRequestParser
+{
+private:
+  static ConfigStatus unsignedNumber(JsonScanner &json, uint32_t &out);
+
+public:
+  static ConfigStatus parse(const uint8_t *payload, size_t length, QueryRequest &request);
+};
+
+class QueryStream
+{
+private:
+  SeriesStore &store;
+  SeriesQuery query;
+  uint32_t id = 0;
+  uint32_t sent = 0;  // Partes enviadas
+  uint32_t acked = 0; // Partes confirmadas
+  uint8_t window = QUERY_WINDOW_DEFAULT;
+  uint32_t lastAckMs = 0;
+  bool active = false;
+
+  static void writeError(uint32_t id, const char *error, char *out, size_t size);
+
+public:
+  // Métricas
+  uint32_t started = 0;
+  uint32_t completed = 0;
+  uint32_t canceled = 0;
+  uint32_t timeouts = 0;
+  uint32_t rejected = 0;
+
+  QueryStream(SeriesStore &seriesStore) : store(seriesStore), query(seriesStore) {}
+
+  // Aplica una solicitud. Si hay que contestar de inmediato (un error) deja
+  // la respuesta en reply y devuelve true.
+  bool handle(const QueryRequest &request, uint32_t nowMs, char *reply, size_t size);
+
+  // Hay crédito para otra parte; abandona la consulta si el ack no llega
+  bool ready(uint32_t nowMs);
+
+  // Arma la siguiente parte en out (al menos QUERY_ROW_MAX + QUERY_TAIL_MAX
+  // más el encabezado); devuelve su longitud o 0 si no cupo
+  size_t nextChunk(char *out, size_t size);
+
+  bool isActive(void) { return active; }
+};
+
+/*-- QueryRequestParser --*/
+
+ConfigStatus QueryRequestParser ::unsignedNumber(JsonScanner &json, uint32_t &out)
+{
+  char c = json.peek();
+  if (c == '"' || c == '{' || c == '[' || c == 't' || c == 'f' || c == 'n')
+    return CONFIG_TYPE;
+  double value;
+  if (!json.readNumber(value))
+    return CONFIG_SYNTAX;
+  if (value < 0 || value > 4294967295.0 || value != (double)(uint32_t)value)
+    return CONFIG_RANGE;
+  out = (uint32_t)value;
+  return CONFIG_OK;
+}
+
+ConfigStatus QueryRequestParser ::parse(const uint8_t *payload, size_t length, QueryRequest &request)
+{
+  JsonScanner json(payload, length);
+  const char *key;
+  size_t keyLength;
+  bool first = true;
+  bool hasId = false, hasFrom = false, hasAck = false, cancel = false;
+  uint32_t window = QUERY_WINDOW_DEFAULT;
+
+  request.from = 0;
+  request.to = UINT32_MAX;
+  request.part = 0;
+
+  if (!json.beginObject())
+    return CONFIG_SYNTAX;
+  while (json.nextKey(key, keyLength, first))
+  {
+    ConfigStatus status;
+    if (json.keyIs(key, keyLength, "id"))
+    {
+      status = unsignedNumber(json, request.id);
+      hasId = true;
+    }
+    else if (json.keyIs(key, keyLength, "desde"))
+    {
+      status = unsignedNumber(json, request.from);
+      hasFrom = true;
+    }
+    else if (json.keyIs(key, keyLength, "hasta"))
+      status = unsignedNumber(json, request.to);
+    else if (json.keyIs(key, keyLength, "ventana"))
+      status = unsignedNumber(json, window);
+    else if (json.keyIs(key, keyLength, "ack"))
+    {
+      status = unsignedNumber(json, request.part);
+      hasAck = true;
+    }
+    else if (json.keyIs(key, keyLength, "cancelar"))
+    {
+      char c = json.peek();
+      status = c == 't' || c == 'f' ? (json.readBool(cancel) ? CONFIG_OK : CONFIG_SYNTAX) : CONFIG_TYPE;
+    }
+    else
+      status = json.skip() ? CONFIG_OK : CONFIG_SYNTAX;
+    if (status != CONFIG_OK)
+      return status;
+  }
+  if (json.failed() || !json.atEnd())
+    return CONFIG_SYNTAX;
+  if (!hasId || (!hasFrom && !hasAck && !cancel))
+    return CONFIG_EMPTY;
+  if (window < 1 || window > QUERY_WINDOW_MAX)
+    return CONFIG_RANGE;
+
+  request.window = (uint8_t)window;
+  request.command = cancel ? QUERY_CANCEL : hasFrom ? QUERY_START : QUERY_ACK;
+  return CONFIG_OK;
+}
+
+/*-- QueryStream --*/
+
+void QueryStream ::writeError(uint32_t id, const char *error, char *out, size_t size)
+{
+  JsonWriter w(out, size);
+  w.beginObject();
+  w.key("id");
+  w.number(id);
+  w.key("error");
+  w.string(error);
+  w.endObject();
+  w.finish();
+}
+
+bool QueryStream ::handle(const QueryRequest &request, uint32_t nowMs, char *reply, size_t size)
+{
+  if (request.command != QUERY_START)
+  {
+    // Confirmaciones y cancelaciones de otra consulta se ignoran
+    if (!active || request.id != id)
+      return false;
+    if (request.command == QUERY_CANCEL)
+    {
+      active = false;
+      query.stop();
+      canceled++;
+      return false;
+    }
+    if (request.part + 1 > acked && request.part < sent)
+      acked = request.part + 1;
+    lastAckMs = nowMs;
+    return false;
+  }
+
+  // Repetir la solicitud en curso la reinicia
+  const char *error = NULL;
+  if (active && request.id != id)
+    error = "ocupado";
+  else if (!store.isReady())
+    error = "sin SD";
+  else if (request.from > request.to)
+    error = "rango";
+  if (error != NULL)
+  {
+    rejected++;
+    writeError(request.id, error, reply, size);
+    return true;
+  }
+
+  id = request.id;
+  window = request.window;
+  sent = acked = 0;
+  lastAckMs = nowMs;
+  query.start(request.from, request.to);
+  active = true;
+  started++;
+  return false;
+}
+
+bool QueryStream ::ready(uint32_t nowMs)
+{
+  if (!active)
+    return false;
+  if (sent < acked + window)
+    return true;
+  if (nowMs - lastAckMs >= QUERY_ACK_TIMEOUT_MS)
+  {
+    active = false;
+    query.stop();
+    timeouts++;
+  }
+  return false;
+}
+
+size_t QueryStream ::nextChunk(char *out, size_t size)
+{
+  JsonWriter w(out, size);
+  w.beginObject();
+  w.key("id");
+  w.number(id);
+  w.key("parte");
+  w.number(sent);
+  if (sent == 0)
+  {
+    w.beginArray("campos");
+    for (uint8_t i = 0; i < sizeof(QUERY_FIELDS) / sizeof(QUERY_FIELDS[0]); i++)
+      w.string(QUERY_FIELDS[i]);
+    w.endArray();
+  }
+
+  w.beginArray("muestras");
+  bool more = true;
+  SensorsData d;
+  while (w.size() + QUERY_ROW_MAX + QUERY_TAIL_MAX < size)
+  {
+    if (!query.next(d))
+    {
+      more = false;
+      break;
+    }
+    w.beginArray();
+    w.number(d.timestamp);
+    w.number(d.temperature);
+    w.number(d.humidity);
+    w.number((int32_t)d.soilMoisture1);
+    w.number((int32_t)d.soilMoisture2);
+    w.number((int32_t)d.lightIntensity);
+    w.number(d.waterLevel);
+    w.number((int32_t)d.waterPercent);
+    w.endArray();
+  }
+  w.endArray();
+
+  if (!more)
+  {
+    w.key("fin");
+    w.boolean(true);
+    w.key("total");
+    w.number(query.matched);
+    active = false;
+    completed++;
+  }
+  w.endObject();
+
+  sent++;
+  return w.finish() ? w.size() : 0;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef ReportFilter_h
+#define ReportFilter_h
+
+#include <stdint.h>
+#include <math.h>
+#include "SensorsData.h"
+
+/*
+  Reporte por excepción de la telemetría.
+
+  Cada muestra se compara campo por campo contra la última que se publicó;
+  sólo se envía si algún campo se movió más que su banda muerta, si cambió
+  el estado del riego o si pasó el latido (máximo tiempo en silencio). La
+  comparación es contra lo publicado y no contra la muestra anterior, así
+  que una deriva lenta también termina por reportarse.
+
+  La bitácora de la SD sigue guardando todas las muestras.
+*/
+
+#define REPORT_HEARTBEAT_DEFAULT 300000 // 5 minutos sin publicar como máximo
+
+enum ReportReason
+{
+  REPORT_NONE,      // Se suprime
+  REPORT_FIRST,     // Primera muestra desde el arranque
+  REPORT_CHANGE,    // Un campo salió de su banda muerta
+  REPORT_EVENT,     // Cambió el estado del riego
+  REPORT_HEARTBEAT, // Se cumplió el latido
+  REPORT_ALWAYS     // Reporte por excepción desactivado
+};
+
+// Bandas muertas en las unidades de cada campo de SensorsData
+struct ReportConfig
+{
+  bool enabled;
+  float temperature;    // °C
+  float humidity;       // %
+  int16_t soilMoisture; // % (ambos sensores)
+  int16_t light;        // %
+  float waterLevel;     // cm
+  int16_t waterPercent; // %
+  uint32_t heartbeatMs;
+};
+
+static const ReportConfig DEFAULT_REPORT_CONFIG = {true, 0.5f, 2.0f, 2, 5, 1.0f, 5, REPORT_HEARTBEAT_DEFAULT};
+
+class ReportFilter
+{
+private:
+  ReportConfig config = DEFAULT_REPORT_CONFIG;
+  SensorsData last;
+  bool lastIrrigation = false;
+  uint32_t lastSentMs = 0;
+  bool hasSent = false;
+
+  static bool movedFloat(float now, float before, float band);
+  static bool movedInt(int16_t now, int16_t before, int16_t band);
+
+public:
+  // Contadores desde el arranque
+  uint32_t sent = 0;
+  uint32_t suppressed = 0;
+  uint32_t heartbeats = 0;
+  uint32_t events = 0;
+
+  void configure(const ReportConfig &newConfig) { config = newConfig; }
+  const ReportConfig &configuration(void) { return config; }
+
+  // Decide si la muestra se publica; si es así la toma como la última enviada
+  ReportReason evaluate(const SensorsData &data, bool irrigation, uint32_t nowMs);
+};
+
+bool ReportFilter ::movedFloat(float now, float before, float band)
+{
+  // Un sensor que deja de responder (o vuelve) también es un cambio
+  if (isnan(now) || isnan(before))
+    return isnan(now) != isnan(before);
+  return fabsf(now - before) > band;
+}
+
+bool ReportFilter ::movedInt(int16_t now, int16_t before, int16_t band)
+{
+  return (now > before ? now - before : before - now) > band;
+}
+
+ReportReason ReportFilter ::evaluate(const SensorsData &data, bool irrigation, uint32_t nowMs)
+{
+  ReportReason reason = REPORT_NONE;
+
+  if (!config.enabled)
+    reason = REPORT_ALWAYS;
+  else if (!hasSent)
+    reason = REPORT_FIRST;
+  else if (irrigation != lastIrrigation)
+    reason = REPORT_EVENT;
+  else if (movedFloat(data.temperature, last.temperature, config.temperature) ||
+           movedFloat(data.humidity, last.humidity, config.humidity) ||
+           movedInt(data.soilMoisture1, last.soilMoisture1, config.soilMoisture) ||
+           movedInt(data.soilMoisture2, last.soilMoisture2, config.soilMoisture) ||
+           movedInt(data.lightIntensity, last.lightIntensity, config.light) ||
+           movedFloat(data.waterLevel, last.waterLevel, config.waterLevel) ||
+           movedInt(data.waterPercent, last.waterPercent, config.waterPercent))
+    reason = REPORT_CHANGE;
+  else if (nowMs - lastSentMs >= config.heartbeatMs)
+    reason = REPORT_HEARTBEAT;
+
+  if (reason == REPORT_NONE)
+  {
+    suppressed++;
+    return reason;
+  }
+
+  if (reason == REPORT_HEARTBEAT)
+    heartbeats++;
+  else if (reason == REPORT_EVENT)
+    events++;
+  sent++;
+  last = data;
+  lastIrrigation = irrigation;
+  lastSentMs = nowMs;
+  hasSent = true;
+  return reason;
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef Rollup_h
+#define Rollup_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "SensorsData.h"
+#include "Datalog.h"
+#include "TelemetryEncoder.h"
+
+/*
+  Resúmenes por ventana de las muestras (mínimo, máximo, promedio y
+  desviación estándar) para que los tableros no tengan que recorrer cada
+  muestra de 5 s.
+
+  RollupAggregator recibe cada muestra y actualiza, en tiempo constante, una
+  ventana fija de 1 minuto, 1 hora y 1 día por canal. El promedio y la
+  varianza usan el método de Welford, que no acumula sumas de cuadrados y no
+  pierde precisión en float aunque un día junte 17 280 muestras. Las
+  ventanas se alinean al reloj del RTC (hora local): la diaria va de
+  medianoche a medianoche. Una ventana se cierra con la primera muestra que
+  cae fuera de ella, también si el reloj se ajustó hacia atrás; la primera
+  ventana después de un reinicio está incompleta y "muestras" lo indica.
+
+  Cada resumen cerrado se guarda en la SD (RollupLog, mismo anillo de
+  bloques que la bitácora) y se publica como
+
+    {"resumen": 3600, "inicio": 1718000000, "muestras": 720,
+     "temperaturaAmbiente": [mín, máx, promedio, desviación], ...}
+
+  en su tópico (ucol/iot/resumen/minuto, /hora o /dia, seguido del client
+  ID del nodo). "resumen" es el periodo en segundos y permite elegir el
+  tópico también al reenviar el respaldo. Una lectura inválida (NaN del
+  DHT11, o suelo, luz o tanque sin lectura) no entra al canal.
+*/
+
+#define ROLLUP_CHANNELS 6
+#define ROLLUP_WINDOWS 3
+#define ROLLUP_MINUTE 0
+#define ROLLUP_HOUR 1
+#define ROLLUP_DAY 2
+#define ROLLUP_MESSAGE_SIZE 384 // Peor caso del JSON con seis canales
+
+// Registro en la SD: inicio, periodo, muestras y 4 floats por canal
+#define ROLLUP_RECORD_SIZE (12 + ROLLUP_CHANNELS * 16)
+#define ROLLUP_MAGIC 0x4D555352UL // "RSUM"
+#define ROLLUP_VERSION 1
+
+static const uint32_t ROLLUP_PERIODS[ROLLUP_WINDOWS] = {60, 3600, 86400};
+
+// Qué resúmenes se publican (sección "resumen" de la configuración). Los tres
+// se guardan en la SD de todos modos.
+struct RollupConfig
+{
+  bool rollupOnly; // No publicar las muestras en vivo, sólo los resúmenes
+  bool publish[ROLLUP_WINDOWS];
+};
+
+static const RollupConfig DEFAULT_ROLLUP_CONFIG = {false, {true, true, true}};
+
+// Mismos nombres que la telemetría
+static const char *const ROLLUP_CHANNEL_NAMES[ROLLUP_CHANNELS] = {
+    "temperaturaAmbiente", "humedadAmbiente", "humedadSuelo1", "humedadSuelo2", "iluminacion", "porcentajeAgua"};
+
+// Estadística incremental de un canal
+class RunningStats
+{
+public:
+  uint32_t count = 0;
+  float min = 0;
+  float max = 0;
+  float mean = 0;
+  float m2 = 0; // Suma de los cuadrados de las diferencias con el promedio
+
+  void reset(void)
+  {
+    count = 0;
+    min = max = mean = m2 = 0;
+  }
+
+  void add(float x)
+  {
+    count++;
+    if (count == 1)
+    {
+      min = max = mean = x;
+      m2 = 0;
+      return;
+    }
+    if (x < min)
+      min = x;
+    if (x > max)
+      max = x;
+    float delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+  }
+
+  // Varianza muestral (n - 1)
+  float variance(void) const { return count > 1 ? m2 / (count - 1) : 0; }
+  float stddev(void) const { return sqrtf(variance()); }
+};
+
+struct Rollup
+{
+  uint32_t start;  // Inicio de la ventana (segundos del RTC)
+  uint32_t period; // Segundos
+  uint32_t samples;
+  RunningStats channels[ROLLUP_CHANNELS];
+};
+
+class RollupAggregator
+{
+private:
+  Rollup open[ROLLUP_WINDOWS];
+  Rollup closed[ROLLUP_WINDOWS];
+  bool started = false;
+
+public:
+  // Valores de cada canal en el orden de ROLLUP_CHANNEL_NAMES
+  static void channelValues(const SensorsData &data, float *values);
+
+  // Agrega una muestra; devuelve un bit por cada ventana que cerró (bit =
+  // ROLLUP_MINUTE, ROLLUP_HOUR, ROLLUP_DAY), disponible en completed()
+  uint8_t add(const SensorsData &data);
+  const Rollup &completed(uint8_t window) const { return closed[window]; }
+  const Rollup &current(uint8_t window) const { return open[window]; }
+};
+
+class RollupEncoder
+{
+public:
+  // JSON del resumen; false si no cabe
+  static bool encode(const Rollup &rollup, char *out, size_t size, size_t *length = NULL);
+
+  // Periodo de un mensaje de resumen; 0 si el mensaje es otra cosa
+  static uint32_t periodOf(const char *message, size_t length);
+
+  static void pack(const Rollup &rollup, uint8_t *out);
+  static void unpack(const uint8_t *in, Rollup &rollup);
+};
+
+// Resúmenes en la SD con el formato de bloques de la bitácora
+class RollupLog : public RecordLog
+{
+public:
+  RollupLog(BlockStorage &blockStorage) : RecordLog(blockStorage, ROLLUP_MAGIC, ROLLUP_RECORD_SIZE, ROLLUP_VERSION) {}
+
+  bool append(const Rollup &rollup)
+  {
+    uint8_t record[ROLLUP_RECORD_SIZE];
+    RollupEncoder::pack(rollup, record);
+    return appendRecord(record);
+  }
+
+  static bool isValidBlock(const uint8_t *buffer)
+  {
+    return RecordLog::isValidBlock(buffer, ROLLUP_MAGIC, ROLLUP_RECORD_SIZE);
+  }
+};
+
+void RollupAggregator ::channelValues(const SensorsData &data, float *values)
+{
+  values[0] = data.temperature;
+  values[1] = data.humidity;
+  // Los porcentajes sin lectura llegan como READING_INVALID (negativo)
+  values[2] = data.soilMoisture1 < 0 ? NAN : data.soilMoisture1;
+  values[3] = data.soilMoisture2 < 0 ? NAN : data.soilMoisture2;
+  values[4] = data.lightIntensity < 0 ? NAN : data.lightIntensity;
+  values[5] = data.waterPercent < 0 ? NAN : data.waterPercent;
+}
+
+uint8_t RollupAggregator ::add(const SensorsData &data)
+{
+  float values[ROLLUP_CHANNELS];
+  channelValues(data, values);
+  uint8_t done = 0;
+
+  for (uint8_t w = 0; w < ROLLUP_WINDOWS; w++)
+  {
+    Rollup &r = open[w];
+    uint32_t start = data.timestamp - data.timestamp % ROLLUP_PERIODS[w];
+    if (!started || start != r.start)
+    {
+      if (started && r.samples > 0)
+      {
+        closed[w] = r;
+        done |= 1 << w;
+      }
+      r.start = start;
+      r.period = ROLLUP_PERIODS[w];
+      r.samples = 0;
+      for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+        r.channels[c].reset();
+    }
+
+    r.samples++;
+    for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+      if (!isnan(values[c]))
+        r.channels[c].add(values[c]);
+  }
+  started = true;
+  return done;
+}
+
+bool RollupEncoder ::encode(const Rollup &rollup, char *out, size_t size, size_t *length)
+{
+  JsonWriter w(out, size);
+  w.beginObject();
+  w.key("resumen");
+  w.number(rollup.period);
+  w.key("inicio");
+  w.number(rollup.start);
+  w.key("muestras");
+  w.number(rollup.samples);
+  for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+  {
+    // Canal sin lecturas válidas en toda la ventana
+    const RunningStats &s = rollup.channels[c];
+    if (s.count == 0)
+    {
+      w.key(ROLLUP_CHANNEL_NAMES[c]);
+      w.raw("null");
+      continue;
+    }
+    w.beginArray(ROLLUP_CHANNEL_NAMES[c]);
+    w.number(s.min);
+    w.number(s.max);
+    w.number(s.mean);
+    w.number(s.stddev());
+    w.endArray();
+  }
+  w.endObject();
+
+  bool ok = w.finish();
+  if (length != NULL)
+    *length = ok ? w.size() : 0;
+  return ok;
+}
+
+uint32_t RollupEncoder ::periodOf(const char *message, size_t length)
+{
+  static const char prefix[] = "{\"resumen\":";
+  const size_t prefixLength = sizeof(prefix) - 1;
+  if (length <= prefixLength || memcmp(message, prefix, prefixLength) != 0)
+    return 0;
+
+  uint32_t period = 0;
+  for (size_t i = prefixLength; i < length && message[i] >= '0' && message[i] <= '9'; i++)
+    period = period * 10 + (message[i] - '0');
+  return period;
+}
+
+void RollupEncoder ::pack(const Rollup &rollup, uint8_t *out)
+{
+  putU32(out + 0, rollup.start);
+  putU32(out + 4, rollup.period);
+  putU32(out + 8, rollup.samples);
+  for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+  {
+    const RunningStats &s = rollup.channels[c];
+    uint8_t *p = out + 12 + c * 16;
+    // Un canal sin lecturas se guarda como NaN
+    putF32(p + 0, s.count > 0 ? s.min : NAN);
+    putF32(p + 4, s.count > 0 ? s.max : NAN);
+    putF32(p + 8, s.count > 0 ? s.mean : NAN);
+    putF32(p + 12, s.count > 0 ? s.stddev() : NAN);
+  }
+}
+
+void RollupEncoder ::unpack(const uint8_t *in, Rollup &rollup)
+{
+  rollup.start = getU32(in + 0);
+  rollup.period = getU32(in + 4);
+  rollup.samples = getU32(in + 8);
+  for (uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+  {
+    // Sólo se recupera lo que se publica: la desviación queda en m2 con n = 2
+    RunningStats &s = rollup.channels[c];
+    const uint8_t *p = in + 12 + c * 16;
+    s.min = getF32(p + 0);
+    s.max = getF32(p + 4);
+    s.mean = getF32(p + 8);
+    float deviation = getF32(p + 12);
+    s.count = isnan(s.mean) ? 0 : 2;
+    s.m2 = deviation * deviation;
+  }
+}
+
+#endif
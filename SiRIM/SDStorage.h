@@ -0,0 +1,283 @@
+#ifndef SDStorage_h
+#define SDStorage_h
+
+#include <SD.h>
+#include "Datalog.h"
+#include "SeriesStore.h"
+
+// Archivo preasignado en la microSD accedido por bloques. El archivo se crea
+// una sola vez con su tamaño final, así que las escrituras posteriores no
+// modifican la FAT ni la entrada de directorio.
+class SDBlockStorage : public BlockStorage
+{
+private:
+  File file;
+  uint32_t blocks = 0;
+
+public:
+  bool begin(const char *path, uint32_t numBlocks);
+  void end(void);
+  bool readBlock(uint32_t index, uint8_t *buffer);
+  bool writeBlock(uint32_t index, const uint8_t *buffer);
+  uint32_t blockCount(void) { return blocks; }
+};
+
+bool SDBlockStorage ::begin(const char *path, uint32_t numBlocks)
+{
+  uint32_t bytes = numBlocks * DATALOG_BLOCK_SIZE;
+  blocks = 0;
+
+  if (!SD.exists(path) || SD.open(path, FILE_READ).size() < bytes)
+  {
+    // Preasignar con ceros; sólo ocurre la primera vez
+    File created = SD.open(path, FILE_WRITE);
+    if (!created)
+      return false;
+    uint8_t zeros[DATALOG_BLOCK_SIZE];
+    memset(zeros, 0, sizeof(zeros));
+    for (uint32_t i = 0; i < numBlocks; i++)
+    {
+      if (created.write(zeros, sizeof(zeros)) != sizeof(zeros))
+      {
+        created.close();
+        return false;
+      }
+    }
+    created.close();
+  }
+
+  // "r+" permite escribir en cualquier posición sin truncar
+  file = SD.open(path, "r+");
+  if (!file)
+    return false;
+
+  blocks = numBlocks;
+  return true;
+}
+
+void SDBlockStorage ::end(void)
+{
+  if (file)
+    file.close();
+  blocks = 0;
+}
+
+bool SDBlockStorage ::readBlock(uint32_t index, uint8_t *buffer)
+{
+  if (index >= blocks || !file.seek(index * DATALOG_BLOCK_SIZE))
+    return false;
+  return file.read(buffer, DATALOG_BLOCK_SIZE) == DATALOG_BLOCK_SIZE;
+}
+
+bool SDBlockStorage ::writeBlock(uint32_t index, const uint8_t *buffer)
+{
+  if (index >= blocks || !file.seek(index * DATALOG_BLOCK_SIZE))
+    return false;
+  if (file.write(buffer, DATALOG_BLOCK_SIZE) != DATALOG_BLOCK_SIZE)
+    return false;
+  file.flush();
+  return true;
+}
+
+/*
+  Particiones de la serie (SeriesStore.h) como archivos de la microSD:
+  <directorio>/AAAAMMDD.dat y AAAAMMDD.idx (nombres 8.3). Quedan abiertos
+  los archivos del día en que se escribe y los del último día consultado.
+*/
+class SDPartitionStorage : public PartitionStorage
+{
+private:
+  const char *directory = NULL;
+  File writeFiles[2];
+  File readFiles[2];
+  uint32_t writeDay = SERIES_NO_DAY;
+  uint32_t readDay = SERIES_NO_DAY;
+
+  void path(uint32_t day, SeriesFile file, char *out, size_t size);
+  File *openFile(uint32_t day, SeriesFile file, bool write);
+  void closeDay(uint32_t day);
+
+public:
+  bool begin(const char *dir);
+  bool readBlock(uint32_t day, SeriesFile file, uint32_t index, uint8_t *buffer);
+  bool writeBlock(uint32_t day, SeriesFile file, uint32_t index, const uint8_t *buffer);
+  uint32_t blockCount(uint32_t day, SeriesFile file);
+  bool removeDay(uint32_t day);
+  uint32_t oldestDay(void);
+
+  // Fecha civil <-> días desde 1970 (algoritmo de Howard Hinnant)
+  static void civilFromDays(uint32_t day, uint16_t &year, uint8_t &month, uint8_t &dayOfMonth);
+  static uint32_t daysFromCivil(uint16_t year, uint8_t month, uint8_t dayOfMonth);
+};
+
+bool SDPartitionStorage ::begin(const char *dir)
+{
+  directory = dir;
+  if (!SD.exists(dir) && !SD.mkdir(dir))
+    return false;
+  return true;
+}
+
+void SDPartitionStorage ::civilFromDays(uint32_t day, uint16_t &year, uint8_t &month, uint8_t &dayOfMonth)
+{
+  int32_t z = (int32_t)day + 719468;
+  int32_t era = z / 146097;
+  uint32_t doe = (uint32_t)(z - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  dayOfMonth = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  year = (uint16_t)(yoe + era * 400 + (month <= 2));
+}
+
+uint32_t SDPartitionStorage ::daysFromCivil(uint16_t year, uint8_t month, uint8_t dayOfMonth)
+{
+  int32_t y = (int32_t)year - (month <= 2);
+  int32_t era = y / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + dayOfMonth - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (uint32_t)(era * 146097 + (int32_t)doe - 719468);
+}
+
+void SDPartitionStorage ::path(uint32_t day, SeriesFile file, char *out, size_t size)
+{
+  uint16_t year;
+  uint8_t month, dayOfMonth;
+  civilFromDays(day, year, month, dayOfMonth);
+  snprintf(out, size, "%s/%04u%02u%02u.%s", directory, year, month, dayOfMonth, file == SERIES_DATA ? "dat" : "idx");
+}
+
+File *SDPartitionStorage ::openFile(uint32_t day, SeriesFile file, bool write)
+{
+  if (day == writeDay)
+    return &writeFiles[file];
+  if (!write && day == readDay)
+    return &readFiles[file];
+
+  char name[40];
+  if (write)
+  {
+    // Los dos archivos del día nuevo; "r+" escribe en cualquier posición sin truncar
+    for (uint8_t f = 0; f < 2; f++)
+    {
+      writeFiles[f].close();
+      path(day, (SeriesFile)f, name, sizeof(name));
+      if (!SD.exists(name))
+      {
+        File created = SD.open(name, FILE_WRITE);
+        if (!created)
+          return NULL;
+        created.close();
+      }
+      writeFiles[f] = SD.open(name, "r+");
+      if (!writeFiles[f])
+        return NULL;
+    }
+    if (readDay == day)
+      closeDay(day);
+    writeDay = day;
+    return &writeFiles[file];
+  }
+
+  // Un día sin partición no se crea al consultarlo
+  path(day, SERIES_DATA, name, sizeof(name));
+  if (!SD.exists(name))
+    return NULL;
+  for (uint8_t f = 0; f < 2; f++)
+  {
+    path(day, (SeriesFile)f, name, sizeof(name));
+    readFiles[f] = SD.open(name, FILE_READ);
+  }
+  readDay = day;
+  return &readFiles[file];
+}
+
+void SDPartitionStorage ::closeDay(uint32_t day)
+{
+  for (uint8_t f = 0; f < 2; f++)
+  {
+    if (day == writeDay)
+      writeFiles[f].close();
+    if (day == readDay)
+      readFiles[f].close();
+  }
+  if (day == writeDay)
+    writeDay = SERIES_NO_DAY;
+  if (day == readDay)
+    readDay = SERIES_NO_DAY;
+}
+
+bool SDPartitionStorage ::readBlock(uint32_t day, SeriesFile file, uint32_t index, uint8_t *buffer)
+{
+  File *f = openFile(day, file, false);
+  if (f == NULL || !*f || !f->seek(index * DATALOG_BLOCK_SIZE))
+    return false;
+  return f->read(buffer, DATALOG_BLOCK_SIZE) == DATALOG_BLOCK_SIZE;
+}
+
+bool SDPartitionStorage ::writeBlock(uint32_t day, SeriesFile file, uint32_t index, const uint8_t *buffer)
+{
+  File *f = openFile(day, file, true);
+  if (f == NULL || !*f || index > f->size() / DATALOG_BLOCK_SIZE || !f->seek(index * DATALOG_BLOCK_SIZE))
+    return false;
+  if (f->write(buffer, DATALOG_BLOCK_SIZE) != DATALOG_BLOCK_SIZE)
+    return false;
+  f->flush();
+  return true;
+}
+
+uint32_t SDPartitionStorage ::blockCount(uint32_t day, SeriesFile file)
+{
+  File *f = openFile(day, file, false);
+  if (f == NULL || !*f)
+    return 0;
+  return f->size() / DATALOG_BLOCK_SIZE;
+}
+
+bool SDPartitionStorage ::removeDay(uint32_t day)
+{
+  closeDay(day);
+  char name[40];
+  bool removed = true;
+  for (uint8_t f = 0; f < 2; f++)
+  {
+    path(day, (SeriesFile)f, name, sizeof(name));
+    if (SD.exists(name))
+      removed = SD.remove(name) && removed;
+  }
+  return removed;
+}
+
+uint32_t SDPartitionStorage ::oldestDay(void)
+{
+  File dir = SD.open(directory);
+  if (!dir || !dir.isDirectory())
+    return SERIES_NO_DAY;
+
+  uint32_t oldest = SERIES_NO_DAY;
+  File entry;
+  while ((entry = dir.openNextFile()))
+  {
+    // Sólo los archivos AAAAMMDD.dat
+    const char *name = entry.name();
+    bool valid = strlen(name) == 12 && strcmp(name + 8, ".dat") == 0;
+    uint32_t date = 0;
+    for (uint8_t i = 0; valid && i < 8; i++)
+    {
+      valid = name[i] >= '0' && name[i] <= '9';
+      date = date * 10 + (name[i] - '0');
+    }
+    entry.close();
+    if (!valid)
+      continue;
+    uint32_t day = daysFromCivil(date / 10000, date / 100 % 100, date % 100);
+    if (day < oldest)
+      oldest = day;
+  }
+  dir.close();
+  return oldest;
+}
+
+#endif
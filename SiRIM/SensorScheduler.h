@@ -0,0 +1,162 @@
+#ifndef SensorScheduler_h
+#define SensorScheduler_h
+
+#include <stdint.h>
+#include "Instrumentation.h"
+
+/*
+  Planificador de lecturas por sensor.
+
+  Cada sensor se registra con su propio periodo, un plazo (cuánto puede
+  retrasarse su lectura) y un costo estimado. runDue() ejecuta los que ya
+  tocan en orden de plazo más cercano y, si la vuelta excede su presupuesto
+  de tiempo, deja el resto para la siguiente vuelta; así un sensor lento
+  (el DHT11 tarda ~25 ms) no retrasa a los rápidos (LDR, humedad de suelo).
+
+  Los relojes se pasan como funciones para poder correrlo en el escritorio
+  con un reloj virtual.
+*/
+
+#define SCHED_MAX_SENSORS 8
+#define SCHED_PASS_BUDGET_US 30000 // Tiempo máximo de lecturas por vuelta
+
+typedef void (*SensorReadFunction)(void *context);
+typedef uint32_t (*ClockFunction)(void);
+
+struct SensorEntry
+{
+  const char *name;
+  uint32_t periodMs;
+  uint32_t deadlineMs;
+  uint32_t costUs;
+  SensorReadFunction read;
+  void *context;
+
+  uint32_t nextDue;  // Próxima lectura (ms)
+  uint32_t lastRead; // Momento de la última lectura (ms)
+  bool hasRead;
+
+  // Duración de cada lectura y lecturas que empezaron fuera de plazo
+  LatencyStats duration;
+  uint32_t deadlineMisses;
+};
+
+class SensorScheduler
+{
+private:
+  SensorEntry entries[SCHED_MAX_SENSORS];
+  uint8_t count = 0;
+  ClockFunction clockMs;
+  ClockFunction clockUs;
+
+public:
+  SensorScheduler(ClockFunction millisClock, ClockFunction microsClock)
+      : clockMs(millisClock), clockUs(microsClock) {}
+
+  // Devuelve el índice del sensor o -1 si no hay espacio
+  int8_t add(const char *name, uint32_t periodMs, uint32_t deadlineMs, uint32_t costUs,
+             SensorReadFunction read, void *context);
+
+  // Ejecuta las lecturas pendientes; devuelve los ms hasta la próxima
+  uint32_t runDue(void);
+
+  uint8_t size(void) { return count; }
+  SensorEntry &entry(uint8_t index) { return entries[index]; }
+
+  // Tras dormir: todas las lecturas tocan ya, sin contar el sueño como retraso
+  void restart(void);
+
+  // Antigüedad de la última lectura de un sensor (ms)
+  uint32_t ageMs(uint8_t index) { return clockMs() - entries[index].lastRead; }
+};
+
+int8_t SensorScheduler ::add(const char *name, uint32_t periodMs, uint32_t deadlineMs, uint32_t costUs,
+                             SensorReadFunction read, void *context)
+{
+  if (count >= SCHED_MAX_SENSORS)
+    return -1;
+
+  SensorEntry &e = entries[count];
+  e.name = name;
+  e.periodMs = periodMs;
+  e.deadlineMs = deadlineMs;
+  e.costUs = costUs;
+  e.read = read;
+  e.context = context;
+  e.nextDue = clockMs();
+  e.lastRead = 0;
+  e.hasRead = false;
+  e.duration.reset();
+  e.deadlineMisses = 0;
+  return count++;
+}
+
+void SensorScheduler ::restart(void)
+{
+  uint32_t now = clockMs();
+  for (uint8_t i = 0; i < count; i++)
+    entries[i].nextDue = now;
+}
+
+uint32_t SensorScheduler ::runDue(void)
+{
+  uint32_t passStart = clockUs();
+  bool ran[SCHED_MAX_SENSORS] = {false};
+
+  while (true)
+  {
+    // Elegir el pendiente con el plazo absoluto más cercano (EDF); a igual
+    // plazo, el más barato
+    uint32_t now = clockMs();
+    int8_t pick = -1;
+    int32_t pickSlack = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      SensorEntry &e = entries[i];
+      if (ran[i] || (int32_t)(now - e.nextDue) < 0)
+        continue;
+      int32_t slack = (int32_t)(e.nextDue + e.deadlineMs - now);
+      if (pick < 0 || slack < pickSlack || (slack == pickSlack && e.costUs < entries[pick].costUs))
+      {
+        pick = i;
+        pickSlack = slack;
+      }
+    }
+    if (pick < 0)
+      break;
+
+    SensorEntry &e = entries[pick];
+    // Respetar el presupuesto de la vuelta, salvo que la lectura ya vaya tarde
+    if (clockUs() - passStart + e.costUs > SCHED_PASS_BUDGET_US && pickSlack > 0)
+      break;
+
+    if (pickSlack < 0)
+      e.deadlineMisses++;
+
+    uint32_t start = clockUs();
+    e.read(e.context);
+    e.duration.record(clockUs() - start);
+
+    e.lastRead = now;
+    e.hasRead = true;
+    // Mantener la fase: si se atrasó más de un periodo, se reprograma desde ahora
+    e.nextDue += e.periodMs;
+    if ((int32_t)(now - e.nextDue) >= 0)
+      e.nextDue = now + e.periodMs;
+    ran[pick] = true;
+  }
+
+  // Tiempo hasta el siguiente sensor pendiente
+  uint32_t now = clockMs();
+  uint32_t wait = UINT32_MAX;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    int32_t until = (int32_t)(entries[i].nextDue - now);
+    uint32_t w = until > 0 ? (uint32_t)until : 0;
+    if (w < wait)
+      wait = w;
+  }
+  return wait;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SensorsData_h
+#define SensorsData_h
+
+#include <stdint.h>
+
+// Lectura completa de los sensores en un instante. No depende de Arduino para
+// que también pueda usarse en las herramientas de escritorio (Herramientas/).
+struct SensorsData {
+  float temperature;      // °C
+  float humidity;         // % humedad relativa del aire
+  int16_t soilMoisture1;  // % humedad del suelo, sensor 1
+  int16_t soilMoisture2;  // % humedad del suelo, sensor 2
+  int16_t lightIntensity; // % iluminación
+  float waterLevel;       // Distancia medida por el ultrasónico (cm)
+  int16_t waterPercent;   // % de llenado del tanque
+  uint32_t timestamp;     // Segundos Unix tomados del RTC (hora local)
+};
+
+#endif
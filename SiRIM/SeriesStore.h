@@ -0,0 +1,505 @@
+#ifndef SeriesStore_h
+#define SeriesStore_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "SensorsData.h"
+#include "Datalog.h"
+
+/*
+  Serie de tiempo de las muestras en la microSD, una partición por día.
+
+  Cada día (hora local del RTC, timestamp / 86400) tiene dos archivos:
+
+    datos   bloques de 512 bytes con el formato de la bitácora (Datalog.h:
+            encabezado con CRC y 20 registros); la secuencia es el número de
+            bloque dentro del día. El último bloque puede estar incompleto.
+    índice  una entrada de 8 bytes por bloque de datos completo, 64 por
+            bloque del índice:
+              0  uint32 maxTimestamp  Máximo de la partición hasta este bloque
+              4  uint8  flags         SERIES_UNORDERED: algún registro hasta
+                                      aquí llegó con el reloj atrasado
+              5  reservado
+
+  Como maxTimestamp nunca decrece, el primer bloque que puede tener una
+  muestra >= t se encuentra con búsqueda binaria sobre el índice: unas
+  log2(864 / 64) + log2(64) lecturas para un día de muestras cada 5 s, sin
+  recorrer los datos. Si el reloj nunca se atrasó la lectura se detiene en
+  la primera muestra posterior al rango; si se atrasó se recorre el resto de
+  la partición. Los bloques sin entrada (el bloque incompleto o uno cuya
+  entrada no se escribió por un corte) se recorren siempre; al reabrir el
+  día el índice se reconstruye a partir de los datos.
+
+  La retención borra particiones completas: al abrir un día más nuevo que
+  los anteriores se eliminan las de hace SERIES_RETENTION_DAYS días o más.
+  Un reloj adelantado por error también borra, así que conviene que el RTC
+  se ajuste antes de guardar muestras.
+
+  SeriesStore no es reentrante: la tarea de sensores agrega y la de red
+  consulta (RangeQuery.h), así que ambas lo usan con el mismo mutex.
+*/
+
+#define SERIES_SECONDS_PER_DAY 86400UL
+#ifndef SERIES_RETENTION_DAYS
+#define SERIES_RETENTION_DAYS 365
+#endif
+#define SERIES_NO_DAY 0xFFFFFFFFUL
+#define SERIES_INDEX_ENTRY_SIZE 8
+#define SERIES_INDEX_PER_BLOCK (DATALOG_BLOCK_SIZE / SERIES_INDEX_ENTRY_SIZE)
+#define SERIES_UNORDERED 0x01
+
+enum SeriesFile
+{
+  SERIES_DATA,
+  SERIES_INDEX
+};
+
+// Archivos de las particiones por bloques de DATALOG_BLOCK_SIZE bytes. En el
+// ESP32 lo implementa SDPartitionStorage (SDStorage.h); en el escritorio el
+// mismo código corre sobre el SD simulado de Herramientas/host.
+class PartitionStorage
+{
+public:
+  virtual ~PartitionStorage() {}
+  virtual bool readBlock(uint32_t day, SeriesFile file, uint32_t index, uint8_t *buffer) = 0;
+  // Sobrescribe un bloque o agrega uno al final (index == blockCount); crea
+  // los archivos del día si no existen
+  virtual bool writeBlock(uint32_t day, SeriesFile file, uint32_t index, const uint8_t *buffer) = 0;
+  virtual uint32_t blockCount(uint32_t day, SeriesFile file) = 0;
+  virtual bool removeDay(uint32_t day) = 0;
+  // Día más antiguo con partición, o SERIES_NO_DAY si no hay ninguna
+  virtual uint32_t oldestDay(void) = 0;
+};
+
+class SeriesStore
+{
+private:
+  PartitionStorage &storage;
+  uint8_t block[DATALOG_BLOCK_SIZE]; // Bloque de datos en construcción
+  uint8_t index[DATALOG_BLOCK_SIZE]; // Bloque del índice con la siguiente entrada
+  uint32_t openDay = SERIES_NO_DAY;
+  uint32_t sealedBlocks = 0; // Bloques completos del día abierto (= entradas del índice)
+  uint16_t count = 0;        // Registros en el bloque en construcción
+  uint32_t maxTimestamp = 0;
+  uint8_t flags = 0;
+  uint32_t newestDay = 0;
+  bool ready = false;
+
+  bool openPartition(uint32_t day);
+  bool sealCurrentBlock(void);
+  void writeIndexEntry(void);
+  void track(uint32_t timestamp);
+  void enforceRetention(void);
+  uint32_t storedEntries(uint32_t day, uint8_t *lastIndexBlock);
+
+public:
+  // Métricas
+  uint32_t blocksWritten = 0;
+  uint32_t writeErrors = 0;
+  uint32_t partitionsRemoved = 0;
+  uint32_t outOfOrder = 0;   // Muestras anteriores a la última del mismo día
+  uint32_t blocksRead = 0;   // Lecturas de las consultas (datos e índice)
+
+  SeriesStore(PartitionStorage &partitionStorage) : storage(partitionStorage) {}
+
+  bool begin(void)
+  {
+    openDay = SERIES_NO_DAY;
+    count = 0;
+    ready = true;
+    return true;
+  }
+  bool isReady(void) { return ready; }
+
+  // Agrega una muestra a la partición de su día; sólo escribe en la SD cada
+  // bloque completo
+  bool append(const SensorsData &data);
+
+  // Escribe el bloque incompleto (se vuelve a escribir al llenarse)
+  bool flush(void);
+
+  /*-- Lectura para las consultas --*/
+
+  // Bloques de datos del día, incluido el que está en RAM
+  uint32_t dataBlocks(uint32_t day);
+  // Entradas del índice del día (bloques completos indexados)
+  uint32_t indexEntries(uint32_t day);
+  // El bloque en construcción se entrega sellado, como si ya estuviera en la SD
+  bool readData(uint32_t day, uint32_t block, uint8_t *buffer);
+  bool readIndex(uint32_t day, uint32_t block, uint8_t *buffer);
+
+  static uint32_t entryMax(const uint8_t *indexBlock, uint32_t entry)
+  {
+    return getU32(indexBlock + (entry % SERIES_INDEX_PER_BLOCK) * SERIES_INDEX_ENTRY_SIZE);
+  }
+  static uint8_t entryFlags(const uint8_t *indexBlock, uint32_t entry)
+  {
+    return indexBlock[(entry % SERIES_INDEX_PER_BLOCK) * SERIES_INDEX_ENTRY_SIZE + 4];
+  }
+};
+
+// Recorre en orden de archivo las muestras de un rango [from, to]
+class SeriesQuery
+{
+private:
+  SeriesStore &store;
+  uint8_t block[DATALOG_BLOCK_SIZE];
+  uint8_t index[DATALOG_BLOCK_SIZE];
+  uint32_t indexDay = SERIES_NO_DAY; // Bloque del índice cargado en index
+  uint32_t indexBlock = 0;
+  uint32_t from = 0;
+  uint32_t to = 0;
+  uint32_t day = 0;
+  uint32_t blockIndex = 0;
+  uint32_t blocks = 0;  // Bloques de datos del día
+  uint32_t indexed = 0; // Bloques con entrada en el índice
+  uint16_t record = 0;
+  uint16_t records = 0;
+  bool ordered = true;
+  bool active = false;
+
+  bool loadIndex(uint32_t entry);
+  bool enterDay(void);
+  bool loadBlock(void);
+
+public:
+  uint32_t matched = 0;
+
+  SeriesQuery(SeriesStore &seriesStore) : store(seriesStore) {}
+
+  void start(uint32_t fromTimestamp, uint32_t toTimestamp);
+  void stop(void) { active = false; }
+  bool isActive(void) { return active; }
+
+  // Siguiente muestra del rango; false al terminar
+  bool next(SensorsData &out);
+};
+
+/*-- SeriesStore --*/
+
+void SeriesStore ::track(uint32_t timestamp)
+{
+  if (timestamp < maxTimestamp)
+  {
+    flags |= SERIES_UNORDERED;
+    outOfOrder++;
+  }
+  else
+    maxTimestamp = timestamp;
+}
+
+uint32_t SeriesStore ::storedEntries(uint32_t day, uint8_t *lastIndexBlock)
+{
+  uint32_t n = storage.blockCount(day, SERIES_INDEX);
+  if (n == 0 || !storage.readBlock(day, SERIES_INDEX, n - 1, lastIndexBlock))
+  {
+    memset(lastIndexBlock, 0, DATALOG_BLOCK_SIZE);
+    return 0;
+  }
+  // Las entradas sin usar están en cero
+  uint32_t used = 0;
+  while (used < SERIES_INDEX_PER_BLOCK && entryMax(lastIndexBlock, used) != 0)
+    used++;
+  return (n - 1) * SERIES_INDEX_PER_BLOCK + used;
+}
+
+bool SeriesStore ::openPartition(uint32_t day)
+{
+  // El bloque incompleto del día anterior queda en la SD
+  flush();
+
+  openDay = day;
+  count = 0;
+  maxTimestamp = 0;
+  flags = 0;
+  memset(block, 0, sizeof(block));
+
+  sealedBlocks = storedEntries(day, index);
+  if (sealedBlocks > 0)
+  {
+    maxTimestamp = entryMax(index, sealedBlocks - 1);
+    flags = entryFlags(index, sealedBlocks - 1);
+  }
+  if (sealedBlocks % SERIES_INDEX_PER_BLOCK == 0)
+    memset(index, 0, sizeof(index));
+
+  // Bloques sin entrada: completos (corte antes de escribir el índice) o el
+  // último incompleto, que se sigue llenando
+  uint32_t blocks = storage.blockCount(day, SERIES_DATA);
+  uint32_t appendedOutOfOrder = outOfOrder; // Sólo se cuentan las muestras nuevas
+  while (sealedBlocks < blocks)
+  {
+    if (!storage.readBlock(day, SERIES_DATA, sealedBlocks, block) || !Datalog::isValidBlock(block))
+    {
+      // Bloque a medio escribir: el siguiente ocupa su lugar
+      memset(block, 0, sizeof(block));
+      break;
+    }
+    uint16_t stored = getU16(block + 8);
+    for (uint16_t r = 0; r < stored; r++)
+      track(getU32(block + DATALOG_HEADER_SIZE + r * DATALOG_RECORD_SIZE));
+    if (stored < DATALOG_RECORDS_PER_BLOCK)
+    {
+      count = stored;
+      break;
+    }
+    writeIndexEntry();
+  }
+  outOfOrder = appendedOutOfOrder;
+
+  if (day > newestDay)
+  {
+    newestDay = day;
+    enforceRetention();
+  }
+  return true;
+}
+
+void SeriesStore ::enforceRetention(void)
+{
+  uint32_t oldest;
+  while ((oldest = storage.oldestDay()) != SERIES_NO_DAY && oldest + SERIES_RETENTION_DAYS <= newestDay &&
+         oldest != openDay)
+  {
+    if (!storage.removeDay(oldest))
+      break;
+    partitionsRemoved++;
+  }
+}
+
+bool SeriesStore ::append(const SensorsData &data)
+{
+  if (!ready)
+    return false;
+
+  uint32_t day = data.timestamp / SERIES_SECONDS_PER_DAY;
+  if (day != openDay && !openPartition(day))
+  {
+    writeErrors++;
+    openDay = SERIES_NO_DAY;
+    return false;
+  }
+
+  Datalog::packRecord(data, block + DATALOG_HEADER_SIZE + count * DATALOG_RECORD_SIZE);
+  count++;
+  track(data.timestamp);
+
+  if (count < DATALOG_RECORDS_PER_BLOCK)
+    return true;
+  return sealCurrentBlock();
+}
+
+bool SeriesStore ::sealCurrentBlock(void)
+{
+  Datalog::sealBlock(block, sealedBlocks, count);
+  if (!storage.writeBlock(openDay, SERIES_DATA, sealedBlocks, block))
+  {
+    // El bloque se pierde; el siguiente ocupa su lugar
+    writeErrors++;
+    count = 0;
+    return false;
+  }
+
+  blocksWritten++;
+  writeIndexEntry();
+  return true;
+}
+
+// Entrada del bloque completo que está en block; pasa al siguiente bloque
+void SeriesStore ::writeIndexEntry(void)
+{
+  uint8_t *entry = index + (sealedBlocks % SERIES_INDEX_PER_BLOCK) * SERIES_INDEX_ENTRY_SIZE;
+  putU32(entry, maxTimestamp);
+  entry[4] = flags;
+  if (!storage.writeBlock(openDay, SERIES_INDEX, sealedBlocks / SERIES_INDEX_PER_BLOCK, index))
+    writeErrors++; // Se reconstruye al reabrir el día
+
+  sealedBlocks++;
+  count = 0;
+  memset(block, 0, sizeof(block));
+  if (sealedBlocks % SERIES_INDEX_PER_BLOCK == 0)
+    memset(index, 0, sizeof(index));
+}
+
+bool SeriesStore ::flush(void)
+{
+  if (openDay == SERIES_NO_DAY || count == 0)
+    return true;
+  Datalog::sealBlock(block, sealedBlocks, count);
+  if (!storage.writeBlock(openDay, SERIES_DATA, sealedBlocks, block))
+  {
+    writeErrors++;
+    return false;
+  }
+  return true;
+}
+
+uint32_t SeriesStore ::dataBlocks(uint32_t day)
+{
+  if (day == openDay)
+    return sealedBlocks + (count > 0 ? 1 : 0);
+  return storage.blockCount(day, SERIES_DATA);
+}
+
+uint32_t SeriesStore ::indexEntries(uint32_t day)
+{
+  if (day == openDay)
+    return sealedBlocks;
+  uint8_t last[DATALOG_BLOCK_SIZE];
+  blocksRead++;
+  return storedEntries(day, last);
+}
+
+bool SeriesStore ::readData(uint32_t day, uint32_t n, uint8_t *buffer)
+{
+  if (day == openDay && n == sealedBlocks && count > 0)
+  {
+    memcpy(buffer, block, DATALOG_BLOCK_SIZE);
+    Datalog::sealBlock(buffer, n, count);
+    return true;
+  }
+  blocksRead++;
+  return storage.readBlock(day, SERIES_DATA, n, buffer);
+}
+
+bool SeriesStore ::readIndex(uint32_t day, uint32_t n, uint8_t *buffer)
+{
+  if (day == openDay && n == sealedBlocks / SERIES_INDEX_PER_BLOCK)
+  {
+    memcpy(buffer, index, DATALOG_BLOCK_SIZE);
+    return true;
+  }
+  blocksRead++;
+  return storage.readBlock(day, SERIES_INDEX, n, buffer);
+}
+
+/*-- SeriesQuery --*/
+
+bool SeriesQuery ::loadIndex(uint32_t entry)
+{
+  uint32_t n = entry / SERIES_INDEX_PER_BLOCK;
+  if (indexDay == day && indexBlock == n)
+    return true;
+  if (!store.readIndex(day, n, index))
+  {
+    indexDay = SERIES_NO_DAY;
+    return false;
+  }
+  indexDay = day;
+  indexBlock = n;
+  return true;
+}
+
+// Ubica el primer bloque del día que puede tener muestras >= from
+bool SeriesQuery ::enterDay(void)
+{
+  blocks = store.dataBlocks(day);
+  indexed = blocks > 0 ? store.indexEntries(day) : 0;
+  if (indexed > blocks)
+    indexed = blocks;
+  blockIndex = 0;
+  record = records = 0;
+  ordered = true;
+  indexDay = SERIES_NO_DAY;
+  if (blocks == 0)
+    return false;
+
+  if (indexed > 0)
+  {
+    if (!loadIndex(indexed - 1))
+    {
+      // Sin índice legible se recorre todo el día
+      indexed = 0;
+      ordered = false;
+      return true;
+    }
+    ordered = !(SeriesStore::entryFlags(index, indexed - 1) & SERIES_UNORDERED);
+
+    uint32_t lo = 0, hi = indexed;
+    while (lo < hi)
+    {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (!loadIndex(mid))
+        break;
+      if (SeriesStore::entryMax(index, mid) >= from)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    blockIndex = lo;
+  }
+  return true;
+}
+
+bool SeriesQuery ::loadBlock(void)
+{
+  record = records = 0;
+  if (!store.readData(day, blockIndex, block) || !Datalog::isValidBlock(block))
+    return false;
+  records = getU16(block + 8);
+  return true;
+}
+
+void SeriesQuery ::start(uint32_t fromTimestamp, uint32_t toTimestamp)
+{
+  from = fromTimestamp;
+  to = toTimestamp;
+  day = from / SERIES_SECONDS_PER_DAY;
+  matched = 0;
+  active = from <= to;
+  if (active && enterDay() && blockIndex < blocks)
+    loadBlock();
+  else
+    blocks = 0;
+}
+
+bool SeriesQuery ::next(SensorsData &out)
+{
+  while (active)
+  {
+    if (record >= records)
+    {
+      // Siguiente bloque del día o primer bloque del día siguiente
+      if (blocks > 0 && blockIndex + 1 < blocks)
+      {
+        blockIndex++;
+        loadBlock();
+        continue;
+      }
+      if (day >= to / SERIES_SECONDS_PER_DAY)
+      {
+        active = false;
+        return false;
+      }
+      day++;
+      if (enterDay() && blockIndex < blocks)
+        loadBlock();
+      else
+        blocks = 0;
+      continue;
+    }
+
+    const uint8_t *r = block + DATALOG_HEADER_SIZE + record * DATALOG_RECORD_SIZE;
+    record++;
+    uint32_t timestamp = getU32(r);
+    if (timestamp > to)
+    {
+      // En la parte ordenada no hay nada más del rango; falta la cola sin índice
+      if (ordered && blockIndex < indexed)
+      {
+        record = records;
+        blockIndex = indexed - 1;
+      }
+      continue;
+    }
+    if (timestamp < from)
+      continue;
+    Datalog::unpackRecord(r, out);
+    matched++;
+    return true;
+  }
+  return false;
+}
+
+#endif
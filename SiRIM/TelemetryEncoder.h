@@ -0,0 +1,327 @@
+#ifndef TelemetryEncoder_h
+#define TelemetryEncoder_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "SensorsData.h"
+
+/*
+  Codificador JSON de telemetría sin memoria dinámica.
+
+  Escribe el mismo documento que generaba createJSON con ArduinoJson, pero
+  directamente en un buffer fijo (por ejemplo MQTTMessage.message). No usa
+  String, DynamicJsonDocument ni printf, así que no toca el heap.
+*/
+
+// Escritor secuencial sobre un buffer del llamador. Si el texto no cabe se
+// marca como truncado y el resto de las escrituras se ignoran.
+class JsonWriter
+{
+private:
+  char *buffer;
+  size_t capacity;
+  size_t length = 0;
+  bool overflow = false;
+  bool needComma = false;
+
+  void putChar(char c);
+  void separator(void);
+
+public:
+  JsonWriter(char *out, size_t size) : buffer(out), capacity(size)
+  {
+    if (capacity > 0)
+      buffer[0] = '\0';
+  }
+
+  void beginObject(const char *name = NULL);
+  void endObject(void);
+  void beginArray(const char *name = NULL);
+  void endArray(void);
+  void key(const char *name);
+  void raw(const char *text);
+  void digits(uint32_t value);
+  void number(int32_t value);
+  void number(uint32_t value);
+  void number(float value, uint8_t decimals = 2);
+  void boolean(bool value);
+  void string(const char *text);
+
+  // Termina la cadena; devuelve false si hubo truncamiento
+  bool finish(void);
+  bool truncated(void) { return overflow; }
+  size_t size(void) { return length; }
+};
+
+// Fecha y hora civil a partir de segundos Unix (sin zona horaria)
+struct CivilTime
+{
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+};
+
+class TelemetryEncoder
+{
+public:
+  static CivilTime civilFromUnix(uint32_t timestamp);
+
+  // Codifica una muestra. Devuelve false si el buffer no alcanza; en ese caso
+  // out queda como cadena vacía y no se debe publicar.
+  static bool encode(const SensorsData &data, bool manualIrrigation, char *out, size_t size, size_t *length = NULL);
+};
+
+/*-- JsonWriter --*/
+
+void JsonWriter ::putChar(char c)
+{
+  // Se reserva un byte para el terminador
+  if (length + 1 < capacity)
+    buffer[length++] = c;
+  else
+    overflow = true;
+}
+
+void JsonWriter ::separator(void)
+{
+  if (needComma)
+    putChar(',');
+  needComma = true;
+}
+
+void JsonWriter ::beginObject(const char *name)
+{
+  if (name != NULL)
+    key(name);
+  else
+    separator();
+  putChar('{');
+  needComma = false;
+}
+
+void JsonWriter ::endObject(void)
+{
+  putChar('}');
+  needComma = true;
+}
+
+void JsonWriter ::beginArray(const char *name)
+{
+  if (name != NULL)
+    key(name);
+  else
+    separator();
+  putChar('[');
+  needComma = false;
+}
+
+void JsonWriter ::endArray(void)
+{
+  putChar(']');
+  needComma = true;
+}
+
+void JsonWriter ::key(const char *name)
+{
+  string(name);
+  putChar(':');
+  needComma = false;
+}
+
+void JsonWriter ::raw(const char *text)
+{
+  while (*text)
+    putChar(*text++);
+}
+
+void JsonWriter ::digits(uint32_t value)
+{
+  char reversed[10];
+  uint8_t n = 0;
+  do
+  {
+    reversed[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (n > 0)
+    putChar(reversed[--n]);
+}
+
+void JsonWriter ::number(uint32_t value)
+{
+  separator();
+  digits(value);
+}
+
+void JsonWriter ::number(int32_t value)
+{
+  separator();
+  if (value < 0)
+    putChar('-');
+  digits(value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value);
+}
+
+void JsonWriter ::number(float value, uint8_t decimals)
+{
+  // Igual que ArduinoJson: NaN e infinito se escriben como null
+  if (isnan(value) || isinf(value) || fabsf(value) > 2.0e9f)
+  {
+    separator();
+    raw("null");
+    return;
+  }
+
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++)
+    scale *= 10;
+
+  bool negative = value < 0;
+  float magnitude = negative ? -value : value;
+  uint64_t fixed = (uint64_t)(magnitude * scale + 0.5f);
+  uint32_t integer = (uint32_t)(fixed / scale);
+  uint32_t fraction = (uint32_t)(fixed % scale);
+
+  // Quitar ceros a la derecha: 24.50 -> 24.5, 30.00 -> 30
+  while (decimals > 0 && fraction % 10 == 0)
+  {
+    fraction /= 10;
+    decimals--;
+  }
+
+  separator();
+  if (negative && (integer > 0 || fraction > 0))
+    putChar('-');
+  digits(integer);
+
+  if (decimals > 0)
+  {
+    putChar('.');
+    char padded[10];
+    for (int8_t i = decimals - 1; i >= 0; i--)
+    {
+      padded[i] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    for (uint8_t i = 0; i < decimals; i++)
+      putChar(padded[i]);
+  }
+}
+
+void JsonWriter ::boolean(bool value)
+{
+  separator();
+  raw(value ? "true" : "false");
+}
+
+void JsonWriter ::string(const char *text)
+{
+  separator();
+  putChar('"');
+  for (; *text; text++)
+  {
+    if (*text == '"' || *text == '\\')
+      putChar('\\');
+    putChar(*text);
+  }
+  putChar('"');
+}
+
+bool JsonWriter ::finish(void)
+{
+  if (capacity == 0)
+    return false;
+  if (overflow)
+  {
+    buffer[0] = '\0';
+    length = 0;
+    return false;
+  }
+  buffer[length] = '\0';
+  return true;
+}
+
+/*-- TelemetryEncoder --*/
+
+CivilTime TelemetryEncoder ::civilFromUnix(uint32_t timestamp)
+{
+  // Algoritmo de días civiles de H. Hinnant, válido para cualquier fecha >= 1970
+  CivilTime t;
+  uint32_t days = timestamp / 86400UL;
+  uint32_t secs = timestamp % 86400UL;
+  t.hour = secs / 3600;
+  t.minute = (secs / 60) % 60;
+  t.second = secs % 60;
+
+  uint32_t z = days + 719468UL;
+  uint32_t era = z / 146097UL;
+  uint32_t doe = z - era * 146097UL;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  t.day = doy - (153 * mp + 2) / 5 + 1;
+  t.month = mp < 10 ? mp + 3 : mp - 9;
+  t.year = yoe + era * 400 + (t.month <= 2 ? 1 : 0);
+  return t;
+}
+
+bool TelemetryEncoder ::encode(const SensorsData &data, bool manualIrrigation, char *out, size_t size, size_t *length)
+{
+  CivilTime t = civilFromUnix(data.timestamp);
+
+  // "d/m/aaaa" y "h:m:s" sin ceros a la izquierda, como el formato original
+  char fecha[12];
+  char hora[9];
+  {
+    JsonWriter w(fecha, sizeof(fecha));
+    w.digits(t.day);
+    w.raw("/");
+    w.digits(t.month);
+    w.raw("/");
+    w.digits(t.year);
+    w.finish();
+  }
+  {
+    JsonWriter w(hora, sizeof(hora));
+    w.digits(t.hour);
+    w.raw(":");
+    w.digits(t.minute);
+    w.raw(":");
+    w.digits(t.second);
+    w.finish();
+  }
+
+  JsonWriter w(out, size);
+  w.beginObject();
+  w.key("fecha");
+  w.string(fecha);
+  w.key("hora");
+  w.string(hora);
+  w.key("temperaturaAmbiente");
+  w.number(data.temperature);
+  w.key("humedadAmbiente");
+  w.number(data.humidity);
+  w.beginObject("humedadSuelo");
+  w.key("sensor1");
+  w.number((int32_t)data.soilMoisture1);
+  w.key("sensor2");
+  w.number((int32_t)data.soilMoisture2);
+  w.endObject();
+  w.key("iluminacion");
+  w.number((int32_t)data.lightIntensity);
+  w.key("riegoManual");
+  w.boolean(manualIrrigation);
+  w.key("nivelAgua");
+  w.number(data.waterLevel);
+  w.key("porcentajeAgua");
+  w.number((int32_t)data.waterPercent);
+  w.key("timestamp");
+  w.number(data.timestamp);
+  w.endObject();
+
+  bool ok = w.finish();
+  if (length != NULL)
+    *length = w.size();
+  return ok;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef TelemetryPacket_h
+#define TelemetryPacket_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "SensorsData.h"
+#include "Datalog.h"
+
+/*
+  Telemetría binaria compacta (alternativa al JSON de TelemetryEncoder).
+
+  Este encabezado es la definición única del formato: lo usa el nodo para
+  codificar y las herramientas de ingesta (Herramientas/telemetria_binaria.cpp)
+  para decodificar. Campos en punto fijo, little endian:
+
+    0   uint8  versión       TELEMETRY_PACKET_VERSION
+    1   uint8  banderas      bit 0 riego manual, bit 1 riego activo
+    2   uint16 secuencia     Crece con cada paquete; permite detectar pérdidas
+    4   uint32 timestamp     Segundos Unix del RTC (hora local)
+    8   int16  temperatura   Centésimas de °C
+    10  int16  humedad       Centésimas de % HR
+    12  int16  suelo 1       %
+    14  int16  suelo 2       %
+    16  int16  iluminación   %
+    18  int16  nivel agua    Milímetros (distancia del ultrasónico)
+    20  int16  % agua        %
+
+  Un valor TELEMETRY_MISSING indica que el sensor no respondió (NAN).
+
+  Reglas de versión: campos nuevos se agregan al final sin cambiar la
+  versión, así que un decodificador acepta paquetes más largos e ignora lo
+  que no conoce; un cambio incompatible incrementa la versión. La versión
+  nunca puede ser '{', que es como empieza el JSON: así ambos formatos
+  comparten el respaldo de la SD.
+
+  El modo de bajo consumo (PowerManager.h) publica lotes: varios paquetes
+  seguidos en un mensaje, todos de la misma versión y de
+  TELEMETRY_PACKET_SIZE bytes.
+*/
+
+#define TELEMETRY_PACKET_VERSION 1
+#define TELEMETRY_PACKET_SIZE 22
+#define TELEMETRY_MISSING INT16_MIN
+
+#define TELEMETRY_FLAG_MANUAL 0x01
+#define TELEMETRY_FLAG_IRRIGATING 0x02
+
+enum TelemetryDecodeStatus
+{
+  TELEMETRY_OK,
+  TELEMETRY_TOO_SHORT,
+  TELEMETRY_UNKNOWN_VERSION
+};
+
+// Paquete decodificado
+struct TelemetryRecord
+{
+  uint8_t version;
+  uint16_t sequence;
+  bool manualIrrigation;
+  bool irrigating;
+  SensorsData data;
+};
+
+class TelemetryPacket
+{
+private:
+  static int16_t toFixed(float value, float scale);
+  static float fromFixed(int16_t value, float scale);
+  static int16_t clampInt(int32_t value);
+
+public:
+  // Escribe TELEMETRY_PACKET_SIZE bytes; devuelve 0 si no caben
+  static size_t encode(const SensorsData &data, uint16_t sequence, bool manualIrrigation,
+                       bool irrigating, uint8_t *out, size_t size);
+
+  static TelemetryDecodeStatus decode(const uint8_t *in, size_t length, TelemetryRecord &record);
+
+  // Paquetes de un lote (0 si el mensaje no es un lote de esta versión);
+  // un paquete suelto más largo es uno solo
+  static size_t batchCount(const uint8_t *in, size_t length)
+  {
+    if (!isPacket(in, length) || length % TELEMETRY_PACKET_SIZE != 0)
+      return 0;
+    for (size_t i = TELEMETRY_PACKET_SIZE; i < length; i += TELEMETRY_PACKET_SIZE)
+      if (in[i] != TELEMETRY_PACKET_VERSION)
+        return 0;
+    return length / TELEMETRY_PACKET_SIZE;
+  }
+
+  // Distingue un paquete binario de un mensaje JSON
+  static bool isPacket(const uint8_t *in, size_t length)
+  {
+    return length >= TELEMETRY_PACKET_SIZE && in[0] == TELEMETRY_PACKET_VERSION;
+  }
+};
+
+int16_t TelemetryPacket ::clampInt(int32_t value)
+{
+  // INT16_MIN queda reservado para TELEMETRY_MISSING
+  if (value < -INT16_MAX)
+    return -INT16_MAX;
+  if (value > INT16_MAX)
+    return INT16_MAX;
+  return (int16_t)value;
+}
+
+int16_t TelemetryPacket ::toFixed(float value, float scale)
+{
+  if (isnan(value))
+    return TELEMETRY_MISSING;
+  float scaled = roundf(value * scale);
+  if (scaled < -INT16_MAX)
+    return -INT16_MAX;
+  if (scaled > INT16_MAX)
+    return INT16_MAX;
+  return (int16_t)scaled;
+}
+
+float TelemetryPacket ::fromFixed(int16_t value, float scale)
+{
+  if (value == TELEMETRY_MISSING)
+    return NAN;
+  return value / scale;
+}
+
+size_t TelemetryPacket ::encode(const SensorsData &data, uint16_t sequence, bool manualIrrigation,
+                                bool irrigating, uint8_t *out, size_t size)
+{
+  if (size < TELEMETRY_PACKET_SIZE)
+    return 0;
+
+  out[0] = TELEMETRY_PACKET_VERSION;
+  out[1] = (manualIrrigation ? TELEMETRY_FLAG_MANUAL : 0) | (irrigating ? TELEMETRY_FLAG_IRRIGATING : 0);
+  putU16(out + 2, sequence);
+  putU32(out + 4, data.timestamp);
+  putU16(out + 8, (uint16_t)toFixed(data.temperature, 100.0f));
+  putU16(out + 10, (uint16_t)toFixed(data.humidity, 100.0f));
+  putU16(out + 12, (uint16_t)clampInt(data.soilMoisture1));
+  putU16(out + 14, (uint16_t)clampInt(data.soilMoisture2));
+  putU16(out + 16, (uint16_t)clampInt(data.lightIntensity));
+  putU16(out + 18, (uint16_t)toFixed(data.waterLevel, 10.0f));
+  putU16(out + 20, (uint16_t)clampInt(data.waterPercent));
+  return TELEMETRY_PACKET_SIZE;
+}
+
+TelemetryDecodeStatus TelemetryPacket ::decode(const uint8_t *in, size_t length, TelemetryRecord &record)
+{
+  if (length < 1)
+    return TELEMETRY_TOO_SHORT;
+  if (in[0] != TELEMETRY_PACKET_VERSION)
+    return TELEMETRY_UNKNOWN_VERSION;
+  if (length < TELEMETRY_PACKET_SIZE)
+    return TELEMETRY_TOO_SHORT;
+
+  record.version = in[0];
+  record.manualIrrigation = (in[1] & TELEMETRY_FLAG_MANUAL) != 0;
+  record.irrigating = (in[1] & TELEMETRY_FLAG_IRRIGATING) != 0;
+  record.sequence = getU16(in + 2);
+  record.data.timestamp = getU32(in + 4);
+  record.data.temperature = fromFixed((int16_t)getU16(in + 8), 100.0f);
+  record.data.humidity = fromFixed((int16_t)getU16(in + 10), 100.0f);
+  record.data.soilMoisture1 = (int16_t)getU16(in + 12);
+  record.data.soilMoisture2 = (int16_t)getU16(in + 14);
+  record.data.lightIntensity = (int16_t)getU16(in + 16);
+  record.data.waterLevel = fromFixed((int16_t)getU16(in + 18), 10.0f);
+  record.data.waterPercent = (int16_t)getU16(in + 20);
+  return TELEMETRY_OK;
+}
+
+#endif
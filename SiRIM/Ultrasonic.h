@@ -0,0 +1,188 @@
+#ifndef Ultrasonic_h
+#define Ultrasonic_h
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+  Medición del HC-SR04 sin pulseIn.
+
+  EchoCapture convierte los flancos del pin ECHO (registrados por una
+  interrupción) en el ancho del pulso; UltrasonicFilter pasa los anchos a
+  centímetros, guarda las últimas muestras y entrega su mediana. Si el
+  sensor deja de contestar (o sólo entrega ecos fuera de rango) durante
+  ULTRASONIC_MAX_MISSES disparos seguidos, el filtro olvida sus muestras y la
+  mediana vuelve a NAN en lugar de congelar el último nivel. Ninguna de
+  las dos depende de Arduino, así que se pueden alimentar con tiempos de
+  flancos grabados en el escritorio.
+*/
+
+#define ULTRASONIC_SAMPLES 5        // Muestras para la mediana
+#define ULTRASONIC_TIMEOUT_US 30000 // Sin eco después de esto se descarta (~5 m)
+#define ULTRASONIC_MAX_MISSES 10    // Disparos seguidos sin eco válido antes de olvidar la mediana
+#define ULTRASONIC_MIN_CM 2.0f      // Rango útil del sensor
+#define ULTRASONIC_MAX_CM 400.0f
+#define SOUND_SPEED_CM_PER_US 0.034f
+
+// Calibración del tanque (CodigoIoTV1.0BETA): 17 cm = vacío, 6 cm = lleno
+#define TANK_EMPTY_CM 17.0f
+#define TANK_FULL_CM 6.0f
+
+class EchoCapture
+{
+private:
+  volatile uint32_t triggeredAt = 0;
+  volatile uint32_t risingAt = 0;
+  volatile uint32_t pulseWidth = 0;
+  volatile bool armed = false;
+  volatile bool inPulse = false;
+  volatile bool complete = false;
+
+public:
+  // Se llama justo después de enviar el disparo
+  void arm(uint32_t nowUs)
+  {
+    triggeredAt = nowUs;
+    inPulse = false;
+    complete = false;
+    armed = true;
+  }
+
+  // Llamado desde la interrupción en cada cambio del pin ECHO
+  void onEdge(bool level, uint32_t nowUs)
+  {
+    if (!armed)
+      return;
+    if (level)
+    {
+      risingAt = nowUs;
+      inPulse = true;
+    }
+    else if (inPulse)
+    {
+      pulseWidth = nowUs - risingAt;
+      inPulse = false;
+      complete = true;
+      armed = false;
+    }
+  }
+
+  // Entrega el ancho del pulso una vez terminado
+  bool takePulse(uint32_t &widthUs)
+  {
+    if (!complete)
+      return false;
+    widthUs = pulseWidth;
+    complete = false;
+    return true;
+  }
+
+  bool isBusy(void) { return armed; }
+
+  // Venció la espera sin eco; la medición se abandona
+  bool expire(uint32_t nowUs)
+  {
+    if (!armed || nowUs - triggeredAt < ULTRASONIC_TIMEOUT_US)
+      return false;
+    armed = false;
+    inPulse = false;
+    return true;
+  }
+};
+
+class UltrasonicFilter
+{
+private:
+  float samples[ULTRASONIC_SAMPLES];
+  uint8_t count = 0;
+  uint8_t next = 0;
+  uint8_t misses = 0;
+
+public:
+  // Mediciones descartadas por estar fuera de rango
+  uint32_t rejected = 0;
+  // Veces que se olvidaron las muestras por falta de ecos válidos
+  uint32_t expired = 0;
+
+  static float distanceFromEcho(uint32_t widthUs)
+  {
+    // Ida y vuelta: se divide entre 2
+    return widthUs * SOUND_SPEED_CM_PER_US / 2;
+  }
+
+  static float tankPercent(float distanceCm)
+  {
+    if (isnan(distanceCm))
+      return NAN;
+    float percent = (TANK_EMPTY_CM - distanceCm) * 100.0f / (TANK_EMPTY_CM - TANK_FULL_CM);
+    if (percent < 0)
+      return 0;
+    if (percent > 100)
+      return 100;
+    return percent;
+  }
+
+  bool addEcho(uint32_t widthUs) { return addDistance(distanceFromEcho(widthUs)); }
+
+  bool addDistance(float distanceCm)
+  {
+    if (distanceCm < ULTRASONIC_MIN_CM || distanceCm > ULTRASONIC_MAX_CM)
+    {
+      rejected++;
+      addMiss();
+      return false;
+    }
+    misses = 0;
+    samples[next] = distanceCm;
+    next = (next + 1) % ULTRASONIC_SAMPLES;
+    if (count < ULTRASONIC_SAMPLES)
+      count++;
+    return true;
+  }
+
+  // Disparo sin eco; tras ULTRASONIC_MAX_MISSES seguidos la mediana vuelve a NAN
+  void addMiss(void)
+  {
+    if (++misses < ULTRASONIC_MAX_MISSES)
+      return;
+    misses = 0;
+    if (count > 0)
+    {
+      expired++;
+      count = 0;
+      next = 0;
+    }
+  }
+
+  // Mediana de las últimas muestras válidas; NAN si no hay ninguna vigente
+  float median(void)
+  {
+    if (count == 0)
+      return NAN;
+    float sorted[ULTRASONIC_SAMPLES];
+    for (uint8_t i = 0; i < count; i++)
+    {
+      // Inserción: a lo sumo ULTRASONIC_SAMPLES elementos
+      float v = samples[i];
+      int8_t j = i - 1;
+      while (j >= 0 && sorted[j] > v)
+      {
+        sorted[j + 1] = sorted[j];
+        j--;
+      }
+      sorted[j + 1] = v;
+    }
+    if (count % 2 == 1)
+      return sorted[count / 2];
+    return (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+  }
+
+  void clear(void)
+  {
+    count = 0;
+    next = 0;
+    misses = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef WaterLevelSensor_h
+#define WaterLevelSensor_h
+
+#include <Arduino.h>
+#include "Ultrasonic.h"
+
+// Tiempo mínimo entre disparos recomendado para el HC-SR04
+#define ULTRASONIC_INTERVAL_US 60000
+
+// HC-SR04 medido por interrupciones: service() dispara el sensor y recoge el
+// eco anterior, sin esperar nunca al pin ECHO. Un disparo sin eco cuenta en
+// timeouts y para el filtro (ver ULTRASONIC_MAX_MISSES en Ultrasonic.h).
+class WaterLevelSensor
+{
+private:
+  static uint8_t trigPin;
+  static uint8_t echoPin;
+  static EchoCapture capture;
+  static UltrasonicFilter filter;
+  static uint32_t lastTrigger;
+
+  static void IRAM_ATTR echoISR(void);
+
+public:
+  // Disparos sin respuesta
+  static uint32_t timeouts;
+
+  static void begin(uint8_t trigger, uint8_t echo);
+  static void service(void);
+  static float distance(void) { return filter.median(); }
+  static float percent(void) { return UltrasonicFilter::tankPercent(filter.median()); }
+  // Ecos fuera de rango y veces que la mediana se olvidó por falta de ecos
+  static uint32_t rejected(void) { return filter.rejected; }
+  static uint32_t expired(void) { return filter.expired; }
+};
+
+uint8_t WaterLevelSensor::trigPin = 0;
+uint8_t WaterLevelSensor::echoPin = 0;
+EchoCapture WaterLevelSensor::capture;
+UltrasonicFilter WaterLevelSensor::filter;
+uint32_t WaterLevelSensor::lastTrigger = 0;
+uint32_t WaterLevelSensor::timeouts = 0;
+
+void IRAM_ATTR WaterLevelSensor ::echoISR(void)
+{
+  capture.onEdge(digitalRead(echoPin) == HIGH, micros());
+}
+
+void WaterLevelSensor ::begin(uint8_t trigger, uint8_t echo)
+{
+  trigPin = trigger;
+  echoPin = echo;
+  pinMode(trigPin, OUTPUT);
+  pinMode(echoPin, INPUT);
+  digitalWrite(trigPin, LOW);
+  attachInterrupt(digitalPinToInterrupt(echoPin), echoISR, CHANGE);
+}
+
+void WaterLevelSensor ::service(void)
+{
+  uint32_t now = micros();
+  uint32_t width;
+
+  if (capture.takePulse(width))
+    filter.addEcho(width);
+  else if (capture.expire(now))
+  {
+    timeouts++;
+    filter.addMiss();
+  }
+
+  if (capture.isBusy() || now - lastTrigger < ULTRASONIC_INTERVAL_US)
+    return;
+
+  // Pulso de disparo de 10 us; el eco se registra en echoISR
+  digitalWrite(trigPin, LOW);
+  delayMicroseconds(2);
+  digitalWrite(trigPin, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(trigPin, LOW);
+  lastTrigger = micros();
+  capture.arm(lastTrigger);
+}
+
+#endif
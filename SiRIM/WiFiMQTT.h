@@ -3,13 +3,17 @@
 
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <Preferences.h>
 #include "env.h"
+#include "Connectivity.h"
 
 // Crear un archivo llamado env.h con los valores y agregarlo:
 // struct KeysEnv {
 // 	char* ssid = "[ssid]";
 //   char* password =  "[pswd]";
 // 	char* mqtt_server = "[server]";
+// 	char* firebase_host = "[proyecto].firebaseio.com";  // Con FIREBASE_SINK
+// 	char* firebase_auth = "[secreto]";
 // } KeysEnv;
 struct KeysEnv env;
 
@@ -18,68 +22,275 @@ const char *password = env.password;
 const char *mqtt_server = env.mqtt_server;
 const uint16_t mqtt_port = env.MQTT_PORT;
 
+// Tópico para métricas del nodo. Éste y los de diagnóstico llevan el client ID
+// al final (ver makeNodeTopic), como la telemetría
+#define MQTT_METRICS_TOPIC "ucol/iot/metricas"
+
+// Lotes a Firebase, con cada ronda de métricas (sólo con FIREBASE_SINK), en
+// un subtópico con el client ID
+#define MQTT_FIREBASE_TOPIC "ucol/iot/firebase"
+
+// Estado de los relevadores: al cambiar y cada 15 minutos, en un subtópico con el client ID
+#define MQTT_IRRIGATION_TOPIC "ucol/iot/riego"
+
+// Diagnóstico: pilas, CPU por tarea y núcleo, heap, colas e histogramas de latencia
+#define MQTT_DIAGNOSTICS_TOPIC "ucol/iot/diagnostico"
+
+// Duración de cada lectura (SensorScheduler.h) y fallas del ultrasónico, cada hora
+#define MQTT_SENSOR_TIMES_TOPIC "ucol/iot/diagnostico/sensores"
+
+// Hitos del arranque (ver BootTimeline.h): al terminar las etapas locales y
+// otra vez si una etapa degradada se recupera, en un subtópico con el client ID
+#define MQTT_BOOT_TOPIC "ucol/iot/arranque"
+
+// Tópico paralelo para la telemetría binaria (ver TelemetryPacket.h); como
+// env.topicTX, cada nodo publica en un subtópico con su client ID
+#define MQTT_BINARY_TOPIC "ucol/iot/sensores/bin"
+
+// Resúmenes por ventana (ver Rollup.h), en un subtópico con el client ID
+#define MQTT_ROLLUP_MINUTE_TOPIC "ucol/iot/resumen/minuto"
+#define MQTT_ROLLUP_HOUR_TOPIC "ucol/iot/resumen/hora"
+#define MQTT_ROLLUP_DAY_TOPIC "ucol/iot/resumen/dia"
+
+// Consultas por rango sobre la serie de la SD (ver RangeQuery.h); cada nodo
+// escucha y contesta en un subtópico con su client ID
+#define MQTT_QUERY_TOPIC "ucol/iot/consulta"
+#define MQTT_QUERY_REPLY_TOPIC "ucol/iot/consulta/respuesta"
+
+// Telemetría por lotes a Firebase (ver FirebaseSink.h). Apagada por omisión:
+// el saludo TLS detiene la tarea de red unos segundos y env.h necesita
+// firebase_host y firebase_auth.
+#ifndef FIREBASE_SINK
+#define FIREBASE_SINK 0
+#endif
+
+// Imprimir cada mensaje publicado. A 115200 baudios imprimir el JSON tarda más
+// que publicarlo, así que sólo se activa para depurar.
+#define MQTT_VERBOSE 0
+
 // Conexiones
 WiFiClient espClient;
 PubSubClient mqttClient(espClient);
 
+// Tiempo máximo de un intento de conexión al broker (s)
+#define MQTT_SOCKET_TIMEOUT 2
+
+// Paquete MQTT más grande (tópico + mensaje); el documento de métricas no cabe en los 256 por defecto
+#define MQTT_BUFFER_SIZE 1024
+
+// Receptor de los mensajes del tópico de configuración o de consultas
+typedef void (*ConfigHandler)(const uint8_t *payload, unsigned int length);
+
+// Enlace real del ESP32 para el administrador de conectividad
+class EspLinkLayer : public LinkLayer
+{
+public:
+  void wifiBegin(int32_t channel, const uint8_t *bssid);
+  bool wifiConnected(void);
+  void wifiDisconnect(void);
+  bool wifiApInfo(ApCache &ap);
+  bool mqttConnect(void);
+  bool mqttConnected(void);
+  uint32_t random32(void) { return esp_random(); }
+};
+
+#if FIREBASE_SINK
+#include <WiFiClientSecure.h>
+#include "FirebaseSink.h"
+
+#define FIREBASE_PORT 443
+#define FIREBASE_PATH "sirim/telemetria"
+#define FIREBASE_READ_TIMEOUT_MS 5000
+
+// Conexión HTTPS real para FirebaseClient
+class TlsHttpStream : public HttpStream
+{
+private:
+  WiFiClientSecure client;
+
+public:
+  TlsHttpStream(void)
+  {
+#ifdef FIREBASE_ROOT_CA
+    client.setCACert(FIREBASE_ROOT_CA);
+#else
+    client.setInsecure(); // Sin el certificado raíz no se verifica el servidor
+#endif
+  }
+  bool connect(const char *host, uint16_t port) { return client.connect(host, port); }
+  bool connected(void) { return client.connected(); }
+  void stop(void) { client.stop(); }
+  size_t write(const uint8_t *buffer, size_t size) { return client.write(buffer, size); }
+  size_t read(uint8_t *buffer, size_t size);
+};
+
+size_t TlsHttpStream ::read(uint8_t *buffer, size_t size)
+{
+  uint32_t start = millis();
+  while (client.available() == 0)
+  {
+    if (!client.connected() || millis() - start >= FIREBASE_READ_TIMEOUT_MS)
+      return 0;
+    delay(1);
+  }
+  int n = client.read(buffer, size);
+  return n > 0 ? (size_t)n : 0;
+}
+#endif
+
+EspLinkLayer espLink;
+ConnectivityManager connectivity(espLink);
+Preferences connPrefs;
+
+// Client ID único del nodo (ver makeClientId en Connectivity.h)
+char mqttClientId[MQTT_CLIENT_ID_SIZE];
+
+// Telemetría del nodo: env.topicTX/<client ID> y MQTT_BINARY_TOPIC/<client ID>
+char telemetryTopic[MQTT_NODE_TOPIC_SIZE];
+char binaryTopic[MQTT_NODE_TOPIC_SIZE];
+
+// Métricas, diagnóstico, Firebase, arranque y riego: MQTT_METRICS_TOPIC/<client ID>, etc.
+char metricsTopic[MQTT_NODE_TOPIC_SIZE];
+char diagnosticsTopic[MQTT_NODE_TOPIC_SIZE];
+char sensorTimesTopic[MQTT_NODE_TOPIC_SIZE];
+char firebaseTopic[MQTT_NODE_TOPIC_SIZE];
+char bootTopic[MQTT_NODE_TOPIC_SIZE];
+char irrigationTopic[MQTT_NODE_TOPIC_SIZE];
+
+// Resúmenes: MQTT_ROLLUP_MINUTE_TOPIC/<client ID>, etc.
+char rollupMinuteTopic[MQTT_NODE_TOPIC_SIZE];
+char rollupHourTopic[MQTT_NODE_TOPIC_SIZE];
+char rollupDayTopic[MQTT_NODE_TOPIC_SIZE];
+
+inline const char *rollupTopic(uint32_t period)
+{
+  if (period >= 86400)
+    return rollupDayTopic;
+  return period >= 3600 ? rollupHourTopic : rollupMinuteTopic;
+}
+
+// Consultas al nodo: MQTT_QUERY_TOPIC/<client ID> y MQTT_QUERY_REPLY_TOPIC/<client ID>
+char queryTopic[MQTT_NODE_TOPIC_SIZE];
+char queryReplyTopic[MQTT_NODE_TOPIC_SIZE];
+
 class WifiMqtt
 {
+private:
+  static ConfigHandler configHandler;
+  static ConfigHandler queryHandler;
+
 public:
   static void startConnections(void);
-  static void connectWiFi(void);
-  static void reconnectWiFi(void);
+  static bool serviceConnections(void);
+  static void stopConnections(void);
+  static void resumeConnections(void);
+  static void connectWiFi(int32_t channel, const uint8_t *bssid);
   static bool isWiFiConnected(void);
   static void connectMQTT(void);
-  static void reconnectMQTT(void);
+  static bool reconnectMQTT(void);
   static bool isMQTTConnected(void);
-  static void publishMessage(const char *payload);
-  static void mqttCallback(byte *payload, unsigned int length);
+  static bool publishMessage(const char *payload);
+  static bool publishMessage(const char *topic, const char *payload);
+  static bool publishMessage(const char *topic, const uint8_t *payload, unsigned int length);
+  static void mqttCallback(char *topic, byte *payload, unsigned int length);
+  static void setConfigHandler(ConfigHandler handler) { configHandler = handler; }
+  static void setQueryHandler(ConfigHandler handler) { queryHandler = handler; }
   static void subscribeTopic(char *topic);
 };
 
+ConfigHandler WifiMqtt::configHandler = NULL;
+ConfigHandler WifiMqtt::queryHandler = NULL;
+
 void WifiMqtt ::startConnections(void)
 {
-  connectWiFi();
+  WiFi.mode(WIFI_STA);
+
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  makeClientId(mqttClientId, sizeof(mqttClientId), mac);
+  makeNodeTopic(telemetryTopic, sizeof(telemetryTopic), env.topicTX, mqttClientId);
+  makeNodeTopic(binaryTopic, sizeof(binaryTopic), MQTT_BINARY_TOPIC, mqttClientId);
+  makeNodeTopic(metricsTopic, sizeof(metricsTopic), MQTT_METRICS_TOPIC, mqttClientId);
+  makeNodeTopic(diagnosticsTopic, sizeof(diagnosticsTopic), MQTT_DIAGNOSTICS_TOPIC, mqttClientId);
+  makeNodeTopic(sensorTimesTopic, sizeof(sensorTimesTopic), MQTT_SENSOR_TIMES_TOPIC, mqttClientId);
+  makeNodeTopic(firebaseTopic, sizeof(firebaseTopic), MQTT_FIREBASE_TOPIC, mqttClientId);
+  makeNodeTopic(bootTopic, sizeof(bootTopic), MQTT_BOOT_TOPIC, mqttClientId);
+  makeNodeTopic(irrigationTopic, sizeof(irrigationTopic), MQTT_IRRIGATION_TOPIC, mqttClientId);
+  makeNodeTopic(rollupMinuteTopic, sizeof(rollupMinuteTopic), MQTT_ROLLUP_MINUTE_TOPIC, mqttClientId);
+  makeNodeTopic(rollupHourTopic, sizeof(rollupHourTopic), MQTT_ROLLUP_HOUR_TOPIC, mqttClientId);
+  makeNodeTopic(rollupDayTopic, sizeof(rollupDayTopic), MQTT_ROLLUP_DAY_TOPIC, mqttClientId);
+  makeNodeTopic(queryTopic, sizeof(queryTopic), MQTT_QUERY_TOPIC, mqttClientId);
+  makeNodeTopic(queryReplyTopic, sizeof(queryReplyTopic), MQTT_QUERY_REPLY_TOPIC, mqttClientId);
   connectMQTT();
+
+  // Canal y BSSID del último AP para reconectar sin escanear
+  ApCache saved;
+  connPrefs.begin("conexion", false);
+  bool hasSaved = connPrefs.getBytes("ap", &saved, sizeof(saved)) == sizeof(saved);
+  connectivity.begin(hasSaved ? &saved : NULL);
+
   Serial.println("Iniciando conexiones MQTT y WiFI");
 }
 
-void WifiMqtt ::connectWiFi(void)
+// Avanza la máquina de estados de conexión sin bloquear; true si hay MQTT
+bool WifiMqtt ::serviceConnections(void)
 {
-  Serial.println();
-  Serial.print("Connecting to ");
-  Serial.println(ssid);
-  WiFi.begin(ssid, password);
-  while (!isWiFiConnected())
+  ConnState before = connectivity.state();
+  ConnState now = connectivity.update(millis());
+
+  if (now != before)
   {
-    // Serial.print(".");
-    delay(1);
+    if (now == CONN_ONLINE)
+    {
+      Serial.print("Conectado, IP: ");
+      Serial.println(WiFi.localIP());
+    }
+    else if (before == CONN_ONLINE)
+    {
+      Serial.println("Conexión perdida");
+    }
   }
-  Serial.println("");
-  Serial.println("WiFi connected");
-  Serial.println("IP address: ");
-  Serial.println(WiFi.localIP());
+
+  ApCache ap;
+  if (connectivity.takeCacheUpdate(ap))
+    connPrefs.putBytes("ap", &ap, sizeof(ap));
+
+  return now == CONN_ONLINE;
 }
 
-bool WifiMqtt ::isWiFiConnected(void)
+// Apaga el radio (modo de bajo consumo); el AP guardado se conserva
+void WifiMqtt ::stopConnections(void)
 {
-  return WiFi.status() == WL_CONNECTED;
+  mqttClient.disconnect();
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  connectivity.begin(NULL);
 }
 
-void WifiMqtt ::reconnectWiFi(void)
+// Enciende el radio; serviceConnections() reconecta con el canal y BSSID guardados
+void WifiMqtt ::resumeConnections(void)
 {
-  WiFi.disconnect();
-  if (!isWiFiConnected())
-  {
-    Serial.print("Reconectando a WiFi...");
-    connectWiFi();
-    delay(1);
-  }
+  WiFi.mode(WIFI_STA);
+}
+
+void WifiMqtt ::connectWiFi(int32_t channel, const uint8_t *bssid)
+{
+  Serial.print("Connecting to ");
+  Serial.println(ssid);
+  WiFi.begin(ssid, password, channel, bssid);
+}
+
+bool WifiMqtt ::isWiFiConnected(void)
+{
+  return WiFi.status() == WL_CONNECTED;
 }
 
 void WifiMqtt ::connectMQTT(void)
 {
   mqttClient.setServer(mqtt_server, mqtt_port);
+  mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+  mqttClient.setCallback(mqttCallback);
 }
 
 bool WifiMqtt ::isMQTTConnected(void)
@@ -87,58 +298,122 @@ bool WifiMqtt ::isMQTTConnected(void)
   return mqttClient.connected();
 }
 
-void WifiMqtt ::reconnectMQTT(void)
+// Un solo intento de conexión al broker
+bool WifiMqtt ::reconnectMQTT(void)
 {
-  Serial.print("Intentando conectar a MQTT...");
-  if (mqttClient.connect("ucol/iot"))
+  Serial.print("Intentando conectar a MQTT como ");
+  Serial.print(mqttClientId);
+  Serial.print("...");
+  if (mqttClient.connect(mqttClientId))
   {
     Serial.println("connected");
+    // Sin Nagle: cada publicación sale de inmediato en lugar de esperar al ACK.
+    // Va aquí porque el socket se crea en cada connect()
+    espClient.setNoDelay(true);
     mqttClient.subscribe(env.topicRX);
     Serial.println("Suscrito al topic ucol/iot/config");
+    mqttClient.subscribe(queryTopic);
+    return true;
   }
-  else
-  {
-    Serial.print("Error de conexión MQTT: , rc=");
-    Serial.print(mqttClient.state());
-    connectMQTT();
-  }
+
+  Serial.print("Error de conexión MQTT: , rc=");
+  Serial.println(mqttClient.state());
+  return false;
+}
+
+/*-- EspLinkLayer --*/
+
+void EspLinkLayer ::wifiBegin(int32_t channel, const uint8_t *bssid)
+{
+  WifiMqtt::connectWiFi(channel, bssid);
+}
+
+bool EspLinkLayer ::wifiConnected(void)
+{
+  return WifiMqtt::isWiFiConnected();
+}
+
+void EspLinkLayer ::wifiDisconnect(void)
+{
+  WiFi.disconnect();
+}
+
+bool EspLinkLayer ::wifiApInfo(ApCache &ap)
+{
+  uint8_t *bssid = WiFi.BSSID();
+  if (bssid == NULL)
+    return false;
+  memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+  ap.channel = WiFi.channel();
+  ap.valid = true;
+  return true;
+}
+
+bool EspLinkLayer ::mqttConnect(void)
+{
+  return WifiMqtt::reconnectMQTT();
+}
+
+bool EspLinkLayer ::mqttConnected(void)
+{
+  return WifiMqtt::isMQTTConnected();
 }
 
 // MODIFICAR FUNCION PARA QUE SEA CON ENV O MARCAR UN DEFAULT DEL TOPICO DE ENVÍO DE DATOS
-void WifiMqtt ::publishMessage(const char *payload)
+bool WifiMqtt ::publishMessage(const char *payload)
 {
-  if (isMQTTConnected())
+  return publishMessage(telemetryTopic, payload);
+}
+
+bool WifiMqtt ::publishMessage(const char *topic, const char *payload)
+{
+  if (isMQTTConnected() && mqttClient.publish(topic, payload))
   {
-    mqttClient.publish(env.topicTX, payload);
+#if MQTT_VERBOSE
     Serial.print("Mensaje publicado en el topic ");
-    Serial.print(env.topicTX);
+    Serial.print(topic);
     Serial.print(": ");
     Serial.println(payload);
+#endif
+    return true;
   }
-  else
+
+  Serial.println("No se puede publicar. MQTT no está conectado.");
+  return false;
+}
+
+bool WifiMqtt ::publishMessage(const char *topic, const uint8_t *payload, unsigned int length)
+{
+  if (isMQTTConnected() && mqttClient.publish(topic, payload, length))
   {
-    Serial.println("No se puede publicar. MQTT no está conectado.");
+#if MQTT_VERBOSE
+    Serial.print("Mensaje binario publicado en el topic ");
+    Serial.print(topic);
+    Serial.print(": ");
+    Serial.print(length);
+    Serial.println(" bytes");
+#endif
+    return true;
   }
+
+  Serial.println("No se puede publicar. MQTT no está conectado.");
+  return false;
 }
 
 // Función de callback para manejar mensajes entrantes
-void WifiMqtt ::mqttCallback(byte *payload, unsigned int length)
+void WifiMqtt ::mqttCallback(char *topic, byte *payload, unsigned int length)
 {
   Serial.print("Mensaje recibido en el topic: ");
-  Serial.println(env.topicRX);
+  Serial.println(topic);
 
-  String message;
-  for (unsigned int i = 0; i < length; i++)
+  if (strcmp(topic, env.topicRX) == 0 && configHandler != NULL)
   {
-    message += (char)payload[i];
+    configHandler(payload, length);
+  }
+  else if (strcmp(topic, queryTopic) == 0 && queryHandler != NULL)
+  {
+    queryHandler(payload, length);
   }
-
-  Serial.print("Contenido del mensaje: ");
-  Serial.println(message);
-
-  // if (String(topic) == topicWorked) {
-  //     Serial.println("Procesando mensaje del topic ucol/iot...");
-  // }
 }
 
 void WifiMqtt ::subscribeTopic(char *topic)
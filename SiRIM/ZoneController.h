@@ -0,0 +1,301 @@
+#ifndef ZoneController_h
+#define ZoneController_h
+
+#include <stdint.h>
+#include <string.h>
+#include "IrrigationSchedule.h"
+
+/*
+  Control de los relevadores de riego, una zona por relevador.
+
+  La tarea de actuación recibe instantáneas de los sensores (ActuationSnapshot)
+  y decide cada zona por separado: el sensor de suelo 1 gobierna el
+  relevador 1 y el 2 al 2, en lugar del promedio de ambos. Según el modo:
+    - Automático: histéresis sobre el umbral de humedad; enciende si el
+      suelo está bajo el umbral y la luz bajo la suya, y apaga hasta que el
+      suelo supera el umbral más ZONE_HYSTERESIS.
+    - Temporizador: cada turno del horario mantiene la zona encendida los
+      segundos del turno.
+    - Manual: ambas zonas siguen la orden "regar".
+
+  Sobre cualquier modo se aplican los límites de seguridad:
+    - Tanque bajo (nivelAgua < 20 %, como CodigoIoTV1.0BETA): todo apagado
+      hasta que el tanque se mantiene en TANK_INTERLOCK_RELEASE o más
+      durante TANK_RELEASE_HOLD_MS (un eco ruidoso no basta para soltarlo).
+    - Sin lectura del tanque (READING_INVALID: el ultrasónico dejó de
+      contestar y su filtro se venció), todo apagado en cualquier modo igual
+      que sin lecturas; si el interbloqueo estaba puesto, vuelve a esperar
+      TANK_RELEASE_HOLD_MS de lecturas válidas.
+    - Ninguna zona pasa más de ZONE_MAX_RUN_MS encendida seguida; después
+      descansa ZONE_REST_MS.
+    - Si no llegan lecturas en ACTUATION_STALE_MS (la tarea de sensores se
+      colgó), todo apagado.
+    - En automático, una zona cuyo sensor de suelo, o el de luz, no tiene
+      lectura (READING_INVALID, p. ej. el ADC todavía sin datos) se apaga
+      igual que sin lecturas: un 0 falso la haría regar.
+
+  Sin dependencias del ESP32: el tiempo se pasa en milisegundos.
+*/
+
+#define ZONE_HYSTERESIS 5              // % de humedad sobre el umbral para apagar
+#define READING_INVALID -1             // Suelo, luz o tanque sin lectura
+#define ZONE_MAX_RUN_MS 3600000UL      // IRRIGATION_MAX_SECONDS: ningún turno lo rebasa
+#define ZONE_REST_MS 600000UL          // Descanso tras el máximo
+#define TANK_INTERLOCK_PERCENT 20
+#define TANK_INTERLOCK_RELEASE 25
+#define TANK_RELEASE_HOLD_MS 60000
+#define ACTUATION_STALE_MS 10000
+
+enum ActuationMode : uint8_t
+{
+  ACTUATION_AUTO,
+  ACTUATION_TIMER,
+  ACTUATION_MANUAL
+};
+
+// Lo que la tarea de sensores manda a la de actuación; se copia por la cola
+struct ActuationSnapshot
+{
+  int16_t soil[SCHEDULE_ZONES]; // % (READING_INVALID sin lectura)
+  int16_t light;                // % (READING_INVALID sin lectura)
+  int16_t waterPercent;         // % del tanque (READING_INVALID si el ultrasónico no responde)
+  int16_t soilThreshold;
+  int16_t lightThreshold;
+  ActuationMode mode;
+  bool manualOn;
+  uint16_t turnSeconds[SCHEDULE_ZONES]; // Turnos que empiezan (0 = ninguno)
+  uint32_t sampledAt;                   // micros() de la lectura más reciente
+};
+
+enum ZoneCause : uint8_t
+{
+  CAUSE_NONE,
+  CAUSE_DRY,       // Encendida: suelo bajo el umbral
+  CAUSE_TURN,      // Encendida: turno del horario
+  CAUSE_MANUAL,    // Encendida: orden manual
+  CAUSE_SATISFIED, // Apagada: se cumplió la condición
+  CAUSE_INTERLOCK, // Apagada: tanque bajo
+  CAUSE_MAX_RUN,   // Apagada: tiempo máximo
+  CAUSE_STALE      // Apagada: sin lecturas
+};
+
+struct ZoneState
+{
+  bool on;
+  ZoneCause cause;
+  uint32_t onSince;
+  uint32_t turnUntil;
+  bool turnActive;
+  uint32_t restSince;
+  bool resting;
+
+  // Estadísticas
+  uint32_t starts;
+  uint32_t onMs; // Tiempo encendida acumulado (sin la vuelta en curso)
+};
+
+class ZoneController
+{
+private:
+  ZoneState zones[SCHEDULE_ZONES];
+  ActuationSnapshot last;
+  uint32_t lastSnapshotMs = 0;
+  bool hasSnapshot = false;
+  bool tankLow = false;
+  bool tankRecovering = false;
+  uint32_t tankOkSince = 0;
+
+  bool wants(uint8_t zone, uint32_t nowMs, ZoneCause &cause);
+  bool isBlind(uint8_t zone);
+
+public:
+  // Estadísticas
+  uint32_t interlockTrips = 0;
+  uint32_t maxRunCutoffs = 0;
+  uint32_t staleCutoffs = 0;
+
+  ZoneController(void)
+  {
+    memset(zones, 0, sizeof(zones));
+    memset(&last, 0, sizeof(last));
+  }
+
+  // Nueva instantánea de los sensores
+  void update(const ActuationSnapshot &snapshot, uint32_t nowMs);
+
+  // Decide todas las zonas; devuelve los relevadores encendidos (bit = zona)
+  uint8_t evaluate(uint32_t nowMs);
+
+  static const char *describe(ZoneCause cause);
+
+  const ZoneState &zone(uint8_t index) { return zones[index]; }
+  bool isTankLow(void) { return tankLow; }
+  uint8_t relays(void)
+  {
+    uint8_t mask = 0;
+    for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+      mask |= zones[z].on << z;
+    return mask;
+  }
+};
+
+void ZoneController ::update(const ActuationSnapshot &snapshot, uint32_t nowMs)
+{
+  last = snapshot;
+  lastSnapshotMs = nowMs;
+  hasSnapshot = true;
+
+  // Interbloqueo del tanque con histéresis para que no rebote cerca del 20 %.
+  // Sin lectura las zonas se apagan en isBlind y la espera para soltarlo se reinicia
+  if (snapshot.waterPercent < 0)
+  {
+    tankRecovering = false;
+  }
+  else if (snapshot.waterPercent < TANK_INTERLOCK_PERCENT)
+  {
+    if (!tankLow)
+      interlockTrips++;
+    tankLow = true;
+    tankRecovering = false;
+  }
+  else if (tankLow && snapshot.waterPercent < TANK_INTERLOCK_RELEASE)
+  {
+    tankRecovering = false;
+  }
+  else if (tankLow && !tankRecovering)
+  {
+    tankRecovering = true;
+    tankOkSince = nowMs;
+  }
+  else if (tankLow && nowMs - tankOkSince >= TANK_RELEASE_HOLD_MS)
+  {
+    tankLow = false;
+    tankRecovering = false;
+  }
+
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    if (snapshot.turnSeconds[z] > 0)
+    {
+      zones[z].turnActive = true;
+      zones[z].turnUntil = nowMs + snapshot.turnSeconds[z] * 1000UL;
+    }
+  }
+}
+
+bool ZoneController ::wants(uint8_t z, uint32_t nowMs, ZoneCause &cause)
+{
+  ZoneState &s = zones[z];
+
+  if (s.turnActive && (int32_t)(nowMs - s.turnUntil) >= 0)
+    s.turnActive = false;
+
+  switch (last.mode)
+  {
+  case ACTUATION_MANUAL:
+    cause = CAUSE_MANUAL;
+    return last.manualOn;
+  case ACTUATION_TIMER:
+    cause = CAUSE_TURN;
+    return s.turnActive;
+  default:
+    cause = CAUSE_DRY;
+    if (s.on && s.cause == CAUSE_DRY)
+      return last.soil[z] < last.soilThreshold + ZONE_HYSTERESIS;
+    return last.soil[z] < last.soilThreshold && last.light < last.lightThreshold;
+  }
+}
+
+// Sin tanque no riega ninguna zona; en automático la zona además decide con su
+// sensor de suelo y con el de luz
+bool ZoneController ::isBlind(uint8_t z)
+{
+  if (last.waterPercent < 0)
+    return true;
+  if (last.mode != ACTUATION_AUTO)
+    return false;
+  return last.soil[z] < 0 || last.light < 0;
+}
+
+uint8_t ZoneController ::evaluate(uint32_t nowMs)
+{
+  bool stale = !hasSnapshot || nowMs - lastSnapshotMs > ACTUATION_STALE_MS;
+
+  for (uint8_t z = 0; z < SCHEDULE_ZONES; z++)
+  {
+    ZoneState &s = zones[z];
+    ZoneCause onCause;
+    bool want = wants(z, nowMs, onCause);
+    ZoneCause offCause = CAUSE_SATISFIED;
+
+    if (s.resting && nowMs - s.restSince >= ZONE_REST_MS)
+      s.resting = false;
+
+    if (stale || isBlind(z))
+    {
+      want = false;
+      offCause = CAUSE_STALE;
+    }
+    else if (tankLow)
+    {
+      want = false;
+      offCause = CAUSE_INTERLOCK;
+    }
+    else if (s.resting)
+    {
+      want = false;
+      offCause = CAUSE_MAX_RUN;
+    }
+    else if (want && s.on && nowMs - s.onSince >= ZONE_MAX_RUN_MS)
+    {
+      want = false;
+      offCause = CAUSE_MAX_RUN;
+      s.resting = true;
+      s.restSince = nowMs;
+      s.turnActive = false;
+      maxRunCutoffs++;
+    }
+
+    if (want && !s.on)
+    {
+      s.on = true;
+      s.cause = onCause;
+      s.onSince = nowMs;
+      s.starts++;
+    }
+    else if (!want && s.on)
+    {
+      s.on = false;
+      s.cause = offCause;
+      s.onMs += nowMs - s.onSince;
+      if (offCause == CAUSE_STALE)
+        staleCutoffs++;
+    }
+  }
+  return relays();
+}
+
+const char *ZoneController ::describe(ZoneCause cause)
+{
+  switch (cause)
+  {
+  case CAUSE_DRY:
+    return "suelo seco";
+  case CAUSE_TURN:
+    return "turno";
+  case CAUSE_MANUAL:
+    return "manual";
+  case CAUSE_SATISFIED:
+    return "condición cumplida";
+  case CAUSE_INTERLOCK:
+    return "tanque bajo";
+  case CAUSE_MAX_RUN:
+    return "tiempo máximo";
+  case CAUSE_STALE:
+    return "sin lecturas";
+  default:
+    return "inicio";
+  }
+}
+
+#endif